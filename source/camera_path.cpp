@@ -0,0 +1,265 @@
+namespace camera_path
+{
+	// Records the camera pose and the gui selections that change what is drawn, one fixed size record per frame, and replays them.
+	// A replay forces fixed delta time, drops the input and places the camera of every frame before scene_manager::update, so every
+	// replay of a file simulates and draws the same frames whatever the frame rate and the build. The timings of a frame come back
+	// with packets retired later, the GPU ones frames later still; the replay holds its last frame until they are all in or
+	// max_drain_frame_count frames have passed, then writes every frame to camera_path_timings_file_address.
+	// File layout: magic, version, frame count, then the frames.
+	constexpr uint32_t file_magic{ 0x48544150 }; // "PATH"
+	constexpr uint32_t file_version{ 1 };
+	constexpr uint32_t max_drain_frame_count{ 16 };
+
+	enum FrameFlag : uint8_t {
+		FRAME_FLAG_DEPTH_PREPASS			= 1 << 0,
+		FRAME_FLAG_FRONT_TO_BACK_SORTING	= 1 << 1,
+		FRAME_FLAG_FRAME_PIPELINING			= 1 << 2,
+		FRAME_FLAG_OCCLUSION_CULLING		= 1 << 3,
+		FRAME_FLAG_LOD_SELECTION			= 1 << 4,
+		FRAME_FLAG_MESHLET_CULLING			= 1 << 5
+	};
+
+	struct Frame {
+		XMFLOAT3 pos_ws;
+		float yaw_rad;
+		float pitch_rad;
+		uint8_t model_scene_index;
+		uint8_t ibl_environment_index;
+		uint8_t background_env_map_type;
+		uint8_t background_specular_irradiance_mip_level;
+		uint8_t isolation_mode_index;
+		uint8_t draw_submission_mode;
+		uint8_t flags;
+		uint8_t padding;
+	};
+	static_assert(sizeof(Frame) == 28, "Frames are written as they are laid out in memory");
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t num_frames;
+	};
+
+	// Negative until the frame's timing has arrived
+	struct FrameTimings {
+		float frame_ms;
+		float simulation_ms;
+		float render_ms;
+		float gpu_ms;
+	};
+
+	CameraPathMode mode{ CAMERA_PATH_MODE_IDLE };
+	vector<Frame> v_frames;
+	vector<FrameTimings> v_frame_timings;
+	uint32_t num_replayed_frames{ 0 };
+	uint32_t num_drained_frames{ 0 };
+	uint64_t first_replay_frame_number{ 0 };
+	bool was_fixed_delta_time_enabled{ false };
+
+	// The frame count of the header has to match the size of the file, so that a damaged header cannot make it allocate more than the file holds
+	bool load(const string &file_address, vector<Frame> &v_loaded_frames) {
+		v_loaded_frames.clear();
+		ifstream file(file_address, ios::binary | ios::ate);
+		if(!file.is_open()) { return false; }
+		uint64_t file_size = static_cast<uint64_t>(file.tellg());
+		file.seekg(0);
+		FileHeader header = {};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if(!file.good() || header.magic != file_magic || header.version != file_version) { return false; }
+		if(uint64_t(header.num_frames) * sizeof(Frame) != file_size - sizeof(header)) { return false; }
+		v_loaded_frames.resize(header.num_frames);
+		size_t frames_size = sizeof(Frame) * v_loaded_frames.size();
+		file.read(reinterpret_cast<char*>(v_loaded_frames.data()), frames_size);
+		if(!file.good() || static_cast<size_t>(file.gcount()) != frames_size) {
+			v_loaded_frames.clear();
+			return false;
+		}
+		return true;
+	}
+
+	void save(const string &file_address, const vector<Frame> &v_saved_frames) {
+		ofstream file(file_address, ios::binary | ios::trunc);
+		if(!file.is_open()) {
+			throw exception("Camera path could not be written!");
+		}
+		FileHeader header = { file_magic, file_version, static_cast<uint32_t>(v_saved_frames.size()) };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(v_saved_frames.data()), sizeof(Frame) * v_saved_frames.size());
+	}
+
+	// Nearest rank percentiles of the timings that arrived
+	TimingPercentiles get_percentiles(const vector<FrameTimings> &v_timings, float FrameTimings::*p_member) {
+		vector<float> v_ms;
+		v_ms.reserve(v_timings.size());
+		for(const auto& timings : v_timings) {
+			if(timings.*p_member >= 0.f) { v_ms.push_back(timings.*p_member); }
+		}
+		TimingPercentiles percentiles = {};
+		if(v_ms.empty()) { return percentiles; }
+		sort(v_ms.begin(), v_ms.end());
+		auto get_percentile = [&v_ms](float percentile) {
+			size_t rank = static_cast<size_t>(ceil(percentile * 0.01f * v_ms.size()));
+			return v_ms[min(max(rank, size_t(1)), v_ms.size()) - 1];
+		};
+		double sum_ms = 0.0;
+		for(float ms : v_ms) { sum_ms += ms; }
+		percentiles.mean_ms = static_cast<float>(sum_ms / v_ms.size());
+		percentiles.p50_ms = get_percentile(50.f);
+		percentiles.p95_ms = get_percentile(95.f);
+		percentiles.p99_ms = get_percentile(99.f);
+		percentiles.max_ms = v_ms.back();
+		return percentiles;
+	}
+
+	void write_timings(const string &file_address, const vector<FrameTimings> &v_timings) {
+		ofstream file(file_address, ios::trunc);
+		if(!file.is_open()) {
+			throw exception("Camera path timings could not be written!");
+		}
+		file << "frame,frame_ms,simulation_ms,render_ms,gpu_ms\n";
+		for(size_t frame_index = 0; frame_index < v_timings.size(); ++frame_index) {
+			const auto& timings = v_timings[frame_index];
+			file << frame_index << ',' << timings.frame_ms << ',' << timings.simulation_ms << ',' << timings.render_ms << ',' << timings.gpu_ms << '\n';
+		}
+	}
+
+	void finish_replay(GuiData &gui_data) {
+		auto& result = gui_data.camera_path_replay_result;
+		result.num_frames = static_cast<uint32_t>(v_frame_timings.size());
+		result.num_gpu_timed_frames = static_cast<uint32_t>(count_if(v_frame_timings.begin(), v_frame_timings.end(), [](const FrameTimings &timings) { return timings.gpu_ms >= 0.f; }));
+		result.frame = get_percentiles(v_frame_timings, &FrameTimings::frame_ms);
+		result.simulation = get_percentiles(v_frame_timings, &FrameTimings::simulation_ms);
+		result.render = get_percentiles(v_frame_timings, &FrameTimings::render_ms);
+		result.gpu = get_percentiles(v_frame_timings, &FrameTimings::gpu_ms);
+		gui_data.has_camera_path_replay_result = true;
+		gui_data.is_fixed_delta_time_enabled = was_fixed_delta_time_enabled;
+		mode = CAMERA_PATH_MODE_IDLE;
+		write_timings(camera_path_timings_file_address, v_frame_timings);
+	}
+
+	FrameTimings* get_frame_timings(uint64_t frame_number) {
+		if(frame_number < first_replay_frame_number || frame_number - first_replay_frame_number >= v_frame_timings.size()) { return nullptr; }
+		return &v_frame_timings[frame_number - first_replay_frame_number];
+	}
+
+	// The timings of earlier frames that arrived with the packet begin_frame() collected
+	void collect_frame_timings(const GuiData &gui_data) {
+		const auto& statistics = gui_data.frame_pipeline_statistics;
+		if(auto p_timings = get_frame_timings(statistics.frame_number)) {
+			p_timings->simulation_ms = statistics.simulation_ms;
+			p_timings->render_ms = statistics.render_ms;
+		}
+		if(auto p_timings = get_frame_timings(statistics.gpu_frame_number)) {
+			p_timings->gpu_ms = statistics.gpu_ms;
+		}
+	}
+
+	bool has_all_frame_timings() {
+		return all_of(v_frame_timings.begin(), v_frame_timings.end(), [](const FrameTimings &timings) { return timings.render_ms >= 0.f && timings.gpu_ms >= 0.f; });
+	}
+
+	void toggle_recording() {
+		if(mode == CAMERA_PATH_MODE_RECORDING) {
+			save(camera_path_file_address, v_frames);
+			mode = CAMERA_PATH_MODE_IDLE;
+		}
+		else if(mode == CAMERA_PATH_MODE_IDLE) {
+			v_frames.clear();
+			mode = CAMERA_PATH_MODE_RECORDING;
+		}
+	}
+
+	void toggle_replay(GuiData &gui_data, uint64_t frame_number) {
+		if(mode == CAMERA_PATH_MODE_REPLAYING) {
+			gui_data.is_fixed_delta_time_enabled = was_fixed_delta_time_enabled;
+			mode = CAMERA_PATH_MODE_IDLE;
+		}
+		else if(mode == CAMERA_PATH_MODE_IDLE) {
+			if(!load(camera_path_file_address, v_frames) || v_frames.empty()) {
+				v_frames.clear();
+				return;
+			}
+			v_frame_timings.assign(v_frames.size(), { -1.f, -1.f, -1.f, -1.f });
+			num_replayed_frames = 0;
+			num_drained_frames = 0;
+			first_replay_frame_number = frame_number;
+			was_fixed_delta_time_enabled = gui_data.is_fixed_delta_time_enabled;
+			gui_data.has_camera_path_replay_result = false;
+			mode = CAMERA_PATH_MODE_REPLAYING;
+		}
+	}
+
+	void apply_frame(const Frame &frame, GuiData &gui_data) {
+		gui_data.model_scene_index = frame.model_scene_index;
+		gui_data.ibl_environment_index = frame.ibl_environment_index;
+		gui_data.background_env_map_type = frame.background_env_map_type;
+		gui_data.background_specular_irradiance_mip_level = frame.background_specular_irradiance_mip_level;
+		gui_data.isolation_mode_index = frame.isolation_mode_index;
+		gui_data.draw_submission_mode = frame.draw_submission_mode;
+		gui_data.is_depth_prepass_enabled = (frame.flags & FRAME_FLAG_DEPTH_PREPASS) != 0;
+		gui_data.is_front_to_back_sorting_enabled = (frame.flags & FRAME_FLAG_FRONT_TO_BACK_SORTING) != 0;
+		gui_data.is_frame_pipelining_enabled = (frame.flags & FRAME_FLAG_FRAME_PIPELINING) != 0;
+		gui_data.is_occlusion_culling_enabled = (frame.flags & FRAME_FLAG_OCCLUSION_CULLING) != 0;
+		gui_data.is_lod_selection_enabled = (frame.flags & FRAME_FLAG_LOD_SELECTION) != 0;
+		gui_data.is_meshlet_culling_enabled = (frame.flags & FRAME_FLAG_MESHLET_CULLING) != 0;
+
+		gui_data.delta_yaw_rad = 0.f;
+		gui_data.delta_pitch_rad = 0.f;
+		gui_data.is_w_pressed = gui_data.is_s_pressed = gui_data.is_d_pressed = gui_data.is_a_pressed = gui_data.is_e_pressed = gui_data.is_q_pressed = false;
+		gui_data.is_fixed_delta_time_enabled = true;
+		scene_manager::set_camera_pose(frame.pos_ws, frame.yaw_rad, frame.pitch_rad);
+	}
+
+	// Called between gui::update() and scene_manager::update(), the replay overrides the input and selections of the gui here
+	void begin_frame(GuiData &gui_data, uint64_t frame_number) {
+		if(gui_data.is_camera_path_recording_toggle_requested) {
+			toggle_recording();
+			gui_data.is_camera_path_recording_toggle_requested = false;
+		}
+		if(gui_data.is_camera_path_replay_toggle_requested) {
+			toggle_replay(gui_data, frame_number);
+			gui_data.is_camera_path_replay_toggle_requested = false;
+		}
+
+		if(mode == CAMERA_PATH_MODE_REPLAYING) {
+			collect_frame_timings(gui_data);
+			if(num_replayed_frames == v_frames.size() && (has_all_frame_timings() || ++num_drained_frames > max_drain_frame_count)) {
+				finish_replay(gui_data);
+			}
+		}
+		if(mode == CAMERA_PATH_MODE_REPLAYING) {
+			apply_frame(v_frames[min(num_replayed_frames, static_cast<uint32_t>(v_frames.size() - 1))], gui_data);
+		}
+	}
+
+	// Called after scene_manager::update(), which leaves the pose of the camera in gui_data
+	void end_frame(GuiData &gui_data) {
+		if(mode == CAMERA_PATH_MODE_RECORDING) {
+			Frame frame = {};
+			frame.pos_ws = gui_data.camera_pos;
+			frame.yaw_rad = gui_data.camera_yaw;
+			frame.pitch_rad = gui_data.camera_pitch;
+			frame.model_scene_index = static_cast<uint8_t>(gui_data.model_scene_index);
+			frame.ibl_environment_index = static_cast<uint8_t>(gui_data.ibl_environment_index);
+			frame.background_env_map_type = static_cast<uint8_t>(gui_data.background_env_map_type);
+			frame.background_specular_irradiance_mip_level = static_cast<uint8_t>(gui_data.background_specular_irradiance_mip_level);
+			frame.isolation_mode_index = static_cast<uint8_t>(gui_data.isolation_mode_index);
+			frame.draw_submission_mode = static_cast<uint8_t>(gui_data.draw_submission_mode);
+			frame.flags = static_cast<uint8_t>((gui_data.is_depth_prepass_enabled ? FRAME_FLAG_DEPTH_PREPASS : 0) |
+				(gui_data.is_front_to_back_sorting_enabled ? FRAME_FLAG_FRONT_TO_BACK_SORTING : 0) |
+				(gui_data.is_frame_pipelining_enabled ? FRAME_FLAG_FRAME_PIPELINING : 0) |
+				(gui_data.is_occlusion_culling_enabled ? FRAME_FLAG_OCCLUSION_CULLING : 0) |
+				(gui_data.is_lod_selection_enabled ? FRAME_FLAG_LOD_SELECTION : 0) |
+				(gui_data.is_meshlet_culling_enabled ? FRAME_FLAG_MESHLET_CULLING : 0));
+			v_frames.push_back(frame);
+		}
+		else if(mode == CAMERA_PATH_MODE_REPLAYING && num_replayed_frames < v_frames.size()) {
+			v_frame_timings[num_replayed_frames].frame_ms = gui_data.frame_timing_statistics.delta_ms;
+			num_replayed_frames++;
+		}
+
+		gui_data.camera_path_mode = mode;
+		gui_data.num_camera_path_frames = static_cast<uint32_t>(v_frames.size());
+		gui_data.num_replayed_camera_path_frames = num_replayed_frames;
+	}
+} // namespace camera_path
@@ -9,13 +9,21 @@ inline void check_win32_call(HANDLE h) {
 template <typename T, uint32_t N>
 constexpr uint32_t count_of(T(&)[N]) { return N; }
 
+// Wall clock time of one call in milliseconds, benchmarks keep the minimum over their iterations
+template <typename F>
+float measure_ms(F function) {
+	auto start = chrono::high_resolution_clock::now();
+	function();
+	return chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
 constexpr DXGI_FORMAT	back_buffer_format{ DXGI_FORMAT_R8G8B8A8_UNORM };
 constexpr uint32_t		max_texture_count{ 128 };
 constexpr uint32_t		max_mesh_count{ 64 };
 constexpr float			mip_lod_bias{ -0.5f };
 constexpr uint16_t		max_transformation_count_per_scene{ 128 };
 constexpr uint16_t		max_material_count_per_scene{ 32 };
-constexpr uint16_t		max_descriptor_count_per_frame{ 128 };
+constexpr uint32_t		max_srv_descriptor_count{ 4096 };
 uint16_t				back_buffer_width{ 1280 };
 uint16_t				back_buffer_height{ 720 };
 constexpr uint8_t		ms_count{ 8 };
@@ -23,11 +31,252 @@ constexpr uint8_t		ms_quality{ 0 };
 constexpr uint8_t		max_anisotropy{ 16 };
 constexpr uint8_t		max_inflight_frame_count{ 3 };
 constexpr uint8_t		num_descriptor_per_environment{ 3 };
+constexpr uint8_t		max_recording_thread_count{ 4 };
+constexpr uint8_t		max_worker_command_list_count{ 2 * max_recording_thread_count };
+constexpr uint32_t		min_draw_count_per_recording_thread{ 256 };
+constexpr uint32_t		min_vertex_count_per_tangent_thread{ 16 * 1024 };
+constexpr uint32_t		max_indirect_draw_count{ 4096 };
+constexpr uint32_t		max_indirect_range_count{ 64 };
+constexpr uint32_t		max_instance_count_per_scene{ 4096 };
 constexpr bool			is_msaa_enabled{ true };
 bool					is_mipchain_generation_enabled = true;
 
 const string asset_folder{ "../assets/" };
 const string shader_folder{ "../source/shaders/" };
+const string pipeline_cache_file_address{ "pipeline_cache.bin" };
+const string texture_cache_folder{ "texture_cache/" };
+const string camera_path_file_address{ "camera_path.bin" };
+const string camera_path_timings_file_address{ "camera_path_timings.csv" };
+constexpr uint64_t		max_texture_cache_size{ 2048ull * 1024 * 1024 };
+
+enum DrawSubmissionMode : uint32_t {
+	DRAW_SUBMISSION_DIRECT,
+	DRAW_SUBMISSION_INDIRECT,
+	DRAW_SUBMISSION_INDIRECT_CPU_CULLED,
+	DRAW_SUBMISSION_INDIRECT_GPU_CULLED
+};
+
+// Placed resources are sub-allocated from the heaps of these pools, see heap_allocator.cpp
+enum HeapPool : uint32_t {
+	HEAP_POOL_BUFFERS,
+	HEAP_POOL_UPLOAD_BUFFERS,
+	HEAP_POOL_SMALL_TEXTURES,
+	HEAP_POOL_TEXTURES,
+	HEAP_POOL_RENDER_TARGETS
+};
+constexpr uint32_t		heap_pool_count{ 5 };
+
+struct HeapStatistics {
+	uint32_t num_pages;
+	uint32_t num_allocations;
+	uint32_t num_free_blocks;
+	uint64_t reserved_size;
+	uint64_t allocated_size;
+	uint64_t largest_free_block_size;
+};
+
+struct ResidencyStatistics {
+	uint32_t num_pageables;
+	uint32_t num_resident_pageables;
+	uint64_t resident_size;
+	uint64_t registered_size;
+	uint64_t num_evictions;
+	uint64_t num_make_residents;
+	// Filled by the renderer: what the resident pageables may occupy, and the OS budget and usage of the whole process
+	uint64_t budget;
+	uint64_t os_budget;
+	uint64_t os_usage;
+};
+
+constexpr uint32_t		max_job_benchmark_scaling_step_count{ 8 };
+
+struct JobSystemScalingStep {
+	uint32_t num_batches;
+	float parallel_for_ms;
+};
+
+struct JobSystemBenchmarkResult {
+	uint32_t num_workers;
+	// run() and wait() per empty job, and per task of a chain in which every task depends on the previous one
+	float empty_job_ns;
+	float task_chain_ns;
+	uint32_t num_scaling_steps;
+	JobSystemScalingStep a_scaling_steps[max_job_benchmark_scaling_step_count];
+};
+
+struct IndirectDrawStatistics {
+	// Opaque draws of the frame, those the indirect buffers held and those past their capacity that were drawn directly
+	uint32_t num_draws;
+	uint32_t num_indirect_draws;
+	uint32_t num_direct_draws;
+	// One ExecuteIndirect per run of draws with the same pipeline state
+	uint32_t num_ranges;
+};
+
+enum OcclusionIsa : uint32_t {
+	OCCLUSION_ISA_SSE,
+	OCCLUSION_ISA_AVX2
+};
+constexpr uint32_t		occlusion_isa_count{ 2 };
+
+struct OcclusionCullingStatistics {
+	uint32_t num_occluder_triangles;
+	uint32_t num_draws;
+	uint32_t num_culled_draws;
+	float rasterize_ms;
+	float test_ms;
+	bool is_avx2_used;
+};
+
+struct OcclusionBenchmarkResult {
+	bool is_avx2_supported;
+	// The current scene from the current camera
+	uint32_t num_occluder_triangles;
+	uint32_t num_draws;
+	uint32_t num_culled_draws;
+	float a_rasterize_ms[occlusion_isa_count];
+	float a_test_ms[occlusion_isa_count];
+};
+
+// Levels of detail of a primitive including the primitive itself
+constexpr uint32_t		max_lod_count{ 6 };
+
+struct LodSelectionStatistics {
+	// Triangles of the draws left to render, instances included, at full detail and at the LODs they were drawn with
+	uint32_t num_full_triangles;
+	uint32_t num_selected_triangles;
+	uint32_t a_num_draws_per_lod[max_lod_count];
+};
+
+struct SimplificationBenchmarkResult {
+	uint32_t num_meshes;
+	uint32_t num_triangles;
+	uint32_t num_workers;
+	float single_thread_ms;
+	float multi_thread_ms;
+	// The LODs of the current scene, built when it was loaded
+	uint32_t num_scene_lods;
+	uint32_t a_num_scene_triangles[max_lod_count];
+	float scene_lod_build_ms;
+};
+
+struct MeshletCullingStatistics {
+	// Meshlets of the draws that were split into meshlets, the triangles in them and those left in the drawn index ranges
+	uint32_t num_meshlets;
+	uint32_t num_frustum_culled_meshlets;
+	uint32_t num_backface_culled_meshlets;
+	uint32_t num_triangles;
+	uint32_t num_drawn_triangles;
+	uint32_t num_ranges;
+	float cull_ms;
+};
+
+struct MeshletBenchmarkResult {
+	uint32_t num_meshes;
+	uint32_t num_triangles;
+	uint32_t num_meshlets;
+	uint32_t num_workers;
+	float single_thread_ms;
+	float multi_thread_ms;
+	// Culling every meshlet of the meshes from one of num_views eyes around them, with backface culling
+	uint32_t num_views;
+	float cull_ms;
+	// The meshlets of the current scene's LODs, built when it was loaded
+	uint32_t num_scene_meshlets;
+	uint32_t num_scene_triangles;
+	float scene_meshlet_build_ms;
+};
+
+struct TextureCacheStatistics {
+	// Scene textures found in the textures of earlier scenes, found on disk, or decoded and processed
+	uint32_t num_memory_hits;
+	uint32_t num_disk_hits;
+	uint32_t num_misses;
+	uint32_t num_stored_files;
+	// Files in the cache folder after the last eviction
+	uint32_t num_files;
+	uint32_t num_evicted_files;
+	uint64_t disk_size;
+};
+
+// Best times of the mapped gltf_loader path and of tinygltf for one file
+struct GltfLoadTiming {
+	// Everything load_scene waits for: the mapped path decodes images in parallel after loading, tinygltf decodes them one by one while loading
+	float mapped_load_ms;
+	float tinygltf_load_ms;
+	// Wall time of the parallel decode stage within mapped_load_ms
+	float mapped_image_decode_ms;
+	// Without image decoding: JSON parsing and buffer access only
+	float mapped_parse_ms;
+	float tinygltf_parse_ms;
+	// Buffer bytes tinygltf copies into process memory, mapped buffers are paged in from the file on demand instead
+	uint64_t tinygltf_buffer_bytes_copied;
+};
+
+// Time spent on one glTF image by the parallel decode stage
+struct ImageDecodeTiming {
+	char name[48];
+	uint32_t width;
+	uint32_t height;
+	// Channels of the encoded image, 3 channel images are expanded to rgba
+	uint32_t num_source_channels;
+	float decode_ms;
+	float expand_ms;
+};
+
+constexpr uint32_t		model_scene_count{ 4 };
+constexpr uint32_t		max_image_decode_timing_count{ 128 };
+constexpr uint32_t		frame_packet_count{ 2 };
+constexpr uint32_t		frame_timing_history_count{ 256 };
+
+struct FrameTimingStatistics {
+	float delta_ms;
+	float smoothed_delta_ms;
+	uint32_t num_fixed_steps;
+	float simulated_time_s;
+	bool is_fixed_delta_enabled;
+	// Wall clock time of the last frames, the oldest at next_history_index
+	float a_delta_ms_history[frame_timing_history_count];
+	uint32_t next_history_index;
+};
+constexpr uint32_t		default_max_frame_latency{ 1 };
+
+struct FramePipelineStatistics {
+	// Simulation is input sampling to submitting the packet, rendering is taking the packet to Present() returning
+	float simulation_ms;
+	float render_ms;
+	// From sampling the input of a frame to presenting it, smoothed over recent frames, and a peak that decays at the same rate
+	float input_to_present_ms;
+	float max_input_to_present_ms;
+	// The frame simulation_ms and render_ms were measured on, and the GPU time of an older one, the GPU runs frames behind
+	uint64_t frame_number;
+	uint64_t gpu_frame_number;
+	float gpu_ms;
+};
+
+enum CameraPathMode : uint32_t {
+	CAMERA_PATH_MODE_IDLE,
+	CAMERA_PATH_MODE_RECORDING,
+	CAMERA_PATH_MODE_REPLAYING
+};
+
+struct TimingPercentiles {
+	float mean_ms;
+	float p50_ms;
+	float p95_ms;
+	float p99_ms;
+	float max_ms;
+};
+
+struct CameraPathReplayResult {
+	uint32_t num_frames;
+	uint32_t num_gpu_timed_frames;
+	// Frame is the wall clock time between two frames, simulation and rendering are as in FramePipelineStatistics
+	TimingPercentiles frame;
+	TimingPercentiles simulation;
+	TimingPercentiles render;
+	TimingPercentiles gpu;
+};
 
 struct GuiData {
 	float view_azimuth_angle_in_degrees;
@@ -44,11 +293,75 @@ struct GuiData {
 	bool is_e_pressed;
 	bool is_q_pressed;
 
+	// frame timing
+	bool is_fixed_delta_time_enabled;
+	FrameTimingStatistics frame_timing_statistics;
+
+	// frame pipeline
+	bool is_frame_pipelining_enabled;
+	uint32_t max_frame_latency;
+	FramePipelineStatistics frame_pipeline_statistics;
+
+	// camera path
+	bool is_camera_path_recording_toggle_requested;
+	bool is_camera_path_replay_toggle_requested;
+	CameraPathMode camera_path_mode;
+	uint32_t num_camera_path_frames;
+	uint32_t num_replayed_camera_path_frames;
+	bool has_camera_path_replay_result;
+	CameraPathReplayResult camera_path_replay_result;
+
 	// view
 	uint32_t isolation_mode_index;
 
+	// rendering
+	uint32_t draw_submission_mode;
+	IndirectDrawStatistics indirect_draw_statistics;
+	bool is_depth_prepass_enabled;
+	bool is_front_to_back_sorting_enabled;
+	bool is_sort_benchmark_requested;
+	uint32_t sort_benchmark_num_keys;
+	float sort_benchmark_radix_sort_ms;
+	float sort_benchmark_std_sort_ms;
+	bool is_job_benchmark_requested;
+	JobSystemBenchmarkResult job_benchmark_result;
+	bool is_occlusion_culling_enabled;
+	OcclusionCullingStatistics occlusion_culling_statistics;
+	bool is_occlusion_benchmark_requested;
+	bool is_occlusion_benchmark_done;
+	OcclusionBenchmarkResult occlusion_benchmark_result;
+	bool is_lod_selection_enabled;
+	float lod_error_threshold_px;
+	LodSelectionStatistics lod_selection_statistics;
+	bool is_simplification_benchmark_requested;
+	bool is_simplification_benchmark_done;
+	SimplificationBenchmarkResult simplification_benchmark_result;
+	bool is_meshlet_culling_enabled;
+	MeshletCullingStatistics meshlet_culling_statistics;
+	bool is_meshlet_benchmark_requested;
+	bool is_meshlet_benchmark_done;
+	MeshletBenchmarkResult meshlet_benchmark_result;
+
+	// memory
+	bool is_heap_defragmentation_requested;
+	HeapStatistics a_heap_statistics[heap_pool_count];
+	bool is_residency_budget_simulated;
+	uint32_t simulated_residency_budget_in_mb;
+	ResidencyStatistics residency_statistics;
+	TextureCacheStatistics texture_cache_statistics;
+
 	// model
 	uint32_t model_scene_index;
+	float a_scene_load_ms[model_scene_count];
+	bool a_is_scene_mapped[model_scene_count];
+	// Images decoded by the scene loads, the comparison below decodes every image again
+	uint32_t a_num_scene_image_decode_timings[model_scene_count];
+	ImageDecodeTiming a_scene_image_decode_timings[model_scene_count][max_image_decode_timing_count];
+	bool is_gltf_load_comparison_requested;
+	bool is_gltf_load_comparison_done;
+	GltfLoadTiming a_gltf_load_timings[model_scene_count];
+	uint32_t a_num_image_decode_timings[model_scene_count];
+	ImageDecodeTiming a_image_decode_timings[model_scene_count][max_image_decode_timing_count];
 
 	// image based lighting
 	uint32_t ibl_environment_index;
@@ -64,18 +377,30 @@ struct GuiData {
 	XMFLOAT3 camera_pos;
 };
 
+// Material features a pbs_ps.hlsl permutation is compiled for, must match the FEATURE_* defines in pbs_ps.hlsl
+enum ShaderFeature : uint32_t {
+	SHADER_FEATURE_BASE_COLOR_TEXTURE			= 1 << 0,
+	SHADER_FEATURE_NORMAL_TEXTURE				= 1 << 1,
+	SHADER_FEATURE_METALLIC_ROUGHNESS_TEXTURE	= 1 << 2,
+	SHADER_FEATURE_EMISSIVE_TEXTURE				= 1 << 3,
+	SHADER_FEATURE_ALPHA_MASK					= 1 << 4
+};
+constexpr uint32_t		shader_permutation_count{ 32 };
+
 struct Vertex {
 	XMFLOAT3 pos;
 	XMFLOAT3 normal;
 	XMFLOAT2 uv;
+	XMFLOAT4 tangent; // w is the sign of the bitangent, cross(normal, tangent.xyz) * w
 };
 
+// Copied as is into the material constant buffer, layout must match MaterialData in pbs_ps.hlsl and depth_ps.hlsl
 __declspec(align(16)) struct Material {
-	enum AlphaMode { ALPHAMODE_OPAQUE, ALPHAMODE_MASK, ALPHAMODE_BLEND };
+	enum AlphaMode : int32_t { ALPHAMODE_OPAQUE, ALPHAMODE_MASK, ALPHAMODE_BLEND };
 	XMFLOAT4 basecolor_factor{ 1.0f, 1.0f, 1.0f, 1.0f };
 	float metallic_factor{ 1.0f };
 	float roughness_factor{ 1.0f };
-	float alpha_cutoff{ 1.0f };
+	float alpha_cutoff{ 0.5f };
 
 	int base_color_texture_index{ -1 };
 	int normal_texture_index{ -1 };
@@ -83,14 +408,40 @@ __declspec(align(16)) struct Material {
 	int emissive_texture_index{ -1 };
 	int occlusion_texture_index{ -1 };
 	AlphaMode alphaMode{ ALPHAMODE_OPAQUE };
+	uint32_t shader_permutation{ 0 };
+	int a_padding[2]{};
 };
 
+static_assert(offsetof(Material, basecolor_factor) == 0, "Material layout must match MaterialData in HLSL");
+static_assert(offsetof(Material, metallic_factor) == 16, "Material layout must match MaterialData in HLSL");
+static_assert(offsetof(Material, roughness_factor) == 20, "Material layout must match MaterialData in HLSL");
+static_assert(offsetof(Material, alpha_cutoff) == 24, "Material layout must match MaterialData in HLSL");
+static_assert(offsetof(Material, base_color_texture_index) == 28, "Material layout must match MaterialData in HLSL");
+static_assert(offsetof(Material, normal_texture_index) == 32, "Material layout must match MaterialData in HLSL");
+static_assert(offsetof(Material, metallic_roughness_texture_index) == 36, "Material layout must match MaterialData in HLSL");
+static_assert(offsetof(Material, emissive_texture_index) == 40, "Material layout must match MaterialData in HLSL");
+static_assert(offsetof(Material, occlusion_texture_index) == 44, "Material layout must match MaterialData in HLSL");
+static_assert(offsetof(Material, alphaMode) == 48, "Material layout must match MaterialData in HLSL");
+static_assert(offsetof(Material, shader_permutation) == 52, "Material layout must match MaterialData in HLSL");
+static_assert(sizeof(Material) == 64, "Material must match the 16 byte aligned array stride of MaterialData in HLSL");
+
 struct DrawInfo {
 	uint32_t mesh_index;
 	uint32_t transformation_index;
 	uint32_t material_index;
 	uint32_t draw_index_count;
 	uint32_t draw_first_index;
+	int32_t draw_base_vertex;
+	uint32_t first_instance;
+	uint32_t instance_count;
+	XMFLOAT3 bbox_center_ws;
+	XMFLOAT3 bbox_extents_ws;
+	// Index ranges of the primitive's LODs in scene_manager, and the world space diagonal their relative errors scale with
+	uint32_t first_lod;
+	uint32_t lod_count;
+	float lod_size_ws;
+	// The LOD the draw's index range is of, picked by LOD selection
+	uint32_t lod_level;
 };
 
 struct Camera {
@@ -112,22 +463,49 @@ struct Camera {
 	float far_plane_in_meters;
 };
 
+// One simulated frame as the render thread sees it. The simulation thread fills a packet and does not touch it again until the
+// render thread has presented it, so scene state that changes every frame is copied here instead of being read from scene_manager.
+struct FramePacket {
+	uint64_t frame_number;
+	int64_t input_sample_ticks;
+	int64_t submit_ticks;
+	int64_t render_start_ticks;
+	int64_t present_ticks;
+	// GPU time of an earlier frame whose timestamps were read back while this one was rendered, 0 when there was none
+	uint64_t gpu_frame_number;
+	float gpu_ms;
+	GuiData gui_data;
+	Camera camera;
+	uint32_t scene_index;
+	// With occlusion culling, LOD selection or meshlet culling the opaque draws of the frame are in v_opaque_draws, in the scene's order
+	bool has_opaque_draws;
+	vector<DrawInfo> v_opaque_draws;
+	vector<DrawInfo> v_front_to_back_opaque_draws;
+	vector<DrawInfo> v_sorted_alpha_blend_draws;
+	vector<ImDrawList*> v_p_gui_draw_lists;
+};
+
 namespace gui { 
 	GuiData&				get_data(); 
 }
 
+namespace frame_pipeline {
+	bool resize(LPARAM lparam);
+}
+
 namespace renderer {
 	ID3D12Device*				get_device();
 	ID3D12GraphicsCommandList*	get_command_list();
 	pair<D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_GPU_DESCRIPTOR_HANDLE> get_handles_for_a_srv_desc();
 	bool resize(LPARAM lparam);
+	void prepare_shader_permutation(const Material &material);
+	uint32_t get_texture_descriptor_index(uint32_t tex_index);
 }
 
 namespace scene_manager {
-	const vector<DrawInfo>&		get_opaque_draw_list();
-	const vector<DrawInfo>&		get_alpha_blend_draw_list();
-	const vector<XMFLOAT4X4>&	get_transformation_list();
-	const vector<Material>&		get_material_list();
-	const Camera&				get_camera();
-	pair<uint32_t, uint32_t>	get_scene_texture_usage();
+	const vector<DrawInfo>&		get_opaque_draw_list(uint32_t scene_index);
+	const vector<DrawInfo>&		get_alpha_blend_draw_list(uint32_t scene_index);
+	const vector<uint32_t>&		get_instance_transform_index_list(uint32_t scene_index);
+	const vector<XMFLOAT4X4>&	get_transformation_list(uint32_t scene_index);
+	const vector<Material>&		get_material_list(uint32_t scene_index);
 }
\ No newline at end of file
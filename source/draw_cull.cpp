@@ -0,0 +1,54 @@
+namespace draw_cull
+{
+	// Layout must match IndirectCommand in cull_cs.hlsl and the argument order of the renderer's draw command signature
+	struct IndirectCommand {
+		uint32_t first_instance_index;
+		uint32_t material_index;
+		D3D12_VERTEX_BUFFER_VIEW vbv;
+		D3D12_INDEX_BUFFER_VIEW ibv;
+		D3D12_DRAW_INDEXED_ARGUMENTS draw_arguments;
+	};
+	static_assert(sizeof(IndirectCommand) == 64, "IndirectCommand must match the HLSL layout");
+
+	struct DrawBounds {
+		XMFLOAT4 center_ws;
+		XMFLOAT4 extents_ws;
+	};
+
+	// Gribb-Hartmann plane extraction for the post-multiplied clip_from_world matrix, planes point inwards
+	void extract_frustum_planes(const Camera &camera, XMFLOAT4 a_planes[6]) {
+		XMMATRIX xm_clip_from_world = XMMatrixMultiply(XMLoadFloat4x4(&camera.clip_from_view), XMLoadFloat4x4(&camera.view_from_world));
+		XMVECTOR xm_row_x = xm_clip_from_world.r[0];
+		XMVECTOR xm_row_y = xm_clip_from_world.r[1];
+		XMVECTOR xm_row_z = xm_clip_from_world.r[2];
+		XMVECTOR xm_row_w = xm_clip_from_world.r[3];
+
+		XMVECTOR a_xm_planes[6] = {
+			xm_row_w + xm_row_x, xm_row_w - xm_row_x,
+			xm_row_w + xm_row_y, xm_row_w - xm_row_y,
+			xm_row_z,            xm_row_w - xm_row_z
+		};
+		for(uint32_t plane_index = 0; plane_index < 6; ++plane_index) {
+			XMStoreFloat4(&a_planes[plane_index], XMPlaneNormalize(a_xm_planes[plane_index]));
+		}
+	}
+
+	// CPU emulation of cull_cs.hlsl, keeps the input order where the GPU version appends in arbitrary order
+	uint32_t cull_draws(const XMFLOAT4 a_planes[6], const IndirectCommand *p_src_commands, const DrawBounds *p_bounds, uint32_t num_draws, IndirectCommand *p_dst_commands) {
+		uint32_t num_visible_draws = 0;
+		for(uint32_t draw_index = 0; draw_index < num_draws; ++draw_index) {
+			const auto& bounds = p_bounds[draw_index];
+			bool is_visible = true;
+			for(uint32_t plane_index = 0; plane_index < 6 && is_visible; ++plane_index) {
+				const auto& plane = a_planes[plane_index];
+				float distance = plane.x * bounds.center_ws.x + plane.y * bounds.center_ws.y + plane.z * bounds.center_ws.z + plane.w;
+				float radius = abs(plane.x) * bounds.extents_ws.x + abs(plane.y) * bounds.extents_ws.y + abs(plane.z) * bounds.extents_ws.z;
+				is_visible = (distance + radius) >= 0.0f;
+			}
+			if(is_visible) {
+				p_dst_commands[num_visible_draws++] = p_src_commands[draw_index];
+			}
+		}
+		return num_visible_draws;
+	}
+} // namespace draw_cull
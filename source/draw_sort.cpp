@@ -0,0 +1,127 @@
+namespace draw_sort
+{
+	// 64-bit draw key layout, most significant first:
+	// opaque:		[pass:2][pso:6][mesh:8][material:16][depth:32]
+	// batch:		[pass:2][pso:6][mesh:8][material:16][first index:32]
+	// depth:		[pass:2][pso:6][unused:24][depth:32]
+	// alpha blend:	[pass:2][unused:30][inverted depth:32]
+	enum DrawPass : uint64_t { DRAW_PASS_OPAQUE = 0, DRAW_PASS_ALPHA_BLEND = 1 };
+	static_assert(shader_permutation_count <= 64 && max_mesh_count <= 256, "Draw key fields are too narrow");
+
+	// Maps a float to an unsigned integer with the same ordering, negative values included
+	inline uint32_t float_to_sortable_uint(float value) {
+		uint32_t bits = *reinterpret_cast<uint32_t*>(&value);
+		return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	}
+
+	inline uint64_t make_opaque_draw_key(uint32_t pso_index, uint32_t mesh_index, uint32_t material_index, float view_depth) {
+		return (uint64_t(DRAW_PASS_OPAQUE) << 62) |
+			(uint64_t(pso_index & 0x3F) << 56) |
+			(uint64_t(mesh_index & 0xFF) << 48) |
+			(uint64_t(material_index & 0xFFFF) << 32) |
+			uint64_t(float_to_sortable_uint(view_depth));
+	}
+
+	// Every mesh lives in the one merged buffer, so the index range is what tells primitives apart and makes equal ranges adjacent for merging
+	inline uint64_t make_opaque_batch_key(uint32_t pso_index, uint32_t mesh_index, uint32_t material_index, uint32_t first_index) {
+		return (uint64_t(DRAW_PASS_OPAQUE) << 62) |
+			(uint64_t(pso_index & 0x3F) << 56) |
+			(uint64_t(mesh_index & 0xFF) << 48) |
+			(uint64_t(material_index & 0xFFFF) << 32) |
+			uint64_t(first_index);
+	}
+
+	// Front to back within each pso, used by the depth pre-pass and early-z friendly opaque ordering
+	inline uint64_t make_depth_draw_key(uint32_t pso_index, float view_depth) {
+		return (uint64_t(DRAW_PASS_OPAQUE) << 62) |
+			(uint64_t(pso_index & 0x3F) << 56) |
+			uint64_t(float_to_sortable_uint(view_depth));
+	}
+
+	// Back to front: the farthest draw gets the smallest key
+	inline uint64_t make_alpha_blend_draw_key(float view_depth) {
+		return (uint64_t(DRAW_PASS_ALPHA_BLEND) << 62) | uint64_t(~float_to_sortable_uint(view_depth));
+	}
+
+	// LSD radix sort over 8-bit digits, stable, sorts the indices along with the keys.
+	// Digits that are identical for every key are skipped, so short or partially used keys only pay for the bits they use.
+	void radix_sort(vector<uint64_t> &keys, vector<uint32_t> &indices, vector<uint64_t> &scratch_keys, vector<uint32_t> &scratch_indices) {
+		size_t num_keys = keys.size();
+		scratch_keys.resize(num_keys);
+		scratch_indices.resize(num_keys);
+		if(num_keys < 2) { return; }
+
+		uint32_t a_histograms[8][256] = {};
+		for(auto key : keys) {
+			for(uint32_t digit_index = 0; digit_index < 8; ++digit_index) {
+				a_histograms[digit_index][(key >> (digit_index * 8)) & 0xFF]++;
+			}
+		}
+
+		uint64_t *p_src_keys = keys.data();
+		uint32_t *p_src_indices = indices.data();
+		uint64_t *p_dst_keys = scratch_keys.data();
+		uint32_t *p_dst_indices = scratch_indices.data();
+		for(uint32_t digit_index = 0; digit_index < 8; ++digit_index) {
+			uint32_t *p_histogram = a_histograms[digit_index];
+			uint32_t shift = digit_index * 8;
+			if(p_histogram[(p_src_keys[0] >> shift) & 0xFF] == num_keys) { continue; }
+
+			uint32_t offset = 0;
+			for(uint32_t bucket_index = 0; bucket_index < 256; ++bucket_index) {
+				uint32_t count = p_histogram[bucket_index];
+				p_histogram[bucket_index] = offset;
+				offset += count;
+			}
+
+			for(size_t key_index = 0; key_index < num_keys; ++key_index) {
+				uint64_t key = p_src_keys[key_index];
+				uint32_t dst_index = p_histogram[(key >> shift) & 0xFF]++;
+				p_dst_keys[dst_index] = key;
+				p_dst_indices[dst_index] = p_src_indices[key_index];
+			}
+			swap(p_src_keys, p_dst_keys);
+			swap(p_src_indices, p_dst_indices);
+		}
+
+		if(p_src_keys != keys.data()) {
+			memcpy(keys.data(), p_src_keys, num_keys * sizeof(uint64_t));
+			memcpy(indices.data(), p_src_indices, num_keys * sizeof(uint32_t));
+		}
+	}
+
+	struct BenchmarkResult {
+		uint32_t num_keys;
+		float radix_sort_ms;
+		float std_sort_ms;
+	};
+
+	// Sorts num_keys random opaque-style keys with radix_sort and std::sort, best of num_iterations
+	BenchmarkResult run_benchmark(uint32_t num_keys = 100000, uint32_t num_iterations = 10) {
+		vector<uint64_t> source_keys(num_keys);
+		uint64_t state = 0x9E3779B97F4A7C15ull;
+		for(auto &key : source_keys) {
+			state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+			key = make_opaque_draw_key(uint32_t(state & 0x3), uint32_t((state >> 8) & 0xFF), uint32_t((state >> 20) & 0x1F), float(state >> 40) * 1e-6f);
+		}
+
+		vector<uint64_t> keys, scratch_keys;
+		vector<uint32_t> indices(num_keys), scratch_indices;
+		BenchmarkResult result = { num_keys, FLT_MAX, FLT_MAX };
+		for(uint32_t iteration = 0; iteration < num_iterations; ++iteration) {
+			keys = source_keys;
+			for(uint32_t i = 0; i < num_keys; ++i) { indices[i] = i; }
+			auto start = chrono::high_resolution_clock::now();
+			radix_sort(keys, indices, scratch_keys, scratch_indices);
+			auto end = chrono::high_resolution_clock::now();
+			result.radix_sort_ms = min(result.radix_sort_ms, chrono::duration<float, milli>(end - start).count());
+
+			keys = source_keys;
+			start = chrono::high_resolution_clock::now();
+			sort(keys.begin(), keys.end());
+			end = chrono::high_resolution_clock::now();
+			result.std_sort_ms = min(result.std_sort_ms, chrono::duration<float, milli>(end - start).count());
+		}
+		return result;
+	}
+} // namespace draw_sort
@@ -29,7 +29,6 @@ static ImGuiMouseCursor             g_LastMouseCursor = ImGuiMouseCursor_COUNT;
 
 // DirectX data
 static ID3D12Device*                g_pd3dDevice = NULL;
-static ID3D12GraphicsCommandList*   g_pd3dCommandList = NULL;
 static ID3D10Blob*                  g_pVertexShaderBlob = NULL;
 static ID3D10Blob*                  g_pPixelShaderBlob = NULL;
 static ID3D12RootSignature*         g_pRootSignature = NULL;
@@ -57,7 +56,7 @@ struct VERTEX_CONSTANT_BUFFER
 
 // Render function
 // (this used to be set in io.RenderDrawListsFn and called by ImGui::Render(), but you can now call this directly from your main loop)
-void ImGui_ImplDX12_RenderDrawData(ImDrawData* draw_data)
+void ImGui_ImplDX12_RenderDrawData(ImDrawData* draw_data, ID3D12GraphicsCommandList* command_list)
 {
     // NOTE: I'm assuming that this only get's called once per frame!
     // If not, we can't just re-allocate the IB or VB, we'll have to do a proper allocator.
@@ -67,7 +66,7 @@ void ImGui_ImplDX12_RenderDrawData(ImDrawData* draw_data)
     ID3D12Resource* g_pIB = frameResources->IB;
     int g_VertexBufferSize = frameResources->VertexBufferSize;
     int g_IndexBufferSize = frameResources->IndexBufferSize;
-    ID3D12GraphicsCommandList* ctx = g_pd3dCommandList;
+    ID3D12GraphicsCommandList* ctx = command_list;
 
     // Create and grow vertex/index buffers if needed
     if (!g_pVB || g_VertexBufferSize < draw_data->TotalVtxCount)
@@ -764,7 +763,6 @@ void ImGui_ImplDX12_Shutdown()
     delete[] g_pFrameResources;
     g_pd3dDevice = NULL;
     g_hWnd = (HWND)0;
-    g_pd3dCommandList = NULL;
     g_hFontSrvCpuDescHandle.ptr = 0;
     g_hFontSrvGpuDescHandle.ptr = 0;
     g_pFrameResources = NULL;
@@ -772,13 +770,11 @@ void ImGui_ImplDX12_Shutdown()
     g_frameIndex = UINT_MAX;
 }
 
-void ImGui_ImplDX12_NewFrame(ID3D12GraphicsCommandList* command_list)
+void ImGui_ImplDX12_NewFrame()
 {
     if (!g_pPipelineState)
         ImGui_ImplDX12_CreateDeviceObjects();
 
-    g_pd3dCommandList = command_list;
-
     ImGuiIO& io = ImGui::GetIO();
 
     // Setup display size (every frame to accommodate for window resizing)
@@ -25,8 +25,8 @@ IMGUI_API bool        ImGui_ImplDX12_Init(void* hwnd, int num_frames_in_flight,
                                           D3D12_CPU_DESCRIPTOR_HANDLE font_srv_cpu_desc_handle,
                                           D3D12_GPU_DESCRIPTOR_HANDLE font_srv_gpu_desc_handle);
 IMGUI_API void        ImGui_ImplDX12_Shutdown();
-IMGUI_API void        ImGui_ImplDX12_NewFrame(ID3D12GraphicsCommandList* cmd_list);
-IMGUI_API void        ImGui_ImplDX12_RenderDrawData(ImDrawData* draw_data);
+IMGUI_API void        ImGui_ImplDX12_NewFrame();
+IMGUI_API void        ImGui_ImplDX12_RenderDrawData(ImDrawData* draw_data, ID3D12GraphicsCommandList* cmd_list);
 
 // Use if you want to reset your rendering device without losing ImGui state.
 IMGUI_API void        ImGui_ImplDX12_InvalidateDeviceObjects();
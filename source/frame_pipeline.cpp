@@ -0,0 +1,162 @@
+namespace frame_pipeline
+{
+	// Simulation runs on the thread that owns the window, recording and presenting on a render thread of its own.
+	// Frame n is simulated into packet n % frame_packet_count and rendered from it, so while the render thread records frame n the
+	// simulation already fills frame n + 1 and a frame costs the longer of the two instead of their sum. With pipelining disabled
+	// the simulation waits for every frame to be presented before it starts the next one, as the serial loop did.
+	// Before pumping messages the simulation also waits on the swap chain's frame latency object, input is sampled only once
+	// a frame can be queued without waiting behind more than max_frame_latency others.
+	constexpr DWORD frame_latency_timeout_ms{ 100 };
+	constexpr float latency_smoothing_factor{ 0.1f };
+
+	array<FramePacket, frame_packet_count> a_frame_packets;
+	uint64_t num_submitted_frames{ 0 };
+	uint64_t num_retired_frames{ 0 };
+	bool is_stopping{ false };
+	exception_ptr render_exception;
+	mutex pipeline_mutex;
+	condition_variable pipeline_condition;
+	thread render_thread;
+	function<void(FramePacket&)> render_frame_function;
+
+	void render_main() {
+		job_system::attach_external_thread(0);
+		try {
+			while(true) {
+				FramePacket *p_frame_packet;
+				{
+					unique_lock<mutex> lock(pipeline_mutex);
+					pipeline_condition.wait(lock, [] { return is_stopping || num_submitted_frames > num_retired_frames; });
+					if(num_submitted_frames == num_retired_frames) { return; }
+					p_frame_packet = &a_frame_packets[num_retired_frames % frame_packet_count];
+				}
+				p_frame_packet->render_start_ticks = frame_timing::get_ticks();
+				render_frame_function(*p_frame_packet);
+				{
+					lock_guard<mutex> lock(pipeline_mutex);
+					num_retired_frames++;
+				}
+				pipeline_condition.notify_all();
+			}
+		}
+		catch(...) {
+			{
+				lock_guard<mutex> lock(pipeline_mutex);
+				render_exception = current_exception();
+			}
+			pipeline_condition.notify_all();
+		}
+	}
+
+	// Called with pipeline_mutex held, a failed render thread never retires another frame so its exception ends every wait
+	void rethrow_render_exception() {
+		if(render_exception) {
+			exception_ptr exception = render_exception;
+			render_exception = nullptr;
+			rethrow_exception(exception);
+		}
+	}
+
+	// render_frame runs on the render thread and must set present_ticks of the packet once it has presented
+	void start(function<void(FramePacket&)> render_frame) {
+		render_frame_function = move(render_frame);
+		is_stopping = false;
+		render_thread = thread(render_main);
+	}
+
+	// Renders whatever was submitted and joins the render thread, then rethrows an exception it threw
+	void stop() {
+		if(!render_thread.joinable()) { return; }
+		{
+			lock_guard<mutex> lock(pipeline_mutex);
+			is_stopping = true;
+		}
+		pipeline_condition.notify_all();
+		render_thread.join();
+		for(auto& frame_packet : a_frame_packets) {
+			gui::release_draw_lists(frame_packet);
+		}
+		lock_guard<mutex> lock(pipeline_mutex);
+		rethrow_render_exception();
+	}
+
+	// Returns once every submitted frame is presented, the render thread then touches nothing until the next submit
+	void flush() {
+		unique_lock<mutex> lock(pipeline_mutex);
+		pipeline_condition.wait(lock, [] { return render_exception || num_retired_frames == num_submitted_frames; });
+		rethrow_render_exception();
+	}
+
+	bool resize(LPARAM lparam) {
+		flush();
+		return renderer::resize(lparam);
+	}
+
+	// Called before messages are pumped, so that the input the next frame samples is as recent as the frame queue allows
+	void wait_for_frame_slot(const GuiData &gui_data) {
+		uint32_t max_num_frames_in_flight = gui_data.is_frame_pipelining_enabled ? frame_packet_count : 1;
+		{
+			unique_lock<mutex> lock(pipeline_mutex);
+			pipeline_condition.wait(lock, [&] { return render_exception || num_submitted_frames - num_retired_frames < max_num_frames_in_flight; });
+			rethrow_render_exception();
+		}
+		renderer::wait_for_frame_latency(frame_latency_timeout_ms);
+	}
+
+	// What the render thread reports back through the gui arrives with the packet it retired
+	void collect_rendered_frame(const FramePacket &frame_packet, GuiData &gui_data) {
+		copy_n(frame_packet.gui_data.a_heap_statistics, heap_pool_count, gui_data.a_heap_statistics);
+		gui_data.residency_statistics = frame_packet.gui_data.residency_statistics;
+		gui_data.indirect_draw_statistics = frame_packet.gui_data.indirect_draw_statistics;
+
+		auto& statistics = gui_data.frame_pipeline_statistics;
+		float input_to_present_ms = frame_timing::get_ms(frame_packet.input_sample_ticks, frame_packet.present_ticks);
+		statistics.simulation_ms = frame_timing::get_ms(frame_packet.input_sample_ticks, frame_packet.submit_ticks);
+		statistics.render_ms = frame_timing::get_ms(frame_packet.render_start_ticks, frame_packet.present_ticks);
+		statistics.input_to_present_ms += (input_to_present_ms - statistics.input_to_present_ms) * latency_smoothing_factor;
+		statistics.max_input_to_present_ms = max(statistics.max_input_to_present_ms * (1.f - latency_smoothing_factor), input_to_present_ms);
+		statistics.frame_number = frame_packet.frame_number;
+		statistics.gpu_frame_number = frame_packet.gpu_frame_number;
+		statistics.gpu_ms = frame_packet.gpu_ms;
+	}
+
+	// The packet of the next frame, its input is sampled now; the packet is free since wait_for_frame_slot() returned
+	FramePacket& begin_frame(GuiData &gui_data) {
+		FramePacket &frame_packet = a_frame_packets[num_submitted_frames % frame_packet_count];
+		if(frame_packet.frame_number > 0) {
+			collect_rendered_frame(frame_packet, gui_data);
+		}
+		frame_packet.frame_number = num_submitted_frames + 1;
+		frame_packet.input_sample_ticks = frame_timing::get_ticks();
+		return frame_packet;
+	}
+
+	// Only the settings the renderer reads are copied into the packet, the rest of the gui data is mostly statistics and timings.
+	// Whatever renderer::update() starts reading of frame_packet.gui_data has to be added here.
+	void copy_render_settings(const GuiData &gui_data, GuiData &packet_gui_data) {
+		packet_gui_data.max_frame_latency = gui_data.max_frame_latency;
+		packet_gui_data.is_heap_defragmentation_requested = gui_data.is_heap_defragmentation_requested;
+		packet_gui_data.ibl_environment_index = gui_data.ibl_environment_index;
+		packet_gui_data.background_env_map_type = gui_data.background_env_map_type;
+		packet_gui_data.background_specular_irradiance_mip_level = gui_data.background_specular_irradiance_mip_level;
+		packet_gui_data.isolation_mode_index = gui_data.isolation_mode_index;
+		packet_gui_data.draw_submission_mode = gui_data.draw_submission_mode;
+		packet_gui_data.is_depth_prepass_enabled = gui_data.is_depth_prepass_enabled;
+		packet_gui_data.is_front_to_back_sorting_enabled = gui_data.is_front_to_back_sorting_enabled;
+		packet_gui_data.test = gui_data.test;
+		packet_gui_data.is_residency_budget_simulated = gui_data.is_residency_budget_simulated;
+		packet_gui_data.simulated_residency_budget_in_mb = gui_data.simulated_residency_budget_in_mb;
+	}
+
+	// Requests the renderer handles are taken by the packet, so that they are acted on once
+	void submit_frame(FramePacket &frame_packet, GuiData &gui_data) {
+		copy_render_settings(gui_data, frame_packet.gui_data);
+		gui_data.is_heap_defragmentation_requested = false;
+		frame_packet.submit_ticks = frame_timing::get_ticks();
+		{
+			lock_guard<mutex> lock(pipeline_mutex);
+			num_submitted_frames++;
+		}
+		pipeline_condition.notify_all();
+	}
+} // namespace frame_pipeline
@@ -0,0 +1,75 @@
+namespace frame_timing
+{
+	// Frame times from the performance counter, which is monotonic and unaffected by changes to the system time.
+	// Simulation advances in fixed steps: the wall clock time of every frame is accumulated and consumed fixed_step_s at a time,
+	// so motion and damping come out the same at any frame rate. The time left over, as a fraction of a step, interpolates
+	// renderable state between the last two steps: it is shown up to a step late but never extrapolated. In fixed delta mode
+	// every frame is exactly one step long whatever time it took, runs are then identical from machine to machine.
+	constexpr double fixed_step_s{ 1.0 / 120.0 };
+	// A stall longer than this (a breakpoint, a blocking load) is simulated as this long instead of as a burst of steps
+	constexpr double max_frame_delta_s{ 0.25 };
+	constexpr float delta_smoothing_factor{ 0.1f };
+
+	const int64_t ticks_per_second = [] {
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return frequency.QuadPart;
+	}();
+
+	int64_t get_ticks() {
+		LARGE_INTEGER ticks;
+		QueryPerformanceCounter(&ticks);
+		return ticks.QuadPart;
+	}
+
+	float get_ms(int64_t start_ticks, int64_t end_ticks) {
+		return static_cast<float>(double(end_ticks - start_ticks) * 1000.0 / double(ticks_per_second));
+	}
+
+	struct Clock {
+		int64_t last_ticks;
+		double accumulated_s;
+		double simulated_time_s;
+		uint64_t num_frames;
+		FrameTimingStatistics statistics;
+	};
+
+	// The steps one frame runs and how far between the last two of them the frame is shown
+	struct FrameTime {
+		uint32_t num_fixed_steps;
+		float fixed_step_s;
+		float interpolation_alpha;
+	};
+
+	FrameTime tick(Clock &clock, bool is_fixed_delta_enabled) {
+		int64_t ticks = get_ticks();
+		double delta_s = (clock.num_frames > 0) ? double(ticks - clock.last_ticks) / double(ticks_per_second) : fixed_step_s;
+		clock.last_ticks = ticks;
+		clock.num_frames++;
+
+		auto& statistics = clock.statistics;
+		statistics.delta_ms = static_cast<float>(delta_s * 1000.0);
+		statistics.smoothed_delta_ms = (clock.num_frames > 1) ? statistics.smoothed_delta_ms + (statistics.delta_ms - statistics.smoothed_delta_ms) * delta_smoothing_factor : statistics.delta_ms;
+		statistics.a_delta_ms_history[statistics.next_history_index] = statistics.delta_ms;
+		statistics.next_history_index = (statistics.next_history_index + 1) % frame_timing_history_count;
+		statistics.is_fixed_delta_enabled = is_fixed_delta_enabled;
+
+		FrameTime frame_time;
+		frame_time.fixed_step_s = static_cast<float>(fixed_step_s);
+		if(is_fixed_delta_enabled) {
+			clock.accumulated_s = 0.0;
+			frame_time.num_fixed_steps = 1;
+			frame_time.interpolation_alpha = 1.f;
+		}
+		else {
+			clock.accumulated_s += min(delta_s, max_frame_delta_s);
+			frame_time.num_fixed_steps = static_cast<uint32_t>(clock.accumulated_s / fixed_step_s);
+			clock.accumulated_s -= frame_time.num_fixed_steps * fixed_step_s;
+			frame_time.interpolation_alpha = static_cast<float>(clock.accumulated_s / fixed_step_s);
+		}
+		clock.simulated_time_s += frame_time.num_fixed_steps * fixed_step_s;
+		statistics.num_fixed_steps = frame_time.num_fixed_steps;
+		statistics.simulated_time_s = static_cast<float>(clock.simulated_time_s);
+		return frame_time;
+	}
+} // namespace frame_timing
@@ -0,0 +1,774 @@
+namespace gltf_loader
+{
+	// Loads .gltf and .glb files into a tinygltf::Model without going through tinygltf. Files are memory mapped and buffers are read in place,
+	// the JSON is parsed in situ into a flat array of values and only the fields Poirot reads are filled.
+	// Data uris and accessors without a buffer view are not supported, load() fails on them so that the caller can fall back to tinygltf.
+	// load() also fails on buffer views, accessors and images whose bytes are not all inside the files.
+	// Neither path decodes images while loading, decode_images() decodes all of them in parallel afterwards.
+	constexpr uint32_t glb_magic{ 0x46546C67 }; // "glTF"
+	constexpr uint32_t glb_chunk_type_json{ 0x4E4F534A }; // "JSON"
+	constexpr uint32_t glb_chunk_type_bin{ 0x004E4942 }; // "BIN\0"
+	constexpr uint32_t glb_header_size{ 12 };
+	constexpr uint32_t glb_chunk_header_size{ 8 };
+	constexpr uint32_t invalid_json_index{ UINT32_MAX };
+	constexpr uint32_t max_json_depth{ 128 };
+	constexpr uint32_t max_json_number_length{ 63 };
+
+	struct MappedFile {
+		HANDLE h_file;
+		HANDLE h_mapping;
+		const uint8_t *p_data;
+		size_t size;
+	};
+
+	struct EncodedImage {
+		const uint8_t *p_data;
+		size_t size;
+	};
+
+	// Buffers of the model are left empty, their bytes are at v_p_buffer_data and stay valid until release(). v_buffer_sizes has how many
+	// of those bytes the buffer views may use.
+	// Images stay encoded until decode_images(), their bytes point into the mapped files or into v_encoded_image_copies for tinygltf.
+	struct Document {
+		tinygltf::Model model;
+		vector<const uint8_t*> v_p_buffer_data;
+		vector<size_t> v_buffer_sizes;
+		vector<MappedFile> v_mapped_files;
+		vector<EncodedImage> v_encoded_images;
+		vector<vector<uint8_t>> v_encoded_image_copies;
+	};
+
+	enum JsonType : uint8_t {
+		JSON_NULL,
+		JSON_FALSE,
+		JSON_TRUE,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	// Values are stored in document order: the first child of a value comes right after it and next_sibling skips over its subtree.
+	// Strings point into the mapped file and keep their escape sequences.
+	struct JsonValue {
+		JsonType type;
+		uint32_t num_children;
+		uint32_t next_sibling;
+		string_view key;
+		string_view string;
+		double number;
+	};
+
+	struct JsonParser {
+		const char *p_cursor;
+		const char *p_end;
+		vector<JsonValue> v_values;
+		uint32_t depth;
+	};
+
+	bool map_file(const string &file_address, MappedFile &mapped_file) {
+		mapped_file = {};
+		mapped_file.h_file = CreateFileA(file_address.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if(mapped_file.h_file == INVALID_HANDLE_VALUE) {
+			mapped_file.h_file = nullptr;
+			return false;
+		}
+		LARGE_INTEGER file_size;
+		if(!GetFileSizeEx(mapped_file.h_file, &file_size) || file_size.QuadPart == 0) {
+			CloseHandle(mapped_file.h_file);
+			mapped_file = {};
+			return false;
+		}
+		mapped_file.size = static_cast<size_t>(file_size.QuadPart);
+		mapped_file.h_mapping = CreateFileMappingA(mapped_file.h_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(mapped_file.h_mapping) {
+			mapped_file.p_data = reinterpret_cast<const uint8_t*>(MapViewOfFile(mapped_file.h_mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+		if(!mapped_file.p_data) {
+			if(mapped_file.h_mapping) { CloseHandle(mapped_file.h_mapping); }
+			CloseHandle(mapped_file.h_file);
+			mapped_file = {};
+			return false;
+		}
+		return true;
+	}
+
+	void unmap_file(MappedFile &mapped_file) {
+		if(mapped_file.p_data) { UnmapViewOfFile(mapped_file.p_data); }
+		if(mapped_file.h_mapping) { CloseHandle(mapped_file.h_mapping); }
+		if(mapped_file.h_file) { CloseHandle(mapped_file.h_file); }
+		mapped_file = {};
+	}
+
+	void release(Document &document) {
+		for(auto& mapped_file : document.v_mapped_files) {
+			unmap_file(mapped_file);
+		}
+		document.v_mapped_files.clear();
+		document.v_p_buffer_data.clear();
+		document.v_buffer_sizes.clear();
+		document.v_encoded_images.clear();
+		document.v_encoded_image_copies.clear();
+	}
+
+	// load() checked that the accessor's elements are inside its buffer view and the view inside its buffer
+	const uint8_t* get_accessor_data(const Document &document, const tinygltf::Accessor &accessor) {
+		const tinygltf::BufferView &buffer_view = document.model.bufferViews[accessor.bufferView];
+		return document.v_p_buffer_data[buffer_view.buffer] + buffer_view.byteOffset + accessor.byteOffset;
+	}
+
+	// Whether count elements of element_size bytes, stride bytes apart and the first offset bytes in, end within size bytes
+	bool is_range_inside(size_t offset, size_t count, size_t stride, size_t element_size, size_t size) {
+		if(offset > size || (count > 0 && element_size > size - offset)) { return false; }
+		return count <= 1 || (count - 1) <= (size - offset - element_size) / stride;
+	}
+
+	bool check_buffer_views(const Document &document, string &err) {
+		auto& model = document.model;
+		for(size_t view_index = 0; view_index < model.bufferViews.size(); ++view_index) {
+			auto& buffer_view = model.bufferViews[view_index];
+			bool is_valid = buffer_view.buffer >= 0 && size_t(buffer_view.buffer) < model.buffers.size() &&
+				is_range_inside(buffer_view.byteOffset, 1, 1, buffer_view.byteLength, document.v_buffer_sizes[buffer_view.buffer]);
+			if(!is_valid) {
+				err = "glTF buffer view " + to_string(view_index) + " is outside of its buffer";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Every element of an accessor is inside its buffer view and primitives only refer to accessors that exist
+	bool check_accessors(const Document &document, string &err) {
+		auto& model = document.model;
+		for(size_t accessor_index = 0; accessor_index < model.accessors.size(); ++accessor_index) {
+			auto& accessor = model.accessors[accessor_index];
+			bool is_valid = accessor.bufferView >= 0 && size_t(accessor.bufferView) < model.bufferViews.size();
+			if(is_valid) {
+				auto& buffer_view = model.bufferViews[accessor.bufferView];
+				int stride = accessor.ByteStride(buffer_view);
+				int component_size = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType));
+				int num_components = tinygltf::GetTypeSizeInBytes(static_cast<uint32_t>(accessor.type));
+				is_valid = stride > 0 && component_size > 0 && num_components > 0 &&
+					is_range_inside(accessor.byteOffset, accessor.count, stride, size_t(component_size) * num_components, buffer_view.byteLength);
+			}
+			if(!is_valid) {
+				err = "glTF accessor " + to_string(accessor_index) + " is outside of its buffer view";
+				return false;
+			}
+		}
+		for(auto& mesh : model.meshes) {
+			for(auto& primitive : mesh.primitives) {
+				bool is_valid = primitive.indices < int(model.accessors.size());
+				for(auto& [name, accessor_index] : primitive.attributes) {
+					is_valid &= accessor_index >= 0 && accessor_index < int(model.accessors.size());
+				}
+				if(!is_valid) {
+					err = "glTF mesh " + mesh.name + " refers to a missing accessor";
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	void skip_whitespace(JsonParser &parser) {
+		while(parser.p_cursor < parser.p_end && (*parser.p_cursor == ' ' || *parser.p_cursor == '\t' || *parser.p_cursor == '\n' || *parser.p_cursor == '\r')) {
+			++parser.p_cursor;
+		}
+	}
+
+	void expect(JsonParser &parser, char c) {
+		skip_whitespace(parser);
+		if(parser.p_cursor >= parser.p_end || *parser.p_cursor != c) { throw exception("Malformed glTF json"); }
+		++parser.p_cursor;
+	}
+
+	string_view parse_string(JsonParser &parser) {
+		expect(parser, '"');
+		const char *p_start = parser.p_cursor;
+		while(parser.p_cursor < parser.p_end && *parser.p_cursor != '"') {
+			parser.p_cursor += (*parser.p_cursor == '\\') ? 2 : 1;
+		}
+		if(parser.p_cursor >= parser.p_end) { throw exception("Malformed glTF json"); }
+		string_view result(p_start, parser.p_cursor - p_start);
+		++parser.p_cursor;
+		return result;
+	}
+
+	void parse_literal(JsonParser &parser, string_view literal) {
+		if(size_t(parser.p_end - parser.p_cursor) < literal.size() || string_view(parser.p_cursor, literal.size()) != literal) {
+			throw exception("Malformed glTF json");
+		}
+		parser.p_cursor += literal.size();
+	}
+
+	uint32_t parse_value(JsonParser &parser, string_view key) {
+		skip_whitespace(parser);
+		if(parser.p_cursor >= parser.p_end) { throw exception("Malformed glTF json"); }
+
+		uint32_t value_index = static_cast<uint32_t>(parser.v_values.size());
+		parser.v_values.push_back({});
+		parser.v_values[value_index].key = key;
+
+		char c = *parser.p_cursor;
+		if(c == '{' || c == '[') {
+			// Deeper documents than any exporter writes are rejected before they exhaust the stack
+			if(++parser.depth > max_json_depth) { throw exception("Malformed glTF json"); }
+			bool is_object = (c == '{');
+			char closing = is_object ? '}' : ']';
+			++parser.p_cursor;
+			uint32_t num_children = 0;
+			uint32_t previous_child_index = invalid_json_index;
+			skip_whitespace(parser);
+			if(parser.p_cursor < parser.p_end && *parser.p_cursor == closing) {
+				++parser.p_cursor;
+			}
+			else {
+				while(true) {
+					string_view child_key;
+					if(is_object) {
+						child_key = parse_string(parser);
+						expect(parser, ':');
+					}
+					uint32_t child_index = parse_value(parser, child_key);
+					if(previous_child_index != invalid_json_index) {
+						parser.v_values[previous_child_index].next_sibling = child_index;
+					}
+					previous_child_index = child_index;
+					++num_children;
+
+					skip_whitespace(parser);
+					if(parser.p_cursor >= parser.p_end) { throw exception("Malformed glTF json"); }
+					if(*parser.p_cursor == ',') { ++parser.p_cursor; continue; }
+					if(*parser.p_cursor == closing) { ++parser.p_cursor; break; }
+					throw exception("Malformed glTF json");
+				}
+			}
+			parser.v_values[value_index].type = is_object ? JSON_OBJECT : JSON_ARRAY;
+			parser.v_values[value_index].num_children = num_children;
+			--parser.depth;
+		}
+		else if(c == '"') {
+			string_view value_string = parse_string(parser);
+			parser.v_values[value_index].type = JSON_STRING;
+			parser.v_values[value_index].string = value_string;
+		}
+		else if(c == 't') { parse_literal(parser, "true"); parser.v_values[value_index].type = JSON_TRUE; }
+		else if(c == 'f') { parse_literal(parser, "false"); parser.v_values[value_index].type = JSON_FALSE; }
+		else if(c == 'n') { parse_literal(parser, "null"); parser.v_values[value_index].type = JSON_NULL; }
+		else {
+			// The mapped file is not NUL-terminated, strtod reads a copy of the token
+			const char *p_token_end = parser.p_cursor;
+			while(p_token_end < parser.p_end && ((*p_token_end >= '0' && *p_token_end <= '9') || *p_token_end == '-' || *p_token_end == '+' ||
+				*p_token_end == '.' || *p_token_end == 'e' || *p_token_end == 'E')) {
+				++p_token_end;
+			}
+			size_t token_length = p_token_end - parser.p_cursor;
+			if(token_length == 0 || token_length > max_json_number_length) { throw exception("Malformed glTF json"); }
+			char a_token[max_json_number_length + 1];
+			memcpy(a_token, parser.p_cursor, token_length);
+			a_token[token_length] = '\0';
+			char *p_number_end = nullptr;
+			double number = strtod(a_token, &p_number_end);
+			if(p_number_end != a_token + token_length) { throw exception("Malformed glTF json"); }
+			parser.p_cursor = p_token_end;
+			parser.v_values[value_index].type = JSON_NUMBER;
+			parser.v_values[value_index].number = number;
+		}
+		return value_index;
+	}
+
+	template<typename F>
+	void for_each_child(const vector<JsonValue> &v_values, uint32_t value_index, F function) {
+		if(value_index == invalid_json_index) { return; }
+		uint32_t child_index = value_index + 1;
+		for(uint32_t child_count = 0; child_count < v_values[value_index].num_children; ++child_count) {
+			function(child_index);
+			child_index = v_values[child_index].next_sibling;
+		}
+	}
+
+	uint32_t find_member(const vector<JsonValue> &v_values, uint32_t object_index, string_view key) {
+		if(object_index == invalid_json_index || v_values[object_index].type != JSON_OBJECT) { return invalid_json_index; }
+		uint32_t member_index = invalid_json_index;
+		for_each_child(v_values, object_index, [&](uint32_t child_index) {
+			if(member_index == invalid_json_index && v_values[child_index].key == key) {
+				member_index = child_index;
+			}
+		});
+		return member_index;
+	}
+
+	double get_number(const vector<JsonValue> &v_values, uint32_t object_index, string_view key, double default_value) {
+		uint32_t member_index = find_member(v_values, object_index, key);
+		return (member_index != invalid_json_index && v_values[member_index].type == JSON_NUMBER) ? v_values[member_index].number : default_value;
+	}
+
+	int get_int(const vector<JsonValue> &v_values, uint32_t object_index, string_view key, int default_value) {
+		return static_cast<int>(get_number(v_values, object_index, key, default_value));
+	}
+
+	bool get_bool(const vector<JsonValue> &v_values, uint32_t object_index, string_view key) {
+		uint32_t member_index = find_member(v_values, object_index, key);
+		return member_index != invalid_json_index && v_values[member_index].type == JSON_TRUE;
+	}
+
+	string get_string(const vector<JsonValue> &v_values, uint32_t object_index, string_view key) {
+		uint32_t member_index = find_member(v_values, object_index, key);
+		return (member_index != invalid_json_index && v_values[member_index].type == JSON_STRING) ? string(v_values[member_index].string) : string();
+	}
+
+	template<typename T>
+	void get_elements(const vector<JsonValue> &v_values, uint32_t array_index, vector<T> &v_numbers) {
+		if(array_index == invalid_json_index || v_values[array_index].type != JSON_ARRAY) { return; }
+		v_numbers.reserve(v_values[array_index].num_children);
+		for_each_child(v_values, array_index, [&](uint32_t child_index) {
+			v_numbers.push_back(static_cast<T>(v_values[child_index].number));
+		});
+	}
+
+	template<typename T>
+	void get_numbers(const vector<JsonValue> &v_values, uint32_t object_index, string_view key, vector<T> &v_numbers) {
+		get_elements(v_values, find_member(v_values, object_index, key), v_numbers);
+	}
+
+	// Same interpretation as tinygltf's ParseParameterProperty
+	tinygltf::Parameter make_parameter(const vector<JsonValue> &v_values, uint32_t value_index) {
+		tinygltf::Parameter parameter{};
+		const JsonValue &value = v_values[value_index];
+		switch(value.type) {
+			case JSON_STRING: parameter.string_value = string(value.string); break;
+			case JSON_ARRAY: get_elements(v_values, value_index, parameter.number_array); break;
+			case JSON_NUMBER: parameter.number_value = value.number; parameter.has_number_value = true; break;
+			case JSON_OBJECT:
+			{
+				for_each_child(v_values, value_index, [&](uint32_t child_index) {
+					if(v_values[child_index].type == JSON_NUMBER) {
+						parameter.json_double_value[string(v_values[child_index].key)] = v_values[child_index].number;
+					}
+				});
+			} break;
+			case JSON_TRUE: parameter.bool_value = true; break;
+			default: break;
+		}
+		return parameter;
+	}
+
+	int get_accessor_type(string_view type) {
+		if(type == "SCALAR") { return TINYGLTF_TYPE_SCALAR; }
+		if(type == "VEC2") { return TINYGLTF_TYPE_VEC2; }
+		if(type == "VEC3") { return TINYGLTF_TYPE_VEC3; }
+		if(type == "VEC4") { return TINYGLTF_TYPE_VEC4; }
+		if(type == "MAT2") { return TINYGLTF_TYPE_MAT2; }
+		if(type == "MAT3") { return TINYGLTF_TYPE_MAT3; }
+		if(type == "MAT4") { return TINYGLTF_TYPE_MAT4; }
+		return -1;
+	}
+
+	// Returns -1 for anything that is not a hex digit
+	int get_hex_digit_value(char c) {
+		if(c >= '0' && c <= '9') { return c - '0'; }
+		if(c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+		if(c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+		return -1;
+	}
+
+	// A % that is not followed by two hex digits is kept as it is
+	string decode_uri(string_view uri) {
+		string decoded;
+		decoded.reserve(uri.size());
+		for(size_t char_index = 0; char_index < uri.size(); ++char_index) {
+			int high = (uri[char_index] == '%' && char_index + 2 < uri.size()) ? get_hex_digit_value(uri[char_index + 1]) : -1;
+			int low = (high >= 0) ? get_hex_digit_value(uri[char_index + 2]) : -1;
+			if(low >= 0) {
+				decoded.push_back(static_cast<char>(high * 16 + low));
+				char_index += 2;
+			}
+			else {
+				decoded.push_back(uri[char_index]);
+			}
+		}
+		return decoded;
+	}
+
+	// Size of an rgba8 texture together with the mips scene_manager::load_texture generates for it, decoded images reserve this much
+	// so that the mips are generated right after the pixels without copying them
+	size_t get_mip_chain_size(int width, int height) {
+		size_t size = size_t(width) * height * 4;
+		bool is_square_power_of_2 = (width == height) && width > 0 && (width & (width - 1)) == 0;
+		if(!is_mipchain_generation_enabled || !is_square_power_of_2) {
+			return size;
+		}
+		for(int mip_size = width >> 1; mip_size > 0; mip_size >>= 1) {
+			size += size_t(mip_size) * mip_size * 4;
+		}
+		return size;
+	}
+
+	bool is_ssse3_supported() {
+		int a_cpu_info[4];
+		__cpuid(a_cpu_info, 1);
+		return (a_cpu_info[2] & (1 << 9)) != 0;
+	}
+
+	// 16 pixels per iteration: three loads cover 48 rgb bytes and every 12 byte group is shuffled into 4 rgba pixels.
+	// The remaining pixels are expanded one by one so that no load reads past the source.
+	void expand_rgb_to_rgba(const uint8_t *p_rgb, size_t num_pixels, uint8_t *p_rgba) {
+		static const bool is_shuffle_supported = is_ssse3_supported();
+		size_t pixel_index = 0;
+		if(is_shuffle_supported) {
+			const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			const __m128i alpha = _mm_set1_epi32(0xFF000000);
+			for(; pixel_index + 16 <= num_pixels; pixel_index += 16) {
+				const __m128i *p_source = reinterpret_cast<const __m128i*>(p_rgb + pixel_index * 3);
+				__m128i *p_destination = reinterpret_cast<__m128i*>(p_rgba + pixel_index * 4);
+				__m128i a = _mm_loadu_si128(p_source);
+				__m128i b = _mm_loadu_si128(p_source + 1);
+				__m128i c = _mm_loadu_si128(p_source + 2);
+				_mm_storeu_si128(p_destination, _mm_or_si128(_mm_shuffle_epi8(a, shuffle), alpha));
+				_mm_storeu_si128(p_destination + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), shuffle), alpha));
+				_mm_storeu_si128(p_destination + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), shuffle), alpha));
+				_mm_storeu_si128(p_destination + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), shuffle), alpha));
+			}
+		}
+		for(; pixel_index < num_pixels; ++pixel_index) {
+			p_rgba[pixel_index * 4 + 0] = p_rgb[pixel_index * 3 + 0];
+			p_rgba[pixel_index * 4 + 1] = p_rgb[pixel_index * 3 + 1];
+			p_rgba[pixel_index * 4 + 2] = p_rgb[pixel_index * 3 + 2];
+			p_rgba[pixel_index * 4 + 3] = 255;
+		}
+	}
+
+	// 3 channel images are expanded to rgba while they are copied out of stb_image, 1 and 2 channel images are kept as they are
+	void decode_image(const EncodedImage &encoded_image, tinygltf::Image &image, ImageDecodeTiming &timing) {
+		auto start = chrono::high_resolution_clock::now();
+		int width, height, component;
+		uint8_t *p_pixels = stbi_load_from_memory(encoded_image.p_data, static_cast<int>(encoded_image.size), &width, &height, &component, 0);
+		if(!p_pixels) {
+			throw exception(("Couldn't decode glTF image " + (image.uri.empty() ? image.name : image.uri)).c_str());
+		}
+		auto decoded = chrono::high_resolution_clock::now();
+
+		size_t num_pixels = size_t(width) * height;
+		int output_component = (component == 3) ? 4 : component;
+		image.image.clear();
+		image.image.reserve((output_component == 4) ? get_mip_chain_size(width, height) : num_pixels * output_component);
+		if(component == 3) {
+			image.image.resize(num_pixels * 4);
+			expand_rgb_to_rgba(p_pixels, num_pixels, image.image.data());
+		}
+		else {
+			image.image.assign(p_pixels, p_pixels + num_pixels * component);
+		}
+		stbi_image_free(p_pixels);
+		image.width = width;
+		image.height = height;
+		image.component = output_component;
+
+		timing = {};
+		string name = image.name.empty() ? image.uri.substr(image.uri.find_last_of('/') + 1) : image.name;
+		strncpy(timing.name, name.c_str(), sizeof(timing.name) - 1);
+		timing.width = width;
+		timing.height = height;
+		timing.num_source_channels = component;
+		timing.decode_ms = chrono::duration<float, milli>(decoded - start).count();
+		timing.expand_ms = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - decoded).count();
+	}
+
+	// Images go out in small batches, a few per worker, since their sizes vary a lot and stealing evens the batches out. The calling thread decodes too.
+	// Only the images v_is_image_needed selects are decoded when it is not empty, the timings of the others stay zero.
+	// The encoded bytes tinygltf copied are freed afterwards, mapped files stay until release().
+	void decode_images(Document &document, vector<ImageDecodeTiming> &v_timings, const vector<bool> &v_is_image_needed = {}) {
+		auto& images = document.model.images;
+		vector<uint32_t> v_image_indices;
+		for(uint32_t image_index = 0; image_index < images.size(); ++image_index) {
+			if(v_is_image_needed.empty() || v_is_image_needed[image_index]) {
+				v_image_indices.push_back(image_index);
+			}
+		}
+		v_timings.assign(images.size(), {});
+		job_system::parallel_for(static_cast<uint32_t>(v_image_indices.size()), 1, [&](uint32_t begin, uint32_t end) {
+			for(uint32_t index = begin; index < end; ++index) {
+				uint32_t image_index = v_image_indices[index];
+				decode_image(document.v_encoded_images[image_index], images[image_index], v_timings[image_index]);
+			}
+		});
+		document.v_encoded_image_copies.clear();
+	}
+
+	// Returns false with an error message when the file is not one the fast path handles
+	bool load(const string &file_address, Document &document, string &err) {
+		document = {};
+		MappedFile mapped_file;
+		if(!map_file(file_address, mapped_file)) {
+			err = "Couldn't map " + file_address;
+			return false;
+		}
+		document.v_mapped_files.push_back(mapped_file);
+
+		string base_folder = file_address.substr(0, file_address.find_last_of("/\\") + 1);
+		const char *p_json = reinterpret_cast<const char*>(mapped_file.p_data);
+		size_t json_size = mapped_file.size;
+		const uint8_t *p_bin_chunk = nullptr;
+		size_t bin_chunk_size = 0;
+
+		uint32_t magic = 0;
+		memcpy(&magic, mapped_file.p_data, min(mapped_file.size, sizeof(magic)));
+		if(magic == glb_magic) {
+			// Header: magic, version, length. Then the JSON chunk and an optional BIN chunk, each with a length and a type.
+			uint32_t a_chunk_header[2];
+			if(mapped_file.size < glb_header_size + glb_chunk_header_size) { err = "Truncated glb"; release(document); return false; }
+			memcpy(a_chunk_header, mapped_file.p_data + glb_header_size, sizeof(a_chunk_header));
+			if(a_chunk_header[1] != glb_chunk_type_json || glb_header_size + glb_chunk_header_size + size_t(a_chunk_header[0]) > mapped_file.size) {
+				err = "Malformed glb json chunk"; release(document); return false;
+			}
+			p_json = reinterpret_cast<const char*>(mapped_file.p_data + glb_header_size + glb_chunk_header_size);
+			json_size = a_chunk_header[0];
+
+			size_t bin_chunk_offset = glb_header_size + glb_chunk_header_size + json_size;
+			if(bin_chunk_offset + glb_chunk_header_size <= mapped_file.size) {
+				memcpy(a_chunk_header, mapped_file.p_data + bin_chunk_offset, sizeof(a_chunk_header));
+				if(a_chunk_header[1] == glb_chunk_type_bin && bin_chunk_offset + glb_chunk_header_size + a_chunk_header[0] <= mapped_file.size) {
+					p_bin_chunk = mapped_file.p_data + bin_chunk_offset + glb_chunk_header_size;
+					bin_chunk_size = a_chunk_header[0];
+				}
+			}
+		}
+
+		JsonParser parser{ p_json, p_json + json_size, {}, 0 };
+		parser.v_values.reserve(json_size / 16);
+		try {
+			parse_value(parser, {});
+		}
+		catch(exception &e) {
+			err = e.what();
+			release(document);
+			return false;
+		}
+		const auto& v_values = parser.v_values;
+		auto& model = document.model;
+		auto get_array = [&](string_view key) { return find_member(v_values, 0, key); };
+
+		for_each_child(v_values, get_array("buffers"), [&](uint32_t buffer_index) {
+			tinygltf::Buffer buffer;
+			buffer.uri = get_string(v_values, buffer_index, "uri");
+			const uint8_t *p_buffer_data = nullptr;
+			size_t buffer_size = 0;
+			if(buffer.uri.empty()) {
+				p_buffer_data = p_bin_chunk;
+				buffer_size = bin_chunk_size;
+			}
+			else if(buffer.uri.compare(0, 5, "data:") != 0) {
+				MappedFile buffer_file;
+				if(map_file(base_folder + decode_uri(buffer.uri), buffer_file)) {
+					document.v_mapped_files.push_back(buffer_file);
+					p_buffer_data = buffer_file.p_data;
+					buffer_size = buffer_file.size;
+				}
+			}
+			if(!p_buffer_data && err.empty()) {
+				err = "Unsupported glTF buffer: " + (buffer.uri.empty() ? string("missing BIN chunk") : buffer.uri.substr(0, 64));
+			}
+			// A chunk or file may be padded past the buffer, the views may only use byteLength of it
+			double byte_length = get_number(v_values, buffer_index, "byteLength", 0);
+			if(p_buffer_data && (byte_length < 0 || byte_length > double(buffer_size)) && err.empty()) {
+				err = "Truncated glTF buffer: " + (buffer.uri.empty() ? string("BIN chunk") : buffer.uri.substr(0, 64));
+			}
+			document.v_p_buffer_data.push_back(p_buffer_data);
+			document.v_buffer_sizes.push_back(static_cast<size_t>(max(byte_length, 0.0)));
+			model.buffers.push_back(move(buffer));
+		});
+		if(!err.empty()) { release(document); return false; }
+
+		for_each_child(v_values, get_array("bufferViews"), [&](uint32_t view_index) {
+			tinygltf::BufferView buffer_view;
+			buffer_view.buffer = get_int(v_values, view_index, "buffer", -1);
+			buffer_view.byteOffset = static_cast<size_t>(get_number(v_values, view_index, "byteOffset", 0));
+			buffer_view.byteLength = static_cast<size_t>(get_number(v_values, view_index, "byteLength", 0));
+			buffer_view.byteStride = static_cast<size_t>(get_number(v_values, view_index, "byteStride", 0));
+			buffer_view.target = get_int(v_values, view_index, "target", 0);
+			model.bufferViews.push_back(buffer_view);
+		});
+		if(!check_buffer_views(document, err)) { release(document); return false; }
+
+		for_each_child(v_values, get_array("accessors"), [&](uint32_t accessor_index) {
+			tinygltf::Accessor accessor;
+			accessor.bufferView = get_int(v_values, accessor_index, "bufferView", -1);
+			accessor.byteOffset = static_cast<size_t>(get_number(v_values, accessor_index, "byteOffset", 0));
+			accessor.normalized = get_bool(v_values, accessor_index, "normalized");
+			accessor.componentType = get_int(v_values, accessor_index, "componentType", -1);
+			accessor.count = static_cast<size_t>(get_number(v_values, accessor_index, "count", 0));
+			uint32_t type_index = find_member(v_values, accessor_index, "type");
+			accessor.type = (type_index != invalid_json_index) ? get_accessor_type(v_values[type_index].string) : -1;
+			get_numbers(v_values, accessor_index, "min", accessor.minValues);
+			get_numbers(v_values, accessor_index, "max", accessor.maxValues);
+			model.accessors.push_back(accessor);
+		});
+
+		for_each_child(v_values, get_array("meshes"), [&](uint32_t mesh_index) {
+			tinygltf::Mesh mesh;
+			mesh.name = get_string(v_values, mesh_index, "name");
+			for_each_child(v_values, find_member(v_values, mesh_index, "primitives"), [&](uint32_t primitive_index) {
+				tinygltf::Primitive primitive;
+				for_each_child(v_values, find_member(v_values, primitive_index, "attributes"), [&](uint32_t attribute_index) {
+					primitive.attributes[string(v_values[attribute_index].key)] = static_cast<int>(v_values[attribute_index].number);
+				});
+				primitive.indices = get_int(v_values, primitive_index, "indices", -1);
+				primitive.material = get_int(v_values, primitive_index, "material", -1);
+				primitive.mode = get_int(v_values, primitive_index, "mode", TINYGLTF_MODE_TRIANGLES);
+				mesh.primitives.push_back(move(primitive));
+			});
+			model.meshes.push_back(move(mesh));
+		});
+		if(!check_accessors(document, err)) { release(document); return false; }
+
+		for_each_child(v_values, get_array("nodes"), [&](uint32_t node_index) {
+			tinygltf::Node node;
+			node.name = get_string(v_values, node_index, "name");
+			node.mesh = get_int(v_values, node_index, "mesh", -1);
+			get_numbers(v_values, node_index, "children", node.children);
+			get_numbers(v_values, node_index, "matrix", node.matrix);
+			get_numbers(v_values, node_index, "translation", node.translation);
+			get_numbers(v_values, node_index, "rotation", node.rotation);
+			get_numbers(v_values, node_index, "scale", node.scale);
+			model.nodes.push_back(move(node));
+		});
+
+		for_each_child(v_values, get_array("scenes"), [&](uint32_t scene_index) {
+			tinygltf::Scene scene;
+			scene.name = get_string(v_values, scene_index, "name");
+			get_numbers(v_values, scene_index, "nodes", scene.nodes);
+			model.scenes.push_back(move(scene));
+		});
+		model.defaultScene = get_int(v_values, 0, "scene", 0);
+
+		for_each_child(v_values, get_array("textures"), [&](uint32_t texture_index) {
+			tinygltf::Texture texture;
+			texture.source = get_int(v_values, texture_index, "source", -1);
+			texture.sampler = get_int(v_values, texture_index, "sampler", -1);
+			model.textures.push_back(move(texture));
+		});
+
+		for_each_child(v_values, get_array("materials"), [&](uint32_t material_index) {
+			tinygltf::Material material;
+			for_each_child(v_values, material_index, [&](uint32_t member_index) {
+				string_view key = v_values[member_index].key;
+				if(key == "pbrMetallicRoughness") {
+					for_each_child(v_values, member_index, [&](uint32_t value_index) {
+						material.values[string(v_values[value_index].key)] = make_parameter(v_values, value_index);
+					});
+				}
+				else if(key != "extensions" && key != "extras") {
+					material.additionalValues[string(key)] = make_parameter(v_values, member_index);
+				}
+			});
+			model.materials.push_back(move(material));
+		});
+
+		for_each_child(v_values, get_array("images"), [&](uint32_t image_index) {
+			tinygltf::Image image;
+			image.name = get_string(v_values, image_index, "name");
+			image.uri = get_string(v_values, image_index, "uri");
+			image.mimeType = get_string(v_values, image_index, "mimeType");
+			image.bufferView = get_int(v_values, image_index, "bufferView", -1);
+			EncodedImage encoded_image = {};
+			if(image.bufferView >= 0) {
+				if(size_t(image.bufferView) < model.bufferViews.size()) {
+					const auto& buffer_view = model.bufferViews[image.bufferView];
+					encoded_image = { document.v_p_buffer_data[buffer_view.buffer] + buffer_view.byteOffset, buffer_view.byteLength };
+				}
+			}
+			else if(image.uri.compare(0, 5, "data:") != 0) {
+				MappedFile image_file;
+				if(map_file(base_folder + decode_uri(image.uri), image_file)) {
+					document.v_mapped_files.push_back(image_file);
+					encoded_image = { image_file.p_data, image_file.size };
+				}
+			}
+			if(!encoded_image.p_data && err.empty()) {
+				err = "Unsupported glTF image: " + (image.uri.empty() ? image.name : image.uri.substr(0, 64));
+			}
+			document.v_encoded_images.push_back(encoded_image);
+			model.images.push_back(move(image));
+		});
+		if(!err.empty()) { release(document); return false; }
+
+		return true;
+	}
+
+	// The existing path, buffers are copied into the model and v_p_buffer_data points at those copies.
+	// Unless is_image_decoding_deferred is false, the image loader only keeps the encoded bytes for decode_images().
+	bool load_with_tinygltf(const string &file_address, Document &document, string &err, bool is_image_decoding_deferred = true) {
+		document = {};
+		tinygltf::TinyGLTF gltf_ctx;
+		if(is_image_decoding_deferred) {
+			gltf_ctx.SetImageLoader([](tinygltf::Image *p_image, string*, int, int, const unsigned char *p_bytes, int size, void*) {
+				p_image->image.assign(p_bytes, p_bytes + size);
+				return true;
+			}, nullptr);
+		}
+		bool is_binary = file_address.size() >= 4 && file_address.compare(file_address.size() - 4, 4, ".glb") == 0;
+		bool is_loaded = is_binary ? gltf_ctx.LoadBinaryFromFile(&document.model, &err, file_address.c_str()) : gltf_ctx.LoadASCIIFromFile(&document.model, &err, file_address.c_str());
+		if(!is_loaded) { return false; }
+		for(auto& buffer : document.model.buffers) {
+			document.v_p_buffer_data.push_back(buffer.data.data());
+			document.v_buffer_sizes.push_back(buffer.data.size());
+		}
+		if(is_image_decoding_deferred) {
+			for(auto& image : document.model.images) {
+				document.v_encoded_image_copies.push_back(move(image.image));
+				image.image = {};
+				document.v_encoded_images.push_back({ document.v_encoded_image_copies.back().data(), document.v_encoded_image_copies.back().size() });
+			}
+		}
+		if(document.model.defaultScene < 0) {
+			document.model.defaultScene = 0;
+		}
+		return true;
+	}
+
+	// Best of num_iterations for each path, a path that cannot load the file keeps FLT_MAX.
+	// v_image_timings gets the per image breakdown of the fastest mapped load.
+	GltfLoadTiming compare_load_times(const string &file_address, vector<ImageDecodeTiming> &v_image_timings, uint32_t num_iterations = 3) {
+		GltfLoadTiming timing = { FLT_MAX, FLT_MAX, 0.f, FLT_MAX, FLT_MAX, 0 };
+		auto time_load = [&](auto load_function, bool is_decode_stage_run, float &best_ms) {
+			string err;
+			Document document;
+			vector<ImageDecodeTiming> v_timings;
+			auto start = chrono::high_resolution_clock::now();
+			bool is_loaded = load_function(file_address, document, err);
+			auto loaded = chrono::high_resolution_clock::now();
+			if(is_loaded && is_decode_stage_run) {
+				decode_images(document, v_timings);
+			}
+			auto end = chrono::high_resolution_clock::now();
+			if(is_loaded) {
+				float ms = chrono::duration<float, milli>(end - start).count();
+				if(ms < best_ms && is_decode_stage_run) {
+					timing.mapped_image_decode_ms = chrono::duration<float, milli>(end - loaded).count();
+					v_image_timings = move(v_timings);
+				}
+				best_ms = min(best_ms, ms);
+				uint64_t buffer_bytes_copied = 0;
+				for(auto& buffer : document.model.buffers) {
+					buffer_bytes_copied += buffer.data.size();
+				}
+				timing.tinygltf_buffer_bytes_copied = max(timing.tinygltf_buffer_bytes_copied, buffer_bytes_copied);
+			}
+			release(document);
+		};
+		auto load_with_tinygltf_decoding = [](const string &file_address, Document &document, string &err) {
+			return load_with_tinygltf(file_address, document, err, false);
+		};
+		auto load_with_tinygltf_deferred_decoding = [](const string &file_address, Document &document, string &err) {
+			return load_with_tinygltf(file_address, document, err);
+		};
+		for(uint32_t iteration = 0; iteration < num_iterations; ++iteration) {
+			time_load(load, true, timing.mapped_load_ms);
+			time_load(load_with_tinygltf_decoding, false, timing.tinygltf_load_ms);
+			time_load(load, false, timing.mapped_parse_ms);
+			time_load(load_with_tinygltf_deferred_decoding, false, timing.tinygltf_parse_ms);
+		}
+		return timing;
+	}
+} // namespace gltf_loader
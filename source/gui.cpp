@@ -12,14 +12,27 @@ namespace gui
 
 		ImGui::CreateContext();
 		ImGui_ImplDX12_Init(window_handle, max_inflight_frame_count, p_device, rtv_format /*DXGI_FORMAT_R8G8B8A8_UNORM*/, gui_font_srv_cpu_desc_handle, gui_font_srv_gpu_desc_handle);
+		gui_data.is_frame_pipelining_enabled = true;
+		gui_data.lod_error_threshold_px = 1.0f;
+		gui_data.max_frame_latency = default_max_frame_latency;
 	}
 
 	void clean_up() {
 		ImGui_ImplDX12_Shutdown();
 	}
 
-	void update(ID3D12GraphicsCommandList *p_command_list) {
-		ImGui_ImplDX12_NewFrame(p_command_list);
+	// Clones are made and freed on the simulation thread only, imgui's allocation counters are not atomic
+	void release_draw_lists(FramePacket &frame_packet) {
+		for(ImDrawList *p_draw_list : frame_packet.v_p_gui_draw_lists) {
+			p_draw_list->~ImDrawList();
+			ImGui::MemFree(p_draw_list);
+		}
+		frame_packet.v_p_gui_draw_lists.clear();
+	}
+
+	// Runs on the simulation thread: samples the input and builds the gui, the command list the gui is recorded into is only known to render()
+	void update() {
+		ImGui_ImplDX12_NewFrame();
 		{
 			ImVec2 mouse_pos = ImGui::GetMousePos();
 			ImGuiIO& io = ImGui::GetIO();
@@ -57,16 +70,197 @@ namespace gui
 		ImGui::SetNextWindowBgAlpha(0.2f); // Transparent background
 		ImGui::Begin("Controls", NULL, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoSavedSettings);
 		ImGui::PushItemWidth(200);
+		{
+			ImGui::Text("Frame Pipeline: ");
+			ImGui::Checkbox("Overlap Simulation and Rendering", &gui_data.is_frame_pipelining_enabled);
+			ImGui::SliderInt("Max Frame Latency", reinterpret_cast<int*>(&gui_data.max_frame_latency), 1, max_inflight_frame_count);
+			auto& pipeline_statistics = gui_data.frame_pipeline_statistics;
+			ImGui::Text("Simulation %.2f ms, rendering %.2f ms, input to present %.1f ms (max %.1f ms)", pipeline_statistics.simulation_ms, pipeline_statistics.render_ms,
+				pipeline_statistics.input_to_present_ms, pipeline_statistics.max_input_to_present_ms);
+		}
+		ImGui::Separator();
+		{
+			ImGui::Text("Camera Path: ");
+			bool is_idle = (gui_data.camera_path_mode == CAMERA_PATH_MODE_IDLE);
+			if(is_idle || gui_data.camera_path_mode == CAMERA_PATH_MODE_RECORDING) {
+				if(ImGui::Button(is_idle ? "Record" : "Stop Recording")) { gui_data.is_camera_path_recording_toggle_requested = true; }
+			}
+			if(is_idle || gui_data.camera_path_mode == CAMERA_PATH_MODE_REPLAYING) {
+				if(is_idle) { ImGui::SameLine(); }
+				if(ImGui::Button(is_idle ? "Replay" : "Stop Replay")) { gui_data.is_camera_path_replay_toggle_requested = true; }
+			}
+			if(gui_data.camera_path_mode == CAMERA_PATH_MODE_RECORDING) {
+				ImGui::Text("Recorded %u frames", gui_data.num_camera_path_frames);
+			}
+			else if(gui_data.camera_path_mode == CAMERA_PATH_MODE_REPLAYING) {
+				ImGui::Text("Replayed %u of %u frames", gui_data.num_replayed_camera_path_frames, gui_data.num_camera_path_frames);
+			}
+			if(gui_data.has_camera_path_replay_result) {
+				const auto& result = gui_data.camera_path_replay_result;
+				ImGui::Text("%u frames, %u with GPU time (mean / p50 / p95 / p99 / max ms)", result.num_frames, result.num_gpu_timed_frames);
+				auto show_percentiles = [](const char *p_name, const TimingPercentiles &percentiles) {
+					ImGui::Text("%-10s %6.2f %6.2f %6.2f %6.2f %6.2f", p_name, percentiles.mean_ms, percentiles.p50_ms, percentiles.p95_ms, percentiles.p99_ms, percentiles.max_ms);
+				};
+				show_percentiles("Frame", result.frame);
+				show_percentiles("Simulation", result.simulation);
+				show_percentiles("Rendering", result.render);
+				show_percentiles("GPU", result.gpu);
+			}
+		}
+		ImGui::Separator();
+		{
+			ImGui::Text("Frame Timing: ");
+			ImGui::Checkbox("Fixed Delta Time", &gui_data.is_fixed_delta_time_enabled);
+			const auto& timing_statistics = gui_data.frame_timing_statistics;
+			ImGui::PlotLines("Frame Time (ms)", timing_statistics.a_delta_ms_history, frame_timing_history_count, timing_statistics.next_history_index,
+				nullptr, 0.0f, 50.0f, ImVec2(0.0f, 60.0f));
+			ImGui::Text("Frame %.2f ms (smoothed %.2f ms), %u fixed steps, simulated %.1f s", timing_statistics.delta_ms, timing_statistics.smoothed_delta_ms,
+				timing_statistics.num_fixed_steps, timing_statistics.simulated_time_s);
+		}
+		ImGui::Separator();
 		{
 			ImGui::Text("View: ");
-			const char* a_isolation_modes[] = { "None", "Base Color", "Metallic", "Roughness", "Normal", "Opacity", "Emission", "Diffuse Response", "Specular Response" };
+			const char* a_isolation_modes[] = { "None", "Base Color", "Metallic", "Roughness", "Normal", "Opacity", "Emission", "Diffuse Response", "Specular Response", "Occlusion" };
 			ImGui::Combo("Isolation Mode", reinterpret_cast<int*>(&gui_data.isolation_mode_index), a_isolation_modes, IM_ARRAYSIZE(a_isolation_modes));
 		}
 		ImGui::Separator();
+		{
+			ImGui::Text("Rendering: ");
+			const char* a_draw_submission_modes[] = { "Direct", "Indirect", "Indirect + CPU Culling", "Indirect + GPU Culling" };
+			ImGui::Combo("Draw Submission", reinterpret_cast<int*>(&gui_data.draw_submission_mode), a_draw_submission_modes, IM_ARRAYSIZE(a_draw_submission_modes));
+			if(gui_data.draw_submission_mode != DRAW_SUBMISSION_DIRECT) {
+				const auto& statistics = gui_data.indirect_draw_statistics;
+				ImGui::Text("%u / %u draws in %u pipeline ranges, %u drawn directly past the indirect buffers", statistics.num_indirect_draws, statistics.num_draws,
+					statistics.num_ranges, statistics.num_direct_draws);
+			}
+			ImGui::Checkbox("Depth Pre-pass", &gui_data.is_depth_prepass_enabled);
+			// Indirect draws are shaded in the order of their pipeline ranges, there the order only applies to a depth pre-pass
+			if(gui_data.draw_submission_mode == DRAW_SUBMISSION_DIRECT || gui_data.is_depth_prepass_enabled) {
+				ImGui::Checkbox("Front to Back Opaque Order", &gui_data.is_front_to_back_sorting_enabled);
+			}
+			else {
+				gui_data.is_front_to_back_sorting_enabled = false;
+				ImGui::TextDisabled("Front to Back Opaque Order needs the depth pre-pass with indirect draws");
+			}
+			ImGui::Checkbox("Occlusion Culling", &gui_data.is_occlusion_culling_enabled);
+			if(gui_data.is_occlusion_culling_enabled) {
+				const auto& statistics = gui_data.occlusion_culling_statistics;
+				ImGui::Text("Culled %u / %u draws with %u occluder triangles (%s): raster %.3f ms, test %.3f ms", statistics.num_culled_draws, statistics.num_draws,
+					statistics.num_occluder_triangles, statistics.is_avx2_used ? "AVX2" : "SSE", statistics.rasterize_ms, statistics.test_ms);
+			}
+			ImGui::Checkbox("LOD Selection", &gui_data.is_lod_selection_enabled);
+			if(gui_data.is_lod_selection_enabled) {
+				const auto& statistics = gui_data.lod_selection_statistics;
+				ImGui::SliderFloat("LOD Error Threshold (px)", &gui_data.lod_error_threshold_px, 0.25f, 8.0f);
+				ImGui::Text("%u / %u triangles", statistics.num_selected_triangles, statistics.num_full_triangles);
+				for(uint32_t lod_level = 0; lod_level < max_lod_count; ++lod_level) {
+					ImGui::SameLine();
+					ImGui::Text(" LOD%u: %u", lod_level, statistics.a_num_draws_per_lod[lod_level]);
+				}
+			}
+			ImGui::Checkbox("Meshlet Culling", &gui_data.is_meshlet_culling_enabled);
+			if(gui_data.is_meshlet_culling_enabled) {
+				const auto& statistics = gui_data.meshlet_culling_statistics;
+				ImGui::Text("Culled %u / %u meshlets outside the frustum, %u facing away: %u / %u triangles in %u ranges, %.3f ms", statistics.num_frustum_culled_meshlets, statistics.num_meshlets,
+					statistics.num_backface_culled_meshlets, statistics.num_drawn_triangles, statistics.num_triangles, statistics.num_ranges, statistics.cull_ms);
+			}
+			if(ImGui::Button("Run Draw Sort Benchmark")) { gui_data.is_sort_benchmark_requested = true; }
+			if(gui_data.sort_benchmark_num_keys > 0) {
+				ImGui::Text("%u keys: radix %.3f ms, std::sort %.3f ms", gui_data.sort_benchmark_num_keys, gui_data.sort_benchmark_radix_sort_ms, gui_data.sort_benchmark_std_sort_ms);
+			}
+			if(ImGui::Button("Run Job System Benchmark")) { gui_data.is_job_benchmark_requested = true; }
+			const auto& job_benchmark = gui_data.job_benchmark_result;
+			if(job_benchmark.num_scaling_steps > 0) {
+				ImGui::Text("%u workers: empty job %.0f ns, chained task %.0f ns", job_benchmark.num_workers, job_benchmark.empty_job_ns, job_benchmark.task_chain_ns);
+				for(uint32_t step_index = 0; step_index < job_benchmark.num_scaling_steps; ++step_index) {
+					const auto& step = job_benchmark.a_scaling_steps[step_index];
+					ImGui::Text("  parallel for, %u batches: %.3f ms (%.2fx)", step.num_batches, step.parallel_for_ms, job_benchmark.a_scaling_steps[0].parallel_for_ms / step.parallel_for_ms);
+				}
+			}
+			if(ImGui::Button("Run Occlusion Culling Benchmark")) { gui_data.is_occlusion_benchmark_requested = true; }
+			if(gui_data.is_occlusion_benchmark_done) {
+				const auto& occlusion_benchmark = gui_data.occlusion_benchmark_result;
+				ImGui::Text("%u triangles, %u draws, culled %u", occlusion_benchmark.num_occluder_triangles, occlusion_benchmark.num_draws, occlusion_benchmark.num_culled_draws);
+				ImGui::Text("  SSE: raster %.3f ms, test %.3f ms", occlusion_benchmark.a_rasterize_ms[OCCLUSION_ISA_SSE], occlusion_benchmark.a_test_ms[OCCLUSION_ISA_SSE]);
+				if(occlusion_benchmark.is_avx2_supported) {
+					ImGui::Text("  AVX2: raster %.3f ms, test %.3f ms", occlusion_benchmark.a_rasterize_ms[OCCLUSION_ISA_AVX2], occlusion_benchmark.a_test_ms[OCCLUSION_ISA_AVX2]);
+				}
+			}
+			if(ImGui::Button("Run Mesh Simplification Benchmark")) { gui_data.is_simplification_benchmark_requested = true; }
+			if(gui_data.is_simplification_benchmark_done) {
+				const auto& simplification_benchmark = gui_data.simplification_benchmark_result;
+				ImGui::Text("%u meshes, %u triangles: 1 worker %.1f ms, %u workers %.1f ms", simplification_benchmark.num_meshes, simplification_benchmark.num_triangles,
+					simplification_benchmark.single_thread_ms, simplification_benchmark.num_workers, simplification_benchmark.multi_thread_ms);
+				ImGui::Text("Scene LODs built in %.1f ms:", simplification_benchmark.scene_lod_build_ms);
+				for(uint32_t lod_level = 0; lod_level < simplification_benchmark.num_scene_lods; ++lod_level) {
+					ImGui::SameLine();
+					ImGui::Text(" %u", simplification_benchmark.a_num_scene_triangles[lod_level]);
+				}
+			}
+			if(ImGui::Button("Run Meshlet Benchmark")) { gui_data.is_meshlet_benchmark_requested = true; }
+			if(gui_data.is_meshlet_benchmark_done) {
+				const auto& meshlet_benchmark = gui_data.meshlet_benchmark_result;
+				ImGui::Text("%u meshes, %u triangles, %u meshlets: 1 worker %.1f ms, %u workers %.1f ms", meshlet_benchmark.num_meshes, meshlet_benchmark.num_triangles,
+					meshlet_benchmark.num_meshlets, meshlet_benchmark.single_thread_ms, meshlet_benchmark.num_workers, meshlet_benchmark.multi_thread_ms);
+				ImGui::Text("Culling all meshlets from %u views: %.3f ms per view", meshlet_benchmark.num_views, meshlet_benchmark.cull_ms);
+				ImGui::Text("Scene: %u meshlets of %u triangles in all LODs, built in %.1f ms", meshlet_benchmark.num_scene_meshlets, meshlet_benchmark.num_scene_triangles, meshlet_benchmark.scene_meshlet_build_ms);
+			}
+		}
+		ImGui::Separator();
+		{
+			ImGui::Text("Memory: ");
+			const char* a_heap_pools[] = { "Buffers", "Upload Buffers", "Small Textures", "Textures", "Render Targets" };
+			static_assert(IM_ARRAYSIZE(a_heap_pools) == heap_pool_count, "Every heap pool needs a name");
+			for(uint32_t pool_index = 0; pool_index < heap_pool_count; ++pool_index) {
+				auto& statistics = gui_data.a_heap_statistics[pool_index];
+				ImGui::Text("%s: %.1f / %.1f MB in %u heaps, %u allocations, %u free blocks (largest %.1f MB)", a_heap_pools[pool_index],
+					statistics.allocated_size / (1024.0 * 1024.0), statistics.reserved_size / (1024.0 * 1024.0), statistics.num_pages,
+					statistics.num_allocations, statistics.num_free_blocks, statistics.largest_free_block_size / (1024.0 * 1024.0));
+			}
+			if(ImGui::Button("Defragment Texture Heaps")) { gui_data.is_heap_defragmentation_requested = true; }
+
+			auto& residency_statistics = gui_data.residency_statistics;
+			ImGui::Text("Resident: %.1f / %.1f MB in %u / %u heaps, budget %.1f MB", residency_statistics.resident_size / (1024.0 * 1024.0), residency_statistics.registered_size / (1024.0 * 1024.0),
+				residency_statistics.num_resident_pageables, residency_statistics.num_pageables, residency_statistics.budget / (1024.0 * 1024.0));
+			ImGui::Text("Process: %.1f MB used of %.1f MB OS budget, %llu evictions, %llu made resident", residency_statistics.os_usage / (1024.0 * 1024.0), residency_statistics.os_budget / (1024.0 * 1024.0),
+				residency_statistics.num_evictions, residency_statistics.num_make_residents);
+			ImGui::Checkbox("Simulate Budget", &gui_data.is_residency_budget_simulated);
+			if(gui_data.is_residency_budget_simulated) {
+				ImGui::SliderInt("Simulated Budget (MB)", reinterpret_cast<int*>(&gui_data.simulated_residency_budget_in_mb), 0, 4096);
+			}
+		}
+		ImGui::Separator();
 		{
 			ImGui::Text("Model: ");
 			const char* a_scenes[] = { "CVC Helmet", "Damaged Sci-fi Helmet", "Cartoon Pony", "Vintage Suitcase"};
+			static_assert(IM_ARRAYSIZE(a_scenes) == model_scene_count, "Every model scene needs a name");
 			ImGui::Combo("Model", reinterpret_cast<int*>(&gui_data.model_scene_index), a_scenes, IM_ARRAYSIZE(a_scenes));
+			auto show_image_decode_timings = [](const void *p_id, const char *p_scene, const ImageDecodeTiming *p_timings, uint32_t num_timings) {
+				if(num_timings > 0 && ImGui::TreeNode(p_id, "%s images", p_scene)) {
+					for(uint32_t image_index = 0; image_index < num_timings; ++image_index) {
+						auto& image_timing = p_timings[image_index];
+						ImGui::Text("%s %ux%u x%u: decode %.2f ms, expand %.2f ms", image_timing.name, image_timing.width, image_timing.height,
+							image_timing.num_source_channels, image_timing.decode_ms, image_timing.expand_ms);
+					}
+					ImGui::TreePop();
+				}
+			};
+			for(uint32_t scene_index = 0; scene_index < model_scene_count; ++scene_index) {
+				ImGui::Text("%s: loaded in %.1f ms (%s)", a_scenes[scene_index], gui_data.a_scene_load_ms[scene_index], gui_data.a_is_scene_mapped[scene_index] ? "mapped" : "tinygltf");
+				show_image_decode_timings(gui_data.a_scene_image_decode_timings[scene_index], a_scenes[scene_index], gui_data.a_scene_image_decode_timings[scene_index], gui_data.a_num_scene_image_decode_timings[scene_index]);
+			}
+			auto& cache_statistics = gui_data.texture_cache_statistics;
+			ImGui::Text("Texture cache: %u shared, %u from disk, %u processed; %u files, %.1f MB, %u evicted", cache_statistics.num_memory_hits, cache_statistics.num_disk_hits,
+				cache_statistics.num_misses, cache_statistics.num_files, cache_statistics.disk_size / (1024.0 * 1024.0), cache_statistics.num_evicted_files);
+			if(ImGui::Button("Compare glTF Loaders")) { gui_data.is_gltf_load_comparison_requested = true; }
+			if(gui_data.is_gltf_load_comparison_done) {
+				for(uint32_t scene_index = 0; scene_index < model_scene_count; ++scene_index) {
+					auto& timing = gui_data.a_gltf_load_timings[scene_index];
+					ImGui::Text("%s: mapped %.1f ms (images %.1f ms), tinygltf %.1f ms; parse only: mapped %.2f ms, tinygltf %.2f ms; tinygltf copies %.1f MB", a_scenes[scene_index],
+						timing.mapped_load_ms, timing.mapped_image_decode_ms, timing.tinygltf_load_ms, timing.mapped_parse_ms, timing.tinygltf_parse_ms, timing.tinygltf_buffer_bytes_copied / (1024.0 * 1024.0));
+					show_image_decode_timings(gui_data.a_image_decode_timings[scene_index], a_scenes[scene_index], gui_data.a_image_decode_timings[scene_index], gui_data.a_num_image_decode_timings[scene_index]);
+				}
+			}
 		}
 		ImGui::Separator();
 		{
@@ -83,7 +277,8 @@ namespace gui
 		}
 		ImGui::Separator();
 		{
-			ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+			float smoothed_delta_ms = gui_data.frame_timing_statistics.smoothed_delta_ms;
+			ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", smoothed_delta_ms, (smoothed_delta_ms > 0.0f) ? 1000.0f / smoothed_delta_ms : 0.0f);
 			//ImGui::Text("Camera Yaw: %.3f Pitch: %3.f", XMConvertToDegrees(gui_data.camera_yaw), XMConvertToDegrees(gui_data.camera_pitch));
 			//ImGui::Text("Camera Pos:%.5f,%.5f,%.5f",gui_data.camera_pos.x, gui_data.camera_pos.y, gui_data.camera_pos.z);
 		}
@@ -91,9 +286,27 @@ namespace gui
 		ImGui::End();
 	}
 
-	void render() {
+	// The draw lists imgui owns are rebuilt by the next frame while the render thread may still be recording this one, the packet gets copies
+	void end_frame(FramePacket &frame_packet) {
 		ImGui::Render();
-		ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData());
+		release_draw_lists(frame_packet);
+		ImDrawData *p_draw_data = ImGui::GetDrawData();
+		for(int list_index = 0; list_index < p_draw_data->CmdListsCount; ++list_index) {
+			frame_packet.v_p_gui_draw_lists.push_back(p_draw_data->CmdLists[list_index]->CloneOutput());
+		}
+	}
+
+	// Runs on the render thread and reads nothing of the imgui context but the display size, which only changes while the pipeline is flushed for a resize
+	void render(FramePacket &frame_packet, ID3D12GraphicsCommandList *p_command_list) {
+		ImDrawData draw_data;
+		draw_data.Valid = true;
+		draw_data.CmdLists = frame_packet.v_p_gui_draw_lists.data();
+		draw_data.CmdListsCount = static_cast<int>(frame_packet.v_p_gui_draw_lists.size());
+		for(ImDrawList *p_draw_list : frame_packet.v_p_gui_draw_lists) {
+			draw_data.TotalVtxCount += p_draw_list->VtxBuffer.Size;
+			draw_data.TotalIdxCount += p_draw_list->IdxBuffer.Size;
+		}
+		ImGui_ImplDX12_RenderDrawData(&draw_data, p_command_list);
 	}
 
 	GuiData& get_data() {
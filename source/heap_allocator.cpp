@@ -0,0 +1,429 @@
+namespace heap_allocator
+{
+	// Two level segregated fit (TLSF) allocator that hands out ranges of the heaps of a pool, placed resources are then created at those offsets.
+	// A pool grows by pages of page_size bytes, allocations that do not fit into one get a dedicated page of their own.
+	// Nothing here touches the device, the renderer creates one ID3D12Heap per page.
+	constexpr uint32_t invalid_index{ UINT32_MAX };
+	constexpr uint32_t second_level_log2{ 4 };
+	constexpr uint32_t second_level_count{ 1u << second_level_log2 };
+	constexpr uint32_t first_level_count{ 48 };
+	// Every offset and size is a multiple of it, it is also the smallest free block that is kept around after a split
+	constexpr uint64_t min_block_size{ 256 };
+	constexpr uint64_t page_granularity{ 64 * 1024 };
+
+	struct Block {
+		uint64_t offset;
+		uint64_t size;
+		uint64_t alignment;
+		uint64_t user_data;
+		uint32_t page_index;
+		uint32_t prev_physical_index;
+		uint32_t next_physical_index;
+		uint32_t prev_free_index;
+		uint32_t next_free_index;
+		bool is_free;
+	};
+
+	struct Page {
+		uint64_t size;
+		uint64_t allocated_size;
+		uint32_t num_allocations;
+		uint32_t first_block_index;
+		bool is_dedicated;
+		bool is_released;
+		uint64_t first_level_bitmap;
+		array<uint32_t, first_level_count> a_second_level_bitmaps;
+		array<array<uint32_t, second_level_count>, first_level_count> a_free_list_heads;
+	};
+
+	// Blocks of every page share one array, slots of merged blocks are recycled
+	struct Pool {
+		string name;
+		uint64_t page_size;
+		vector<Page> v_pages;
+		vector<Block> v_blocks;
+		vector<uint32_t> v_unused_block_indices;
+	};
+
+	struct Allocation {
+		uint32_t page_index{ invalid_index };
+		uint32_t block_index{ invalid_index };
+		uint64_t offset{ 0 };
+		uint64_t size{ 0 };
+
+		bool is_valid() const {
+			return block_index != invalid_index;
+		}
+	};
+
+	// Allocation to copy from source to destination, the caller moves the resource and then ends the defragmentation
+	struct DefragmentationMove {
+		Allocation source;
+		Allocation destination;
+		uint64_t user_data;
+	};
+
+	inline uint32_t find_last_set(uint64_t value) {
+#if defined(_MSC_VER)
+		unsigned long bit_index;
+		_BitScanReverse64(&bit_index, value);
+		return bit_index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	inline uint32_t find_first_set(uint64_t value) {
+#if defined(_MSC_VER)
+		unsigned long bit_index;
+		_BitScanForward64(&bit_index, value);
+		return bit_index;
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+	inline uint64_t align_up(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	inline void get_free_list_indices(uint64_t size, uint32_t &first_level, uint32_t &second_level) {
+		first_level = find_last_set(size);
+		second_level = static_cast<uint32_t>(size >> (first_level - second_level_log2)) ^ second_level_count;
+	}
+
+	void init(Pool &pool, const string &name, uint64_t page_size) {
+		pool = {};
+		pool.name = name;
+		pool.page_size = align_up(page_size, page_granularity);
+	}
+
+	uint32_t create_block(Pool &pool) {
+		if(!pool.v_unused_block_indices.empty()) {
+			uint32_t block_index = pool.v_unused_block_indices.back();
+			pool.v_unused_block_indices.pop_back();
+			return block_index;
+		}
+		pool.v_blocks.push_back({});
+		return static_cast<uint32_t>(pool.v_blocks.size() - 1);
+	}
+
+	void destroy_block(Pool &pool, uint32_t block_index) {
+		pool.v_blocks[block_index].page_index = invalid_index;
+		pool.v_unused_block_indices.push_back(block_index);
+	}
+
+	void insert_free_block(Pool &pool, uint32_t block_index) {
+		auto& block = pool.v_blocks[block_index];
+		auto& page = pool.v_pages[block.page_index];
+		uint32_t first_level, second_level;
+		get_free_list_indices(block.size, first_level, second_level);
+
+		uint32_t head_index = page.a_free_list_heads[first_level][second_level];
+		block.is_free = true;
+		block.prev_free_index = invalid_index;
+		block.next_free_index = head_index;
+		if(head_index != invalid_index) {
+			pool.v_blocks[head_index].prev_free_index = block_index;
+		}
+		page.a_free_list_heads[first_level][second_level] = block_index;
+		page.first_level_bitmap |= 1ull << first_level;
+		page.a_second_level_bitmaps[first_level] |= 1u << second_level;
+	}
+
+	void remove_free_block(Pool &pool, uint32_t block_index) {
+		auto& block = pool.v_blocks[block_index];
+		auto& page = pool.v_pages[block.page_index];
+		uint32_t first_level, second_level;
+		get_free_list_indices(block.size, first_level, second_level);
+
+		if(block.prev_free_index != invalid_index) {
+			pool.v_blocks[block.prev_free_index].next_free_index = block.next_free_index;
+		}
+		if(block.next_free_index != invalid_index) {
+			pool.v_blocks[block.next_free_index].prev_free_index = block.prev_free_index;
+		}
+		if(page.a_free_list_heads[first_level][second_level] == block_index) {
+			page.a_free_list_heads[first_level][second_level] = block.next_free_index;
+			if(block.next_free_index == invalid_index) {
+				page.a_second_level_bitmaps[first_level] &= ~(1u << second_level);
+				if(page.a_second_level_bitmaps[first_level] == 0) {
+					page.first_level_bitmap &= ~(1ull << first_level);
+				}
+			}
+		}
+		block.is_free = false;
+		block.prev_free_index = invalid_index;
+		block.next_free_index = invalid_index;
+	}
+
+	// Good fit: the size is rounded up to the next list so that any block of the list found is large enough
+	uint32_t find_free_block(const Pool &pool, uint32_t page_index, uint64_t size) {
+		auto& page = pool.v_pages[page_index];
+		uint64_t rounded_size = size + (1ull << (find_last_set(size) - second_level_log2)) - 1;
+		uint32_t first_level, second_level;
+		get_free_list_indices(rounded_size, first_level, second_level);
+		if(first_level >= first_level_count) { return invalid_index; }
+
+		uint32_t second_level_bitmap = page.a_second_level_bitmaps[first_level] & (~0u << second_level);
+		if(second_level_bitmap == 0) {
+			uint64_t first_level_bitmap = (first_level + 1 < 64) ? page.first_level_bitmap & (~0ull << (first_level + 1)) : 0;
+			if(first_level_bitmap == 0) { return invalid_index; }
+			first_level = find_first_set(first_level_bitmap);
+			second_level_bitmap = page.a_second_level_bitmaps[first_level];
+		}
+		return page.a_free_list_heads[first_level][find_first_set(second_level_bitmap)];
+	}
+
+	// Splits off the part of a block after size as a new free block
+	void split_block(Pool &pool, uint32_t block_index, uint64_t size) {
+		uint32_t remainder_index = create_block(pool);
+		auto& block = pool.v_blocks[block_index];
+		auto& remainder = pool.v_blocks[remainder_index];
+		remainder = block;
+		remainder.offset = block.offset + size;
+		remainder.size = block.size - size;
+		remainder.prev_physical_index = block_index;
+		if(block.next_physical_index != invalid_index) {
+			pool.v_blocks[block.next_physical_index].prev_physical_index = remainder_index;
+		}
+		block.next_physical_index = remainder_index;
+		block.size = size;
+		insert_free_block(pool, remainder_index);
+	}
+
+	// Absorbs the physically next block, which has to be free, into block_index
+	void merge_with_next_block(Pool &pool, uint32_t block_index) {
+		auto& block = pool.v_blocks[block_index];
+		uint32_t next_index = block.next_physical_index;
+		auto& next = pool.v_blocks[next_index];
+		remove_free_block(pool, next_index);
+		block.size += next.size;
+		block.next_physical_index = next.next_physical_index;
+		if(next.next_physical_index != invalid_index) {
+			pool.v_blocks[next.next_physical_index].prev_physical_index = block_index;
+		}
+		destroy_block(pool, next_index);
+	}
+
+	uint32_t add_page(Pool &pool, uint64_t size, bool is_dedicated) {
+		uint32_t page_index = 0;
+		while(page_index < pool.v_pages.size() && !pool.v_pages[page_index].is_released) {
+			++page_index;
+		}
+		if(page_index == pool.v_pages.size()) {
+			pool.v_pages.push_back({});
+		}
+
+		auto& page = pool.v_pages[page_index];
+		page = {};
+		page.size = size;
+		page.is_dedicated = is_dedicated;
+		for(auto& free_list_heads : page.a_free_list_heads) {
+			free_list_heads.fill(invalid_index);
+		}
+
+		uint32_t block_index = create_block(pool);
+		auto& block = pool.v_blocks[block_index];
+		block = {};
+		block.size = size;
+		block.page_index = page_index;
+		block.prev_physical_index = invalid_index;
+		block.next_physical_index = invalid_index;
+		page.first_block_index = block_index;
+		insert_free_block(pool, block_index);
+		return page_index;
+	}
+
+	// The free block has to be large enough for size after aligning its offset
+	void allocate_from_block(Pool &pool, uint32_t block_index, uint64_t size, uint64_t alignment, uint64_t user_data, Allocation &allocation) {
+		remove_free_block(pool, block_index);
+
+		uint64_t padding = align_up(pool.v_blocks[block_index].offset, alignment) - pool.v_blocks[block_index].offset;
+		if(padding > 0) {
+			// The physically previous block is never free, so the padding can become a free block of its own
+			split_block(pool, block_index, padding);
+			uint32_t aligned_index = pool.v_blocks[block_index].next_physical_index;
+			remove_free_block(pool, aligned_index);
+			insert_free_block(pool, block_index);
+			block_index = aligned_index;
+		}
+		if(pool.v_blocks[block_index].size - size >= min_block_size) {
+			split_block(pool, block_index, size);
+		}
+
+		auto& block = pool.v_blocks[block_index];
+		block.alignment = alignment;
+		block.user_data = user_data;
+		auto& page = pool.v_pages[block.page_index];
+		page.allocated_size += block.size;
+		page.num_allocations++;
+
+		allocation.page_index = block.page_index;
+		allocation.block_index = block_index;
+		allocation.offset = block.offset;
+		allocation.size = block.size;
+	}
+
+	bool allocate_from_page(Pool &pool, uint32_t page_index, uint64_t size, uint64_t alignment, uint64_t user_data, Allocation &allocation) {
+		if(pool.v_pages[page_index].is_released) { return false; }
+
+		// Large enough for the worst case padding in front of the aligned offset
+		uint64_t padded_size = size + ((alignment > min_block_size) ? alignment - min_block_size : 0);
+		uint32_t block_index = find_free_block(pool, page_index, padded_size);
+		if(block_index == invalid_index) { return false; }
+		allocate_from_block(pool, block_index, size, alignment, user_data, allocation);
+		return true;
+	}
+
+	// Alignment has to be a power of two, user_data is handed back by the defragmentation
+	Allocation allocate(Pool &pool, uint64_t size, uint64_t alignment, uint64_t user_data = 0) {
+		size = align_up(max(size, min_block_size), min_block_size);
+		alignment = max(alignment, min_block_size);
+
+		Allocation allocation;
+		for(uint32_t page_index = 0; page_index < pool.v_pages.size(); ++page_index) {
+			if(allocate_from_page(pool, page_index, size, alignment, user_data, allocation)) {
+				return allocation;
+			}
+		}
+
+		// A new page is a single free block at offset 0 of a heap, which is aligned enough for any placed resource
+		bool is_dedicated = size > pool.page_size;
+		uint32_t page_index = add_page(pool, is_dedicated ? align_up(size, page_granularity) : pool.page_size, is_dedicated);
+		allocate_from_block(pool, pool.v_pages[page_index].first_block_index, size, alignment, user_data, allocation);
+		return allocation;
+	}
+
+	// Returns true when the allocation was the last one of a dedicated page, which is then released together with its heap
+	bool deallocate(Pool &pool, Allocation &allocation) {
+		if(!allocation.is_valid()) { return false; }
+
+		uint32_t block_index = allocation.block_index;
+		auto& page = pool.v_pages[allocation.page_index];
+		page.allocated_size -= pool.v_blocks[block_index].size;
+		page.num_allocations--;
+		allocation = {};
+
+		uint32_t next_index = pool.v_blocks[block_index].next_physical_index;
+		if(next_index != invalid_index && pool.v_blocks[next_index].is_free) {
+			merge_with_next_block(pool, block_index);
+		}
+		uint32_t prev_index = pool.v_blocks[block_index].prev_physical_index;
+		if(prev_index != invalid_index && pool.v_blocks[prev_index].is_free) {
+			remove_free_block(pool, prev_index);
+			merge_with_next_block(pool, prev_index);
+			block_index = prev_index;
+		}
+		insert_free_block(pool, block_index);
+
+		if(page.is_dedicated && page.num_allocations == 0) {
+			remove_free_block(pool, block_index);
+			destroy_block(pool, block_index);
+			page.is_released = true;
+			return true;
+		}
+		return false;
+	}
+
+	// Releases the pages nothing is allocated from anymore, their indices are returned so that the caller can release the heaps too
+	vector<uint32_t> release_empty_pages(Pool &pool) {
+		vector<uint32_t> v_released_page_indices;
+		for(uint32_t page_index = 0; page_index < pool.v_pages.size(); ++page_index) {
+			auto& page = pool.v_pages[page_index];
+			if(!page.is_released && page.num_allocations == 0) {
+				remove_free_block(pool, page.first_block_index);
+				destroy_block(pool, page.first_block_index);
+				page.is_released = true;
+				v_released_page_indices.push_back(page_index);
+			}
+		}
+		return v_released_page_indices;
+	}
+
+	// Plans moving every allocation out of the least occupied pages into the free space of the others, at most max_moved_size bytes.
+	// The destinations are already allocated, the sources stay allocated until end_defragmentation.
+	// A page that received moves is not evacuated itself, its new blocks would be copied twice and counted twice against the budget.
+	vector<DefragmentationMove> begin_defragmentation(Pool &pool, uint64_t max_moved_size) {
+		vector<uint32_t> v_candidate_page_indices;
+		for(uint32_t page_index = 0; page_index < pool.v_pages.size(); ++page_index) {
+			auto& page = pool.v_pages[page_index];
+			if(!page.is_released && !page.is_dedicated && page.num_allocations > 0) {
+				v_candidate_page_indices.push_back(page_index);
+			}
+		}
+		stable_sort(v_candidate_page_indices.begin(), v_candidate_page_indices.end(), [&](uint32_t a, uint32_t b) { return pool.v_pages[a].allocated_size < pool.v_pages[b].allocated_size; });
+
+		vector<DefragmentationMove> v_moves;
+		vector<bool> v_is_evacuated(pool.v_pages.size(), false);
+		vector<bool> v_is_destination(pool.v_pages.size(), false);
+		uint64_t moved_size = 0;
+		for(uint32_t source_page_index : v_candidate_page_indices) {
+			if(v_is_destination[source_page_index]) { continue; }
+			auto& source_page = pool.v_pages[source_page_index];
+			if(moved_size + source_page.allocated_size > max_moved_size) { break; }
+			v_is_evacuated[source_page_index] = true;
+
+			size_t first_move_index = v_moves.size();
+			bool is_page_evacuated = true;
+			for(uint32_t block_index = source_page.first_block_index; block_index != invalid_index && is_page_evacuated; block_index = pool.v_blocks[block_index].next_physical_index) {
+				if(pool.v_blocks[block_index].is_free) { continue; }
+				auto block = pool.v_blocks[block_index];
+
+				DefragmentationMove move = {};
+				move.source.page_index = source_page_index;
+				move.source.block_index = block_index;
+				move.source.offset = block.offset;
+				move.source.size = block.size;
+				move.user_data = block.user_data;
+				is_page_evacuated = false;
+				for(uint32_t page_index = 0; page_index < pool.v_pages.size() && !is_page_evacuated; ++page_index) {
+					if(v_is_evacuated[page_index] || pool.v_pages[page_index].is_dedicated) { continue; }
+					is_page_evacuated = allocate_from_page(pool, page_index, block.size, block.alignment, block.user_data, move.destination);
+				}
+				if(is_page_evacuated) {
+					v_is_destination[move.destination.page_index] = true;
+					v_moves.push_back(move);
+				}
+			}
+
+			// Moving only part of a page would not give any memory back
+			if(!is_page_evacuated) {
+				for(size_t move_index = first_move_index; move_index < v_moves.size(); ++move_index) {
+					deallocate(pool, v_moves[move_index].destination);
+				}
+				v_moves.resize(first_move_index);
+				break;
+			}
+			moved_size += source_page.allocated_size;
+		}
+		return v_moves;
+	}
+
+	// Frees the sources of the moves once the resources have been moved, returns the pages that became empty
+	vector<uint32_t> end_defragmentation(Pool &pool, vector<DefragmentationMove> &v_moves) {
+		for(auto& move : v_moves) {
+			deallocate(pool, move.source);
+		}
+		v_moves.clear();
+		return release_empty_pages(pool);
+	}
+
+	HeapStatistics get_statistics(const Pool &pool) {
+		HeapStatistics statistics = {};
+		for(auto& page : pool.v_pages) {
+			if(page.is_released) { continue; }
+			statistics.num_pages++;
+			statistics.reserved_size += page.size;
+			statistics.allocated_size += page.allocated_size;
+			statistics.num_allocations += page.num_allocations;
+		}
+		for(auto& block : pool.v_blocks) {
+			if(block.page_index != invalid_index && block.is_free) {
+				statistics.num_free_blocks++;
+				statistics.largest_free_block_size = max(statistics.largest_free_block_size, block.size);
+			}
+		}
+		return statistics;
+	}
+}
@@ -0,0 +1,95 @@
+namespace image_stream
+{
+	// Reads .octrn images straight out of a mapped view: every subresource is copied from the view into its upload footprint,
+	// so the file is never read into a buffer of its own. open() asks the OS to page the data in ahead of time; the caller places
+	// the texture or opens further files meanwhile, and the copies only wait for pages that have not arrived yet.
+	// File layout: magic, version, OctarineImageHeader, then the subresources tightly packed in subresource index order.
+	constexpr uint64_t file_magic{ 0x6F63746172696E65 }; // "octarine"
+	constexpr size_t header_offset{ 16 };
+	constexpr size_t data_offset{ header_offset + sizeof(OctarineImageHeader) };
+
+	struct Stream {
+		gltf_loader::MappedFile mapped_file;
+		OctarineImageHeader header;
+		const uint8_t *p_data;
+	};
+
+	// One slice of a subresource, its rows are row_size bytes long in both layouts
+	struct SliceCopy {
+		uint64_t src_offset;
+		uint64_t dst_offset;
+		uint64_t src_row_pitch;
+		uint64_t dst_row_pitch;
+		uint64_t row_size;
+		uint32_t num_rows;
+	};
+
+	void close(Stream &stream) {
+		gltf_loader::unmap_file(stream.mapped_file);
+		stream = {};
+	}
+
+	// Returns false when the file cannot be mapped or is not an .octrn image whose data fits into it
+	bool open(const string &file_address, Stream &stream) {
+		stream = {};
+		if(!gltf_loader::map_file(file_address, stream.mapped_file)) { return false; }
+		const auto& mapped_file = stream.mapped_file;
+
+		uint64_t magic = 0;
+		if(mapped_file.size >= data_offset) {
+			memcpy(&magic, mapped_file.p_data, sizeof(magic));
+			memcpy(&stream.header, mapped_file.p_data + header_offset, sizeof(OctarineImageHeader));
+		}
+		if(magic != file_magic || stream.header.size_of_data > mapped_file.size - data_offset) {
+			close(stream);
+			return false;
+		}
+		stream.p_data = mapped_file.p_data + data_offset;
+
+		WIN32_MEMORY_RANGE_ENTRY range = { const_cast<uint8_t*>(stream.p_data), stream.header.size_of_data };
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+		return true;
+	}
+
+	// Pairs the packed source layout octarine describes with the destination footprints of the upload buffer, needs no device.
+	// Throws when a subresource does not fit into src_size bytes, since its rows would then be read from past the file.
+	vector<SliceCopy> get_slice_copies(uint32_t num_subresources, const uint64_t *p_src_offsets, const uint64_t *p_src_row_sizes, uint64_t src_size,
+		const D3D12_PLACED_SUBRESOURCE_FOOTPRINT *p_dst_footprints, const UINT *p_dst_num_rows, const UINT64 *p_dst_row_sizes) {
+		vector<SliceCopy> v_slice_copies;
+		for(uint32_t subresource_index = 0; subresource_index < num_subresources; ++subresource_index) {
+			const auto& footprint = p_dst_footprints[subresource_index];
+			uint32_t num_rows = p_dst_num_rows[subresource_index];
+			uint64_t src_row_pitch = p_src_row_sizes[subresource_index];
+			uint64_t row_size = p_dst_row_sizes[subresource_index];
+			uint64_t src_slice_pitch = src_row_pitch * num_rows;
+			uint64_t dst_slice_pitch = uint64_t(footprint.Footprint.RowPitch) * num_rows;
+			if(row_size > src_row_pitch || p_src_offsets[subresource_index] + src_slice_pitch * footprint.Footprint.Depth > src_size) {
+				throw exception("Truncated .octrn image data");
+			}
+			for(uint32_t slice_index = 0; slice_index < footprint.Footprint.Depth; ++slice_index) {
+				SliceCopy slice_copy;
+				slice_copy.src_offset = p_src_offsets[subresource_index] + src_slice_pitch * slice_index;
+				slice_copy.dst_offset = footprint.Offset + dst_slice_pitch * slice_index;
+				slice_copy.src_row_pitch = src_row_pitch;
+				slice_copy.dst_row_pitch = footprint.Footprint.RowPitch;
+				slice_copy.row_size = row_size;
+				slice_copy.num_rows = num_rows;
+				v_slice_copies.push_back(slice_copy);
+			}
+		}
+		return v_slice_copies;
+	}
+
+	// Slices whose rows are not padded in either layout are copied at once
+	void copy_slice(const SliceCopy &slice_copy, const uint8_t *p_src, uint8_t *p_dst) {
+		p_src += slice_copy.src_offset;
+		p_dst += slice_copy.dst_offset;
+		if(slice_copy.src_row_pitch == slice_copy.row_size && slice_copy.dst_row_pitch == slice_copy.row_size) {
+			memcpy(p_dst, p_src, slice_copy.row_size * slice_copy.num_rows);
+			return;
+		}
+		for(uint32_t row_index = 0; row_index < slice_copy.num_rows; ++row_index) {
+			memcpy(p_dst + slice_copy.dst_row_pitch * row_index, p_src + slice_copy.src_row_pitch * row_index, slice_copy.row_size);
+		}
+	}
+} // namespace image_stream
@@ -0,0 +1,378 @@
+namespace job_system
+{
+	// Work-stealing scheduler. Every worker owns a Chase-Lev deque: it pushes and pops jobs at the bottom, the others steal from the top.
+	// The main thread is worker 0 and runs jobs only while it waits; threads that are not workers run the jobs they start inline.
+	// Counters track groups of jobs: run() increments them and finishing a job decrements them, wait() runs jobs until its counter is zero
+	// and rethrows the first exception a job of the counter threw. Idle workers spin for a while and then sleep until jobs are queued.
+	constexpr uint32_t queue_capacity{ 4096 };
+	constexpr uint32_t invalid_worker_index{ UINT32_MAX };
+	constexpr uint32_t num_idle_spins{ 256 };
+	constexpr uint32_t num_batches_per_worker{ 4 };
+
+	struct Counter {
+		atomic<uint32_t> value{ 0 };
+		atomic<bool> has_exception{ false };
+		exception_ptr first_exception;
+	};
+
+	struct Job {
+		function<void()> task;
+		Counter *p_counter;
+		atomic<bool> is_in_use;
+	};
+
+	struct WorkStealingQueue {
+		atomic<Job*> a_p_jobs[queue_capacity];
+		atomic<int64_t> bottom;
+		atomic<int64_t> top;
+	};
+
+	// Jobs are recycled in order, one that is still in use when its turn comes means too many jobs are in flight and the task runs inline
+	struct Worker {
+		WorkStealingQueue queue;
+		Job a_jobs[queue_capacity];
+		uint32_t next_job_index;
+	};
+
+	vector<unique_ptr<Worker>> v_up_workers;
+	vector<thread> v_threads;
+	atomic<uint32_t> num_queued_jobs{ 0 };
+	atomic<uint32_t> num_sleeping_workers{ 0 };
+	atomic<bool> is_shutting_down{ false };
+	mutex sleep_mutex;
+	condition_variable sleep_condition;
+	thread_local uint32_t worker_index{ invalid_worker_index };
+	thread_local uint64_t steal_random_state{ 0x9E3779B97F4A7C15ull };
+
+	// Only the owner pushes, so the queue can only have become less full since top was read
+	bool push(WorkStealingQueue &queue, Job *p_job) {
+		int64_t bottom = queue.bottom.load(memory_order_relaxed);
+		if(bottom - queue.top.load(memory_order_acquire) >= queue_capacity) {
+			return false;
+		}
+		queue.a_p_jobs[bottom & (queue_capacity - 1)].store(p_job, memory_order_relaxed);
+		queue.bottom.store(bottom + 1, memory_order_release);
+		return true;
+	}
+
+	// The owner and a thief race for the last job through top
+	Job* pop(WorkStealingQueue &queue) {
+		int64_t bottom = queue.bottom.load(memory_order_relaxed) - 1;
+		queue.bottom.store(bottom, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		int64_t top = queue.top.load(memory_order_relaxed);
+		if(top > bottom) {
+			queue.bottom.store(bottom + 1, memory_order_relaxed);
+			return nullptr;
+		}
+		Job *p_job = queue.a_p_jobs[bottom & (queue_capacity - 1)].load(memory_order_relaxed);
+		if(top == bottom) {
+			if(!queue.top.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+				p_job = nullptr;
+			}
+			queue.bottom.store(bottom + 1, memory_order_relaxed);
+		}
+		return p_job;
+	}
+
+	Job* steal(WorkStealingQueue &queue) {
+		int64_t top = queue.top.load(memory_order_acquire);
+		atomic_thread_fence(memory_order_seq_cst);
+		int64_t bottom = queue.bottom.load(memory_order_acquire);
+		if(top >= bottom) {
+			return nullptr;
+		}
+		Job *p_job = queue.a_p_jobs[top & (queue_capacity - 1)].load(memory_order_relaxed);
+		if(!queue.top.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+			return nullptr;
+		}
+		return p_job;
+	}
+
+	// Own jobs first, newest first for locality, then the oldest job of a randomly chosen victim
+	Job* get_job() {
+		Job *p_job = (worker_index != invalid_worker_index) ? pop(v_up_workers[worker_index]->queue) : nullptr;
+		uint32_t num_workers = static_cast<uint32_t>(v_up_workers.size());
+		if(!p_job && num_workers > 0) {
+			steal_random_state ^= steal_random_state << 13; steal_random_state ^= steal_random_state >> 7; steal_random_state ^= steal_random_state << 17;
+			uint32_t first_victim_index = static_cast<uint32_t>(steal_random_state % num_workers);
+			for(uint32_t attempt = 0; attempt < num_workers && !p_job; ++attempt) {
+				uint32_t victim_index = (first_victim_index + attempt) % num_workers;
+				if(victim_index != worker_index) {
+					p_job = steal(v_up_workers[victim_index]->queue);
+				}
+			}
+		}
+		if(p_job) {
+			num_queued_jobs.fetch_sub(1, memory_order_relaxed);
+		}
+		return p_job;
+	}
+
+	void finish(Counter &counter) {
+		counter.value.fetch_sub(1, memory_order_release);
+	}
+
+	void execute(function<void()> &task, Counter &counter) {
+		try {
+			task();
+		}
+		catch(...) {
+			bool has_exception = false;
+			if(counter.has_exception.compare_exchange_strong(has_exception, true)) {
+				counter.first_exception = current_exception();
+			}
+		}
+	}
+
+	void execute(Job *p_job) {
+		Counter &counter = *p_job->p_counter;
+		execute(p_job->task, counter);
+		p_job->task = nullptr;
+		p_job->is_in_use.store(false, memory_order_release);
+		finish(counter);
+	}
+
+	void worker_main(uint32_t index) {
+		worker_index = index;
+		steal_random_state += index;
+		uint32_t num_failed_attempts = 0;
+		while(!is_shutting_down.load(memory_order_relaxed)) {
+			if(Job *p_job = get_job()) {
+				execute(p_job);
+				num_failed_attempts = 0;
+				continue;
+			}
+			if(++num_failed_attempts < num_idle_spins) {
+				this_thread::yield();
+				continue;
+			}
+			unique_lock<mutex> lock(sleep_mutex);
+			num_sleeping_workers++;
+			sleep_condition.wait(lock, [] { return num_queued_jobs.load() > 0 || is_shutting_down.load(); });
+			num_sleeping_workers--;
+			num_failed_attempts = 0;
+		}
+	}
+
+	// num_threads counts the calling thread, 0 uses one thread per hardware thread.
+	// Threads the caller creates itself can take one of the num_external_threads worker slots with attach_external_thread().
+	void init(uint32_t num_threads = 0, uint32_t num_external_threads = 0) {
+		if(num_threads == 0) {
+			num_threads = max(1u, thread::hardware_concurrency());
+		}
+		is_shutting_down = false;
+		for(uint32_t index = 0; index < num_threads + num_external_threads; ++index) {
+			auto up_worker = make_unique<Worker>();
+			up_worker->queue.bottom = 0;
+			up_worker->queue.top = 0;
+			up_worker->next_job_index = 0;
+			for(auto& job : up_worker->a_jobs) {
+				job.p_counter = nullptr;
+				job.is_in_use = false;
+			}
+			v_up_workers.push_back(move(up_worker));
+		}
+		worker_index = 0;
+		for(uint32_t index = 1; index < num_threads; ++index) {
+			v_threads.emplace_back(worker_main, index);
+		}
+	}
+
+	// The slots exist from init() on so that the set of queues never changes while workers steal from them
+	void attach_external_thread(uint32_t external_thread_index) {
+		worker_index = static_cast<uint32_t>(v_threads.size()) + 1 + external_thread_index;
+	}
+
+	void shutdown() {
+		{
+			lock_guard<mutex> lock(sleep_mutex);
+			is_shutting_down = true;
+		}
+		sleep_condition.notify_all();
+		for(auto& worker_thread : v_threads) {
+			worker_thread.join();
+		}
+		v_threads.clear();
+		v_up_workers.clear();
+		worker_index = invalid_worker_index;
+	}
+
+	uint32_t get_worker_count() {
+		return max(1u, static_cast<uint32_t>(v_up_workers.size()));
+	}
+
+	void run(function<void()> task, Counter &counter) {
+		counter.value.fetch_add(1, memory_order_relaxed);
+		bool is_queued = false;
+		if(worker_index != invalid_worker_index) {
+			Worker &worker = *v_up_workers[worker_index];
+			Job &job = worker.a_jobs[worker.next_job_index % queue_capacity];
+			if(!job.is_in_use.load(memory_order_acquire)) {
+				job.task = move(task);
+				job.p_counter = &counter;
+				job.is_in_use.store(true, memory_order_relaxed);
+				// Counted before it can be stolen, so that the count never drops below the jobs in the queues
+				num_queued_jobs.fetch_add(1);
+				is_queued = push(worker.queue, &job);
+				if(is_queued) {
+					worker.next_job_index++;
+				}
+				else {
+					num_queued_jobs.fetch_sub(1);
+					task = move(job.task);
+					job.task = nullptr;
+					job.is_in_use.store(false, memory_order_relaxed);
+				}
+			}
+		}
+		if(!is_queued) {
+			execute(task, counter);
+			finish(counter);
+			return;
+		}
+
+		// A worker about to sleep either sees the queued job or is counted as sleeping before this checks
+		if(num_sleeping_workers.load() > 0) {
+			{ lock_guard<mutex> lock(sleep_mutex); }
+			sleep_condition.notify_one();
+		}
+	}
+
+	void wait(Counter &counter) {
+		while(counter.value.load(memory_order_acquire) > 0) {
+			if(Job *p_job = get_job()) {
+				execute(p_job);
+			}
+			else {
+				this_thread::yield();
+			}
+		}
+		if(counter.has_exception.load()) {
+			counter.has_exception = false;
+			rethrow_exception(move(counter.first_exception));
+		}
+	}
+
+	// Splits [0, count) into batches of at least min_batch_size, a few per worker so that stealing evens out uneven batches.
+	// At most max_num_batches batches run at once. The calling thread runs the first batch and returns when all of them are done.
+	void parallel_for(uint32_t count, uint32_t min_batch_size, const function<void(uint32_t begin, uint32_t end)> &body, uint32_t max_num_batches = UINT32_MAX) {
+		if(count == 0) { return; }
+		uint32_t num_batches = max(1u, count / max(1u, min_batch_size));
+		num_batches = min({ num_batches, get_worker_count() * num_batches_per_worker, max(1u, max_num_batches) });
+		uint32_t batch_size = (count + num_batches - 1) / num_batches;
+
+		Counter counter;
+		for(uint32_t begin = batch_size; begin < count; begin += batch_size) {
+			uint32_t end = min(count, begin + batch_size);
+			run([&body, begin, end]() { body(begin, end); }, counter);
+		}
+		function<void()> first_batch = [&body, count, batch_size]() { body(0, min(count, batch_size)); };
+		counter.value.fetch_add(1, memory_order_relaxed);
+		execute(first_batch, counter);
+		finish(counter);
+		wait(counter);
+	}
+
+	// Tasks start once every task they depend on is done, the graph can be run again after run_and_wait() returns
+	struct TaskGraph {
+		struct Task {
+			function<void()> task_function;
+			vector<uint32_t> v_successor_indices;
+			uint32_t num_predecessors;
+			atomic<uint32_t> num_pending_predecessors;
+		};
+		vector<unique_ptr<Task>> v_up_tasks;
+	};
+
+	uint32_t add_task(TaskGraph &graph, function<void()> task_function) {
+		auto up_task = make_unique<TaskGraph::Task>();
+		up_task->task_function = move(task_function);
+		up_task->num_predecessors = 0;
+		graph.v_up_tasks.push_back(move(up_task));
+		return static_cast<uint32_t>(graph.v_up_tasks.size() - 1);
+	}
+
+	void add_dependency(TaskGraph &graph, uint32_t task_index, uint32_t dependency_index) {
+		graph.v_up_tasks[dependency_index]->v_successor_indices.push_back(task_index);
+		graph.v_up_tasks[task_index]->num_predecessors++;
+	}
+
+	// Successors are started by whichever predecessor finishes last, before it finishes itself so the counter never drops to zero early
+	void run_task(TaskGraph &graph, uint32_t task_index, Counter &counter) {
+		run([&graph, task_index, &counter]() {
+			auto& task = *graph.v_up_tasks[task_index];
+			task.task_function();
+			for(uint32_t successor_index : task.v_successor_indices) {
+				if(graph.v_up_tasks[successor_index]->num_pending_predecessors.fetch_sub(1) == 1) {
+					run_task(graph, successor_index, counter);
+				}
+			}
+		}, counter);
+	}
+
+	// A task that throws does not start its successors, the first exception is rethrown once the rest of the graph is done
+	void run_and_wait(TaskGraph &graph) {
+		for(auto& up_task : graph.v_up_tasks) {
+			up_task->num_pending_predecessors = up_task->num_predecessors;
+		}
+		Counter counter;
+		for(uint32_t task_index = 0; task_index < graph.v_up_tasks.size(); ++task_index) {
+			if(graph.v_up_tasks[task_index]->num_predecessors == 0) {
+				run_task(graph, task_index, counter);
+			}
+		}
+		wait(counter);
+	}
+
+	// Scheduling overhead and scaling, best of num_iterations each
+	JobSystemBenchmarkResult run_benchmark(uint32_t num_iterations = 5) {
+		constexpr uint32_t num_empty_jobs{ 64 * 1024 };
+		constexpr uint32_t num_chain_tasks{ 1024 };
+		constexpr uint32_t num_elements{ 1 << 20 };
+		JobSystemBenchmarkResult result = {};
+		result.num_workers = get_worker_count();
+		result.empty_job_ns = FLT_MAX;
+		result.task_chain_ns = FLT_MAX;
+
+		for(uint32_t iteration = 0; iteration < num_iterations; ++iteration) {
+			float ms = measure_ms([&]() {
+				Counter counter;
+				for(uint32_t job_index = 0; job_index < num_empty_jobs; ++job_index) {
+					run([]() {}, counter);
+				}
+				wait(counter);
+			});
+			result.empty_job_ns = min(result.empty_job_ns, ms * 1e6f / num_empty_jobs);
+
+			TaskGraph chain;
+			for(uint32_t task_index = 0; task_index < num_chain_tasks; ++task_index) {
+				add_task(chain, []() {});
+				if(task_index > 0) { add_dependency(chain, task_index, task_index - 1); }
+			}
+			ms = measure_ms([&]() { run_and_wait(chain); });
+			result.task_chain_ns = min(result.task_chain_ns, ms * 1e6f / num_chain_tasks);
+		}
+
+		// The same arithmetic bound loop split into 1, 2, 4... batches, so at most that many workers take part
+		vector<float> v_values(num_elements);
+		auto kernel = [&v_values](uint32_t begin, uint32_t end) {
+			for(uint32_t element_index = begin; element_index < end; ++element_index) {
+				float value = static_cast<float>(element_index);
+				for(uint32_t step = 0; step < 32; ++step) {
+					value = sqrtf(value * 1.0001f + 1.f);
+				}
+				v_values[element_index] = value;
+			}
+		};
+		for(uint32_t num_batches = 1; num_batches <= result.num_workers && result.num_scaling_steps < max_job_benchmark_scaling_step_count; num_batches *= 2) {
+			auto& step = result.a_scaling_steps[result.num_scaling_steps++];
+			step.num_batches = num_batches;
+			step.parallel_for_ms = FLT_MAX;
+			for(uint32_t iteration = 0; iteration < num_iterations; ++iteration) {
+				step.parallel_for_ms = min(step.parallel_for_ms, measure_ms([&]() { parallel_for(num_elements, 1024, kernel, num_batches); }));
+			}
+		}
+		return result;
+	}
+} // namespace job_system
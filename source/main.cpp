@@ -24,22 +24,49 @@
 #include <d3dcompiler.h>
 #include <d3d12sdklayers.h>
 #include <DirectXMath.h>
+#include <intrin.h>
 
 #include <iostream>
 #include <exception>
 #include <vector>
 #include <array>
 #include <fstream>
+#include <future>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <atomic>
+#include <string_view>
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
 using namespace std;
 
 #include "common.cpp"
+#include "job_system.cpp"
+#include "frame_timing.cpp"
 #include "window.cpp"
 #include "gui.cpp"
+#include "draw_sort.cpp"
+#include "draw_cull.cpp"
+#include "occlusion_culler.cpp"
+#include "mesh_simplifier.cpp"
+#include "meshlet_builder.cpp"
+#include "pipeline_cache.cpp"
+#include "render_graph.cpp"
+#include "heap_allocator.cpp"
+#include "residency.cpp"
+#include "gltf_loader.cpp"
+#include "image_stream.cpp"
+#include "texture_cache.cpp"
 #include "renderer.cpp"
 #include "scene_manager.cpp"
+#include "camera_path.cpp"
+#include "frame_pipeline.cpp"
 
 #pragma comment(lib, "dxgi.lib")
 #pragma comment(lib, "d3d12.lib")
@@ -52,6 +79,7 @@ unique_ptr<Window> up_window = nullptr;
 
 void init(HINSTANCE h_instance) {
 
+	job_system::init(0, 1);
 	up_window = make_unique<Window>(h_instance, back_buffer_width, back_buffer_height);
 	renderer::init(up_window->get_handle());
 	scene_manager::init();
@@ -62,25 +90,32 @@ void init(HINSTANCE h_instance) {
 }
 
 void update() {
-	gui::update(renderer::get_command_list());
 	auto& gui_data = gui::get_data();
-
-	scene_manager::update(gui_data);
-	auto [start_index_into_textures, num_used_textures] = scene_manager::get_scene_texture_usage();
-	auto camera = scene_manager::get_camera();
-	
-	renderer::update(gui_data, start_index_into_textures, num_used_textures, camera);
+	FramePacket &frame_packet = frame_pipeline::begin_frame(gui_data);
+	gui::update();
+
+	camera_path::begin_frame(gui_data, frame_packet.frame_number);
+	scene_manager::update(gui_data, frame_packet);
+	camera_path::end_frame(gui_data);
+	gui::end_frame(frame_packet);
+	frame_pipeline::submit_frame(frame_packet, gui_data);
 }
 
-void render_frame() {
+// Runs on the render thread
+void render_frame(FramePacket &frame_packet) {
+	renderer::update(frame_packet);
 	renderer::begin_render();
 	renderer::render();
-	gui::render();
+	gui::render(frame_packet, renderer::get_command_list());
 	renderer::end_render();
+	renderer::present();
+	frame_packet.present_ticks = frame_timing::get_ticks();
+	renderer::prepare_next_frame();
 }
 
 void clean_up() {
 	renderer::wait_for_gpu();
+	renderer::clean_up();
 	gui::clean_up();
 
 	//ComPtr<ID3D12DebugDevice> com_debug_interface;
@@ -93,25 +128,29 @@ void clean_up() {
 int WINAPI WinMain(HINSTANCE h_instance, HINSTANCE, LPSTR, int nCmdShow) {
 	try {
 		init(h_instance);
+		frame_pipeline::start(render_frame);
 		MSG msg = {};
 		while(msg.message != WM_QUIT) {
-			if(PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+			// Messages are drained only once the next frame can be queued, so that it samples the most recent input
+			frame_pipeline::wait_for_frame_slot(gui::get_data());
+			while(msg.message != WM_QUIT && PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
 				TranslateMessage(&msg);
 				DispatchMessage(&msg);
 			}
-			else {
+			if(msg.message != WM_QUIT) {
 				update();
-				render_frame();
-				renderer::present();
-				renderer::prepare_next_frame();
 			}
 		}
+		frame_pipeline::stop();
 		clean_up();
 
 	} catch(std::exception& ex) {
+		// Reports the first failure, a render thread that failed as well is only joined
+		try { frame_pipeline::stop(); } catch(...) {}
 		OutputDebugString(ex.what());
 		MessageBox(up_window->get_handle(), ex.what(), "", 0);
 	}
+	job_system::shutdown();
 
 	return 0;
 }
\ No newline at end of file
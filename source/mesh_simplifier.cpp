@@ -0,0 +1,604 @@
+namespace mesh_simplifier
+{
+	// Quadric error metric edge collapse (Garland and Heckbert 1997). Vertices are never moved or created, a collapse moves the
+	// corners of one vertex onto a neighbour, so every LOD indexes the primitive's own vertices and only its index range differs.
+	// Vertices at the same position are wedges of one corner, those with different normals or uvs meet along seams. A vertex on
+	// a single seam, or on the open border of the mesh, only collapses along it onto another vertex of that seam or border, its
+	// wedges moving together, so that seams keep their place and no triangle takes attributes from across one. Vertices where
+	// seams and borders meet or branch never move.
+	// Quadrics only order the collapses. The error of a LOD is measured: the farthest any vertex of the primitive is from the
+	// plane of the nearest triangle around the vertex it collapsed into, relative to the diagonal of the primitive's bounds and
+	// never below the error of the previous LOD. The plane stands for the surface the LOD has there, which usually reaches
+	// beyond the few triangles searched.
+	constexpr uint32_t min_lod_triangle_count{ 64 };
+	constexpr float lod_triangle_ratio{ 0.5f };
+	// A LOD that keeps more than this fraction of the previous one's triangles ends the chain
+	constexpr float min_lod_reduction{ 0.85f };
+	// Planes through seam and border edges, perpendicular to their triangle, weigh this much per squared edge length
+	constexpr float edge_weight{ 10.f };
+	// A pass stops at collapses this much costlier than the one that would reach its goal, cheaper ones may open up in the next
+	constexpr float pass_error_slack{ 1.5f };
+	// Area a triangle keeps along its old normal, below this a collapse turns it over or into a sliver
+	constexpr float min_area_ratio{ 0.01f };
+	constexpr uint32_t invalid_vertex{ UINT32_MAX };
+	constexpr uint32_t min_primitives_per_batch{ 1 };
+
+	enum VertexKind : uint8_t {
+		VERTEX_KIND_MANIFOLD,
+		VERTEX_KIND_BORDER,
+		VERTEX_KIND_SEAM,
+		VERTEX_KIND_LOCKED
+	};
+
+	// Symmetric 3x3 a, b and c of sum(w * (dot(n, p) + d)^2) = p * a * p + 2 * dot(b, p) + c, with w the sum of the weights
+	struct Quadric {
+		float a00, a11, a22, a10, a20, a21;
+		float b0, b1, b2;
+		float c;
+		float w;
+	};
+
+	inline void add_plane(Quadric &quadric, const XMFLOAT3 &n, float d, float weight) {
+		quadric.a00 += weight * n.x * n.x;
+		quadric.a11 += weight * n.y * n.y;
+		quadric.a22 += weight * n.z * n.z;
+		quadric.a10 += weight * n.y * n.x;
+		quadric.a20 += weight * n.z * n.x;
+		quadric.a21 += weight * n.z * n.y;
+		quadric.b0 += weight * n.x * d;
+		quadric.b1 += weight * n.y * d;
+		quadric.b2 += weight * n.z * d;
+		quadric.c += weight * d * d;
+		quadric.w += weight;
+	}
+
+	inline void add_quadric(Quadric &quadric, const Quadric &other) {
+		quadric.a00 += other.a00; quadric.a11 += other.a11; quadric.a22 += other.a22;
+		quadric.a10 += other.a10; quadric.a20 += other.a20; quadric.a21 += other.a21;
+		quadric.b0 += other.b0; quadric.b1 += other.b1; quadric.b2 += other.b2;
+		quadric.c += other.c;
+		quadric.w += other.w;
+	}
+
+	// Weighted mean of the squared distances of p to the planes of the quadric
+	inline float get_error(const Quadric &quadric, const XMFLOAT3 &p) {
+		float rx = quadric.a00 * p.x + quadric.a10 * p.y + quadric.a20 * p.z + 2.f * quadric.b0;
+		float ry = quadric.a10 * p.x + quadric.a11 * p.y + quadric.a21 * p.z + 2.f * quadric.b1;
+		float rz = quadric.a20 * p.x + quadric.a21 * p.y + quadric.a22 * p.z + 2.f * quadric.b2;
+		float error = rx * p.x + ry * p.y + rz * p.z + quadric.c;
+		return (quadric.w > 0.f) ? max(error, 0.f) / quadric.w : 0.f;
+	}
+
+	// Unit normal and twice the area of a triangle
+	inline XMVECTOR get_normal(const XMFLOAT3 &p0, const XMFLOAT3 &p1, const XMFLOAT3 &p2, float &length) {
+		XMVECTOR xm_normal = XMVector3Cross(XMLoadFloat3(&p1) - XMLoadFloat3(&p0), XMLoadFloat3(&p2) - XMLoadFloat3(&p0));
+		length = XMVectorGetX(XMVector3Length(xm_normal));
+		return (length > 0.f) ? xm_normal / length : xm_normal;
+	}
+
+	// Half-edges leaving every vertex, or triangles around every position, as ranges of one array
+	struct Adjacency {
+		vector<uint32_t> v_offsets;
+		vector<uint32_t> v_items;
+	};
+
+	struct Collapse {
+		uint32_t v0;
+		uint32_t v1;
+		float error;
+	};
+
+	// Indices local to the primitive's vertices
+	struct Lod {
+		vector<uint32_t> v_indices;
+		float error;
+	};
+
+	struct Simplifier {
+		uint32_t num_vertices;
+		vector<XMFLOAT3> v_positions;
+		// Lowest vertex at the same position, the position's quadric and triangles are kept there
+		vector<uint32_t> v_remap;
+		// Next vertex at the same position, in a loop
+		vector<uint32_t> v_wedges;
+		vector<VertexKind> v_kinds;
+		// Other end of the only open edge leaving or entering a border or seam vertex, kept up to date as vertices collapse
+		vector<uint32_t> v_open_out;
+		vector<uint32_t> v_open_in;
+		vector<Quadric> v_quadrics;
+		vector<uint32_t> v_indices;
+		// Vertex whose corners each vertex's corners have become
+		vector<uint32_t> v_representatives;
+		float error;
+
+		Adjacency edges;
+		Adjacency triangles;
+		vector<Collapse> v_collapses;
+		vector<uint32_t> v_collapse_remap;
+		vector<uint8_t> v_is_locked;
+		vector<uint64_t> v_sort_keys;
+		vector<uint32_t> v_sort_indices;
+		vector<uint64_t> v_sort_scratch_keys;
+		vector<uint32_t> v_sort_scratch_indices;
+	};
+
+	// When get_item() returns the same key twice the list is filled in order, the offsets end up pointing at each range's start
+	template<typename GetItem>
+	void build_adjacency(uint32_t num_keys, uint32_t num_triangles, uint32_t num_items_per_triangle, GetItem get_item, Adjacency &adjacency) {
+		adjacency.v_offsets.assign(num_keys + 1, 0);
+		for(uint32_t triangle_index = 0; triangle_index < num_triangles; ++triangle_index) {
+			for(uint32_t item = 0; item < num_items_per_triangle; ++item) {
+				adjacency.v_offsets[get_item(triangle_index, item).first + 1]++;
+			}
+		}
+		for(uint32_t key = 0; key < num_keys; ++key) {
+			adjacency.v_offsets[key + 1] += adjacency.v_offsets[key];
+		}
+		adjacency.v_items.resize(adjacency.v_offsets[num_keys]);
+		for(uint32_t triangle_index = 0; triangle_index < num_triangles; ++triangle_index) {
+			for(uint32_t item = 0; item < num_items_per_triangle; ++item) {
+				auto [key, value] = get_item(triangle_index, item);
+				adjacency.v_items[adjacency.v_offsets[key]++] = value;
+			}
+		}
+		for(uint32_t key = num_keys; key > 0; --key) {
+			adjacency.v_offsets[key] = adjacency.v_offsets[key - 1];
+		}
+		adjacency.v_offsets[0] = 0;
+	}
+
+	void build_edges(Simplifier &simplifier) {
+		const auto& v_indices = simplifier.v_indices;
+		build_adjacency(simplifier.num_vertices, static_cast<uint32_t>(v_indices.size() / 3), 3, [&](uint32_t triangle_index, uint32_t corner) {
+			return make_pair(v_indices[3 * triangle_index + corner], v_indices[3 * triangle_index + (corner + 1) % 3]);
+		}, simplifier.edges);
+	}
+
+	void build_triangles(Simplifier &simplifier) {
+		const auto& v_indices = simplifier.v_indices;
+		build_adjacency(simplifier.num_vertices, static_cast<uint32_t>(v_indices.size() / 3), 3, [&](uint32_t triangle_index, uint32_t corner) {
+			return make_pair(simplifier.v_remap[v_indices[3 * triangle_index + corner]], triangle_index);
+		}, simplifier.triangles);
+	}
+
+	inline bool has_edge(const Adjacency &edges, uint32_t v0, uint32_t v1) {
+		for(uint32_t item = edges.v_offsets[v0]; item < edges.v_offsets[v0 + 1]; ++item) {
+			if(edges.v_items[item] == v1) { return true; }
+		}
+		return false;
+	}
+
+	// Vertices sharing a position are found by sorting, exact matches only
+	void find_wedges(Simplifier &simplifier) {
+		uint32_t num_vertices = simplifier.num_vertices;
+		vector<uint32_t> v_order(num_vertices);
+		for(uint32_t vertex = 0; vertex < num_vertices; ++vertex) {
+			v_order[vertex] = vertex;
+		}
+		const auto& v_positions = simplifier.v_positions;
+		sort(v_order.begin(), v_order.end(), [&](uint32_t a, uint32_t b) {
+			int order = memcmp(&v_positions[a], &v_positions[b], sizeof(XMFLOAT3));
+			return (order != 0) ? (order < 0) : (a < b);
+		});
+
+		simplifier.v_remap.resize(num_vertices);
+		simplifier.v_wedges.resize(num_vertices);
+		for(uint32_t first = 0; first < num_vertices;) {
+			uint32_t end = first + 1;
+			while(end < num_vertices && memcmp(&v_positions[v_order[first]], &v_positions[v_order[end]], sizeof(XMFLOAT3)) == 0) {
+				end++;
+			}
+			for(uint32_t order_index = first; order_index < end; ++order_index) {
+				simplifier.v_remap[v_order[order_index]] = v_order[first];
+				simplifier.v_wedges[v_order[order_index]] = v_order[(order_index + 1 < end) ? order_index + 1 : first];
+			}
+			first = end;
+		}
+	}
+
+	// An edge is open when no triangle has it the other way round between the same two vertices.
+	// A vertex with no open edges is manifold, one alone at its position with one open edge in and one out is on a border and
+	// a pair of wedges whose open edges run along each other is on a seam. Anything else is locked.
+	void classify_vertices(Simplifier &simplifier) {
+		uint32_t num_vertices = simplifier.num_vertices;
+		auto& v_open_out = simplifier.v_open_out;
+		auto& v_open_in = simplifier.v_open_in;
+		v_open_out.assign(num_vertices, invalid_vertex);
+		v_open_in.assign(num_vertices, invalid_vertex);
+		// A vertex with several open edges refers to itself
+		for(uint32_t vertex = 0; vertex < num_vertices; ++vertex) {
+			for(uint32_t item = simplifier.edges.v_offsets[vertex]; item < simplifier.edges.v_offsets[vertex + 1]; ++item) {
+				uint32_t target = simplifier.edges.v_items[item];
+				if(!has_edge(simplifier.edges, target, vertex)) {
+					v_open_out[vertex] = (v_open_out[vertex] == invalid_vertex) ? target : vertex;
+					v_open_in[target] = (v_open_in[target] == invalid_vertex) ? vertex : target;
+				}
+			}
+		}
+
+		auto has_single_loop = [&](uint32_t vertex) {
+			return v_open_out[vertex] != invalid_vertex && v_open_out[vertex] != vertex && v_open_in[vertex] != invalid_vertex && v_open_in[vertex] != vertex;
+		};
+		const auto& v_remap = simplifier.v_remap;
+		simplifier.v_kinds.resize(num_vertices);
+		for(uint32_t vertex = 0; vertex < num_vertices; ++vertex) {
+			uint32_t wedge = simplifier.v_wedges[vertex];
+			VertexKind kind = VERTEX_KIND_LOCKED;
+			if(wedge == vertex) {
+				if(v_open_out[vertex] == invalid_vertex && v_open_in[vertex] == invalid_vertex) {
+					kind = VERTEX_KIND_MANIFOLD;
+				}
+				else if(has_single_loop(vertex)) {
+					kind = VERTEX_KIND_BORDER;
+				}
+			}
+			else if(simplifier.v_wedges[wedge] == vertex && has_single_loop(vertex) && has_single_loop(wedge)) {
+				if(v_remap[v_open_out[vertex]] == v_remap[v_open_in[wedge]] && v_remap[v_open_in[vertex]] == v_remap[v_open_out[wedge]]) {
+					kind = VERTEX_KIND_SEAM;
+				}
+			}
+			simplifier.v_kinds[vertex] = kind;
+		}
+	}
+
+	void init_quadrics(Simplifier &simplifier) {
+		const auto& v_indices = simplifier.v_indices;
+		const auto& v_positions = simplifier.v_positions;
+		simplifier.v_quadrics.assign(simplifier.num_vertices, Quadric{});
+		for(size_t index = 0; index < v_indices.size(); index += 3) {
+			const XMFLOAT3 &p0 = v_positions[v_indices[index]];
+			const XMFLOAT3 &p1 = v_positions[v_indices[index + 1]];
+			const XMFLOAT3 &p2 = v_positions[v_indices[index + 2]];
+			float length;
+			XMVECTOR xm_normal = get_normal(p0, p1, p2, length);
+			if(length == 0.f) { continue; }
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, xm_normal);
+			float d = -XMVectorGetX(XMVector3Dot(xm_normal, XMLoadFloat3(&p0)));
+			for(uint32_t corner = 0; corner < 3; ++corner) {
+				add_plane(simplifier.v_quadrics[simplifier.v_remap[v_indices[index + corner]]], normal, d, length * 0.5f);
+			}
+
+			for(uint32_t corner = 0; corner < 3; ++corner) {
+				uint32_t v0 = v_indices[index + corner];
+				uint32_t v1 = v_indices[index + (corner + 1) % 3];
+				if(has_edge(simplifier.edges, v1, v0) || simplifier.v_remap[v0] == simplifier.v_remap[v1]) { continue; }
+				XMVECTOR xm_edge = XMLoadFloat3(&v_positions[v1]) - XMLoadFloat3(&v_positions[v0]);
+				XMVECTOR xm_edge_normal = XMVector3Normalize(XMVector3Cross(xm_edge, xm_normal));
+				XMFLOAT3 edge_normal;
+				XMStoreFloat3(&edge_normal, xm_edge_normal);
+				float edge_d = -XMVectorGetX(XMVector3Dot(xm_edge_normal, XMLoadFloat3(&v_positions[v0])));
+				float weight = edge_weight * XMVectorGetX(XMVector3LengthSq(xm_edge));
+				add_plane(simplifier.v_quadrics[simplifier.v_remap[v0]], edge_normal, edge_d, weight);
+				add_plane(simplifier.v_quadrics[simplifier.v_remap[v1]], edge_normal, edge_d, weight);
+			}
+		}
+	}
+
+	// Positions are scaled so that the diagonal of the bounds is 1
+	void init(Simplifier &simplifier, const Vertex *p_vertices, uint32_t num_vertices, const uint32_t *p_indices, uint32_t num_indices) {
+		simplifier.num_vertices = num_vertices;
+		XMVECTOR xm_min = XMVectorReplicate(FLT_MAX);
+		XMVECTOR xm_max = XMVectorReplicate(-FLT_MAX);
+		for(uint32_t vertex = 0; vertex < num_vertices; ++vertex) {
+			xm_min = XMVectorMin(xm_min, XMLoadFloat3(&p_vertices[vertex].pos));
+			xm_max = XMVectorMax(xm_max, XMLoadFloat3(&p_vertices[vertex].pos));
+		}
+		float diagonal = XMVectorGetX(XMVector3Length(xm_max - xm_min));
+		float scale = (diagonal > 0.f) ? 1.f / diagonal : 1.f;
+		simplifier.v_positions.resize(num_vertices);
+		for(uint32_t vertex = 0; vertex < num_vertices; ++vertex) {
+			XMStoreFloat3(&simplifier.v_positions[vertex], (XMLoadFloat3(&p_vertices[vertex].pos) - xm_min) * scale);
+		}
+		simplifier.v_indices.assign(p_indices, p_indices + num_indices);
+		simplifier.v_representatives.resize(num_vertices);
+		for(uint32_t vertex = 0; vertex < num_vertices; ++vertex) {
+			simplifier.v_representatives[vertex] = vertex;
+		}
+		simplifier.error = 0.f;
+
+		find_wedges(simplifier);
+		build_edges(simplifier);
+		classify_vertices(simplifier);
+		init_quadrics(simplifier);
+	}
+
+	// Borders and seams only collapse along themselves, onto their own kind or a locked vertex
+	inline bool can_collapse(const Simplifier &simplifier, uint32_t v0, uint32_t v1) {
+		VertexKind kind_0 = simplifier.v_kinds[v0];
+		VertexKind kind_1 = simplifier.v_kinds[v1];
+		switch(kind_0) {
+			case VERTEX_KIND_MANIFOLD: return true;
+			case VERTEX_KIND_BORDER:
+			case VERTEX_KIND_SEAM:
+				return (kind_1 == kind_0 || kind_1 == VERTEX_KIND_LOCKED) && (simplifier.v_open_out[v0] == v1 || simplifier.v_open_in[v0] == v1);
+			default: return false;
+		}
+	}
+
+	void pick_collapses(Simplifier &simplifier) {
+		const auto& v_indices = simplifier.v_indices;
+		const auto& v_remap = simplifier.v_remap;
+		auto& v_collapses = simplifier.v_collapses;
+		v_collapses.clear();
+		for(size_t index = 0; index < v_indices.size(); index += 3) {
+			for(uint32_t corner = 0; corner < 3; ++corner) {
+				uint32_t v0 = v_indices[index + corner];
+				uint32_t v1 = v_indices[index + (corner + 1) % 3];
+				if(v_remap[v0] == v_remap[v1]) { continue; }
+				// Edges shared by two triangles are seen twice
+				if(v_remap[v0] > v_remap[v1] && has_edge(simplifier.edges, v1, v0)) { continue; }
+
+				float error_01 = can_collapse(simplifier, v0, v1) ? get_error(simplifier.v_quadrics[v_remap[v0]], simplifier.v_positions[v1]) : FLT_MAX;
+				float error_10 = can_collapse(simplifier, v1, v0) ? get_error(simplifier.v_quadrics[v_remap[v1]], simplifier.v_positions[v0]) : FLT_MAX;
+				if(error_01 == FLT_MAX && error_10 == FLT_MAX) { continue; }
+				v_collapses.push_back((error_01 <= error_10) ? Collapse{ v0, v1, error_01 } : Collapse{ v1, v0, error_10 });
+			}
+		}
+	}
+
+	// True when moving position v0 onto p1 turns over a triangle around it that survives the collapse, or flattens it into a sliver
+	bool has_triangle_flips(const Simplifier &simplifier, uint32_t position_0, uint32_t position_1, const XMFLOAT3 &p1) {
+		const auto& v_indices = simplifier.v_indices;
+		const auto& v_remap = simplifier.v_remap;
+		const auto& triangles = simplifier.triangles;
+		XMVECTOR xm_p0 = XMLoadFloat3(&simplifier.v_positions[position_0]);
+		XMVECTOR xm_p1 = XMLoadFloat3(&p1);
+		for(uint32_t item = triangles.v_offsets[position_0]; item < triangles.v_offsets[position_0 + 1]; ++item) {
+			uint32_t triangle_index = triangles.v_items[item];
+			uint32_t a_positions[3];
+			uint32_t corner_0 = 0;
+			for(uint32_t corner = 0; corner < 3; ++corner) {
+				a_positions[corner] = v_remap[v_indices[3 * triangle_index + corner]];
+				corner_0 = (a_positions[corner] == position_0) ? corner : corner_0;
+			}
+			if(a_positions[0] == position_1 || a_positions[1] == position_1 || a_positions[2] == position_1) { continue; }
+			XMVECTOR xm_a = XMLoadFloat3(&simplifier.v_positions[a_positions[(corner_0 + 1) % 3]]);
+			XMVECTOR xm_b = XMLoadFloat3(&simplifier.v_positions[a_positions[(corner_0 + 2) % 3]]);
+			XMVECTOR xm_normal_before = XMVector3Cross(xm_a - xm_p0, xm_b - xm_p0);
+			XMVECTOR xm_normal_after = XMVector3Cross(xm_a - xm_p1, xm_b - xm_p1);
+			if(XMVectorGetX(XMVector3Dot(xm_normal_before, xm_normal_after)) <= min_area_ratio * XMVectorGetX(XMVector3LengthSq(xm_normal_before))) { return true; }
+		}
+		return false;
+	}
+
+	// Cheapest first, a position that moves locks the ones around it for the rest of the pass. Returns how many were made.
+	uint32_t perform_collapses(Simplifier &simplifier, uint32_t triangle_goal) {
+		auto& v_collapses = simplifier.v_collapses;
+		auto& v_sort_keys = simplifier.v_sort_keys;
+		auto& v_sort_indices = simplifier.v_sort_indices;
+		uint32_t num_collapses = static_cast<uint32_t>(v_collapses.size());
+		v_sort_keys.resize(num_collapses);
+		v_sort_indices.resize(num_collapses);
+		for(uint32_t collapse_index = 0; collapse_index < num_collapses; ++collapse_index) {
+			v_sort_keys[collapse_index] = draw_sort::float_to_sortable_uint(v_collapses[collapse_index].error);
+			v_sort_indices[collapse_index] = collapse_index;
+		}
+		draw_sort::radix_sort(v_sort_keys, v_sort_indices, simplifier.v_sort_scratch_keys, simplifier.v_sort_scratch_indices);
+
+		uint32_t edge_goal = max(triangle_goal / 2, 1u);
+		float error_goal = (edge_goal < num_collapses) ? v_collapses[v_sort_indices[edge_goal]].error * pass_error_slack : FLT_MAX;
+
+		auto& v_collapse_remap = simplifier.v_collapse_remap;
+		for(uint32_t vertex = 0; vertex < simplifier.num_vertices; ++vertex) {
+			v_collapse_remap[vertex] = vertex;
+		}
+		auto& v_is_locked = simplifier.v_is_locked;
+		v_is_locked.assign(simplifier.num_vertices, 0);
+		uint32_t num_performed = 0;
+		uint32_t num_removed_triangles = 0;
+		for(uint32_t sorted_index = 0; sorted_index < num_collapses && num_removed_triangles < triangle_goal; ++sorted_index) {
+			const Collapse &collapse = v_collapses[v_sort_indices[sorted_index]];
+			if(collapse.error > error_goal) { break; }
+			uint32_t position_0 = simplifier.v_remap[collapse.v0];
+			uint32_t position_1 = simplifier.v_remap[collapse.v1];
+			if(v_is_locked[position_0] || v_is_locked[position_1]) { continue; }
+			if(has_triangle_flips(simplifier, position_0, position_1, simplifier.v_positions[collapse.v1])) { continue; }
+
+			VertexKind kind = simplifier.v_kinds[collapse.v0];
+			v_collapse_remap[collapse.v0] = collapse.v1;
+			if(kind == VERTEX_KIND_SEAM) {
+				// The other wedge follows its own side of the seam to the wedge of v1 next to it
+				uint32_t wedge = simplifier.v_wedges[collapse.v0];
+				v_collapse_remap[wedge] = (simplifier.v_open_out[collapse.v0] == collapse.v1) ? simplifier.v_open_in[wedge] : simplifier.v_open_out[wedge];
+			}
+			add_quadric(simplifier.v_quadrics[position_1], simplifier.v_quadrics[position_0]);
+			// Every triangle that changes keeps its other corners in place, or the flip test above would not hold for it
+			const auto& triangles = simplifier.triangles;
+			for(uint32_t item = triangles.v_offsets[position_0]; item < triangles.v_offsets[position_0 + 1]; ++item) {
+				for(uint32_t corner = 0; corner < 3; ++corner) {
+					v_is_locked[simplifier.v_remap[simplifier.v_indices[3 * triangles.v_items[item] + corner]]] = 1;
+				}
+			}
+			v_is_locked[position_1] = 1;
+			num_removed_triangles += (kind == VERTEX_KIND_BORDER) ? 1 : 2;
+			num_performed++;
+		}
+		return num_performed;
+	}
+
+	// Drops the triangles that lost a corner and follows the open edges past the vertices that are gone
+	void apply_collapses(Simplifier &simplifier) {
+		const auto& v_collapse_remap = simplifier.v_collapse_remap;
+		const auto& v_remap = simplifier.v_remap;
+		auto& v_indices = simplifier.v_indices;
+		size_t num_kept_indices = 0;
+		for(size_t index = 0; index < v_indices.size(); index += 3) {
+			uint32_t v0 = v_collapse_remap[v_indices[index]];
+			uint32_t v1 = v_collapse_remap[v_indices[index + 1]];
+			uint32_t v2 = v_collapse_remap[v_indices[index + 2]];
+			if(v_remap[v0] == v_remap[v1] || v_remap[v1] == v_remap[v2] || v_remap[v2] == v_remap[v0]) { continue; }
+			v_indices[num_kept_indices++] = v0;
+			v_indices[num_kept_indices++] = v1;
+			v_indices[num_kept_indices++] = v2;
+		}
+		v_indices.resize(num_kept_indices);
+		for(auto& representative : simplifier.v_representatives) {
+			representative = v_collapse_remap[representative];
+		}
+
+		for(auto p_v_loop : { &simplifier.v_open_out, &simplifier.v_open_in }) {
+			auto& v_loop = *p_v_loop;
+			for(uint32_t vertex = 0; vertex < simplifier.num_vertices; ++vertex) {
+				uint32_t target = v_loop[vertex];
+				if(v_collapse_remap[vertex] != vertex || target == invalid_vertex || target == vertex) { continue; }
+				// A target collapsed into this vertex leaves its own next vertex as the next one, which cannot have collapsed too
+				uint32_t collapsed_target = v_collapse_remap[target];
+				v_loop[vertex] = (collapsed_target == vertex) ? v_collapse_remap[v_loop[target]] : collapsed_target;
+			}
+		}
+	}
+
+	inline XMVECTOR get_closest_point_on_triangle(XMVECTOR xm_p, XMVECTOR xm_a, XMVECTOR xm_b, XMVECTOR xm_c) {
+		auto dot = [](XMVECTOR xm_0, XMVECTOR xm_1) { return XMVectorGetX(XMVector3Dot(xm_0, xm_1)); };
+		XMVECTOR xm_ab = xm_b - xm_a, xm_ac = xm_c - xm_a, xm_ap = xm_p - xm_a;
+		float d1 = dot(xm_ab, xm_ap), d2 = dot(xm_ac, xm_ap);
+		if(d1 <= 0.f && d2 <= 0.f) { return xm_a; }
+		XMVECTOR xm_bp = xm_p - xm_b;
+		float d3 = dot(xm_ab, xm_bp), d4 = dot(xm_ac, xm_bp);
+		if(d3 >= 0.f && d4 <= d3) { return xm_b; }
+		float vc = d1 * d4 - d3 * d2;
+		if(vc <= 0.f && d1 >= 0.f && d3 <= 0.f) { return xm_a + xm_ab * (d1 / (d1 - d3)); }
+		XMVECTOR xm_cp = xm_p - xm_c;
+		float d5 = dot(xm_ab, xm_cp), d6 = dot(xm_ac, xm_cp);
+		if(d6 >= 0.f && d5 <= d6) { return xm_c; }
+		float vb = d5 * d2 - d1 * d6;
+		if(vb <= 0.f && d2 >= 0.f && d6 <= 0.f) { return xm_a + xm_ac * (d2 / (d2 - d6)); }
+		float va = d3 * d6 - d5 * d4;
+		if(va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f) { return xm_b + (xm_c - xm_b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))); }
+		float denominator = 1.f / (va + vb + vc);
+		return xm_a + xm_ab * (vb * denominator) + xm_ac * (vc * denominator);
+	}
+
+	// Triangles around the representative itself rather than its position, so that they are on the vertex's side of any seam
+	void update_error(Simplifier &simplifier) {
+		const auto& v_positions = simplifier.v_positions;
+		const auto& v_indices = simplifier.v_indices;
+		auto& triangles = simplifier.triangles;
+		build_adjacency(simplifier.num_vertices, static_cast<uint32_t>(v_indices.size() / 3), 3, [&](uint32_t triangle_index, uint32_t corner) {
+			return make_pair(v_indices[3 * triangle_index + corner], triangle_index);
+		}, triangles);
+		for(uint32_t vertex = 0; vertex < simplifier.num_vertices; ++vertex) {
+			uint32_t representative = simplifier.v_representatives[vertex];
+			if(representative == vertex) { continue; }
+			XMVECTOR xm_p = XMLoadFloat3(&v_positions[vertex]);
+			float min_distance = FLT_MAX;
+			float plane_distance = 0.f;
+			for(uint32_t item = triangles.v_offsets[representative]; item < triangles.v_offsets[representative + 1]; ++item) {
+				const uint32_t *p_triangle = &v_indices[3 * triangles.v_items[item]];
+				const XMFLOAT3 &p0 = v_positions[p_triangle[0]];
+				XMVECTOR xm_closest = get_closest_point_on_triangle(xm_p, XMLoadFloat3(&p0), XMLoadFloat3(&v_positions[p_triangle[1]]), XMLoadFloat3(&v_positions[p_triangle[2]]));
+				float distance = XMVectorGetX(XMVector3Length(xm_closest - xm_p));
+				float length;
+				XMVECTOR xm_normal = get_normal(p0, v_positions[p_triangle[1]], v_positions[p_triangle[2]], length);
+				if(distance < min_distance && length > 0.f) {
+					min_distance = distance;
+					plane_distance = abs(XMVectorGetX(XMVector3Dot(xm_normal, xm_p - XMLoadFloat3(&p0))));
+				}
+			}
+			simplifier.error = max(simplifier.error, plane_distance);
+		}
+	}
+
+	// Collapses edges until at most target_index_count indices are left or no edge can collapse
+	void simplify(Simplifier &simplifier, uint32_t target_index_count) {
+		simplifier.v_collapse_remap.resize(simplifier.num_vertices);
+		while(simplifier.v_indices.size() > target_index_count) {
+			build_edges(simplifier);
+			build_triangles(simplifier);
+			pick_collapses(simplifier);
+			if(simplifier.v_collapses.empty()) { break; }
+			uint32_t triangle_goal = static_cast<uint32_t>((simplifier.v_indices.size() - target_index_count) / 3);
+			if(perform_collapses(simplifier, max(triangle_goal, 1u)) == 0) { break; }
+			apply_collapses(simplifier);
+		}
+	}
+
+	// Each LOD halves the triangles of the previous one, starting from it, until the chain is max_lod_count long including the
+	// primitive itself, a LOD would have fewer than min_lod_triangle_count triangles or simplification stops paying off
+	void build_lods(const Vertex *p_vertices, uint32_t num_vertices, const uint32_t *p_indices, uint32_t num_indices, vector<Lod> &v_lods) {
+		v_lods.clear();
+		if(num_indices / 3 <= min_lod_triangle_count) { return; }
+		Simplifier simplifier;
+		init(simplifier, p_vertices, num_vertices, p_indices, num_indices);
+		while(v_lods.size() + 1 < max_lod_count) {
+			uint32_t num_triangles = static_cast<uint32_t>(simplifier.v_indices.size() / 3);
+			if(num_triangles <= min_lod_triangle_count) { break; }
+			uint32_t target_triangle_count = max(min_lod_triangle_count, static_cast<uint32_t>(num_triangles * lod_triangle_ratio));
+			simplify(simplifier, target_triangle_count * 3);
+			if(simplifier.v_indices.size() / 3 > num_triangles * min_lod_reduction) { break; }
+			update_error(simplifier);
+			v_lods.push_back({ simplifier.v_indices, simplifier.error });
+		}
+	}
+
+	// A primitive's vertices and indices relative to them
+	struct MeshData {
+		vector<Vertex> v_vertices;
+		vector<uint32_t> v_indices;
+	};
+
+	// Builds the LODs of every mesh as jobs, at most max_num_batches at a time
+	void build_lods(const vector<MeshData> &v_meshes, vector<vector<Lod>> &a_v_lods, uint32_t max_num_batches = UINT32_MAX) {
+		a_v_lods.resize(v_meshes.size());
+		job_system::parallel_for(static_cast<uint32_t>(v_meshes.size()), min_primitives_per_batch, [&](uint32_t begin, uint32_t end) {
+			for(uint32_t mesh_index = begin; mesh_index < end; ++mesh_index) {
+				const MeshData &mesh = v_meshes[mesh_index];
+				build_lods(mesh.v_vertices.data(), static_cast<uint32_t>(mesh.v_vertices.size()), mesh.v_indices.data(), static_cast<uint32_t>(mesh.v_indices.size()), a_v_lods[mesh_index]);
+			}
+		}, max_num_batches);
+	}
+
+	// Benchmark workload: a grid of quads over [-1, 1] in x and z whose heights follow a few waves, so that edges cost different
+	// amounts to collapse. Its shape only has to keep the simplifier and the meshlet builder busy.
+	void make_wave_grid(uint32_t num_quads_per_side, MeshData &mesh) {
+		constexpr float amplitude{ 0.1f };
+		constexpr float frequency{ 3.f * XM_PI };
+		for(uint32_t row = 0; row <= num_quads_per_side; ++row) {
+			for(uint32_t column = 0; column <= num_quads_per_side; ++column) {
+				float u = float(column) / num_quads_per_side;
+				float v = float(row) / num_quads_per_side;
+				float x = 2.f * u - 1.f, z = 2.f * v - 1.f;
+				Vertex vertex{};
+				vertex.pos = { x, amplitude * sin(frequency * x) * cos(frequency * z), z };
+				float slope_x = amplitude * frequency * cos(frequency * x) * cos(frequency * z);
+				float slope_z = -amplitude * frequency * sin(frequency * x) * sin(frequency * z);
+				XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMVectorSet(-slope_x, 1.f, -slope_z, 0.f)));
+				vertex.uv = { u, v };
+				mesh.v_vertices.push_back(vertex);
+			}
+		}
+		for(uint32_t row = 0; row < num_quads_per_side; ++row) {
+			for(uint32_t column = 0; column < num_quads_per_side; ++column) {
+				uint32_t i00 = row * (num_quads_per_side + 1) + column;
+				uint32_t i01 = i00 + 1;
+				uint32_t i10 = i00 + num_quads_per_side + 1;
+				uint32_t i11 = i10 + 1;
+				mesh.v_indices.insert(mesh.v_indices.end(), { i00, i10, i11, i00, i11, i01 });
+			}
+		}
+	}
+
+	// Throughput on wave grids of different sizes with one thread and with all of them, best of num_iterations
+	SimplificationBenchmarkResult run_benchmark(uint32_t num_iterations = 3) {
+		SimplificationBenchmarkResult result = {};
+		vector<MeshData> v_meshes(16);
+		for(uint32_t mesh_index = 0; mesh_index < v_meshes.size(); ++mesh_index) {
+			make_wave_grid(12 + 6 * mesh_index, v_meshes[mesh_index]);
+		}
+		result.num_meshes = static_cast<uint32_t>(v_meshes.size());
+		for(auto& mesh : v_meshes) {
+			result.num_triangles += static_cast<uint32_t>(mesh.v_indices.size() / 3);
+		}
+		result.num_workers = job_system::get_worker_count();
+
+		vector<vector<Lod>> a_v_lods;
+		result.single_thread_ms = FLT_MAX;
+		result.multi_thread_ms = FLT_MAX;
+		for(uint32_t iteration = 0; iteration < num_iterations; ++iteration) {
+			result.single_thread_ms = min(result.single_thread_ms, measure_ms([&]() { build_lods(v_meshes, a_v_lods, 1); }));
+			result.multi_thread_ms = min(result.multi_thread_ms, measure_ms([&]() { build_lods(v_meshes, a_v_lods); }));
+		}
+		return result;
+	}
+} // namespace mesh_simplifier
@@ -0,0 +1,446 @@
+namespace meshlet_builder
+{
+	// Meshlets are grown one triangle at a time over triangles that share vertices with them, preferring the triangle that adds
+	// the fewest vertices, then the one whose normal and centroid are closest to the meshlet's. Once a meshlet's neighbours are
+	// used up it goes on with the next free triangle in index order while it is less than half full, so small disconnected
+	// pieces do not end up as meshlets of a few triangles each. The indices are reordered meshlet by meshlet, every meshlet is a
+	// contiguous index range and neighbouring visible meshlets are drawn as one. Meshlets are then ordered by the direction
+	// their cone faces, so the meshlets facing the eye are mostly neighbours and make few ranges.
+	// A meshlet is culled when its bounding sphere is outside the frustum, or when every triangle faces away from the eye: each
+	// normal is within the cone's angle of its axis, so the nearest any normal gets to facing the sphere's center bounds how
+	// much of the sphere can be in front of the triangles' planes. Both tests run in the space of the meshlets, which leaves
+	// facing unchanged under any invertible transform.
+	constexpr uint32_t max_meshlet_vertex_count{ 64 };
+	constexpr uint32_t max_meshlet_triangle_count{ 124 };
+	// Among triangles adding as many vertices, how much normal deviation counts against distance from the meshlet
+	constexpr float cone_weight{ 0.5f };
+	// Cones whose normals reach closer than this to a half space are too wide to ever cull anything, cosine of the angle
+	constexpr float min_cone_cos{ 0.05f };
+	// Beyond this many ranges of one draw, those split by the fewest culled indices are merged and the culled indices drawn
+	constexpr uint32_t max_ranges_per_draw{ 32 };
+	constexpr uint32_t min_primitives_per_batch{ 1 };
+	constexpr uint32_t invalid_triangle{ UINT32_MAX };
+
+	struct Meshlet {
+		// Range of the meshlet's triangles in the indices it was built from
+		uint32_t first_index;
+		uint32_t index_count;
+		uint32_t vertex_count;
+		XMFLOAT3 center;
+		float radius;
+		// Every triangle's normal is within the cone's angle of its axis, cone_cos is 0 when there is no such cone
+		XMFLOAT3 cone_axis;
+		float cone_cos;
+		float cone_sin;
+	};
+
+	// Contiguous indices of visible meshlets, relative to the indices the meshlets were built from
+	struct IndexRange {
+		uint32_t first_index;
+		uint32_t index_count;
+	};
+
+	// Frustum planes pointing inwards and the eye, in the space of the meshlets
+	struct CullView {
+		XMFLOAT4 a_planes[6];
+		XMFLOAT3 eye;
+	};
+
+	enum MeshletVisibility : uint8_t {
+		MESHLET_VISIBLE,
+		MESHLET_OUTSIDE_FRUSTUM,
+		MESHLET_BACKFACING
+	};
+
+	inline XMVECTOR get_triangle_normal(XMVECTOR xm_a, XMVECTOR xm_b, XMVECTOR xm_c) {
+		return XMVector3Cross(xm_b - xm_a, xm_c - xm_a);
+	}
+
+	inline XMVECTOR normalize_or_zero(XMVECTOR xm_v) {
+		float length = XMVectorGetX(XMVector3Length(xm_v));
+		return (length > 0.f) ? xm_v / length : XMVectorZero();
+	}
+
+	void compute_bounds(const Vertex *p_vertices, const uint32_t *p_indices, const vector<XMFLOAT3> &v_normals, Meshlet &meshlet) {
+		XMVECTOR xm_min = XMVectorReplicate(FLT_MAX);
+		XMVECTOR xm_max = XMVectorReplicate(-FLT_MAX);
+		for(uint32_t index = 0; index < meshlet.index_count; ++index) {
+			XMVECTOR xm_p = XMLoadFloat3(&p_vertices[p_indices[meshlet.first_index + index]].pos);
+			xm_min = XMVectorMin(xm_min, xm_p);
+			xm_max = XMVectorMax(xm_max, xm_p);
+		}
+		XMVECTOR xm_center = (xm_min + xm_max) * 0.5f;
+		float radius_sq = 0.f;
+		for(uint32_t index = 0; index < meshlet.index_count; ++index) {
+			XMVECTOR xm_p = XMLoadFloat3(&p_vertices[p_indices[meshlet.first_index + index]].pos);
+			radius_sq = max(radius_sq, XMVectorGetX(XMVector3LengthSq(xm_p - xm_center)));
+		}
+		XMStoreFloat3(&meshlet.center, xm_center);
+		meshlet.radius = sqrt(radius_sq);
+
+		// Degenerate triangles have no normal and face nowhere
+		XMVECTOR xm_normal_sum = XMVectorZero();
+		for(uint32_t triangle = meshlet.first_index / 3; triangle < (meshlet.first_index + meshlet.index_count) / 3; ++triangle) {
+			xm_normal_sum += XMLoadFloat3(&v_normals[triangle]);
+		}
+		XMVECTOR xm_axis = normalize_or_zero(xm_normal_sum);
+		float min_dot = 1.f;
+		for(uint32_t triangle = meshlet.first_index / 3; triangle < (meshlet.first_index + meshlet.index_count) / 3; ++triangle) {
+			XMVECTOR xm_normal = XMLoadFloat3(&v_normals[triangle]);
+			if(XMVectorGetX(XMVector3LengthSq(xm_normal)) > 0.f) {
+				min_dot = min(min_dot, XMVectorGetX(XMVector3Dot(xm_normal, xm_axis)));
+			}
+		}
+		XMStoreFloat3(&meshlet.cone_axis, xm_axis);
+		meshlet.cone_cos = (XMVectorGetX(XMVector3LengthSq(xm_axis)) > 0.f && min_dot >= min_cone_cos) ? min(min_dot, 1.f) : 0.f;
+		meshlet.cone_sin = sqrt(1.f - meshlet.cone_cos * meshlet.cone_cos);
+	}
+
+	// Distance of x, y along the Hilbert curve through a 65536 x 65536 grid
+	uint32_t get_hilbert_index(uint32_t x, uint32_t y) {
+		uint32_t index = 0;
+		for(uint32_t s = 1u << 15; s > 0; s >>= 1) {
+			uint32_t rx = (x & s) ? 1 : 0;
+			uint32_t ry = (y & s) ? 1 : 0;
+			index += s * s * ((3 * rx) ^ ry);
+			if(ry == 0) {
+				if(rx == 1) {
+					x = s - 1 - x;
+					y = s - 1 - y;
+				}
+				swap(x, y);
+			}
+		}
+		return index;
+	}
+
+	// Hilbert order of the cone axis on the octahedral map of directions, meshlets facing alike end up next to each other
+	uint32_t get_axis_key(const XMFLOAT3 &axis) {
+		float sum = abs(axis.x) + abs(axis.y) + abs(axis.z);
+		if(sum == 0.f) { return 0; }
+		float u = axis.x / sum;
+		float v = axis.y / sum;
+		if(axis.z < 0.f) {
+			float folded_u = (1.f - abs(v)) * (u >= 0.f ? 1.f : -1.f);
+			v = (1.f - abs(u)) * (v >= 0.f ? 1.f : -1.f);
+			u = folded_u;
+		}
+		auto quantize = [](float f) { return static_cast<uint32_t>((f * 0.5f + 0.5f) * 65535.f + 0.5f); };
+		return get_hilbert_index(quantize(u), quantize(v));
+	}
+
+	// Visible meshlets are drawn as ranges, so the fewer runs the meshlets facing the eye form the fewer the draws
+	void sort_meshlets(vector<uint32_t> &v_indices, vector<Meshlet> &v_meshlets) {
+		vector<uint64_t> v_keys(v_meshlets.size());
+		vector<uint32_t> v_order(v_meshlets.size());
+		vector<uint64_t> v_scratch_keys;
+		vector<uint32_t> v_scratch_order;
+		for(uint32_t meshlet_index = 0; meshlet_index < v_meshlets.size(); ++meshlet_index) {
+			v_keys[meshlet_index] = get_axis_key(v_meshlets[meshlet_index].cone_axis);
+			v_order[meshlet_index] = meshlet_index;
+		}
+		draw_sort::radix_sort(v_keys, v_order, v_scratch_keys, v_scratch_order);
+
+		vector<uint32_t> v_sorted_indices;
+		vector<Meshlet> v_sorted_meshlets;
+		v_sorted_indices.reserve(v_indices.size());
+		v_sorted_meshlets.reserve(v_meshlets.size());
+		for(uint32_t meshlet_index : v_order) {
+			Meshlet meshlet = v_meshlets[meshlet_index];
+			v_sorted_indices.insert(v_sorted_indices.end(), v_indices.begin() + meshlet.first_index, v_indices.begin() + meshlet.first_index + meshlet.index_count);
+			meshlet.first_index = static_cast<uint32_t>(v_sorted_indices.size()) - meshlet.index_count;
+			v_sorted_meshlets.push_back(meshlet);
+		}
+		v_indices.swap(v_sorted_indices);
+		v_meshlets.swap(v_sorted_meshlets);
+	}
+
+	// Reorders the indices, relative to p_vertices, meshlet by meshlet
+	void build_meshlets(const Vertex *p_vertices, uint32_t num_vertices, vector<uint32_t> &v_indices, vector<Meshlet> &v_meshlets) {
+		v_meshlets.clear();
+		uint32_t num_triangles = static_cast<uint32_t>(v_indices.size() / 3);
+		if(num_triangles == 0) { return; }
+
+		vector<XMFLOAT3> v_normals(num_triangles);
+		vector<XMFLOAT3> v_centroids(num_triangles);
+		for(uint32_t triangle = 0; triangle < num_triangles; ++triangle) {
+			XMVECTOR xm_a = XMLoadFloat3(&p_vertices[v_indices[3 * triangle]].pos);
+			XMVECTOR xm_b = XMLoadFloat3(&p_vertices[v_indices[3 * triangle + 1]].pos);
+			XMVECTOR xm_c = XMLoadFloat3(&p_vertices[v_indices[3 * triangle + 2]].pos);
+			XMStoreFloat3(&v_normals[triangle], normalize_or_zero(get_triangle_normal(xm_a, xm_b, xm_c)));
+			XMStoreFloat3(&v_centroids[triangle], (xm_a + xm_b + xm_c) / 3.f);
+		}
+		mesh_simplifier::Adjacency triangles;
+		mesh_simplifier::build_adjacency(num_vertices, num_triangles, 3, [&](uint32_t triangle, uint32_t corner) {
+			return make_pair(v_indices[3 * triangle + corner], triangle);
+		}, triangles);
+
+		// Meshlet each vertex was last added to and each triangle was last a candidate of
+		vector<uint32_t> v_vertex_meshlets(num_vertices, UINT32_MAX);
+		vector<uint32_t> v_candidate_meshlets(num_triangles, UINT32_MAX);
+		vector<uint8_t> v_is_emitted(num_triangles, 0);
+		vector<uint32_t> v_candidates;
+		vector<uint32_t> v_sorted_indices;
+		vector<XMFLOAT3> v_sorted_normals;
+		v_sorted_indices.reserve(v_indices.size());
+		v_sorted_normals.reserve(num_triangles);
+		uint32_t next_seed = 0;
+		uint32_t num_emitted = 0;
+		while(num_emitted < num_triangles) {
+			uint32_t meshlet_index = static_cast<uint32_t>(v_meshlets.size());
+			Meshlet meshlet = {};
+			meshlet.first_index = static_cast<uint32_t>(v_sorted_indices.size());
+			XMVECTOR xm_normal_sum = XMVectorZero();
+			XMVECTOR xm_centroid_sum = XMVectorZero();
+			XMVECTOR xm_centroid_min = XMVectorReplicate(FLT_MAX);
+			XMVECTOR xm_centroid_max = XMVectorReplicate(-FLT_MAX);
+			v_candidates.clear();
+
+			while(v_is_emitted[next_seed]) { ++next_seed; }
+			uint32_t triangle = next_seed;
+			while(true) {
+				v_is_emitted[triangle] = 1;
+				v_sorted_normals.push_back(v_normals[triangle]);
+				num_emitted++;
+				for(uint32_t corner = 0; corner < 3; ++corner) {
+					uint32_t vertex = v_indices[3 * triangle + corner];
+					v_sorted_indices.push_back(vertex);
+					if(v_vertex_meshlets[vertex] != meshlet_index) {
+						v_vertex_meshlets[vertex] = meshlet_index;
+						meshlet.vertex_count++;
+					}
+					for(uint32_t item = triangles.v_offsets[vertex]; item < triangles.v_offsets[vertex + 1]; ++item) {
+						uint32_t neighbour = triangles.v_items[item];
+						if(!v_is_emitted[neighbour] && v_candidate_meshlets[neighbour] != meshlet_index) {
+							v_candidate_meshlets[neighbour] = meshlet_index;
+							v_candidates.push_back(neighbour);
+						}
+					}
+				}
+				meshlet.index_count += 3;
+				XMVECTOR xm_centroid = XMLoadFloat3(&v_centroids[triangle]);
+				xm_normal_sum += XMLoadFloat3(&v_normals[triangle]);
+				xm_centroid_sum += xm_centroid;
+				xm_centroid_min = XMVectorMin(xm_centroid_min, xm_centroid);
+				xm_centroid_max = XMVectorMax(xm_centroid_max, xm_centroid);
+				uint32_t num_meshlet_triangles = meshlet.index_count / 3;
+				if(num_meshlet_triangles == max_meshlet_triangle_count || num_emitted == num_triangles) { break; }
+
+				XMVECTOR xm_axis = normalize_or_zero(xm_normal_sum);
+				XMVECTOR xm_center = xm_centroid_sum / static_cast<float>(num_meshlet_triangles);
+				float extent = XMVectorGetX(XMVector3Length(xm_centroid_max - xm_centroid_min)) * 0.5f;
+				uint32_t best_triangle = invalid_triangle;
+				uint32_t best_num_new_vertices = UINT32_MAX;
+				float best_score = FLT_MAX;
+				uint32_t num_kept_candidates = 0;
+				for(uint32_t candidate : v_candidates) {
+					if(v_is_emitted[candidate]) { continue; }
+					v_candidates[num_kept_candidates++] = candidate;
+					uint32_t num_new_vertices = 0;
+					for(uint32_t corner = 0; corner < 3; ++corner) {
+						num_new_vertices += (v_vertex_meshlets[v_indices[3 * candidate + corner]] != meshlet_index) ? 1 : 0;
+					}
+					if(meshlet.vertex_count + num_new_vertices > max_meshlet_vertex_count || num_new_vertices > best_num_new_vertices) { continue; }
+					float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&v_centroids[candidate]) - xm_center));
+					float deviation = 1.f - XMVectorGetX(XMVector3Dot(XMLoadFloat3(&v_normals[candidate]), xm_axis));
+					float score = cone_weight * deviation + (1.f - cone_weight) * distance / (distance + extent + FLT_MIN);
+					if(num_new_vertices < best_num_new_vertices || score < best_score) {
+						best_triangle = candidate;
+						best_num_new_vertices = num_new_vertices;
+						best_score = score;
+					}
+				}
+				v_candidates.resize(num_kept_candidates);
+
+				if(best_triangle == invalid_triangle) {
+					bool has_room = num_meshlet_triangles < max_meshlet_triangle_count / 2 && meshlet.vertex_count + 3 <= max_meshlet_vertex_count;
+					if(!v_candidates.empty() || !has_room) { break; }
+					while(v_is_emitted[next_seed]) { ++next_seed; }
+					best_triangle = next_seed;
+				}
+				triangle = best_triangle;
+			}
+			v_meshlets.push_back(meshlet);
+		}
+		v_indices.swap(v_sorted_indices);
+		for(auto& meshlet : v_meshlets) {
+			compute_bounds(p_vertices, v_indices.data(), v_sorted_normals, meshlet);
+		}
+		sort_meshlets(v_indices, v_meshlets);
+	}
+
+	// A primitive's vertices and its indices, reordered by build_meshlets()
+	struct MeshletMesh {
+		const mesh_simplifier::MeshData *p_mesh;
+		vector<uint32_t> v_indices;
+		vector<Meshlet> v_meshlets;
+	};
+
+	// Builds the meshlets of every mesh as jobs, at most max_num_batches at a time
+	void build_meshlets(vector<MeshletMesh> &v_meshlet_meshes, uint32_t max_num_batches = UINT32_MAX) {
+		job_system::parallel_for(static_cast<uint32_t>(v_meshlet_meshes.size()), min_primitives_per_batch, [&](uint32_t begin, uint32_t end) {
+			for(uint32_t mesh_index = begin; mesh_index < end; ++mesh_index) {
+				auto& meshlet_mesh = v_meshlet_meshes[mesh_index];
+				meshlet_mesh.v_indices = meshlet_mesh.p_mesh->v_indices;
+				build_meshlets(meshlet_mesh.p_mesh->v_vertices.data(), static_cast<uint32_t>(meshlet_mesh.p_mesh->v_vertices.size()), meshlet_mesh.v_indices, meshlet_mesh.v_meshlets);
+			}
+		}, max_num_batches);
+	}
+
+	// Gribb-Hartmann plane extraction for a post-multiplied clip_from_object matrix, as the renderer does in world space
+	void make_cull_view(const XMMATRIX &xm_clip_from_object, const XMVECTOR &xm_eye_os, CullView &view) {
+		XMVECTOR xm_row_x = xm_clip_from_object.r[0];
+		XMVECTOR xm_row_y = xm_clip_from_object.r[1];
+		XMVECTOR xm_row_z = xm_clip_from_object.r[2];
+		XMVECTOR xm_row_w = xm_clip_from_object.r[3];
+
+		XMVECTOR a_xm_planes[6] = {
+			xm_row_w + xm_row_x, xm_row_w - xm_row_x,
+			xm_row_w + xm_row_y, xm_row_w - xm_row_y,
+			xm_row_z,            xm_row_w - xm_row_z
+		};
+		for(uint32_t plane_index = 0; plane_index < 6; ++plane_index) {
+			XMStoreFloat4(&view.a_planes[plane_index], XMPlaneNormalize(a_xm_planes[plane_index]));
+		}
+		XMStoreFloat3(&view.eye, xm_eye_os);
+	}
+
+	// With the eye at e, a triangle faces away when dot(n, p - e) >= 0 for its points p. For n within the cone's angle t of the
+	// axis at angle a to v = center - e, dot(n, v) >= |v| * cos(a + t), and the sphere reaches at most radius against n.
+	MeshletVisibility get_visibility(const CullView &view, const Meshlet &meshlet, bool is_backface_culling_enabled) {
+		for(const auto& plane : view.a_planes) {
+			if(plane.x * meshlet.center.x + plane.y * meshlet.center.y + plane.z * meshlet.center.z + plane.w < -meshlet.radius) {
+				return MESHLET_OUTSIDE_FRUSTUM;
+			}
+		}
+		if(is_backface_culling_enabled && meshlet.cone_cos > 0.f) {
+			XMVECTOR xm_v = XMLoadFloat3(&meshlet.center) - XMLoadFloat3(&view.eye);
+			XMVECTOR xm_axis = XMLoadFloat3(&meshlet.cone_axis);
+			float along = XMVectorGetX(XMVector3Dot(xm_v, xm_axis));
+			float across = XMVectorGetX(XMVector3Length(XMVector3Cross(xm_v, xm_axis)));
+			if(along * meshlet.cone_cos - across * meshlet.cone_sin >= meshlet.radius) {
+				return MESHLET_BACKFACING;
+			}
+		}
+		return MESHLET_VISIBLE;
+	}
+
+	// Keeps the num_ranges - max_ranges_per_draw smallest gaps from splitting ranges, ties broken in order
+	void merge_ranges(vector<IndexRange> &v_ranges, vector<uint32_t> &v_gaps) {
+		uint32_t num_merges = static_cast<uint32_t>(v_ranges.size()) - max_ranges_per_draw;
+		v_gaps.resize(v_ranges.size() - 1);
+		for(size_t range_index = 1; range_index < v_ranges.size(); ++range_index) {
+			v_gaps[range_index - 1] = v_ranges[range_index].first_index - (v_ranges[range_index - 1].first_index + v_ranges[range_index - 1].index_count);
+		}
+		nth_element(v_gaps.begin(), v_gaps.begin() + (num_merges - 1), v_gaps.end());
+		uint32_t max_gap = v_gaps[num_merges - 1];
+		uint32_t num_equal_merges = num_merges - static_cast<uint32_t>(count_if(v_gaps.begin(), v_gaps.end(), [&](uint32_t gap) { return gap < max_gap; }));
+
+		size_t num_kept_ranges = 1;
+		for(size_t range_index = 1; range_index < v_ranges.size(); ++range_index) {
+			auto& last_range = v_ranges[num_kept_ranges - 1];
+			const auto& range = v_ranges[range_index];
+			uint32_t gap = range.first_index - (last_range.first_index + last_range.index_count);
+			bool is_merged = gap < max_gap;
+			if(gap == max_gap && num_equal_merges > 0) {
+				is_merged = true;
+				num_equal_merges--;
+			}
+			if(is_merged) {
+				last_range.index_count = range.first_index + range.index_count - last_range.first_index;
+			}
+			else {
+				v_ranges[num_kept_ranges++] = range;
+			}
+		}
+		v_ranges.resize(num_kept_ranges);
+	}
+
+	// Index ranges of the visible meshlets, neighbours merged into one
+	void cull_meshlets(const CullView &view, const Meshlet *p_meshlets, uint32_t num_meshlets, bool is_backface_culling_enabled, vector<IndexRange> &v_ranges, vector<uint32_t> &v_gaps, MeshletCullingStatistics &statistics) {
+		v_ranges.clear();
+		for(uint32_t meshlet_index = 0; meshlet_index < num_meshlets; ++meshlet_index) {
+			const Meshlet &meshlet = p_meshlets[meshlet_index];
+			statistics.num_triangles += meshlet.index_count / 3;
+			switch(get_visibility(view, meshlet, is_backface_culling_enabled)) {
+				case MESHLET_OUTSIDE_FRUSTUM: statistics.num_frustum_culled_meshlets++; break;
+				case MESHLET_BACKFACING: statistics.num_backface_culled_meshlets++; break;
+				case MESHLET_VISIBLE:
+				{
+					if(!v_ranges.empty() && v_ranges.back().first_index + v_ranges.back().index_count == meshlet.first_index) {
+						v_ranges.back().index_count += meshlet.index_count;
+					}
+					else {
+						v_ranges.push_back({ meshlet.first_index, meshlet.index_count });
+					}
+				} break;
+			}
+		}
+		if(v_ranges.size() > max_ranges_per_draw) {
+			merge_ranges(v_ranges, v_gaps);
+		}
+		statistics.num_meshlets += num_meshlets;
+		statistics.num_ranges += static_cast<uint32_t>(v_ranges.size());
+		for(auto& range : v_ranges) {
+			statistics.num_drawn_triangles += range.index_count / 3;
+		}
+	}
+
+	// Throughput on wave grids of different sizes: building with one thread and with all of them, then culling every meshlet
+	// of them from num_views eyes all around, best of num_iterations each
+	MeshletBenchmarkResult run_benchmark(uint32_t num_iterations = 3) {
+		constexpr uint32_t num_views{ 64 };
+		constexpr float view_distance{ 3.f };
+		MeshletBenchmarkResult result = {};
+		vector<mesh_simplifier::MeshData> v_meshes(16);
+		for(uint32_t mesh_index = 0; mesh_index < v_meshes.size(); ++mesh_index) {
+			mesh_simplifier::make_wave_grid(24 + 12 * mesh_index, v_meshes[mesh_index]);
+		}
+		vector<MeshletMesh> v_meshlet_meshes(v_meshes.size());
+		result.num_meshes = static_cast<uint32_t>(v_meshes.size());
+		for(uint32_t mesh_index = 0; mesh_index < result.num_meshes; ++mesh_index) {
+			v_meshlet_meshes[mesh_index].p_mesh = &v_meshes[mesh_index];
+			result.num_triangles += static_cast<uint32_t>(v_meshes[mesh_index].v_indices.size() / 3);
+		}
+		result.num_workers = job_system::get_worker_count();
+
+		result.single_thread_ms = FLT_MAX;
+		result.multi_thread_ms = FLT_MAX;
+		for(uint32_t iteration = 0; iteration < num_iterations; ++iteration) {
+			result.single_thread_ms = min(result.single_thread_ms, measure_ms([&]() { build_meshlets(v_meshlet_meshes, 1); }));
+			result.multi_thread_ms = min(result.multi_thread_ms, measure_ms([&]() { build_meshlets(v_meshlet_meshes); }));
+		}
+		for(auto& meshlet_mesh : v_meshlet_meshes) {
+			result.num_meshlets += static_cast<uint32_t>(meshlet_mesh.v_meshlets.size());
+		}
+
+		// Eyes in Fibonacci sphere directions and a frustum that holds everything, so that only the cones cull
+		vector<CullView> v_views(num_views);
+		for(uint32_t view_index = 0; view_index < num_views; ++view_index) {
+			auto& view = v_views[view_index];
+			for(auto& plane : view.a_planes) {
+				plane = { 0.f, 0.f, 0.f, 1.f };
+			}
+			float y = 1.f - 2.f * (view_index + 0.5f) / num_views;
+			float ring_radius = sqrt(max(0.f, 1.f - y * y));
+			float phi = view_index * XM_PI * (3.f - sqrt(5.f));
+			XMStoreFloat3(&view.eye, XMVectorSet(ring_radius * cos(phi), y, ring_radius * sin(phi), 0.f) * view_distance);
+		}
+		vector<IndexRange> v_ranges;
+		vector<uint32_t> v_gaps;
+		MeshletCullingStatistics statistics = {};
+		result.num_views = num_views;
+		result.cull_ms = FLT_MAX;
+		for(uint32_t iteration = 0; iteration < num_iterations; ++iteration) {
+			float ms = measure_ms([&]() {
+				for(auto& view : v_views) {
+					for(auto& meshlet_mesh : v_meshlet_meshes) {
+						cull_meshlets(view, meshlet_mesh.v_meshlets.data(), static_cast<uint32_t>(meshlet_mesh.v_meshlets.size()), true, v_ranges, v_gaps, statistics);
+					}
+				}
+			});
+			result.cull_ms = min(result.cull_ms, ms / num_views);
+		}
+		return result;
+	}
+} // namespace meshlet_builder
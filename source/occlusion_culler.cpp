@@ -0,0 +1,384 @@
+namespace occlusion_culler
+{
+	// Occluder triangles are rasterized on the CPU into a small depth buffer and the bounds of every draw are tested against it.
+	// Depths err towards drawing: a pixel whose center a triangle covers takes the farthest depth the triangle has inside it,
+	// while a box is tested with its nearest depth over every pixel its projection touches. A draw is only culled when every
+	// one of those pixels is covered by something nearer than the whole box. Coverage is sampled at pixel centers, as masked
+	// occlusion culling does, so that the triangles of a mesh leave no cracks between them; a box seen only through a gap
+	// narrower than a pixel along an occluder's silhouette can be culled.
+	// The screen is split into bins that are cleared and rasterized as jobs, each bin then keeps the farthest depth of its tiles
+	// so that most of a test is decided a tile at a time. Rows are processed 8 pixels at a time with AVX2 where the CPU and
+	// the OS support it and 4 at a time with SSE otherwise. Triangles crossing the near plane are not used as occluders and
+	// boxes crossing it are always visible.
+	constexpr uint32_t depth_buffer_width{ 320 };
+	constexpr uint32_t depth_buffer_height{ 192 };
+	constexpr uint32_t tile_width{ 16 };
+	constexpr uint32_t tile_height{ 8 };
+	constexpr uint32_t tile_count_x{ depth_buffer_width / tile_width };
+	constexpr uint32_t tile_count_y{ depth_buffer_height / tile_height };
+	constexpr uint32_t bin_width{ 80 };
+	constexpr uint32_t bin_height{ 48 };
+	constexpr uint32_t bin_count_x{ depth_buffer_width / bin_width };
+	constexpr uint32_t bin_count_y{ depth_buffer_height / bin_height };
+	constexpr uint32_t bin_count{ bin_count_x * bin_count_y };
+	static_assert(bin_width % tile_width == 0 && bin_height % tile_height == 0 && depth_buffer_width % bin_width == 0 && depth_buffer_height % bin_height == 0,
+		"Bins are made of whole tiles and the buffer of whole bins");
+	static_assert(tile_width % 8 == 0, "Tile rows are a whole number of 8 wide vectors");
+
+	constexpr uint32_t min_vertices_per_transform_batch{ 2048 };
+	constexpr uint32_t min_triangles_per_setup_batch{ 1024 };
+	constexpr uint32_t min_draws_per_test_batch{ 64 };
+
+	// World space triangles of the occluders of a scene
+	struct OccluderMesh {
+		vector<XMFLOAT3> v_positions_ws;
+		vector<uint32_t> v_indices;
+	};
+
+	// Pixels with y down and the depth the renderer's depth buffer would store, invalid triangles are skipped when binning
+	struct ScreenTriangle {
+		float a_x[3];
+		float a_y[3];
+		float a_z[3];
+		bool is_valid;
+	};
+
+	struct Culler {
+		OcclusionIsa isa;
+		vector<float> v_depths;
+		vector<float> v_tile_max_depths;
+		vector<XMVECTOR> v_clip_positions;
+		vector<ScreenTriangle> v_triangles;
+		array<vector<uint32_t>, bin_count> a_v_bin_triangle_indices;
+		vector<uint8_t> v_is_draw_visible;
+	};
+
+	struct SimdSse {
+		using Float = __m128;
+		static constexpr uint32_t width{ 4 };
+		static Float set1(float value) { return _mm_set1_ps(value); }
+		static Float ramp() { return _mm_setr_ps(0.f, 1.f, 2.f, 3.f); }
+		static Float load(const float *p_values) { return _mm_loadu_ps(p_values); }
+		static void store(float *p_values, Float value) { _mm_storeu_ps(p_values, value); }
+		static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+		static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+		static Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+		static Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+		static Float cmp_ge(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+		static Float cmp_lt(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+		static Float and_mask(Float a, Float b) { return _mm_and_ps(a, b); }
+		static Float select(Float a, Float b, Float mask) { return _mm_or_ps(_mm_andnot_ps(mask, a), _mm_and_ps(mask, b)); }
+		static int move_mask(Float mask) { return _mm_movemask_ps(mask); }
+		static float reduce_max(Float value) {
+			value = _mm_max_ps(value, _mm_movehl_ps(value, value));
+			value = _mm_max_ss(value, _mm_shuffle_ps(value, value, 1));
+			return _mm_cvtss_f32(value);
+		}
+	};
+
+	struct SimdAvx2 {
+		using Float = __m256;
+		static constexpr uint32_t width{ 8 };
+		static Float set1(float value) { return _mm256_set1_ps(value); }
+		static Float ramp() { return _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f); }
+		static Float load(const float *p_values) { return _mm256_loadu_ps(p_values); }
+		static void store(float *p_values, Float value) { _mm256_storeu_ps(p_values, value); }
+		static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+		static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+		static Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+		static Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+		static Float cmp_ge(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+		static Float cmp_lt(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static Float and_mask(Float a, Float b) { return _mm256_and_ps(a, b); }
+		static Float select(Float a, Float b, Float mask) { return _mm256_blendv_ps(a, b, mask); }
+		static int move_mask(Float mask) { return _mm256_movemask_ps(mask); }
+		static float reduce_max(Float value) {
+			return SimdSse::reduce_max(_mm_max_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1)));
+		}
+	};
+
+	// AVX2 needs the CPU to have it and the OS to save the upper halves of the ymm registers
+	bool is_avx2_supported() {
+		int a_cpu_info[4];
+		__cpuid(a_cpu_info, 0);
+		if(a_cpu_info[0] < 7) { return false; }
+		__cpuid(a_cpu_info, 1);
+		bool is_avx_enabled = (a_cpu_info[2] & (1 << 27)) != 0 && (a_cpu_info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+		__cpuidex(a_cpu_info, 7, 0);
+		return is_avx_enabled && (a_cpu_info[1] & (1 << 5)) != 0;
+	}
+
+	void init(Culler &culler, OcclusionIsa isa) {
+		culler.isa = (isa == OCCLUSION_ISA_AVX2 && !is_avx2_supported()) ? OCCLUSION_ISA_SSE : isa;
+		culler.v_depths.assign(depth_buffer_width * depth_buffer_height, 1.f);
+		culler.v_tile_max_depths.assign(tile_count_x * tile_count_y, 1.f);
+	}
+
+	// Clip space positions are post-multiplied as everywhere else, XMVector4Transform() wants the transpose
+	void transform_vertices(Culler &culler, const OccluderMesh &occluder_mesh, const XMMATRIX &xm_clip_from_world) {
+		XMMATRIX xm_transform = XMMatrixTranspose(xm_clip_from_world);
+		uint32_t num_vertices = static_cast<uint32_t>(occluder_mesh.v_positions_ws.size());
+		culler.v_clip_positions.resize(num_vertices);
+		job_system::parallel_for(num_vertices, min_vertices_per_transform_batch, [&](uint32_t begin, uint32_t end) {
+			for(uint32_t vertex_index = begin; vertex_index < end; ++vertex_index) {
+				XMVECTOR xm_position = XMVectorSetW(XMLoadFloat3(&occluder_mesh.v_positions_ws[vertex_index]), 1.f);
+				culler.v_clip_positions[vertex_index] = XMVector4Transform(xm_position, xm_transform);
+			}
+		});
+	}
+
+	void set_up_triangles(Culler &culler, const OccluderMesh &occluder_mesh) {
+		uint32_t num_triangles = static_cast<uint32_t>(occluder_mesh.v_indices.size() / 3);
+		culler.v_triangles.resize(num_triangles);
+		job_system::parallel_for(num_triangles, min_triangles_per_setup_batch, [&](uint32_t begin, uint32_t end) {
+			for(uint32_t triangle_index = begin; triangle_index < end; ++triangle_index) {
+				ScreenTriangle &triangle = culler.v_triangles[triangle_index];
+				triangle.is_valid = true;
+				for(uint32_t corner = 0; corner < 3; ++corner) {
+					XMFLOAT4 clip_position;
+					XMStoreFloat4(&clip_position, culler.v_clip_positions[occluder_mesh.v_indices[3 * triangle_index + corner]]);
+					if(clip_position.w <= 0.f || clip_position.z < 0.f) {
+						triangle.is_valid = false;
+						break;
+					}
+					float inv_w = 1.f / clip_position.w;
+					triangle.a_x[corner] = (clip_position.x * inv_w * 0.5f + 0.5f) * depth_buffer_width;
+					triangle.a_y[corner] = (0.5f - clip_position.y * inv_w * 0.5f) * depth_buffer_height;
+					triangle.a_z[corner] = clip_position.z * inv_w;
+				}
+				if(!triangle.is_valid) { continue; }
+				float area = (triangle.a_x[1] - triangle.a_x[0]) * (triangle.a_y[2] - triangle.a_y[0]) - (triangle.a_x[2] - triangle.a_x[0]) * (triangle.a_y[1] - triangle.a_y[0]);
+				triangle.is_valid = abs(area) >= 1e-4f;
+			}
+		});
+	}
+
+	// Pixel rectangle of a triangle's bounds, clamped to the buffer
+	inline bool get_pixel_bounds(const ScreenTriangle &triangle, int32_t &x_begin, int32_t &y_begin, int32_t &x_end, int32_t &y_end) {
+		x_begin = max(static_cast<int32_t>(floor(min({ triangle.a_x[0], triangle.a_x[1], triangle.a_x[2] }))), 0);
+		y_begin = max(static_cast<int32_t>(floor(min({ triangle.a_y[0], triangle.a_y[1], triangle.a_y[2] }))), 0);
+		x_end = min(static_cast<int32_t>(ceil(max({ triangle.a_x[0], triangle.a_x[1], triangle.a_x[2] }))), int32_t(depth_buffer_width));
+		y_end = min(static_cast<int32_t>(ceil(max({ triangle.a_y[0], triangle.a_y[1], triangle.a_y[2] }))), int32_t(depth_buffer_height));
+		return x_begin < x_end && y_begin < y_end;
+	}
+
+	void bin_triangles(Culler &culler) {
+		for(auto& v_bin_triangle_indices : culler.a_v_bin_triangle_indices) {
+			v_bin_triangle_indices.clear();
+		}
+		for(uint32_t triangle_index = 0; triangle_index < culler.v_triangles.size(); ++triangle_index) {
+			const ScreenTriangle &triangle = culler.v_triangles[triangle_index];
+			int32_t x_begin, y_begin, x_end, y_end;
+			if(!triangle.is_valid || !get_pixel_bounds(triangle, x_begin, y_begin, x_end, y_end)) { continue; }
+			for(uint32_t bin_y = y_begin / bin_height; bin_y <= uint32_t(y_end - 1) / bin_height; ++bin_y) {
+				for(uint32_t bin_x = x_begin / bin_width; bin_x <= uint32_t(x_end - 1) / bin_width; ++bin_x) {
+					culler.a_v_bin_triangle_indices[bin_y * bin_count_x + bin_x].push_back(triangle_index);
+				}
+			}
+		}
+	}
+
+	// Edge functions are positive inside, a pixel is covered when they all are at its center. The depth written is the
+	// plane's farthest over the pixel, never beyond the triangle's farthest vertex.
+	template<typename Simd>
+	void rasterize_triangle(const ScreenTriangle &triangle, int32_t bin_x_begin, int32_t bin_y_begin, float *p_depths) {
+		int32_t x_begin, y_begin, x_end, y_end;
+		get_pixel_bounds(triangle, x_begin, y_begin, x_end, y_end);
+		x_begin = max(x_begin, bin_x_begin) & ~int32_t(Simd::width - 1);
+		y_begin = max(y_begin, bin_y_begin);
+		x_end = min(x_end, bin_x_begin + int32_t(bin_width));
+		y_end = min(y_end, bin_y_begin + int32_t(bin_height));
+		if(x_begin >= x_end || y_begin >= y_end) { return; }
+
+		const float *p_x = triangle.a_x;
+		const float *p_y = triangle.a_y;
+		const float *p_z = triangle.a_z;
+		float a_edge_a[3], a_edge_b[3], a_edge_c[3];
+		for(uint32_t edge = 0; edge < 3; ++edge) {
+			uint32_t i = edge, j = (edge + 1) % 3, k = (edge + 2) % 3;
+			float a = p_y[i] - p_y[j];
+			float b = p_x[j] - p_x[i];
+			float c = p_x[i] * p_y[j] - p_x[j] * p_y[i];
+			if(a * p_x[k] + b * p_y[k] + c < 0.f) { a = -a; b = -b; c = -c; }
+			a_edge_a[edge] = a;
+			a_edge_b[edge] = b;
+			a_edge_c[edge] = c;
+		}
+		float area = (p_x[1] - p_x[0]) * (p_y[2] - p_y[0]) - (p_x[2] - p_x[0]) * (p_y[1] - p_y[0]);
+		float z_dx = ((p_z[1] - p_z[0]) * (p_y[2] - p_y[0]) - (p_z[2] - p_z[0]) * (p_y[1] - p_y[0])) / area;
+		float z_dy = ((p_z[2] - p_z[0]) * (p_x[1] - p_x[0]) - (p_z[1] - p_z[0]) * (p_x[2] - p_x[0])) / area;
+		float z_at_origin = p_z[0] - z_dx * p_x[0] - z_dy * p_y[0] + 0.5f * (abs(z_dx) + abs(z_dy));
+		auto z_max = Simd::set1(max({ p_z[0], p_z[1], p_z[2] }));
+
+		auto x_first = Simd::add(Simd::ramp(), Simd::set1(x_begin + 0.5f));
+		auto x_step = Simd::set1(float(Simd::width));
+		auto zero = Simd::set1(0.f);
+		typename Simd::Float a_a[3];
+		for(uint32_t edge = 0; edge < 3; ++edge) {
+			a_a[edge] = Simd::set1(a_edge_a[edge]);
+		}
+		auto lane_z_dx = Simd::set1(z_dx);
+		for(int32_t y = y_begin; y < y_end; ++y) {
+			float y_center = y + 0.5f;
+			typename Simd::Float a_row_c[3];
+			for(uint32_t edge = 0; edge < 3; ++edge) {
+				a_row_c[edge] = Simd::set1(a_edge_b[edge] * y_center + a_edge_c[edge]);
+			}
+			auto row_z = Simd::set1(z_dy * y_center + z_at_origin);
+			float *p_row = p_depths + y * depth_buffer_width;
+			auto x = x_first;
+			for(int32_t x_index = x_begin; x_index < x_end; x_index += Simd::width, x = Simd::add(x, x_step)) {
+				auto mask = Simd::cmp_ge(Simd::add(Simd::mul(a_a[0], x), a_row_c[0]), zero);
+				mask = Simd::and_mask(mask, Simd::cmp_ge(Simd::add(Simd::mul(a_a[1], x), a_row_c[1]), zero));
+				mask = Simd::and_mask(mask, Simd::cmp_ge(Simd::add(Simd::mul(a_a[2], x), a_row_c[2]), zero));
+				if(Simd::move_mask(mask) == 0) { continue; }
+				auto z = Simd::min(Simd::add(Simd::mul(lane_z_dx, x), row_z), z_max);
+				auto depth = Simd::load(p_row + x_index);
+				Simd::store(p_row + x_index, Simd::select(depth, Simd::min(depth, z), mask));
+			}
+		}
+	}
+
+	template<typename Simd>
+	void rasterize_bin(Culler &culler, uint32_t bin_index) {
+		int32_t bin_x_begin = (bin_index % bin_count_x) * bin_width;
+		int32_t bin_y_begin = (bin_index / bin_count_x) * bin_height;
+		float *p_depths = culler.v_depths.data();
+		for(int32_t y = bin_y_begin; y < bin_y_begin + int32_t(bin_height); ++y) {
+			fill_n(p_depths + y * depth_buffer_width + bin_x_begin, bin_width, 1.f);
+		}
+		for(uint32_t triangle_index : culler.a_v_bin_triangle_indices[bin_index]) {
+			rasterize_triangle<Simd>(culler.v_triangles[triangle_index], bin_x_begin, bin_y_begin, p_depths);
+		}
+
+		for(uint32_t tile_y = bin_y_begin / tile_height; tile_y < (bin_y_begin + bin_height) / tile_height; ++tile_y) {
+			for(uint32_t tile_x = bin_x_begin / tile_width; tile_x < (bin_x_begin + bin_width) / tile_width; ++tile_x) {
+				auto max_depth = Simd::set1(0.f);
+				for(uint32_t y = tile_y * tile_height; y < (tile_y + 1) * tile_height; ++y) {
+					for(uint32_t x = tile_x * tile_width; x < (tile_x + 1) * tile_width; x += Simd::width) {
+						max_depth = Simd::max(max_depth, Simd::load(p_depths + y * depth_buffer_width + x));
+					}
+				}
+				culler.v_tile_max_depths[tile_y * tile_count_x + tile_x] = Simd::reduce_max(max_depth);
+			}
+		}
+	}
+
+	void rasterize_occluders(Culler &culler, const OccluderMesh &occluder_mesh, const XMMATRIX &xm_clip_from_world) {
+		transform_vertices(culler, occluder_mesh, xm_clip_from_world);
+		set_up_triangles(culler, occluder_mesh);
+		bin_triangles(culler);
+		job_system::parallel_for(bin_count, 1, [&culler](uint32_t begin, uint32_t end) {
+			for(uint32_t bin_index = begin; bin_index < end; ++bin_index) {
+				if(culler.isa == OCCLUSION_ISA_AVX2) { rasterize_bin<SimdAvx2>(culler, bin_index); }
+				else { rasterize_bin<SimdSse>(culler, bin_index); }
+			}
+		});
+	}
+
+	// Pixel rectangle and nearest depth of a box, false when its projection is off the buffer or it crosses the near plane
+	bool project_box(const XMMATRIX &xm_transform, const XMFLOAT3 &center_ws, const XMFLOAT3 &extents_ws, int32_t &x_begin, int32_t &y_begin, int32_t &x_end, int32_t &y_end, float &min_z, bool &is_crossing_near_plane) {
+		float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+		min_z = FLT_MAX;
+		is_crossing_near_plane = false;
+		for(uint32_t corner = 0; corner < 8; ++corner) {
+			XMVECTOR xm_corner = XMVectorSet(center_ws.x + ((corner & 1) ? extents_ws.x : -extents_ws.x), center_ws.y + ((corner & 2) ? extents_ws.y : -extents_ws.y),
+				center_ws.z + ((corner & 4) ? extents_ws.z : -extents_ws.z), 1.f);
+			XMFLOAT4 clip_position;
+			XMStoreFloat4(&clip_position, XMVector4Transform(xm_corner, xm_transform));
+			if(clip_position.w <= 0.f || clip_position.z < 0.f) {
+				is_crossing_near_plane = true;
+				return false;
+			}
+			float inv_w = 1.f / clip_position.w;
+			float x = (clip_position.x * inv_w * 0.5f + 0.5f) * depth_buffer_width;
+			float y = (0.5f - clip_position.y * inv_w * 0.5f) * depth_buffer_height;
+			min_x = min(min_x, x);
+			max_x = max(max_x, x);
+			min_y = min(min_y, y);
+			max_y = max(max_y, y);
+			min_z = min(min_z, clip_position.z * inv_w);
+		}
+		x_begin = max(static_cast<int32_t>(floor(min_x)), 0);
+		y_begin = max(static_cast<int32_t>(floor(min_y)), 0);
+		x_end = min(static_cast<int32_t>(ceil(max_x)), int32_t(depth_buffer_width));
+		y_end = min(static_cast<int32_t>(ceil(max_y)), int32_t(depth_buffer_height));
+		return x_begin < x_end && y_begin < y_end && min_z <= 1.f;
+	}
+
+	template<typename Simd>
+	bool is_visible(const Culler &culler, const XMMATRIX &xm_transform, const XMFLOAT3 &center_ws, const XMFLOAT3 &extents_ws) {
+		int32_t x_begin, y_begin, x_end, y_end;
+		float min_z;
+		bool is_crossing_near_plane;
+		if(!project_box(xm_transform, center_ws, extents_ws, x_begin, y_begin, x_end, y_end, min_z, is_crossing_near_plane)) {
+			return is_crossing_near_plane;
+		}
+
+		auto box_z = Simd::set1(min_z);
+		for(int32_t tile_y = y_begin / tile_height; tile_y <= (y_end - 1) / int32_t(tile_height); ++tile_y) {
+			for(int32_t tile_x = x_begin / tile_width; tile_x <= (x_end - 1) / int32_t(tile_width); ++tile_x) {
+				if(culler.v_tile_max_depths[tile_y * tile_count_x + tile_x] < min_z) { continue; }
+
+				int32_t rect_x_begin = max(x_begin, tile_x * int32_t(tile_width));
+				int32_t rect_x_end = min(x_end, (tile_x + 1) * int32_t(tile_width));
+				auto lane_x_begin = Simd::set1(float(rect_x_begin));
+				auto lane_x_end = Simd::set1(float(rect_x_end));
+				for(int32_t y = max(y_begin, tile_y * int32_t(tile_height)); y < min(y_end, (tile_y + 1) * int32_t(tile_height)); ++y) {
+					const float *p_row = culler.v_depths.data() + y * depth_buffer_width;
+					for(int32_t x = rect_x_begin & ~int32_t(Simd::width - 1); x < rect_x_end; x += Simd::width) {
+						auto lane_x = Simd::add(Simd::ramp(), Simd::set1(float(x)));
+						auto mask = Simd::and_mask(Simd::cmp_ge(lane_x, lane_x_begin), Simd::cmp_lt(lane_x, lane_x_end));
+						mask = Simd::and_mask(mask, Simd::cmp_ge(Simd::load(p_row + x), box_z));
+						if(Simd::move_mask(mask) != 0) { return true; }
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	// Keeps the order of the draws, returns how many were culled
+	uint32_t cull_draws(Culler &culler, const XMMATRIX &xm_clip_from_world, const vector<DrawInfo> &v_draws, vector<DrawInfo> &v_visible_draws) {
+		XMMATRIX xm_transform = XMMatrixTranspose(xm_clip_from_world);
+		uint32_t num_draws = static_cast<uint32_t>(v_draws.size());
+		culler.v_is_draw_visible.resize(num_draws);
+		job_system::parallel_for(num_draws, min_draws_per_test_batch, [&](uint32_t begin, uint32_t end) {
+			for(uint32_t draw_index = begin; draw_index < end; ++draw_index) {
+				const DrawInfo &draw_info = v_draws[draw_index];
+				culler.v_is_draw_visible[draw_index] = (culler.isa == OCCLUSION_ISA_AVX2) ?
+					is_visible<SimdAvx2>(culler, xm_transform, draw_info.bbox_center_ws, draw_info.bbox_extents_ws) :
+					is_visible<SimdSse>(culler, xm_transform, draw_info.bbox_center_ws, draw_info.bbox_extents_ws);
+			}
+		});
+
+		v_visible_draws.clear();
+		for(uint32_t draw_index = 0; draw_index < num_draws; ++draw_index) {
+			if(culler.v_is_draw_visible[draw_index]) {
+				v_visible_draws.push_back(v_draws[draw_index]);
+			}
+		}
+		return num_draws - static_cast<uint32_t>(v_visible_draws.size());
+	}
+
+	// Rasterizes the occluders and culls the draws the way the frame does, with each instruction set the CPU supports, best of num_iterations
+	OcclusionBenchmarkResult run_benchmark(const OccluderMesh &occluder_mesh, const vector<DrawInfo> &v_draws, const XMMATRIX &xm_clip_from_world, uint32_t num_iterations = 10) {
+		OcclusionBenchmarkResult result = {};
+		result.is_avx2_supported = is_avx2_supported();
+		result.num_occluder_triangles = static_cast<uint32_t>(occluder_mesh.v_indices.size() / 3);
+		result.num_draws = static_cast<uint32_t>(v_draws.size());
+		vector<DrawInfo> v_visible_draws;
+		for(uint32_t isa = 0; isa < occlusion_isa_count; ++isa) {
+			if(isa == OCCLUSION_ISA_AVX2 && !result.is_avx2_supported) { continue; }
+			Culler culler;
+			init(culler, OcclusionIsa(isa));
+			result.a_rasterize_ms[isa] = FLT_MAX;
+			result.a_test_ms[isa] = FLT_MAX;
+			for(uint32_t iteration = 0; iteration < num_iterations; ++iteration) {
+				result.a_rasterize_ms[isa] = min(result.a_rasterize_ms[isa], measure_ms([&]() { rasterize_occluders(culler, occluder_mesh, xm_clip_from_world); }));
+				result.a_test_ms[isa] = min(result.a_test_ms[isa], measure_ms([&]() { result.num_culled_draws = cull_draws(culler, xm_clip_from_world, v_draws, v_visible_draws); }));
+			}
+		}
+		return result;
+	}
+} // namespace occlusion_culler
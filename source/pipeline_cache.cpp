@@ -0,0 +1,239 @@
+namespace pipeline_cache
+{
+	// On-disk layout: FileHeader followed by num_entries x { EntryHeader, blob bytes }
+	constexpr uint32_t file_magic{ 0x43535050 }; // "PPSC"
+	constexpr uint32_t file_version{ 1 };
+	constexpr uint64_t fnv_offset_basis{ 0xcbf29ce484222325ull };
+	constexpr uint64_t fnv_prime{ 0x100000001b3ull };
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t device_hash;
+		uint64_t payload_hash;
+		uint32_t num_entries;
+		uint32_t padding;
+	};
+
+	struct EntryHeader {
+		uint64_t key;
+		uint64_t blob_size;
+	};
+
+	// Driver compiled PSO blobs keyed by compute_*_pipeline_key, only valid for the device they were created on
+	struct PipelineCache {
+		uint64_t device_hash{ 0 };
+		map<uint64_t, vector<uint8_t>> blobs;
+		mutex blob_mutex;
+		bool is_dirty{ false };
+	};
+
+	uint64_t hash_bytes(const void *p_data, size_t size, uint64_t hash = fnv_offset_basis) {
+		auto p_bytes = static_cast<const uint8_t*>(p_data);
+		for(size_t byte_index = 0; byte_index < size; ++byte_index) {
+			hash ^= p_bytes[byte_index];
+			hash *= fnv_prime;
+		}
+		return hash;
+	}
+
+	template<typename T>
+	uint64_t hash_value(uint64_t hash, const T &value) {
+		static_assert(is_trivially_copyable_v<T>, "Only plain values can be hashed bytewise");
+		return hash_bytes(&value, sizeof(T), hash);
+	}
+
+	// DXBC containers start with "DXBC" and a 128-bit checksum of their content computed by the compiler, reuse it as the shader hash
+	uint64_t get_shader_hash(const D3D12_SHADER_BYTECODE &bytecode) {
+		if(bytecode.pShaderBytecode == nullptr || bytecode.BytecodeLength == 0) {
+			return 0;
+		}
+		auto p_bytes = static_cast<const uint8_t*>(bytecode.pShaderBytecode);
+		if(bytecode.BytecodeLength >= 20 && memcmp(p_bytes, "DXBC", 4) == 0) {
+			uint64_t a_checksum[2];
+			memcpy(a_checksum, p_bytes + 4, sizeof(a_checksum));
+			return a_checksum[0] ^ (a_checksum[1] * fnv_prime);
+		}
+		return hash_bytes(p_bytes, bytecode.BytecodeLength);
+	}
+
+	// Every field that ends up in the driver compiled PSO, member by member so that struct padding never leaks into the key
+	uint64_t compute_graphics_pipeline_key(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc, uint64_t root_signature_hash) {
+		uint64_t hash = hash_value(fnv_offset_basis, root_signature_hash);
+		hash = hash_value(hash, get_shader_hash(desc.VS));
+		hash = hash_value(hash, get_shader_hash(desc.PS));
+		hash = hash_value(hash, get_shader_hash(desc.DS));
+		hash = hash_value(hash, get_shader_hash(desc.HS));
+		hash = hash_value(hash, get_shader_hash(desc.GS));
+
+		hash = hash_value(hash, desc.BlendState.AlphaToCoverageEnable);
+		hash = hash_value(hash, desc.BlendState.IndependentBlendEnable);
+		for(uint32_t rt_index = 0; rt_index < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++rt_index) {
+			auto& rt_blend = desc.BlendState.RenderTarget[rt_index];
+			hash = hash_value(hash, rt_blend.BlendEnable);
+			hash = hash_value(hash, rt_blend.LogicOpEnable);
+			hash = hash_value(hash, rt_blend.SrcBlend);
+			hash = hash_value(hash, rt_blend.DestBlend);
+			hash = hash_value(hash, rt_blend.BlendOp);
+			hash = hash_value(hash, rt_blend.SrcBlendAlpha);
+			hash = hash_value(hash, rt_blend.DestBlendAlpha);
+			hash = hash_value(hash, rt_blend.BlendOpAlpha);
+			hash = hash_value(hash, rt_blend.LogicOp);
+			hash = hash_value(hash, rt_blend.RenderTargetWriteMask);
+		}
+		hash = hash_value(hash, desc.SampleMask);
+
+		auto& rasterizer = desc.RasterizerState;
+		hash = hash_value(hash, rasterizer.FillMode);
+		hash = hash_value(hash, rasterizer.CullMode);
+		hash = hash_value(hash, rasterizer.FrontCounterClockwise);
+		hash = hash_value(hash, rasterizer.DepthBias);
+		hash = hash_value(hash, rasterizer.DepthBiasClamp);
+		hash = hash_value(hash, rasterizer.SlopeScaledDepthBias);
+		hash = hash_value(hash, rasterizer.DepthClipEnable);
+		hash = hash_value(hash, rasterizer.MultisampleEnable);
+		hash = hash_value(hash, rasterizer.AntialiasedLineEnable);
+		hash = hash_value(hash, rasterizer.ForcedSampleCount);
+		hash = hash_value(hash, rasterizer.ConservativeRaster);
+
+		auto& depth_stencil = desc.DepthStencilState;
+		hash = hash_value(hash, depth_stencil.DepthEnable);
+		hash = hash_value(hash, depth_stencil.DepthWriteMask);
+		hash = hash_value(hash, depth_stencil.DepthFunc);
+		hash = hash_value(hash, depth_stencil.StencilEnable);
+		hash = hash_value(hash, depth_stencil.StencilReadMask);
+		hash = hash_value(hash, depth_stencil.StencilWriteMask);
+		for(auto p_face : { &depth_stencil.FrontFace, &depth_stencil.BackFace }) {
+			hash = hash_value(hash, p_face->StencilFailOp);
+			hash = hash_value(hash, p_face->StencilDepthFailOp);
+			hash = hash_value(hash, p_face->StencilPassOp);
+			hash = hash_value(hash, p_face->StencilFunc);
+		}
+
+		for(uint32_t element_index = 0; element_index < desc.InputLayout.NumElements; ++element_index) {
+			auto& element = desc.InputLayout.pInputElementDescs[element_index];
+			hash = hash_bytes(element.SemanticName, strlen(element.SemanticName), hash);
+			hash = hash_value(hash, element.SemanticIndex);
+			hash = hash_value(hash, element.Format);
+			hash = hash_value(hash, element.InputSlot);
+			hash = hash_value(hash, element.AlignedByteOffset);
+			hash = hash_value(hash, element.InputSlotClass);
+			hash = hash_value(hash, element.InstanceDataStepRate);
+		}
+
+		hash = hash_value(hash, desc.IBStripCutValue);
+		hash = hash_value(hash, desc.PrimitiveTopologyType);
+		hash = hash_value(hash, desc.NumRenderTargets);
+		for(uint32_t rt_index = 0; rt_index < desc.NumRenderTargets; ++rt_index) {
+			hash = hash_value(hash, desc.RTVFormats[rt_index]);
+		}
+		hash = hash_value(hash, desc.DSVFormat);
+		hash = hash_value(hash, desc.SampleDesc.Count);
+		hash = hash_value(hash, desc.SampleDesc.Quality);
+		hash = hash_value(hash, desc.NodeMask);
+		hash = hash_value(hash, desc.Flags);
+		return hash;
+	}
+
+	uint64_t compute_compute_pipeline_key(const D3D12_COMPUTE_PIPELINE_STATE_DESC &desc, uint64_t root_signature_hash) {
+		uint64_t hash = hash_value(fnv_offset_basis, root_signature_hash);
+		hash = hash_value(hash, get_shader_hash(desc.CS));
+		hash = hash_value(hash, desc.NodeMask);
+		hash = hash_value(hash, desc.Flags);
+		return hash;
+	}
+
+	bool find_blob(PipelineCache &cache, uint64_t key, vector<uint8_t> &blob) {
+		lock_guard<mutex> lock(cache.blob_mutex);
+		auto it = cache.blobs.find(key);
+		if(it == cache.blobs.end()) {
+			return false;
+		}
+		blob = it->second;
+		return true;
+	}
+
+	void add_blob(PipelineCache &cache, uint64_t key, const void *p_blob, size_t blob_size) {
+		lock_guard<mutex> lock(cache.blob_mutex);
+		auto p_bytes = static_cast<const uint8_t*>(p_blob);
+		cache.blobs[key].assign(p_bytes, p_bytes + blob_size);
+		cache.is_dirty = true;
+	}
+
+	// Called with blob_mutex held
+	vector<uint8_t> serialize_blobs(const PipelineCache &cache) {
+		vector<uint8_t> data(sizeof(FileHeader));
+		for(auto& [key, blob] : cache.blobs) {
+			EntryHeader entry_header{ key, blob.size() };
+			auto p_entry_header = reinterpret_cast<const uint8_t*>(&entry_header);
+			data.insert(data.end(), p_entry_header, p_entry_header + sizeof(EntryHeader));
+			data.insert(data.end(), blob.begin(), blob.end());
+		}
+
+		FileHeader header = {};
+		header.magic = file_magic;
+		header.version = file_version;
+		header.device_hash = cache.device_hash;
+		header.payload_hash = hash_bytes(data.data() + sizeof(FileHeader), data.size() - sizeof(FileHeader));
+		header.num_entries = static_cast<uint32_t>(cache.blobs.size());
+		memcpy(data.data(), &header, sizeof(FileHeader));
+		return data;
+	}
+
+	vector<uint8_t> serialize(PipelineCache &cache) {
+		lock_guard<mutex> lock(cache.blob_mutex);
+		return serialize_blobs(cache);
+	}
+
+	// Rejects files written by another build, another device or driver, or truncated/corrupted ones
+	bool deserialize(const uint8_t *p_data, size_t size, PipelineCache &cache) {
+		FileHeader header = {};
+		if(size < sizeof(FileHeader)) { return false; }
+		memcpy(&header, p_data, sizeof(FileHeader));
+		if(header.magic != file_magic || header.version != file_version || header.device_hash != cache.device_hash) { return false; }
+		if(header.payload_hash != hash_bytes(p_data + sizeof(FileHeader), size - sizeof(FileHeader))) { return false; }
+
+		map<uint64_t, vector<uint8_t>> blobs;
+		size_t offset = sizeof(FileHeader);
+		for(uint32_t entry_index = 0; entry_index < header.num_entries; ++entry_index) {
+			EntryHeader entry_header = {};
+			if(size - offset < sizeof(EntryHeader)) { return false; }
+			memcpy(&entry_header, p_data + offset, sizeof(EntryHeader));
+			offset += sizeof(EntryHeader);
+			if(size - offset < entry_header.blob_size) { return false; }
+			blobs[entry_header.key].assign(p_data + offset, p_data + offset + entry_header.blob_size);
+			offset += entry_header.blob_size;
+		}
+		if(offset != size) { return false; }
+
+		lock_guard<mutex> lock(cache.blob_mutex);
+		cache.blobs = std::move(blobs);
+		cache.is_dirty = false;
+		return true;
+	}
+
+	bool load(const string &file_address, PipelineCache &cache) {
+		ifstream file(file_address, ios::binary | ios::ate);
+		if(!file.is_open()) { return false; }
+		size_t size = static_cast<size_t>(file.tellg());
+		vector<uint8_t> data(size);
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(data.data()), size);
+		return file.good() && deserialize(data.data(), data.size(), cache);
+	}
+
+	// The dirty flag is cleared with the snapshot that gets written, a blob added meanwhile marks the cache dirty again
+	void save(const string &file_address, PipelineCache &cache) {
+		vector<uint8_t> data;
+		{
+			lock_guard<mutex> lock(cache.blob_mutex);
+			data = serialize_blobs(cache);
+			cache.is_dirty = false;
+		}
+		ofstream file(file_address, ios::binary | ios::trunc);
+		if(!file.is_open()) {
+			throw exception("Pipeline cache could not be written!");
+		}
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+}
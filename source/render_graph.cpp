@@ -0,0 +1,291 @@
+namespace render_graph
+{
+	// A frame is described once as passes that declare the resource states they read and write in.
+	// compile() turns that into the barriers each pass needs and, from the lifetime of every transient
+	// resource, offsets into a single heap where resources whose lifetimes do not overlap share memory.
+	// Nothing here touches the device, the renderer turns the result into D3D12 calls.
+	constexpr uint32_t invalid_index{ UINT32_MAX };
+
+	constexpr D3D12_RESOURCE_STATES write_states{ D3D12_RESOURCE_STATE_RENDER_TARGET | D3D12_RESOURCE_STATE_UNORDERED_ACCESS | D3D12_RESOURCE_STATE_DEPTH_WRITE |
+		D3D12_RESOURCE_STATE_STREAM_OUT | D3D12_RESOURCE_STATE_COPY_DEST | D3D12_RESOURCE_STATE_RESOLVE_DEST };
+
+	struct ResourceDesc {
+		string name;
+		// Transient resources are placed in the graph's heap, the others are imported from the caller
+		bool is_transient;
+		// Size and alignment as reported by GetResourceAllocationInfo, only used for transient resources
+		uint64_t size;
+		uint64_t alignment;
+		// Render targets and depth buffers have to be discarded in this state after they take over aliased memory, zero when no initialization is needed
+		D3D12_RESOURCE_STATES initialization_state;
+		// Imported resources enter the graph in initial_state and are left in final_state
+		D3D12_RESOURCE_STATES initial_state;
+		D3D12_RESOURCE_STATES final_state;
+	};
+
+	struct Access {
+		uint32_t resource_index;
+		D3D12_RESOURCE_STATES state;
+		bool is_write;
+	};
+
+	struct Pass {
+		string name;
+		vector<Access> v_accesses;
+	};
+
+	struct Graph {
+		vector<ResourceDesc> v_resources;
+		vector<Pass> v_passes;
+	};
+
+	struct Barrier {
+		enum Type : uint32_t { TYPE_TRANSITION, TYPE_ALIASING, TYPE_UAV };
+		Type type;
+		uint32_t resource_index;
+		D3D12_RESOURCE_STATES state_before;
+		D3D12_RESOURCE_STATES state_after;
+	};
+
+	// Recorded right before a pass: the aliasing batch, the discards of the resources that just took over aliased memory, then the pass's own transitions
+	struct PassPreamble {
+		vector<Barrier> v_aliasing_barriers;
+		vector<uint32_t> v_discarded_resources;
+		vector<Barrier> v_barriers;
+	};
+
+	struct CompiledGraph {
+		vector<PassPreamble> v_pass_preambles;
+		// Brings the imported resources into their final state after the last pass
+		vector<Barrier> v_final_barriers;
+		vector<uint32_t> v_first_pass_indices;
+		vector<uint32_t> v_last_pass_indices;
+		vector<uint64_t> v_heap_offsets;
+		// Transient resources have to be created in the state the frame leaves them in
+		vector<D3D12_RESOURCE_STATES> v_creation_states;
+		uint64_t heap_size;
+		uint64_t heap_alignment;
+		// Heap size it would take without aliasing, for statistics
+		uint64_t unaliased_heap_size;
+	};
+
+	uint32_t add_transient_resource(Graph &graph, const string &name, uint64_t size, uint64_t alignment, D3D12_RESOURCE_STATES initialization_state) {
+		graph.v_resources.push_back({ name, true, size, alignment, initialization_state, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COMMON });
+		return static_cast<uint32_t>(graph.v_resources.size() - 1);
+	}
+
+	uint32_t add_imported_resource(Graph &graph, const string &name, D3D12_RESOURCE_STATES initial_state, D3D12_RESOURCE_STATES final_state) {
+		graph.v_resources.push_back({ name, false, 0, 0, D3D12_RESOURCE_STATE_COMMON, initial_state, final_state });
+		return static_cast<uint32_t>(graph.v_resources.size() - 1);
+	}
+
+	uint32_t add_pass(Graph &graph, const string &name) {
+		graph.v_passes.push_back({ name, {} });
+		return static_cast<uint32_t>(graph.v_passes.size() - 1);
+	}
+
+	void read(Graph &graph, uint32_t pass_index, uint32_t resource_index, D3D12_RESOURCE_STATES state) {
+		if(state & write_states) { throw exception("A render graph read must use a read-only state"); }
+		graph.v_passes[pass_index].v_accesses.push_back({ resource_index, state, false });
+	}
+
+	void write(Graph &graph, uint32_t pass_index, uint32_t resource_index, D3D12_RESOURCE_STATES state) {
+		if(!(state & write_states)) { throw exception("A render graph write must use a writable state"); }
+		graph.v_passes[pass_index].v_accesses.push_back({ resource_index, state, true });
+	}
+
+	inline uint64_t align_up(uint64_t value, uint64_t alignment) {
+		return (alignment > 1) ? (value + alignment - 1) / alignment * alignment : value;
+	}
+
+	inline bool is_read_only(D3D12_RESOURCE_STATES state) {
+		return (state & write_states) == 0;
+	}
+
+	// State of every resource a pass touches, several reads of one resource are combined into one state
+	void get_pass_states(const Graph &graph, uint32_t pass_index, vector<D3D12_RESOURCE_STATES> &v_states, vector<bool> &v_is_written) {
+		fill(v_states.begin(), v_states.end(), D3D12_RESOURCE_STATE_COMMON);
+		fill(v_is_written.begin(), v_is_written.end(), false);
+		for(auto& access : graph.v_passes[pass_index].v_accesses) {
+			v_states[access.resource_index] |= access.state;
+			v_is_written[access.resource_index] = v_is_written[access.resource_index] || access.is_write;
+		}
+	}
+
+	// First fit placement, largest resources first, against the already placed resources whose lifetimes overlap
+	void place_transient_resources(const Graph &graph, const vector<uint32_t> &v_lifetime_begins, const vector<uint32_t> &v_lifetime_ends, CompiledGraph &compiled) {
+		auto& v_resources = graph.v_resources;
+		vector<uint32_t> v_order;
+		for(uint32_t resource_index = 0; resource_index < v_resources.size(); ++resource_index) {
+			if(v_resources[resource_index].is_transient && v_lifetime_begins[resource_index] != invalid_index) {
+				v_order.push_back(resource_index);
+			}
+		}
+		stable_sort(v_order.begin(), v_order.end(), [&](uint32_t a, uint32_t b) { return v_resources[a].size > v_resources[b].size; });
+
+		vector<uint32_t> v_placed;
+		vector<pair<uint64_t, uint64_t>> v_occupied_ranges;
+		for(uint32_t resource_index : v_order) {
+			auto& resource = v_resources[resource_index];
+			uint32_t lifetime_begin = v_lifetime_begins[resource_index];
+			uint32_t lifetime_end = v_lifetime_ends[resource_index];
+
+			v_occupied_ranges.clear();
+			for(uint32_t placed_index : v_placed) {
+				bool is_overlapping = v_lifetime_begins[placed_index] <= lifetime_end && lifetime_begin <= v_lifetime_ends[placed_index];
+				if(is_overlapping) {
+					v_occupied_ranges.emplace_back(compiled.v_heap_offsets[placed_index], compiled.v_heap_offsets[placed_index] + v_resources[placed_index].size);
+				}
+			}
+			sort(v_occupied_ranges.begin(), v_occupied_ranges.end());
+
+			uint64_t offset = 0;
+			for(auto& [range_begin, range_end] : v_occupied_ranges) {
+				if(offset + resource.size <= range_begin) { break; }
+				offset = max(offset, align_up(range_end, resource.alignment));
+			}
+			compiled.v_heap_offsets[resource_index] = offset;
+			compiled.heap_size = max(compiled.heap_size, offset + resource.size);
+			compiled.heap_alignment = max(compiled.heap_alignment, resource.alignment);
+			compiled.unaliased_heap_size = align_up(compiled.unaliased_heap_size, resource.alignment) + resource.size;
+			v_placed.push_back(resource_index);
+		}
+	}
+
+	bool is_sharing_memory(const Graph &graph, const CompiledGraph &compiled, uint32_t resource_index) {
+		auto& v_resources = graph.v_resources;
+		uint64_t begin = compiled.v_heap_offsets[resource_index];
+		uint64_t end = begin + v_resources[resource_index].size;
+		for(uint32_t other_index = 0; other_index < v_resources.size(); ++other_index) {
+			if(other_index == resource_index || !v_resources[other_index].is_transient || compiled.v_first_pass_indices[other_index] == invalid_index) { continue; }
+			uint64_t other_begin = compiled.v_heap_offsets[other_index];
+			uint64_t other_end = other_begin + v_resources[other_index].size;
+			if(begin < other_end && other_begin < end) { return true; }
+		}
+		return false;
+	}
+
+	CompiledGraph compile(const Graph &graph) {
+		uint32_t num_resources = static_cast<uint32_t>(graph.v_resources.size());
+		uint32_t num_passes = static_cast<uint32_t>(graph.v_passes.size());
+
+		CompiledGraph compiled = {};
+		compiled.v_pass_preambles.resize(num_passes);
+		compiled.v_first_pass_indices.assign(num_resources, invalid_index);
+		compiled.v_last_pass_indices.assign(num_resources, invalid_index);
+		compiled.v_heap_offsets.assign(num_resources, 0);
+		compiled.v_creation_states.assign(num_resources, D3D12_RESOURCE_STATE_COMMON);
+		compiled.heap_alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+		// Lifetimes
+		for(uint32_t pass_index = 0; pass_index < num_passes; ++pass_index) {
+			for(auto& access : graph.v_passes[pass_index].v_accesses) {
+				if(access.resource_index >= num_resources) { throw exception("Render graph pass uses an unknown resource"); }
+				auto& first_pass = compiled.v_first_pass_indices[access.resource_index];
+				first_pass = min(first_pass, pass_index);
+				compiled.v_last_pass_indices[access.resource_index] = pass_index;
+			}
+		}
+
+		// A resource read before it is written carries its content over from the previous frame, so it keeps its memory for the whole frame
+		vector<D3D12_RESOURCE_STATES> v_states(num_resources);
+		vector<bool> v_is_written(num_resources);
+		vector<uint32_t> v_lifetime_begins = compiled.v_first_pass_indices;
+		vector<uint32_t> v_lifetime_ends = compiled.v_last_pass_indices;
+		for(uint32_t resource_index = 0; resource_index < num_resources; ++resource_index) {
+			uint32_t first_pass = compiled.v_first_pass_indices[resource_index];
+			if(graph.v_resources[resource_index].is_transient && first_pass != invalid_index) {
+				get_pass_states(graph, first_pass, v_states, v_is_written);
+				if(!v_is_written[resource_index]) {
+					v_lifetime_begins[resource_index] = 0;
+					v_lifetime_ends[resource_index] = num_passes - 1;
+				}
+			}
+		}
+		place_transient_resources(graph, v_lifetime_begins, v_lifetime_ends, compiled);
+
+		// Barriers
+		vector<D3D12_RESOURCE_STATES> v_current_states(num_resources, D3D12_RESOURCE_STATE_COMMON);
+		vector<D3D12_RESOURCE_STATES> v_frame_start_states(num_resources, D3D12_RESOURCE_STATE_COMMON);
+		vector<bool> v_is_last_use_uav_write(num_resources, false);
+		vector<D3D12_RESOURCE_STATES> v_next_states(num_resources);
+		vector<bool> v_is_next_written(num_resources);
+		for(uint32_t resource_index = 0; resource_index < num_resources; ++resource_index) {
+			if(!graph.v_resources[resource_index].is_transient) {
+				v_current_states[resource_index] = graph.v_resources[resource_index].initial_state;
+			}
+		}
+
+		for(uint32_t pass_index = 0; pass_index < num_passes; ++pass_index) {
+			auto& preamble = compiled.v_pass_preambles[pass_index];
+			get_pass_states(graph, pass_index, v_states, v_is_written);
+			for(uint32_t resource_index = 0; resource_index < num_resources; ++resource_index) {
+				D3D12_RESOURCE_STATES needed_state = v_states[resource_index];
+				if(needed_state == D3D12_RESOURCE_STATE_COMMON) { continue; }
+
+				// A read-only state also covers the following passes that only read the resource, so they need no barrier of their own
+				if(is_read_only(needed_state)) {
+					for(uint32_t next_pass_index = pass_index + 1; next_pass_index < num_passes; ++next_pass_index) {
+						get_pass_states(graph, next_pass_index, v_next_states, v_is_next_written);
+						if(v_is_next_written[resource_index]) { break; }
+						needed_state |= v_next_states[resource_index];
+					}
+				}
+
+				if(graph.v_resources[resource_index].is_transient && pass_index == compiled.v_first_pass_indices[resource_index]) {
+					// The state the frame starts in is only known once the whole frame has been walked, see the wrap around below
+					v_frame_start_states[resource_index] = needed_state;
+					v_current_states[resource_index] = needed_state;
+					v_is_last_use_uav_write[resource_index] = v_is_written[resource_index] && (needed_state & D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+					continue;
+				}
+
+				D3D12_RESOURCE_STATES current_state = v_current_states[resource_index];
+				bool is_covered = is_read_only(needed_state) && is_read_only(current_state) && (current_state & needed_state) == needed_state;
+				if(current_state == needed_state || is_covered) {
+					if(v_is_written[resource_index] && (needed_state & D3D12_RESOURCE_STATE_UNORDERED_ACCESS) && v_is_last_use_uav_write[resource_index]) {
+						preamble.v_barriers.push_back({ Barrier::TYPE_UAV, resource_index, needed_state, needed_state });
+					}
+				}
+				else {
+					preamble.v_barriers.push_back({ Barrier::TYPE_TRANSITION, resource_index, current_state, needed_state });
+					v_current_states[resource_index] = needed_state;
+				}
+				v_is_last_use_uav_write[resource_index] = v_is_written[resource_index] && (needed_state & D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+			}
+		}
+
+		for(uint32_t resource_index = 0; resource_index < num_resources; ++resource_index) {
+			auto& resource = graph.v_resources[resource_index];
+			D3D12_RESOURCE_STATES end_state = v_current_states[resource_index];
+			if(!resource.is_transient) {
+				if(end_state != resource.final_state) {
+					compiled.v_final_barriers.push_back({ Barrier::TYPE_TRANSITION, resource_index, end_state, resource.final_state });
+				}
+				continue;
+			}
+
+			uint32_t first_pass = compiled.v_first_pass_indices[resource_index];
+			if(first_pass == invalid_index) { continue; }
+
+			// Transient resources persist across frames, so the frame wraps around from the state it leaves them in
+			auto& preamble = compiled.v_pass_preambles[first_pass];
+			D3D12_RESOURCE_STATES start_state = v_frame_start_states[resource_index];
+			compiled.v_creation_states[resource_index] = end_state;
+			if(is_sharing_memory(graph, compiled, resource_index)) {
+				preamble.v_aliasing_barriers.push_back({ Barrier::TYPE_ALIASING, resource_index, end_state, end_state });
+				if(resource.initialization_state != D3D12_RESOURCE_STATE_COMMON) {
+					if(end_state != resource.initialization_state) {
+						preamble.v_aliasing_barriers.push_back({ Barrier::TYPE_TRANSITION, resource_index, end_state, resource.initialization_state });
+					}
+					preamble.v_discarded_resources.push_back(resource_index);
+					end_state = resource.initialization_state;
+				}
+			}
+			if(end_state != start_state) {
+				preamble.v_barriers.insert(preamble.v_barriers.begin(), { Barrier::TYPE_TRANSITION, resource_index, end_state, start_state });
+			}
+		}
+		return compiled;
+	}
+}
@@ -1,3 +1,14 @@
+// Shader bytecode compiled offline by source/shaders/compile_shaders.cmd
+#include "pbs_vs.h"
+#include "pbs_ps.h"
+#include "pbs_ps_permutations.h"
+#include "depth_alpha_test_ps.h"
+#include "depth_alpha_to_coverage_ps.h"
+#include "full_screen_vs.h"
+#include "background_ps.h"
+#include "copy_ps.h"
+#include "cull_cs.h"
+
 namespace renderer {
 	template<typename T>
 	struct ConstantBuffer {
@@ -42,6 +53,12 @@ namespace renderer {
 		XMFLOAT4X4 view_from_world;
 		XMFLOAT4X4 world_from_view;
 		XMFLOAT3   cam_pos_ws;
+		float      specular_max_mip_level;
+		uint32_t   brdf_lut_index;
+		uint32_t   radiance_index;
+		uint32_t   irradiance_index;
+		uint32_t   specular_index;
+		uint32_t   hdr_buffer_index;
 	};
 
 	__declspec(align(256)) struct Transformations {
@@ -52,6 +69,30 @@ namespace renderer {
 		Material a_material_data[max_material_count_per_scene];
 	};
 
+	__declspec(align(256)) struct CullConstants {
+		XMFLOAT4 a_frustum_planes[6];
+	};
+
+	// A run of indirect commands drawn with the same pipeline state, culling compacts its survivors to the front of the run
+	struct IndirectRange {
+		ID3D12PipelineState *p_pso;
+		uint32_t first_command;
+		uint32_t num_commands;
+	};
+
+	// Upload heap buffer split into one slice per in-flight frame
+	struct UploadBuffer {
+		ComPtr<ID3D12Resource> com_buffer;
+		uint8_t *p_cpu_virtual_address;
+		uint64_t gpu_virtual_address;
+		uint64_t size_per_frame;
+
+		void init(uint64_t _size_per_frame, const string &debug_name);
+		void *get_cpu_address();
+		uint64_t get_gpu_address();
+		uint64_t get_offset();
+	};
+
 	struct RenderBuffer {
 		ComPtr<ID3D12Resource> com_resource;
 		uint32_t srv_descriptor_table_index;
@@ -74,12 +115,15 @@ namespace renderer {
 		uint32_t descriptor_increment_size;
 		D3D12_DESCRIPTOR_HEAP_TYPE type;
 		bool is_shader_visible;
+		vector<uint32_t> v_free_descriptor_indices;
 
 		DescriptorHeap(uint32_t num_max_descriptors, D3D12_DESCRIPTOR_HEAP_TYPE type, bool is_shader_visible)
 			: num_max_descriptors(num_max_descriptors), type(type), is_shader_visible(is_shader_visible) {
 		};
 
 		void init();
+		uint32_t allocate();
+		void release(uint32_t descriptor_index);
 		D3D12_CPU_DESCRIPTOR_HANDLE get_cpu_handle(uint32_t descriptor_index);
 		D3D12_GPU_DESCRIPTOR_HANDLE get_gpu_handle(uint32_t descriptor_index);
 	};
@@ -87,7 +131,12 @@ namespace renderer {
 	struct Texture {
 		ComPtr<ID3D12Resource> com_resource;
 		ComPtr<ID3D12Resource> com_upload;
+		heap_allocator::Allocation allocation;
+		heap_allocator::Allocation upload_allocation;
+		HeapPool heap_pool;
+		D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc;
 		uint32_t srv_descriptor_table_index;
+		uint32_t mip_levels;
 	};
 
 	struct MeshHeader {
@@ -102,10 +151,56 @@ namespace renderer {
 		ComPtr<ID3D12Resource> com_index_buffer;
 		ComPtr<ID3D12Resource> com_vertex_upload_buffer;
 		ComPtr<ID3D12Resource> com_index_upload_buffer;
+		heap_allocator::Allocation vertex_allocation;
+		heap_allocator::Allocation index_allocation;
+		heap_allocator::Allocation vertex_upload_allocation;
+		heap_allocator::Allocation index_upload_allocation;
 		D3D12_VERTEX_BUFFER_VIEW vbv;
 		D3D12_INDEX_BUFFER_VIEW ibv;
 	};
 
+	// PSO of an optional path, compiled on a background thread when the pipeline cache has not seen it yet.
+	// Only the render thread polls it, in update(), recording jobs just read com_pso which stays null until the compile is done.
+	struct DeferredPipelineState {
+		ComPtr<ID3D12PipelineState> com_pso;
+		future<ComPtr<ID3D12PipelineState>> compilation;
+
+		void poll() {
+			if(compilation.valid() && compilation.wait_for(chrono::seconds(0)) == future_status::ready) {
+				com_pso = compilation.get();
+			}
+		}
+
+		void wait() {
+			if(compilation.valid()) {
+				com_pso = compilation.get();
+			}
+		}
+
+		ID3D12PipelineState* get() const {
+			return com_pso.Get();
+		}
+
+		bool is_requested() const {
+			return com_pso || compilation.valid();
+		}
+	};
+
+	// Scene pipelines that shade, each one has a PSO per pbs_ps.hlsl permutation besides the uber shader one
+	enum ScenePipeline : uint32_t {
+		SCENE_PIPELINE_OPAQUE,
+		SCENE_PIPELINE_OPAQUE_EQUAL,
+		SCENE_PIPELINE_ALPHA_BLEND,
+		SCENE_PIPELINE_DEPTH_PREPASS
+	};
+	constexpr uint32_t shading_scene_pipeline_count{ SCENE_PIPELINE_DEPTH_PREPASS };
+
+	// Tracks what has already been bound on a command list so that redundant IA/PSO changes can be skipped
+	struct CommandListState {
+		ID3D12PipelineState *p_pso{ nullptr };
+		const Mesh *p_mesh{ nullptr };
+	};
+
 	ComPtr<ID3D12Device> com_device{ nullptr };
 	ComPtr<ID3D12CommandQueue> com_command_queue{ nullptr };
 	ComPtr<IDXGISwapChain3> com_swap_chain{ nullptr };
@@ -113,30 +208,111 @@ namespace renderer {
 	array<ComPtr<ID3D12CommandAllocator>, max_inflight_frame_count> a_com_command_allocators{};
 	ComPtr<ID3D12GraphicsCommandList> com_command_list{ nullptr };
 
+	// Opaque draws are recorded in parallel into the worker lists, everything after them goes into the epilogue list
+	// The depth pre-pass and the shading pass each get up to max_recording_thread_count of them
+	array<array<ComPtr<ID3D12CommandAllocator>, max_worker_command_list_count>, max_inflight_frame_count> a_com_worker_command_allocators{};
+	array<ComPtr<ID3D12GraphicsCommandList>, max_worker_command_list_count> a_com_worker_command_lists{};
+	array<ComPtr<ID3D12CommandAllocator>, max_inflight_frame_count> a_com_epilogue_command_allocators{};
+	ComPtr<ID3D12GraphicsCommandList> com_epilogue_command_list{ nullptr };
+	uint32_t num_used_worker_command_lists{ 0 };
+
 	ComPtr<ID3D12PipelineState> com_scene_opaque_pso{ nullptr };
+	DeferredPipelineState scene_opaque_equal_pso;
 	ComPtr<ID3D12PipelineState> com_scene_alpha_blend_pso{ nullptr };
+	array<array<DeferredPipelineState, shading_scene_pipeline_count>, shader_permutation_count> a_permutation_psos;
+	array<D3D12_GRAPHICS_PIPELINE_STATE_DESC, shading_scene_pipeline_count> a_scene_pso_descs{};
+	static_assert(count_of(a_pbs_ps_permutations) == shader_permutation_count && count_of(a_pbs_alpha_to_coverage_ps_permutations) == shader_permutation_count, "compile_shaders.cmd must compile every permutation");
+	DeferredPipelineState depth_prepass_pso;
+	DeferredPipelineState depth_prepass_masked_pso;
 	ComPtr<ID3D12PipelineState> com_background_pso{ nullptr };
 	ComPtr<ID3D12PipelineState> com_final_pso{ nullptr };
 	ComPtr<ID3D12RootSignature> com_root_signature{ nullptr };
+	uint64_t root_signature_hash{ 0 };
+	ComPtr<ID3D12PipelineState> com_cull_pso{ nullptr };
+	ComPtr<ID3D12RootSignature> com_cull_root_signature{ nullptr };
+	uint64_t cull_root_signature_hash{ 0 };
+	pipeline_cache::PipelineCache pso_cache;
+	ComPtr<ID3D12CommandSignature> com_draw_command_signature{ nullptr };
 
 	array<uint64_t, max_inflight_frame_count> a_fence_values{};
 	ComPtr<ID3D12Fence> com_fence{ nullptr };
 	HANDLE h_fence_event{ 0 };
+	HANDLE h_frame_latency_waitable{ 0 };
+	uint32_t max_frame_latency{ default_max_frame_latency };
 	uint8_t frame_index{ 0 };
 
+	// A begin and an end timestamp per back buffer, read back once the fence of the back buffer says its frame is done
+	ComPtr<ID3D12QueryHeap> com_timestamp_query_heap{ nullptr };
+	ComPtr<ID3D12Resource> com_timestamp_readback_buffer{ nullptr };
+	uint64_t timestamp_frequency{ 1 };
+	// Frame whose timestamps the queries of a back buffer hold, 0 when they hold none
+	array<uint64_t, max_inflight_frame_count> a_timestamp_frame_numbers{};
+
 	array<RenderBuffer, max_inflight_frame_count> a_back_buffers{};
 	RenderBuffer hdr_buffer{ back_buffer_width , back_buffer_height, DXGI_FORMAT_R16G16B16A16_FLOAT, true, is_msaa_enabled };
 	RenderBuffer hdr_buffer_resolved{ back_buffer_width , back_buffer_height, DXGI_FORMAT_R16G16B16A16_FLOAT, true, false };
 	RenderBuffer depth_buffer{ back_buffer_width , back_buffer_height, DXGI_FORMAT_D32_FLOAT, false, is_msaa_enabled };
 
-	DescriptorHeap source_srv_desc_heap{ 256u, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV , false };
-	DescriptorHeap target_srv_desc_heap{ max_descriptor_count_per_frame * max_inflight_frame_count, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV , true };
+	// The frame's passes and the transient render buffers they use, which are placed into one range of the render target pool
+	render_graph::Graph frame_graph;
+	render_graph::CompiledGraph compiled_frame_graph;
+	heap_allocator::Allocation frame_graph_allocation;
+	vector<RenderBuffer*> v_frame_graph_render_buffers;
+	vector<D3D12_RESOURCE_BARRIER> v_frame_graph_resource_barriers;
+	uint32_t back_buffer_resource_index{ render_graph::invalid_index };
+	uint32_t scene_pass_index{ render_graph::invalid_index };
+	uint32_t resolve_pass_index{ render_graph::invalid_index };
+	uint32_t final_pass_index{ render_graph::invalid_index };
+
+	// Every srv lives in this heap for as long as its resource does, shaders index it with the slot the resource was given
+	DescriptorHeap srv_desc_heap{ max_srv_descriptor_count, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV , true };
 	DescriptorHeap rtv_desc_heap{ 64u, D3D12_DESCRIPTOR_HEAP_TYPE_RTV , false };
 	DescriptorHeap dsv_desc_heap{ 1u, D3D12_DESCRIPTOR_HEAP_TYPE_DSV , false };
 
+	struct HeapPoolDesc {
+		const char *p_name;
+		uint64_t page_size;
+		D3D12_HEAP_TYPE heap_type;
+		D3D12_HEAP_FLAGS heap_flags;
+		uint64_t heap_alignment;
+		// Heaps of scene textures and meshes may be evicted when they have not been used for a while
+		bool is_evictable;
+	};
+
+	// Indexed by HeapPool, each page of a pool is one ID3D12Heap
+	const HeapPoolDesc a_heap_pool_descs[] = {
+		{ "buffers", 64 * 1024 * 1024, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, true },
+		{ "upload_buffers", 64 * 1024 * 1024, D3D12_HEAP_TYPE_UPLOAD, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, false },
+		{ "small_textures", 16 * 1024 * 1024, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, true },
+		{ "textures", 128 * 1024 * 1024, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, true },
+		{ "render_targets", 64 * 1024 * 1024, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES, is_msaa_enabled ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, false }
+	};
+	static_assert(count_of(a_heap_pool_descs) == heap_pool_count, "Every HeapPool needs a description");
+	array<heap_allocator::Pool, heap_pool_count> a_heap_pools;
+	array<vector<ComPtr<ID3D12Heap>>, heap_pool_count> a_v_com_pool_heaps;
+
+	// Every pool heap is a pageable of the residency manager, the budget comes from the adapter
+	ComPtr<IDXGIAdapter3> com_adapter{ nullptr };
+	residency::Manager residency_manager;
+	array<vector<uint32_t>, heap_pool_count> a_v_pool_heap_pageable_indices;
+	// Materials reference textures by their descriptor slot
+	vector<uint32_t> v_texture_indices_by_descriptor_index;
+
 	ConstantBuffer<PerFrameConstants> per_frame_cb;
 	ConstantBuffer<Transformations> transformations_cb;
 	ConstantBuffer<MaterialList> material_list_cb;
+	ConstantBuffer<CullConstants> cull_cb;
+
+	UploadBuffer instance_transform_index_upload_buffer;
+	UploadBuffer indirect_command_upload_buffer;
+	UploadBuffer draw_bounds_upload_buffer;
+	ComPtr<ID3D12Resource> com_culled_command_buffer{ nullptr };
+	ComPtr<ID3D12Resource> com_culled_command_count_buffer{ nullptr };
+	ComPtr<ID3D12Resource> com_zero_count_upload_buffer{ nullptr };
+	vector<draw_cull::IndirectCommand> v_packed_commands;
+	vector<IndirectRange> v_indirect_ranges;
+	// Opaque draws from this one on did not fit in the indirect buffers and are drawn directly
+	uint32_t first_direct_draw_index{ 0 };
 
 	using TextureList = array<Texture, max_texture_count>;
 	TextureList a_textures{};
@@ -150,7 +326,13 @@ namespace renderer {
 	uint32_t current_background_index{0};
 	uint32_t current_specular_mip_level{0};
 	uint32_t current_isolation_mode_index{0};
+	uint32_t current_draw_submission_mode{ DRAW_SUBMISSION_DIRECT };
+	bool is_depth_prepass_enabled{ false };
+	bool is_front_to_back_sorting_enabled{ false };
 	float test{ 0.f };
+	// The packet being rendered, the per-frame draw order comes from it while the static scene lists come from scene_manager
+	FramePacket *p_frame_packet{ nullptr };
+	uint32_t current_scene_index{ 0 };
 
 	void DescriptorHeap::init() {
 		D3D12_DESCRIPTOR_HEAP_DESC desc = {};
@@ -163,6 +345,22 @@ namespace renderer {
 		base_gpu_descriptor = com_heap->GetGPUDescriptorHandleForHeapStart();
 	}
 
+	// Released slots are reused first, the heap is only grown into when none are left
+	uint32_t DescriptorHeap::allocate() {
+		if(!v_free_descriptor_indices.empty()) {
+			uint32_t descriptor_index = v_free_descriptor_indices.back();
+			v_free_descriptor_indices.pop_back();
+			return descriptor_index;
+		}
+		if(num_used_descriptors >= num_max_descriptors) { throw exception("Not enough descriptors left in this heap"); }
+		return num_used_descriptors++;
+	}
+
+	// The caller makes sure the GPU is no longer reading the descriptor
+	void DescriptorHeap::release(uint32_t descriptor_index) {
+		v_free_descriptor_indices.push_back(descriptor_index);
+	}
+
 	D3D12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::get_cpu_handle(uint32_t descriptor_index) {
 		if(descriptor_index >= num_max_descriptors) { throw exception("Not enough descriptors left in this heap"); }
 		D3D12_CPU_DESCRIPTOR_HANDLE cpu_descriptor_handle = com_heap->GetCPUDescriptorHandleForHeapStart();
@@ -182,11 +380,129 @@ namespace renderer {
 		com_resource->SetName(name_w.c_str());
 	}
 
+	// Heaps are created the first time a page of their pool is allocated from
+	ID3D12Heap* get_pool_heap(HeapPool heap_pool, uint32_t page_index) {
+		auto& v_com_heaps = a_v_com_pool_heaps[heap_pool];
+		if(page_index >= v_com_heaps.size()) {
+			v_com_heaps.resize(page_index + 1);
+		}
+		if(!v_com_heaps[page_index]) {
+			auto& pool_desc = a_heap_pool_descs[heap_pool];
+			D3D12_HEAP_DESC heap_desc = {};
+			heap_desc.SizeInBytes = a_heap_pools[heap_pool].v_pages[page_index].size;
+			heap_desc.Properties.Type = pool_desc.heap_type;
+			heap_desc.Alignment = pool_desc.heap_alignment;
+			heap_desc.Flags = pool_desc.heap_flags;
+			CHECK_D3D12_CALL(com_device->CreateHeap(&heap_desc, IID_PPV_ARGS(&v_com_heaps[page_index])), "");
+			wstring name_w = wstring(pool_desc.p_name, pool_desc.p_name + strlen(pool_desc.p_name)) + L"_" + to_wstring(page_index);
+			v_com_heaps[page_index]->SetName(name_w.c_str());
+
+			auto& v_pageable_indices = a_v_pool_heap_pageable_indices[heap_pool];
+			v_pageable_indices.resize(v_com_heaps.size(), residency::invalid_index);
+			v_pageable_indices[page_index] = residency::add_pageable(residency_manager, heap_desc.SizeInBytes, pool_desc.is_evictable);
+		}
+		return v_com_heaps[page_index].Get();
+	}
+
+	void release_pool_heaps(HeapPool heap_pool, const vector<uint32_t> &v_released_page_indices) {
+		for(uint32_t page_index : v_released_page_indices) {
+			a_v_com_pool_heaps[heap_pool][page_index].Reset();
+			auto& pageable_index = a_v_pool_heap_pageable_indices[heap_pool][page_index];
+			residency::remove_pageable(residency_manager, pageable_index);
+			pageable_index = residency::invalid_index;
+		}
+	}
+
+	void mark_pool_heap_used(HeapPool heap_pool, const heap_allocator::Allocation &allocation) {
+		if(allocation.is_valid()) {
+			residency::mark_used(residency_manager, a_v_pool_heap_pageable_indices[heap_pool][allocation.page_index]);
+		}
+	}
+
+	// For work outside of the frame, such as placing a new resource into an existing heap
+	void make_pool_heap_resident_now(HeapPool heap_pool, uint32_t page_index) {
+		if(residency::mark_used_now(residency_manager, a_v_pool_heap_pageable_indices[heap_pool][page_index])) {
+			ID3D12Pageable *a_pageables[] = { a_v_com_pool_heaps[heap_pool][page_index].Get() };
+			CHECK_D3D12_CALL(com_device->MakeResident(count_of(a_pageables), a_pageables), "");
+		}
+	}
+
+	void create_placed_resource(HeapPool heap_pool, const D3D12_RESOURCE_DESC &resource_desc, D3D12_RESOURCE_STATES initial_state, const D3D12_CLEAR_VALUE *p_clear_value, 
+		ComPtr<ID3D12Resource> &com_resource, heap_allocator::Allocation &allocation, uint64_t user_data = 0) {
+		D3D12_RESOURCE_ALLOCATION_INFO allocation_info = com_device->GetResourceAllocationInfo(0, 1, &resource_desc);
+		allocation = heap_allocator::allocate(a_heap_pools[heap_pool], allocation_info.SizeInBytes, allocation_info.Alignment, user_data);
+		ID3D12Heap *p_heap = get_pool_heap(heap_pool, allocation.page_index);
+		make_pool_heap_resident_now(heap_pool, allocation.page_index);
+		CHECK_D3D12_CALL(com_device->CreatePlacedResource(p_heap, allocation.offset, &resource_desc, initial_state, p_clear_value, IID_PPV_ARGS(&com_resource)), "");
+	}
+
+	// The GPU must be done with the resource
+	void release_placed_resource(HeapPool heap_pool, ComPtr<ID3D12Resource> &com_resource, heap_allocator::Allocation &allocation) {
+		com_resource.Reset();
+		uint32_t page_index = allocation.page_index;
+		if(heap_allocator::deallocate(a_heap_pools[heap_pool], allocation)) {
+			release_pool_heaps(heap_pool, { page_index });
+		}
+	}
+
+	// Textures that fit into 64KB can be placed at 4KB alignment, they get their own pool so that they do not fragment the large one
+	HeapPool get_texture_heap_pool(D3D12_RESOURCE_DESC &resource_desc) {
+		resource_desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+		D3D12_RESOURCE_ALLOCATION_INFO allocation_info = com_device->GetResourceAllocationInfo(0, 1, &resource_desc);
+		if(allocation_info.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) {
+			return HEAP_POOL_SMALL_TEXTURES;
+		}
+		resource_desc.Alignment = 0;
+		return HEAP_POOL_TEXTURES;
+	}
+
+	// Buffers created here live as long as the renderer, their allocation is never given back
+	void create_buffer(ComPtr<ID3D12Resource> &com_buffer, uint64_t size, D3D12_HEAP_TYPE heap_type, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES initial_state, const string &debug_name) {
+		D3D12_RESOURCE_DESC resource_desc = {};
+		resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		resource_desc.Width = size;
+		resource_desc.Height = 1;
+		resource_desc.DepthOrArraySize = 1;
+		resource_desc.MipLevels = 1;
+		resource_desc.Format = DXGI_FORMAT_UNKNOWN;
+		resource_desc.SampleDesc.Count = 1;
+		resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		resource_desc.Flags = flags;
+
+		heap_allocator::Allocation allocation;
+		HeapPool heap_pool = (heap_type == D3D12_HEAP_TYPE_UPLOAD) ? HEAP_POOL_UPLOAD_BUFFERS : HEAP_POOL_BUFFERS;
+		create_placed_resource(heap_pool, resource_desc, initial_state, nullptr, com_buffer, allocation);
+		residency::set_evictable(residency_manager, a_v_pool_heap_pageable_indices[heap_pool][allocation.page_index], false);
+		set_name(com_buffer, debug_name);
+	}
+
+	void UploadBuffer::init(uint64_t _size_per_frame, const string &debug_name) {
+		size_per_frame = _size_per_frame;
+		create_buffer(com_buffer, size_per_frame * max_inflight_frame_count, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, debug_name);
+		D3D12_RANGE cpu_visible_range = { 0, 0 };
+		CHECK_D3D12_CALL(com_buffer->Map(0, &cpu_visible_range, reinterpret_cast<void**>(&p_cpu_virtual_address)), "");
+		gpu_virtual_address = com_buffer->GetGPUVirtualAddress();
+	}
+
+	void *UploadBuffer::get_cpu_address() {
+		return p_cpu_virtual_address + get_offset();
+	}
+
+	uint64_t UploadBuffer::get_gpu_address() {
+		return gpu_virtual_address + get_offset();
+	}
+
+	uint64_t UploadBuffer::get_offset() {
+		return size_per_frame * frame_index;
+	}
+
 	Texture& get_texture_to_fill(uint32_t &index) {
+		if(num_used_texture == max_texture_count) { throw exception("Too many textures, increase max_texture_count"); }
 		return a_textures[index = num_used_texture++];
 	}
 
 	Mesh& get_mesh_to_fill(uint32_t &index) {
+		if(num_used_mesh == max_mesh_count) { throw exception("Too many meshes, increase max_mesh_count"); }
 		return a_meshes[index = num_used_mesh++];
 	};
 
@@ -195,19 +511,21 @@ namespace renderer {
 	}
 	
 	ID3D12GraphicsCommandList *get_command_list() {
-		return com_command_list.Get();
+		return com_epilogue_command_list.Get();
 	}
 
 	pair<D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_GPU_DESCRIPTOR_HANDLE> get_handles_for_a_srv_desc() {
-		auto gui_font_srv_cpu_desc_handle = target_srv_desc_heap.get_cpu_handle(target_srv_desc_heap.num_used_descriptors);
-		auto gui_font_srv_gpu_desc_handle = target_srv_desc_heap.get_gpu_handle(target_srv_desc_heap.num_used_descriptors);
-		target_srv_desc_heap.num_used_descriptors++;
-		return make_pair(gui_font_srv_cpu_desc_handle, gui_font_srv_gpu_desc_handle);
+		uint32_t descriptor_index = srv_desc_heap.allocate();
+		return make_pair(srv_desc_heap.get_cpu_handle(descriptor_index), srv_desc_heap.get_gpu_handle(descriptor_index));
+	}
+
+	uint32_t get_texture_descriptor_index(uint32_t tex_index) {
+		return a_textures[tex_index].srv_descriptor_table_index;
 	}
 
 	void load_texture(OctarineImageHeader header, const string &texture_name, const void *p_src_data, uint32_t &tex_index) {
-		auto& srv_heap = source_srv_desc_heap;
 		auto& tex = get_texture_to_fill(tex_index);
+		tex.mip_levels = header.mip_levels;
 
 		UINT num_subresources = header.array_size * header.mip_levels;
 		UINT64 *p_src_subresource_offsets = reinterpret_cast<UINT64*>(alloca(sizeof(UINT64)*num_subresources));
@@ -215,8 +533,6 @@ namespace renderer {
 		UINT64 *p_src_subresource_row_sizes = reinterpret_cast<UINT64*>(alloca(sizeof(UINT64)*num_subresources));
 		octarine_image_get_subresource_infos(&header, p_src_subresource_offsets, p_src_subresource_sizes, p_src_subresource_row_sizes);
 
-		D3D12_HEAP_PROPERTIES heap_properties = {};
-		heap_properties.Type = D3D12_HEAP_TYPE_DEFAULT;
 		D3D12_RESOURCE_DESC resource_desc = {};
 		resource_desc.Dimension = (header.depth == 1) ? D3D12_RESOURCE_DIMENSION_TEXTURE2D : D3D12_RESOURCE_DIMENSION_TEXTURE3D;
 		resource_desc.Alignment = 0;
@@ -229,11 +545,10 @@ namespace renderer {
 		resource_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 		resource_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
 
-		CHECK_D3D12_CALL(com_device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&tex.com_resource)), "");
+		tex.heap_pool = get_texture_heap_pool(resource_desc);
+		create_placed_resource(tex.heap_pool, resource_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, tex.com_resource, tex.allocation, tex_index);
 		set_name(tex.com_resource, texture_name);
 
-		heap_properties.Type = D3D12_HEAP_TYPE_UPLOAD;
-
 		D3D12_PLACED_SUBRESOURCE_FOOTPRINT *p_dst_footprints = reinterpret_cast<D3D12_PLACED_SUBRESOURCE_FOOTPRINT*>(alloca(sizeof(D3D12_PLACED_SUBRESOURCE_FOOTPRINT)*num_subresources));
 		UINT *p_dst_num_rows = reinterpret_cast<UINT*>(alloca(sizeof(UINT)*num_subresources));
 		UINT64 *p_dst_row_sizes = reinterpret_cast<UINT64*>(alloca(sizeof(UINT64)*num_subresources));
@@ -252,7 +567,7 @@ namespace renderer {
 		upload_resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
 		upload_resource_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
 
-		CHECK_D3D12_CALL(com_device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &upload_resource_desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&tex.com_upload)), "");
+		create_placed_resource(HEAP_POOL_UPLOAD_BUFFERS, upload_resource_desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, tex.com_upload, tex.upload_allocation);
 
 		D3D12_RESOURCE_BARRIER resource_barrier = {};
 		resource_barrier.Transition.pResource = tex.com_resource.Get();
@@ -261,23 +576,11 @@ namespace renderer {
 		resource_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_DEST;
 		com_command_list->ResourceBarrier(1, &resource_barrier);
 
+		auto v_slice_copies = image_stream::get_slice_copies(num_subresources, p_src_subresource_offsets, p_src_subresource_row_sizes, header.size_of_data, p_dst_footprints, p_dst_num_rows, p_dst_row_sizes);
 		void *p_dst_data = nullptr;
 		CHECK_D3D12_CALL(tex.com_upload->Map(0, nullptr, &p_dst_data), "");
-		for(UINT subresource_index = 0; subresource_index < num_subresources; ++subresource_index) {
-			D3D12_PLACED_SUBRESOURCE_FOOTPRINT subresource_footprint = p_dst_footprints[subresource_index];
-			UINT num_subresource_slices = subresource_footprint.Footprint.Depth;
-			UINT num_subresource_rows = p_dst_num_rows[subresource_index];
-			UINT64 dst_subresource_row_size = subresource_footprint.Footprint.RowPitch;
-			UINT64 dst_subresource_slice_size = dst_subresource_row_size * num_subresource_rows;
-			for(UINT subresource_slice_index = 0; subresource_slice_index < num_subresource_slices; ++subresource_slice_index) {
-				UINT64 dst_subresource_offset = subresource_footprint.Offset + dst_subresource_slice_size * subresource_slice_index;
-				UINT64 src_subresource_offset = p_src_subresource_offsets[subresource_index];
-				BYTE* p_dest = reinterpret_cast<BYTE*>(p_dst_data) + dst_subresource_offset;
-				const BYTE* p_src = reinterpret_cast<const BYTE*>(p_src_data) + src_subresource_offset;
-				for(UINT row_index = 0; row_index < num_subresource_rows; ++row_index) {
-					memcpy(p_dest + dst_subresource_row_size * row_index, p_src + p_src_subresource_row_sizes[subresource_index] * row_index, p_dst_row_sizes[subresource_index]);
-				}
-			}
+		for(auto& slice_copy : v_slice_copies) {
+			image_stream::copy_slice(slice_copy, reinterpret_cast<const uint8_t*>(p_src_data), reinterpret_cast<uint8_t*>(p_dst_data));
 		}
 		tex.com_upload->Unmap(0, nullptr);
 
@@ -298,7 +601,8 @@ namespace renderer {
 		com_command_list->ResourceBarrier(1, &resource_barrier);
 
 		{
-			D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+			auto& srv_desc = tex.srv_desc;
+			srv_desc = {};
 			srv_desc.Format = octarine_image_get_dxgi_format(header.format.as_enum);
 			srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 			if(header.flags == OCTARINE_IMAGE_FLAGS_CUBE) {
@@ -316,39 +620,36 @@ namespace renderer {
 			}
 			else { throw exception("INCOMPLETE!"); return; }
 
-			D3D12_CPU_DESCRIPTOR_HANDLE cpu_descriptor_handle = srv_heap.get_cpu_handle(srv_heap.num_used_descriptors);
-			com_device->CreateShaderResourceView(tex.com_resource.Get(), &srv_desc, cpu_descriptor_handle);
-			tex.srv_descriptor_table_index = srv_heap.num_used_descriptors++;
+			tex.srv_descriptor_table_index = srv_desc_heap.allocate();
+			v_texture_indices_by_descriptor_index[tex.srv_descriptor_table_index] = tex_index;
+			com_device->CreateShaderResourceView(tex.com_resource.Get(), &srv_desc, srv_desc_heap.get_cpu_handle(tex.srv_descriptor_table_index));
 		}
 	}
 
-	void load_texture(const string& asset_filename, uint32_t &tex_index) {
-
-		string asset_file_address{ asset_folder + asset_filename };
-		OctarineImageHeader header = {};
-		void *p_src_data = nullptr;
-
-		OCTARINE_IMAGE result = octarine_image_read_from_file(asset_file_address.c_str(), &header, &p_src_data);
-		if(result != OCTARINE_IMAGE::OCTARINE_IMAGE_OK) { string msg = "File error: " + asset_filename; throw exception(msg.c_str()); };
-
-		load_texture(header, asset_filename, p_src_data, tex_index);
+	// The rows are copied out of the mapped file, pages the prefetch of image_stream::open() has not brought in yet are read on demand
+	void load_texture(const image_stream::Stream &stream, const string &texture_name, uint32_t &tex_index) {
+		load_texture(stream.header, texture_name, stream.p_data, tex_index);
+	}
 
-		free(p_src_data);
+	void load_texture(const string& asset_filename, uint32_t &tex_index) {
+		image_stream::Stream stream;
+		if(!image_stream::open(asset_folder + asset_filename, stream)) { string msg = "File error: " + asset_filename; throw exception(msg.c_str()); };
+		load_texture(stream, asset_filename, tex_index);
+		image_stream::close(stream);
 	}
 
-	void load_mesh(size_t vertex_count, size_t index_count, const void *p_vertex_data, const void *p_index_data, uint32_t &mesh_index) {
+	// index_size is 2 or 4 bytes, indices are relative to the base vertex of each draw
+	void load_mesh(size_t vertex_count, size_t index_count, uint32_t index_size, const void *p_vertex_data, const void *p_index_data, uint32_t &mesh_index) {
 		auto& mesh = get_mesh_to_fill(mesh_index);
 
 		auto vertex_size = sizeof(Vertex);
 		auto vertex_buffer_size = vertex_count * vertex_size;
-		auto index_buffer_size = index_count * sizeof(uint32_t);
+		auto index_buffer_size = index_count * index_size;
 
 		mesh.header.vertex_count = vertex_count;
 		mesh.header.index_count = index_count;
 
 		{
-			D3D12_HEAP_PROPERTIES heap_properties = {};
-			heap_properties.Type = D3D12_HEAP_TYPE_DEFAULT;
 			D3D12_RESOURCE_DESC resource_desc = {};
 			resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
 			resource_desc.Width = vertex_buffer_size;
@@ -359,10 +660,9 @@ namespace renderer {
 			resource_desc.SampleDesc.Count = 1;
 			resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
 
-			CHECK_D3D12_CALL(com_device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&mesh.com_vertex_buffer)), "");
+			create_placed_resource(HEAP_POOL_BUFFERS, resource_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, mesh.com_vertex_buffer, mesh.vertex_allocation);
 			set_name(mesh.com_vertex_buffer, _STRINGIZE(__LINE__));
-			heap_properties.Type = D3D12_HEAP_TYPE_UPLOAD;
-			CHECK_D3D12_CALL(com_device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&mesh.com_vertex_upload_buffer)), "");
+			create_placed_resource(HEAP_POOL_UPLOAD_BUFFERS, resource_desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, mesh.com_vertex_upload_buffer, mesh.vertex_upload_allocation);
 
 			D3D12_RESOURCE_BARRIER resource_barrier = {};
 			resource_barrier.Transition.pResource = mesh.com_vertex_buffer.Get();
@@ -386,8 +686,6 @@ namespace renderer {
 		mesh.vbv.StrideInBytes = static_cast<UINT>(vertex_size);
 
 		{
-			D3D12_HEAP_PROPERTIES heap_properties = {};
-			heap_properties.Type = D3D12_HEAP_TYPE_DEFAULT;
 			D3D12_RESOURCE_DESC resource_desc = {};
 			resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
 			resource_desc.Width = index_buffer_size;
@@ -398,10 +696,9 @@ namespace renderer {
 			resource_desc.SampleDesc.Count = 1;
 			resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
 
-			CHECK_D3D12_CALL(com_device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&mesh.com_index_buffer)), "");
+			create_placed_resource(HEAP_POOL_BUFFERS, resource_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, mesh.com_index_buffer, mesh.index_allocation);
 			set_name(mesh.com_vertex_buffer, _STRINGIZE(__LINE__));
-			heap_properties.Type = D3D12_HEAP_TYPE_UPLOAD;
-			CHECK_D3D12_CALL(com_device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&mesh.com_index_upload_buffer)), "");
+			create_placed_resource(HEAP_POOL_UPLOAD_BUFFERS, resource_desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, mesh.com_index_upload_buffer, mesh.index_upload_allocation);
 
 			D3D12_RESOURCE_BARRIER resource_barrier = {};
 			resource_barrier.Transition.pResource = mesh.com_index_buffer.Get();
@@ -421,14 +718,12 @@ namespace renderer {
 		}
 
 		mesh.ibv.BufferLocation = mesh.com_index_buffer->GetGPUVirtualAddress();
-		mesh.ibv.Format = DXGI_FORMAT_R32_UINT;
+		mesh.ibv.Format = (index_size == sizeof(uint16_t)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 		mesh.ibv.SizeInBytes = static_cast<UINT>(index_buffer_size);
 	}
 
 	void load_mesh(const string &asset_filename, uint32_t &mesh_index) {
 		{
-			auto& mesh = get_mesh_to_fill(mesh_index);
-
 			string asset_file_address{ asset_folder + asset_filename };
 			std::ifstream file(asset_file_address, std::ios::binary);
 			if(!file.is_open()) {
@@ -441,14 +736,16 @@ namespace renderer {
 			auto result = octarine_mesh_read_from_file(asset_filename.c_str(), &header, &p_data);
 			if(result != OCTARINE_MESH_OK) { string msg = "File error: " + asset_filename; throw exception(msg.c_str()); };
 
+			// The file does not describe its vertex layout, it has to be the current Vertex
 			auto vertex_size = sizeof(Vertex);
-			auto vertex_buffer_size = mesh.header.vertex_count * vertex_size;
-			auto index_buffer_size = mesh.header.index_count * sizeof(uint32_t);
+			auto vertex_buffer_size = size_t(header.num_vertices) * vertex_size;
+			auto index_buffer_size = size_t(header.num_indices) * sizeof(uint32_t);
+			if(header.size_of_data != vertex_buffer_size + index_buffer_size) { free(p_data); string msg = "Vertex layout mismatch: " + asset_filename; throw exception(msg.c_str()); }
 
 			void *p_vertex_data = p_data;
 			void *p_index_data = (void*)((uint8_t*)p_data + vertex_buffer_size);
 
-			load_mesh(header.num_vertices, header.num_indices, p_vertex_data, p_index_data, mesh_index);
+			load_mesh(header.num_vertices, header.num_indices, sizeof(uint32_t), p_vertex_data, p_index_data, mesh_index);
 		}
 	}
 
@@ -459,6 +756,23 @@ namespace renderer {
 		a_fence_values[frame_index]++;
 	}
 
+	// The frame the next one reuses the back buffer of is done on the GPU, its timestamps go back with the current frame packet
+	void read_gpu_frame_time() {
+		p_frame_packet->gpu_frame_number = a_timestamp_frame_numbers[frame_index];
+		p_frame_packet->gpu_ms = 0.f;
+		if(p_frame_packet->gpu_frame_number == 0) { return; }
+		a_timestamp_frame_numbers[frame_index] = 0;
+
+		D3D12_RANGE read_range = { sizeof(uint64_t) * 2 * frame_index, sizeof(uint64_t) * 2 * (frame_index + 1) };
+		D3D12_RANGE written_range = { 0, 0 };
+		uint64_t *p_timestamps = nullptr;
+		CHECK_D3D12_CALL(com_timestamp_readback_buffer->Map(0, &read_range, reinterpret_cast<void**>(&p_timestamps)), "");
+		uint64_t begin_timestamp = p_timestamps[2 * frame_index];
+		uint64_t end_timestamp = p_timestamps[2 * frame_index + 1];
+		com_timestamp_readback_buffer->Unmap(0, &written_range);
+		p_frame_packet->gpu_ms = static_cast<float>(double(end_timestamp - begin_timestamp) * 1000.0 / double(timestamp_frequency));
+	}
+
 	void prepare_next_frame() {
 		uint64_t current_fence_value = a_fence_values[frame_index];
 		CHECK_D3D12_CALL(com_command_queue->Signal(com_fence.Get(), current_fence_value), "");
@@ -469,6 +783,7 @@ namespace renderer {
 		}
 
 		a_fence_values[frame_index] = current_fence_value + 1;
+		read_gpu_frame_time();
 	}
 
 	void create_root_signature() {
@@ -478,7 +793,7 @@ namespace renderer {
 			feature_data.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
 		}
 
-		D3D12_ROOT_PARAMETER1 a_root_params[5] = {};
+		D3D12_ROOT_PARAMETER1 a_root_params[6] = {};
 		// per draw constant
 		a_root_params[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
 		a_root_params[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
@@ -507,35 +822,35 @@ namespace renderer {
 		a_root_params[3].Descriptor.RegisterSpace = 0;
 		a_root_params[3].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_NONE;
 
-		// srv desc table parameter
-		D3D12_DESCRIPTOR_RANGE1 a_srv_descriptor_ranges[3] = {};
+		// bindless srv desc table parameter, cube maps (space1) and 2d textures (space2) both alias the whole heap
+		// Free slots hold no valid descriptor, hence DESCRIPTORS_VOLATILE
+		D3D12_DESCRIPTOR_RANGE1 a_srv_descriptor_ranges[2] = {};
 		a_srv_descriptor_ranges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-		a_srv_descriptor_ranges[0].NumDescriptors = is_msaa_enabled ? 2 : 1;
+		a_srv_descriptor_ranges[0].NumDescriptors = UINT_MAX;
 		a_srv_descriptor_ranges[0].BaseShaderRegister = 0;
-		a_srv_descriptor_ranges[0].RegisterSpace = 0;
+		a_srv_descriptor_ranges[0].RegisterSpace = 1;
 		a_srv_descriptor_ranges[0].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE;
-		a_srv_descriptor_ranges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+		a_srv_descriptor_ranges[0].OffsetInDescriptorsFromTableStart = 0;
 
-		// brdf_lut, radiance, diffuse irradiance_ specular irradiance
 		a_srv_descriptor_ranges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-		a_srv_descriptor_ranges[1].NumDescriptors = 1 + num_descriptor_per_environment;
+		a_srv_descriptor_ranges[1].NumDescriptors = UINT_MAX;
 		a_srv_descriptor_ranges[1].BaseShaderRegister = 0;
-		a_srv_descriptor_ranges[1].RegisterSpace = 1;
+		a_srv_descriptor_ranges[1].RegisterSpace = 2;
 		a_srv_descriptor_ranges[1].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE;
-		a_srv_descriptor_ranges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
-		a_srv_descriptor_ranges[2].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-		a_srv_descriptor_ranges[2].NumDescriptors = UINT_MAX;
-		a_srv_descriptor_ranges[2].BaseShaderRegister = 0;
-		a_srv_descriptor_ranges[2].RegisterSpace = 2;
-		a_srv_descriptor_ranges[2].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE;
-		a_srv_descriptor_ranges[2].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+		a_srv_descriptor_ranges[1].OffsetInDescriptorsFromTableStart = 0;
 
 		a_root_params[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
 		a_root_params[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 		a_root_params[4].DescriptorTable.NumDescriptorRanges = count_of(a_srv_descriptor_ranges);
 		a_root_params[4].DescriptorTable.pDescriptorRanges = a_srv_descriptor_ranges;
 
+		// instance transform index srv descriptor
+		a_root_params[5].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		a_root_params[5].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+		a_root_params[5].Descriptor.ShaderRegister = 0;
+		a_root_params[5].Descriptor.RegisterSpace = 3;
+		a_root_params[5].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_NONE;
+
 		D3D12_STATIC_SAMPLER_DESC static_sampler_0 = {};
 		static_sampler_0.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
 		static_sampler_0.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
@@ -580,33 +895,116 @@ namespace renderer {
 		ComPtr<ID3DBlob> error;
 		CHECK_D3D12_CALL(D3D12SerializeVersionedRootSignature(&root_signature_desc, &signature, &error), error ? (char*)error->GetBufferPointer() : "");
 		CHECK_D3D12_CALL(com_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&com_root_signature)), "");
+		root_signature_hash = pipeline_cache::hash_bytes(signature->GetBufferPointer(), signature->GetBufferSize());
+
+		{ // Cull root signature: constants, input commands, bounds, output commands, output counts, range constants
+			D3D12_ROOT_PARAMETER1 a_cull_root_params[6] = {};
+			a_cull_root_params[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+			a_cull_root_params[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+			a_cull_root_params[0].Descriptor.ShaderRegister = 0;
+			a_cull_root_params[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+			a_cull_root_params[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+			a_cull_root_params[1].Descriptor.ShaderRegister = 0;
+			a_cull_root_params[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+			a_cull_root_params[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+			a_cull_root_params[2].Descriptor.ShaderRegister = 1;
+			a_cull_root_params[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+			a_cull_root_params[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+			a_cull_root_params[3].Descriptor.ShaderRegister = 0;
+			a_cull_root_params[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+			a_cull_root_params[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+			a_cull_root_params[4].Descriptor.ShaderRegister = 1;
+			a_cull_root_params[5].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+			a_cull_root_params[5].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+			a_cull_root_params[5].Constants.ShaderRegister = 1;
+			a_cull_root_params[5].Constants.Num32BitValues = 3;
+
+			D3D12_VERSIONED_ROOT_SIGNATURE_DESC cull_root_signature_desc = {};
+			cull_root_signature_desc.Version = feature_data.HighestVersion;
+			cull_root_signature_desc.Desc_1_1.NumParameters = count_of(a_cull_root_params);
+			cull_root_signature_desc.Desc_1_1.pParameters = a_cull_root_params;
+
+			CHECK_D3D12_CALL(D3D12SerializeVersionedRootSignature(&cull_root_signature_desc, &signature, &error), error ? (char*)error->GetBufferPointer() : "");
+			CHECK_D3D12_CALL(com_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&com_cull_root_signature)), "");
+			cull_root_signature_hash = pipeline_cache::hash_bytes(signature->GetBufferPointer(), signature->GetBufferSize());
+		}
 	}
 
-	void create_pipeline_state_objects() {
-		ComPtr<ID3DBlob> com_vertex_shader;
-		ComPtr<ID3DBlob> com_pixel_shader;
-		ComPtr<ID3DBlob> com_full_screen_shader;
-		ComPtr<ID3DBlob> com_background_shader;
-		ComPtr<ID3DBlob> com_copy_shader;
-		ComPtr<ID3DBlob> error;
+	template<size_t N>
+	D3D12_SHADER_BYTECODE get_shader_bytecode(const BYTE (&a_bytecode)[N]) {
+		return { a_bytecode, N };
+	}
 
-		uint32_t compile_flags = D3DCOMPILE_PACK_MATRIX_ROW_MAJOR | D3DCOMPILE_ENABLE_UNBOUNDED_DESCRIPTOR_TABLES;
-#if defined(_DEBUG)
-		// Enable better shader debugging with the graphics debugging tools.
-		compile_flags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
+	void add_to_pipeline_cache(uint64_t key, ID3D12PipelineState *p_pso) {
+		ComPtr<ID3DBlob> com_cached_blob;
+		if(SUCCEEDED(p_pso->GetCachedBlob(&com_cached_blob))) {
+			pipeline_cache::add_blob(pso_cache, key, com_cached_blob->GetBufferPointer(), com_cached_blob->GetBufferSize());
+		}
+	}
 
-		CHECK_D3D12_CALL(D3DCompileFromFile(L"../source/shaders/pbs_vs.hlsl", nullptr, nullptr, "vs_main", "vs_5_1", compile_flags, 0, &com_vertex_shader, &error), error ? (char*)error->GetBufferPointer() : "");
-		CHECK_D3D12_CALL(D3DCompileFromFile(L"../source/shaders/pbs_ps.hlsl", nullptr, nullptr, "ps_main", "ps_5_1", compile_flags, 0, &com_pixel_shader, &error), error ? (char*)error->GetBufferPointer() : "");
-		CHECK_D3D12_CALL(D3DCompileFromFile(L"../source/shaders/full_screen_vs.hlsl", nullptr, nullptr, "vs_main", "vs_5_1", compile_flags, 0, &com_full_screen_shader, &error), error ? (char*)error->GetBufferPointer() : "");
-		CHECK_D3D12_CALL(D3DCompileFromFile(L"../source/shaders/background_ps.hlsl", nullptr, nullptr, "ps_main", "ps_5_1", compile_flags, 0, &com_background_shader, &error), error ? (char*)error->GetBufferPointer() : "");
-		CHECK_D3D12_CALL(D3DCompileFromFile(L"../source/shaders/copy_ps.hlsl", nullptr, nullptr, "ps_main", "ps_5_1", compile_flags, 0, &com_copy_shader, &error), error ? (char*)error->GetBufferPointer() : "");
+	// Starts from the driver blob cached by a previous run when there is one, a driver or device change makes it fail so compile from scratch then
+	ComPtr<ID3D12PipelineState> create_graphics_pipeline_state(D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc, uint64_t pso_root_signature_hash) {
+		ComPtr<ID3D12PipelineState> com_pso;
+		uint64_t key = pipeline_cache::compute_graphics_pipeline_key(pso_desc, pso_root_signature_hash);
+		vector<uint8_t> cached_blob;
+		if(pipeline_cache::find_blob(pso_cache, key, cached_blob)) {
+			pso_desc.CachedPSO = { cached_blob.data(), cached_blob.size() };
+			if(SUCCEEDED(com_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&com_pso)))) {
+				return com_pso;
+			}
+			pso_desc.CachedPSO = {};
+		}
+		CHECK_D3D12_CALL(com_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&com_pso)), "");
+		add_to_pipeline_cache(key, com_pso.Get());
+		return com_pso;
+	}
 
-		D3D12_INPUT_ELEMENT_DESC a_input_element_descs[] = {
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "UV", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		};
+	ComPtr<ID3D12PipelineState> create_compute_pipeline_state(D3D12_COMPUTE_PIPELINE_STATE_DESC pso_desc, uint64_t pso_root_signature_hash) {
+		ComPtr<ID3D12PipelineState> com_pso;
+		uint64_t key = pipeline_cache::compute_compute_pipeline_key(pso_desc, pso_root_signature_hash);
+		vector<uint8_t> cached_blob;
+		if(pipeline_cache::find_blob(pso_cache, key, cached_blob)) {
+			pso_desc.CachedPSO = { cached_blob.data(), cached_blob.size() };
+			if(SUCCEEDED(com_device->CreateComputePipelineState(&pso_desc, IID_PPV_ARGS(&com_pso)))) {
+				return com_pso;
+			}
+			pso_desc.CachedPSO = {};
+		}
+		CHECK_D3D12_CALL(com_device->CreateComputePipelineState(&pso_desc, IID_PPV_ARGS(&com_pso)), "");
+		add_to_pipeline_cache(key, com_pso.Get());
+		return com_pso;
+	}
+
+	// Cache hits are cheap enough to create in place, misses are compiled in the background while the first frames skip the optional path.
+	// The descriptor is copied and everything it points to (embedded bytecode, input layout, root signature) outlives the compilation.
+	void create_deferred_graphics_pipeline_state(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &pso_desc, uint64_t pso_root_signature_hash, DeferredPipelineState &deferred_pso) {
+		uint64_t key = pipeline_cache::compute_graphics_pipeline_key(pso_desc, pso_root_signature_hash);
+		vector<uint8_t> cached_blob;
+		if(pipeline_cache::find_blob(pso_cache, key, cached_blob)) {
+			deferred_pso.com_pso = create_graphics_pipeline_state(pso_desc, pso_root_signature_hash);
+		}
+		else {
+			deferred_pso.compilation = async(launch::async, create_graphics_pipeline_state, pso_desc, pso_root_signature_hash);
+		}
+	}
+
+	const D3D12_INPUT_ELEMENT_DESC a_scene_input_element_descs[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "UV", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+
+	void create_pipeline_state_objects() {
+		auto vertex_shader = get_shader_bytecode(g_pbs_vs);
+		auto pixel_shader = get_shader_bytecode(g_pbs_ps);
+		auto full_screen_shader = get_shader_bytecode(g_full_screen_vs);
+		auto background_shader = get_shader_bytecode(g_background_ps);
+		auto copy_shader = get_shader_bytecode(g_copy_ps);
+		auto cull_shader = get_shader_bytecode(g_cull_cs);
+
+		// Masked materials use alpha to coverage under MSAA and a plain alpha test otherwise
+		auto alpha_mask_depth_shader = is_msaa_enabled ? get_shader_bytecode(g_depth_alpha_to_coverage_ps) : get_shader_bytecode(g_depth_alpha_test_ps);
 
 		D3D12_RASTERIZER_DESC default_rasterizer_desc = {};
 		default_rasterizer_desc.FillMode = D3D12_FILL_MODE_SOLID;
@@ -637,6 +1035,14 @@ namespace renderer {
 		default_depth_stencil_desc.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
 		default_depth_stencil_desc.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
 
+		D3D12_BLEND_DESC depth_only_blend_desc = {};
+
+		// Shading after the depth pre-pass only touches the visible surface, so there is no need to write depth again
+		D3D12_DEPTH_STENCIL_DESC equal_depth_stencil_desc = {};
+		equal_depth_stencil_desc.DepthEnable = TRUE;
+		equal_depth_stencil_desc.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+		equal_depth_stencil_desc.DepthFunc = D3D12_COMPARISON_FUNC_EQUAL;
+
 		D3D12_DEPTH_STENCIL_DESC alpha_blend_depth_stencil_desc = {};
 		alpha_blend_depth_stencil_desc.DepthEnable = TRUE;
 		alpha_blend_depth_stencil_desc.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
@@ -648,10 +1054,10 @@ namespace renderer {
 
 		{
 			D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
-			pso_desc.InputLayout = { a_input_element_descs, static_cast<UINT>(count_of(a_input_element_descs)) };
+			pso_desc.InputLayout = { a_scene_input_element_descs, static_cast<UINT>(count_of(a_scene_input_element_descs)) };
 			pso_desc.pRootSignature = com_root_signature.Get();
-			pso_desc.VS = { com_vertex_shader->GetBufferPointer(), com_vertex_shader->GetBufferSize() };
-			pso_desc.PS = { com_pixel_shader->GetBufferPointer(), com_pixel_shader->GetBufferSize() };
+			pso_desc.VS = vertex_shader;
+			pso_desc.PS = pixel_shader;
 			pso_desc.RasterizerState = default_rasterizer_desc;
 			pso_desc.BlendState = default_blend_desc;
 			pso_desc.DepthStencilState = default_depth_stencil_desc;
@@ -662,15 +1068,30 @@ namespace renderer {
 			pso_desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
 			pso_desc.SampleDesc.Count = hdr_buffer.is_multi_sampled ? ms_count : 1;
 			pso_desc.SampleDesc.Quality = hdr_buffer.is_multi_sampled ? ms_quality : 0;
-			CHECK_D3D12_CALL(com_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&com_scene_opaque_pso)), "");
+			com_scene_opaque_pso = create_graphics_pipeline_state(pso_desc, root_signature_hash);
+			a_scene_pso_descs[SCENE_PIPELINE_OPAQUE] = pso_desc;
+
+			pso_desc.DepthStencilState = equal_depth_stencil_desc;
+			create_deferred_graphics_pipeline_state(pso_desc, root_signature_hash, scene_opaque_equal_pso);
+			a_scene_pso_descs[SCENE_PIPELINE_OPAQUE_EQUAL] = pso_desc;
+
+			// Depth pre-pass: the render target stays bound but is never written
+			pso_desc.BlendState = depth_only_blend_desc;
+			pso_desc.DepthStencilState = default_depth_stencil_desc;
+			pso_desc.PS = {};
+			create_deferred_graphics_pipeline_state(pso_desc, root_signature_hash, depth_prepass_pso);
+
+			pso_desc.PS = alpha_mask_depth_shader;
+			pso_desc.BlendState.AlphaToCoverageEnable = is_msaa_enabled;
+			create_deferred_graphics_pipeline_state(pso_desc, root_signature_hash, depth_prepass_masked_pso);
 		}
 
 		{
 			D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
-			pso_desc.InputLayout = { a_input_element_descs, static_cast<UINT>(count_of(a_input_element_descs)) };
+			pso_desc.InputLayout = { a_scene_input_element_descs, static_cast<UINT>(count_of(a_scene_input_element_descs)) };
 			pso_desc.pRootSignature = com_root_signature.Get();
-			pso_desc.VS = { com_vertex_shader->GetBufferPointer(), com_vertex_shader->GetBufferSize() };
-			pso_desc.PS = { com_pixel_shader->GetBufferPointer(), com_pixel_shader->GetBufferSize() };
+			pso_desc.VS = vertex_shader;
+			pso_desc.PS = pixel_shader;
 			pso_desc.RasterizerState = default_rasterizer_desc;
 			pso_desc.BlendState = alpha_blend_desc;
 			pso_desc.DepthStencilState = alpha_blend_depth_stencil_desc;
@@ -681,15 +1102,16 @@ namespace renderer {
 			pso_desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
 			pso_desc.SampleDesc.Count = hdr_buffer.is_multi_sampled ? ms_count : 1;
 			pso_desc.SampleDesc.Quality = hdr_buffer.is_multi_sampled ? ms_quality : 0;
-			CHECK_D3D12_CALL(com_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&com_scene_alpha_blend_pso)), "");
+			com_scene_alpha_blend_pso = create_graphics_pipeline_state(pso_desc, root_signature_hash);
+			a_scene_pso_descs[SCENE_PIPELINE_ALPHA_BLEND] = pso_desc;
 		}
 
 		{
 			D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
-			pso_desc.InputLayout = { a_input_element_descs, static_cast<UINT>(count_of(a_input_element_descs)) };
+			pso_desc.InputLayout = { a_scene_input_element_descs, static_cast<UINT>(count_of(a_scene_input_element_descs)) };
 			pso_desc.pRootSignature = com_root_signature.Get();
-			pso_desc.VS = { com_full_screen_shader->GetBufferPointer(), com_full_screen_shader->GetBufferSize() };
-			pso_desc.PS = { com_background_shader->GetBufferPointer(), com_background_shader->GetBufferSize() };
+			pso_desc.VS = full_screen_shader;
+			pso_desc.PS = background_shader;
 			pso_desc.RasterizerState = default_rasterizer_desc;
 			pso_desc.BlendState = default_blend_desc;
 			pso_desc.DepthStencilState = background_depth_stencil_desc;
@@ -700,15 +1122,15 @@ namespace renderer {
 			pso_desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
 			pso_desc.SampleDesc.Count = hdr_buffer.is_multi_sampled ? ms_count : 1;
 			pso_desc.SampleDesc.Quality = hdr_buffer.is_multi_sampled ? ms_quality : 0;
-			CHECK_D3D12_CALL(com_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&com_background_pso)), "");
+			com_background_pso = create_graphics_pipeline_state(pso_desc, root_signature_hash);
 		}
 
 		{
 			D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc = {};
-			pso_desc.InputLayout = { a_input_element_descs, static_cast<UINT>(count_of(a_input_element_descs)) };
+			pso_desc.InputLayout = { a_scene_input_element_descs, static_cast<UINT>(count_of(a_scene_input_element_descs)) };
 			pso_desc.pRootSignature = com_root_signature.Get();
-			pso_desc.VS = { com_full_screen_shader->GetBufferPointer(), com_full_screen_shader->GetBufferSize() };
-			pso_desc.PS = { com_copy_shader->GetBufferPointer(), com_copy_shader->GetBufferSize() };
+			pso_desc.VS = full_screen_shader;
+			pso_desc.PS = copy_shader;
 			pso_desc.RasterizerState = default_rasterizer_desc;
 			pso_desc.BlendState = default_blend_desc;
 			pso_desc.DepthStencilState = background_depth_stencil_desc;
@@ -719,36 +1141,80 @@ namespace renderer {
 			pso_desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
 			pso_desc.SampleDesc.Count = 1;
 			pso_desc.SampleDesc.Quality = 0;
-			CHECK_D3D12_CALL(com_device->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&com_final_pso)), "");
+			com_final_pso = create_graphics_pipeline_state(pso_desc, root_signature_hash);
 		}
-	}
 
-	void create_render_buffer(RenderBuffer& render_buffer, DescriptorHeap *p_rtv_desc_heap, DescriptorHeap *p_srv_desc_heap, const string &debug_name, int32_t rtv_desc_heap_index =-1, int32_t stv_desc_heap_index = -1) {
-		if(!render_buffer.com_resource) {
-			D3D12_HEAP_PROPERTIES heap_properties = {};
-			heap_properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		{
+			D3D12_COMPUTE_PIPELINE_STATE_DESC pso_desc = {};
+			pso_desc.pRootSignature = com_cull_root_signature.Get();
+			pso_desc.CS = cull_shader;
+			com_cull_pso = create_compute_pipeline_state(pso_desc, cull_root_signature_hash);
+		}
+	}
 
-			D3D12_CLEAR_VALUE clear_value = {};
-			clear_value.Format = render_buffer.format;
+	void request_permutation_pipeline_state(uint32_t shader_permutation, ScenePipeline pipeline) {
+		auto& deferred_pso = a_permutation_psos[shader_permutation][pipeline];
+		if(deferred_pso.is_requested()) {
+			return;
+		}
+		bool is_alpha_to_coverage = is_msaa_enabled && (shader_permutation & SHADER_FEATURE_ALPHA_MASK) != 0;
+		auto pso_desc = a_scene_pso_descs[pipeline];
+		pso_desc.PS = is_alpha_to_coverage ? a_pbs_alpha_to_coverage_ps_permutations[shader_permutation] : a_pbs_ps_permutations[shader_permutation];
+		pso_desc.BlendState.AlphaToCoverageEnable = is_alpha_to_coverage;
+		create_deferred_graphics_pipeline_state(pso_desc, root_signature_hash, deferred_pso);
+	}
 
-			D3D12_RESOURCE_DESC resource_desc = {};
-			resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-			resource_desc.Width = render_buffer.width;
-			resource_desc.Height = render_buffer.height;
-			resource_desc.DepthOrArraySize = 1;
-			resource_desc.MipLevels = 1;
-			resource_desc.Format = render_buffer.format;
-			resource_desc.SampleDesc.Count = render_buffer.is_multi_sampled ? ms_count : 1;
-			resource_desc.SampleDesc.Quality = render_buffer.is_multi_sampled ? ms_quality : 0;
-			resource_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-			resource_desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
-			CHECK_D3D12_CALL(com_device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, D3D12_RESOURCE_STATE_RENDER_TARGET, &clear_value, IID_PPV_ARGS(&(render_buffer.com_resource))), "");
-			set_name(render_buffer.com_resource, debug_name);
+	// Only the pipelines a material can be drawn with are requested, draws use the uber shader until they are compiled.
+	// After the depth pre-pass the alpha test is already resolved in the depth buffer, so masked materials shade with the unmasked permutation.
+	void prepare_shader_permutation(const Material &material) {
+		if(material.alphaMode == Material::ALPHAMODE_BLEND) {
+			request_permutation_pipeline_state(material.shader_permutation, SCENE_PIPELINE_ALPHA_BLEND);
+			return;
 		}
+		request_permutation_pipeline_state(material.shader_permutation, SCENE_PIPELINE_OPAQUE);
+		request_permutation_pipeline_state(material.shader_permutation & ~SHADER_FEATURE_ALPHA_MASK, SCENE_PIPELINE_OPAQUE_EQUAL);
+	}
+
+	void create_command_signature() {
+		D3D12_INDIRECT_ARGUMENT_DESC a_argument_descs[4] = {};
+		a_argument_descs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+		a_argument_descs[0].Constant.RootParameterIndex = 0;
+		a_argument_descs[0].Constant.DestOffsetIn32BitValues = 0;
+		a_argument_descs[0].Constant.Num32BitValuesToSet = 2;
+		a_argument_descs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+		a_argument_descs[1].VertexBuffer.Slot = 0;
+		a_argument_descs[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+		a_argument_descs[3].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+		D3D12_COMMAND_SIGNATURE_DESC command_signature_desc = {};
+		command_signature_desc.ByteStride = sizeof(draw_cull::IndirectCommand);
+		command_signature_desc.NumArgumentDescs = count_of(a_argument_descs);
+		command_signature_desc.pArgumentDescs = a_argument_descs;
+		CHECK_D3D12_CALL(com_device->CreateCommandSignature(&command_signature_desc, com_root_signature.Get(), IID_PPV_ARGS(&com_draw_command_signature)), "");
+	}
+
+	D3D12_RESOURCE_DESC get_render_buffer_resource_desc(const RenderBuffer &render_buffer, D3D12_RESOURCE_FLAGS flags) {
+		D3D12_RESOURCE_DESC resource_desc = {};
+		resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		resource_desc.Width = render_buffer.width;
+		resource_desc.Height = render_buffer.height;
+		resource_desc.DepthOrArraySize = 1;
+		resource_desc.MipLevels = 1;
+		resource_desc.Format = render_buffer.format;
+		resource_desc.SampleDesc.Count = render_buffer.is_multi_sampled ? ms_count : 1;
+		resource_desc.SampleDesc.Quality = render_buffer.is_multi_sampled ? ms_quality : 0;
+		resource_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		resource_desc.Flags = flags;
+		return resource_desc;
+	}
+
+	// Render buffers own no memory, swap chain buffers come from the swap chain and the others are placed by create_frame_graph
+	void create_render_buffer(RenderBuffer& render_buffer, DescriptorHeap *p_rtv_desc_heap, DescriptorHeap *p_srv_desc_heap, const string &debug_name, int32_t rtv_desc_heap_index =-1, int32_t stv_desc_heap_index = -1) {
+		set_name(render_buffer.com_resource, debug_name);
 
 		D3D12_RENDER_TARGET_VIEW_DESC desc = {};
 		desc.Format = render_buffer.format;
-		desc.ViewDimension = is_msaa_enabled ? D3D12_RTV_DIMENSION_TEXTURE2DMS : D3D12_RTV_DIMENSION_TEXTURE2D;
+		desc.ViewDimension = render_buffer.is_multi_sampled ? D3D12_RTV_DIMENSION_TEXTURE2DMS : D3D12_RTV_DIMENSION_TEXTURE2D;
 		com_device->CreateRenderTargetView(render_buffer.com_resource.Get(), &desc, p_rtv_desc_heap->get_cpu_handle((rtv_desc_heap_index >= 0) ? rtv_desc_heap_index : p_rtv_desc_heap->num_used_descriptors));
 		render_buffer.rtv_descriptor_table_index = (rtv_desc_heap_index >= 0) ? rtv_desc_heap_index : p_rtv_desc_heap->num_used_descriptors++;
 
@@ -761,9 +1227,8 @@ namespace renderer {
 			srv_desc.Texture2D.MipLevels = -1;
 			srv_desc.Texture2D.PlaneSlice = 0;
 			srv_desc.Texture2D.ResourceMinLODClamp = 0;
-			D3D12_CPU_DESCRIPTOR_HANDLE cpu_descriptor_handle = p_srv_desc_heap->get_cpu_handle((stv_desc_heap_index>= 0) ? stv_desc_heap_index : p_srv_desc_heap->num_used_descriptors);
-			com_device->CreateShaderResourceView(render_buffer.com_resource.Get(), &srv_desc, cpu_descriptor_handle);
-			render_buffer.srv_descriptor_table_index = (stv_desc_heap_index >= 0) ? stv_desc_heap_index : p_srv_desc_heap->num_used_descriptors++;
+			render_buffer.srv_descriptor_table_index = (stv_desc_heap_index >= 0) ? stv_desc_heap_index : p_srv_desc_heap->allocate();
+			com_device->CreateShaderResourceView(render_buffer.com_resource.Get(), &srv_desc, p_srv_desc_heap->get_cpu_handle(render_buffer.srv_descriptor_table_index));
 		}
 	}
 
@@ -774,29 +1239,123 @@ namespace renderer {
 		dsv_desc.ViewDimension = depth_buffer.is_multi_sampled ? D3D12_DSV_DIMENSION_TEXTURE2DMS : D3D12_DSV_DIMENSION_TEXTURE2D;
 		dsv_desc.Flags = D3D12_DSV_FLAG_NONE;
 
-		D3D12_CLEAR_VALUE dsc_clear_value = {};
-		dsc_clear_value.Format = depth_buffer.format;
-		dsc_clear_value.DepthStencil.Depth = 1.0f;
-
-		D3D12_HEAP_PROPERTIES heap_properties = {};
-		heap_properties.Type = D3D12_HEAP_TYPE_DEFAULT;
-		D3D12_RESOURCE_DESC resource_desc = {};
-		resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		resource_desc.Width = depth_buffer.width;
-		resource_desc.Height = depth_buffer.height;
-		resource_desc.DepthOrArraySize = 1;
-		resource_desc.MipLevels = 1;
-		resource_desc.Format = depth_buffer.format;
-		resource_desc.SampleDesc.Count = depth_buffer.is_multi_sampled ? ms_count : 1;
-		resource_desc.SampleDesc.Quality = depth_buffer.is_multi_sampled ? ms_quality : 0;
-		resource_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		resource_desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
-
-		CHECK_D3D12_CALL(com_device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, D3D12_RESOURCE_STATE_DEPTH_WRITE, &dsc_clear_value, IID_PPV_ARGS(&depth_buffer.com_resource)), "");
+		set_name(depth_buffer.com_resource, debug_name);
 		D3D12_CPU_DESCRIPTOR_HANDLE cpu_descriptor_handle = p_dsv_desc_heap->get_cpu_handle((dsv_desc_heap_index >= 0) ? dsv_desc_heap_index : p_dsv_desc_heap->num_used_descriptors++);
 		com_device->CreateDepthStencilView(depth_buffer.com_resource.Get(), &dsv_desc, cpu_descriptor_handle);
 	}
 
+	ID3D12Resource* get_frame_graph_resource(uint32_t resource_index) {
+		if(resource_index == back_buffer_resource_index) {
+			return a_back_buffers[frame_index].com_resource.Get();
+		}
+		return v_frame_graph_render_buffers[resource_index]->com_resource.Get();
+	}
+
+	// Describes the frame to the render graph and places its transient render buffers, the views are (re)created by the caller
+	void create_frame_graph() {
+		struct TransientRenderBuffer {
+			RenderBuffer *p_render_buffer;
+			D3D12_RESOURCE_DESC resource_desc;
+			D3D12_CLEAR_VALUE clear_value;
+			uint32_t resource_index;
+		};
+		vector<TransientRenderBuffer> v_transient_render_buffers;
+		frame_graph = {};
+		v_frame_graph_render_buffers.clear();
+
+		auto add_transient_render_buffer = [&](RenderBuffer &render_buffer, const string &name, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES initialization_state) {
+			TransientRenderBuffer transient = {};
+			transient.p_render_buffer = &render_buffer;
+			transient.resource_desc = get_render_buffer_resource_desc(render_buffer, flags);
+			transient.clear_value.Format = render_buffer.format;
+			if(flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) {
+				transient.clear_value.DepthStencil.Depth = 1.0f;
+			}
+			D3D12_RESOURCE_ALLOCATION_INFO allocation_info = com_device->GetResourceAllocationInfo(0, 1, &transient.resource_desc);
+			transient.resource_index = render_graph::add_transient_resource(frame_graph, name, allocation_info.SizeInBytes, allocation_info.Alignment, initialization_state);
+			v_frame_graph_render_buffers.push_back(&render_buffer);
+			v_transient_render_buffers.push_back(transient);
+			return transient.resource_index;
+		};
+
+		uint32_t hdr_resource_index = add_transient_render_buffer(hdr_buffer, "hdr_buffer", D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		uint32_t depth_resource_index = add_transient_render_buffer(depth_buffer, "depth_buffer", D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+		uint32_t resolved_resource_index = render_graph::invalid_index;
+		if constexpr(is_msaa_enabled) {
+			resolved_resource_index = add_transient_render_buffer(hdr_buffer_resolved, "hdr_buffer_resolved", D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		}
+		back_buffer_resource_index = render_graph::add_imported_resource(frame_graph, "back_buffer", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+		v_frame_graph_render_buffers.push_back(nullptr);
+
+		// Background, pre-pass, opaque and alpha blended draws all render into the same targets
+		scene_pass_index = render_graph::add_pass(frame_graph, "scene");
+		render_graph::write(frame_graph, scene_pass_index, hdr_resource_index, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		render_graph::write(frame_graph, scene_pass_index, depth_resource_index, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+		uint32_t final_source_index = hdr_resource_index;
+		resolve_pass_index = render_graph::invalid_index;
+		if constexpr(is_msaa_enabled) {
+			resolve_pass_index = render_graph::add_pass(frame_graph, "resolve");
+			render_graph::read(frame_graph, resolve_pass_index, hdr_resource_index, D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
+			render_graph::write(frame_graph, resolve_pass_index, resolved_resource_index, D3D12_RESOURCE_STATE_RESOLVE_DEST);
+			final_source_index = resolved_resource_index;
+		}
+
+		final_pass_index = render_graph::add_pass(frame_graph, "final");
+		render_graph::read(frame_graph, final_pass_index, final_source_index, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		render_graph::write(frame_graph, final_pass_index, back_buffer_resource_index, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+		compiled_frame_graph = render_graph::compile(frame_graph);
+
+		frame_graph_allocation = heap_allocator::allocate(a_heap_pools[HEAP_POOL_RENDER_TARGETS], compiled_frame_graph.heap_size, compiled_frame_graph.heap_alignment);
+		ID3D12Heap *p_heap = get_pool_heap(HEAP_POOL_RENDER_TARGETS, frame_graph_allocation.page_index);
+		for(auto& transient : v_transient_render_buffers) {
+			uint32_t resource_index = transient.resource_index;
+			CHECK_D3D12_CALL(com_device->CreatePlacedResource(p_heap, frame_graph_allocation.offset + compiled_frame_graph.v_heap_offsets[resource_index], &transient.resource_desc,
+				compiled_frame_graph.v_creation_states[resource_index], &transient.clear_value, IID_PPV_ARGS(&transient.p_render_buffer->com_resource)), "");
+		}
+	}
+
+	void record_barriers(ID3D12GraphicsCommandList *p_command_list, const vector<render_graph::Barrier> &v_barriers) {
+		if(v_barriers.empty()) {
+			return;
+		}
+		v_frame_graph_resource_barriers.assign(v_barriers.size(), {});
+		for(size_t barrier_index = 0; barrier_index < v_barriers.size(); ++barrier_index) {
+			auto& barrier = v_barriers[barrier_index];
+			auto& resource_barrier = v_frame_graph_resource_barriers[barrier_index];
+			ID3D12Resource *p_resource = get_frame_graph_resource(barrier.resource_index);
+			switch(barrier.type) {
+				case render_graph::Barrier::TYPE_TRANSITION:
+					resource_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+					resource_barrier.Transition.pResource = p_resource;
+					resource_barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+					resource_barrier.Transition.StateBefore = barrier.state_before;
+					resource_barrier.Transition.StateAfter = barrier.state_after;
+					break;
+				case render_graph::Barrier::TYPE_ALIASING:
+					resource_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+					resource_barrier.Aliasing.pResourceBefore = nullptr;
+					resource_barrier.Aliasing.pResourceAfter = p_resource;
+					break;
+				case render_graph::Barrier::TYPE_UAV:
+					resource_barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+					resource_barrier.UAV.pResource = p_resource;
+					break;
+			}
+		}
+		p_command_list->ResourceBarrier(static_cast<UINT>(v_frame_graph_resource_barriers.size()), v_frame_graph_resource_barriers.data());
+	}
+
+	void record_pass_preamble(ID3D12GraphicsCommandList *p_command_list, uint32_t pass_index) {
+		auto& preamble = compiled_frame_graph.v_pass_preambles[pass_index];
+		record_barriers(p_command_list, preamble.v_aliasing_barriers);
+		for(uint32_t resource_index : preamble.v_discarded_resources) {
+			p_command_list->DiscardResource(get_frame_graph_resource(resource_index), nullptr);
+		}
+		record_barriers(p_command_list, preamble.v_barriers);
+	}
+
 	void init(HWND h_window) {
 		ComPtr<IDXGIFactory5> com_dxgi_factory{ nullptr };
 		vector<ComPtr<IDXGIAdapter1>> v_com_dxgi_adapters{};
@@ -839,8 +1398,19 @@ namespace renderer {
 				continue;
 			}
 			if(SUCCEEDED(D3D12CreateDevice(com_dxgi_adapter.Get(), D3D_FEATURE_LEVEL_12_0, __uuidof(ID3D12Device), reinterpret_cast<void**>(com_device.GetAddressOf())))) {
+				CHECK_DXGI_CALL(com_dxgi_adapter.As(&com_adapter));
 				DXGI_ADAPTER_DESC adapter_desc = {};
 				com_dxgi_adapter->GetDesc(&adapter_desc);
+
+				// Cached PSO blobs are only valid for the same adapter and driver
+				LARGE_INTEGER driver_version = {};
+				com_dxgi_adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driver_version);
+				uint64_t device_hash = pipeline_cache::hash_value(pipeline_cache::fnv_offset_basis, adapter_desc.VendorId);
+				device_hash = pipeline_cache::hash_value(device_hash, adapter_desc.DeviceId);
+				device_hash = pipeline_cache::hash_value(device_hash, adapter_desc.SubSysId);
+				device_hash = pipeline_cache::hash_value(device_hash, adapter_desc.Revision);
+				device_hash = pipeline_cache::hash_value(device_hash, driver_version.QuadPart);
+				pso_cache.device_hash = device_hash;
 				break;
 			}
 
@@ -860,6 +1430,21 @@ namespace renderer {
 
 			CHECK_D3D12_CALL(com_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE::D3D12_COMMAND_LIST_TYPE_DIRECT, a_com_command_allocators[0].Get(), nullptr, IID_PPV_ARGS(&com_command_list)), "");
 
+			for(uint8_t allocator_index = 0; allocator_index < max_inflight_frame_count; ++allocator_index) {
+				for(uint8_t list_index = 0; list_index < max_worker_command_list_count; ++list_index) {
+					CHECK_D3D12_CALL(com_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&(a_com_worker_command_allocators[allocator_index][list_index]))), "");
+				}
+				CHECK_D3D12_CALL(com_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&(a_com_epilogue_command_allocators[allocator_index]))), "");
+			}
+
+			// Command lists are created in the recording state, close them so that begin_render can reset them uniformly
+			for(uint8_t list_index = 0; list_index < max_worker_command_list_count; ++list_index) {
+				CHECK_D3D12_CALL(com_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, a_com_worker_command_allocators[0][list_index].Get(), nullptr, IID_PPV_ARGS(&a_com_worker_command_lists[list_index])), "");
+				CHECK_D3D12_CALL(a_com_worker_command_lists[list_index]->Close(), "");
+			}
+			CHECK_D3D12_CALL(com_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, a_com_epilogue_command_allocators[0].Get(), nullptr, IID_PPV_ARGS(&com_epilogue_command_list)), "");
+			CHECK_D3D12_CALL(com_epilogue_command_list->Close(), "");
+
 			CHECK_D3D12_CALL(com_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&com_fence)), "");
 			a_fence_values[frame_index]++;
 			CHECK_WIN32_CALL(CreateEvent(nullptr, FALSE, FALSE, nullptr));
@@ -875,9 +1460,12 @@ namespace renderer {
 			swap_chain_desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
 			swap_chain_desc.BufferCount = max_inflight_frame_count;
 			swap_chain_desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+			swap_chain_desc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
 			CHECK_DXGI_CALL(com_dxgi_factory->CreateSwapChainForHwnd(com_command_queue.Get(), h_window, &swap_chain_desc, NULL, NULL, com_temp_swap_chain.GetAddressOf()));
 			CHECK_DXGI_CALL(com_temp_swap_chain.As(&com_swap_chain));
+			CHECK_DXGI_CALL(com_swap_chain->SetMaximumFrameLatency(max_frame_latency));
+			h_frame_latency_waitable = com_swap_chain->GetFrameLatencyWaitableObject();
 			frame_index = com_swap_chain->GetCurrentBackBufferIndex();
 
 			for(int buffer_index = 0; buffer_index < max_inflight_frame_count; ++buffer_index) {
@@ -893,18 +1481,26 @@ namespace renderer {
 		{ // Initialize descriptor heaps
 			rtv_desc_heap.init();
 			dsv_desc_heap.init();
-			source_srv_desc_heap.init();
-			target_srv_desc_heap.init();
+			srv_desc_heap.init();
+		}
+
+		{ // Initialize heap pools
+			for(uint32_t pool_index = 0; pool_index < heap_pool_count; ++pool_index) {
+				heap_allocator::init(a_heap_pools[pool_index], a_heap_pool_descs[pool_index].p_name, a_heap_pool_descs[pool_index].page_size);
+			}
+			residency::init(residency_manager, max_inflight_frame_count);
+			v_texture_indices_by_descriptor_index.assign(max_srv_descriptor_count, UINT32_MAX);
 		}
 
 		{ // Initialize render buffers
 			create_render_buffer(a_back_buffers[0], &rtv_desc_heap, nullptr, "back_buffer_0");
 			create_render_buffer(a_back_buffers[1], &rtv_desc_heap, nullptr, "back_buffer_1");
 			create_render_buffer(a_back_buffers[2], &rtv_desc_heap, nullptr, "back_buffer_2");
+			create_frame_graph();
 			if constexpr(is_msaa_enabled) {
-				create_render_buffer(hdr_buffer_resolved, &rtv_desc_heap, &source_srv_desc_heap, "hdr_buffer_resolved");
+				create_render_buffer(hdr_buffer_resolved, &rtv_desc_heap, &srv_desc_heap, "hdr_buffer_resolved");
 			}
-			create_render_buffer(hdr_buffer, &rtv_desc_heap, &source_srv_desc_heap, "hdr_buffer");
+			create_render_buffer(hdr_buffer, &rtv_desc_heap, &srv_desc_heap, "hdr_buffer");
 		}
 	
 		{ // Create the depth-stencil view
@@ -915,20 +1511,240 @@ namespace renderer {
 			per_frame_cb.init();
 			transformations_cb.init();
 			material_list_cb.init();
+			cull_cb.init();
+		}
+
+		{ // Create indirect draw buffers
+			instance_transform_index_upload_buffer.init(sizeof(uint32_t) * max_instance_count_per_scene, "instance_transform_index_upload_buffer");
+			indirect_command_upload_buffer.init(sizeof(draw_cull::IndirectCommand) * max_indirect_draw_count, "indirect_command_upload_buffer");
+			draw_bounds_upload_buffer.init(sizeof(draw_cull::DrawBounds) * max_indirect_draw_count, "draw_bounds_upload_buffer");
+			create_buffer(com_culled_command_buffer, sizeof(draw_cull::IndirectCommand) * max_indirect_draw_count, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, "culled_command_buffer");
+			create_buffer(com_culled_command_count_buffer, sizeof(uint32_t) * max_indirect_range_count, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST, "culled_command_count_buffer");
+			create_buffer(com_zero_count_upload_buffer, sizeof(uint32_t) * max_indirect_range_count, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, "zero_count_upload_buffer");
+
+			void *p_data = nullptr;
+			CHECK_D3D12_CALL(com_zero_count_upload_buffer->Map(0, nullptr, &p_data), "");
+			memset(p_data, 0, sizeof(uint32_t) * max_indirect_range_count);
+			com_zero_count_upload_buffer->Unmap(0, nullptr);
+
+			v_packed_commands.resize(max_indirect_draw_count);
+			v_indirect_ranges.reserve(max_indirect_range_count);
+		}
+
+		{ // Create timestamp queries
+			D3D12_QUERY_HEAP_DESC query_heap_desc = {};
+			query_heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+			query_heap_desc.Count = 2 * max_inflight_frame_count;
+			CHECK_D3D12_CALL(com_device->CreateQueryHeap(&query_heap_desc, IID_PPV_ARGS(&com_timestamp_query_heap)), "");
+			CHECK_D3D12_CALL(com_command_queue->GetTimestampFrequency(&timestamp_frequency), "");
+
+			// Readback heaps cannot be placed in the pools, which are all default or upload heaps
+			D3D12_HEAP_PROPERTIES heap_properties = {};
+			heap_properties.Type = D3D12_HEAP_TYPE_READBACK;
+			D3D12_RESOURCE_DESC resource_desc = {};
+			resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			resource_desc.Width = sizeof(uint64_t) * query_heap_desc.Count;
+			resource_desc.Height = 1;
+			resource_desc.DepthOrArraySize = 1;
+			resource_desc.MipLevels = 1;
+			resource_desc.Format = DXGI_FORMAT_UNKNOWN;
+			resource_desc.SampleDesc.Count = 1;
+			resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			CHECK_D3D12_CALL(com_device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&com_timestamp_readback_buffer)), "");
+			set_name(com_timestamp_readback_buffer, "timestamp_readback_buffer");
 		}
 
 		create_root_signature();
+		pipeline_cache::load(pipeline_cache_file_address, pso_cache);
 		create_pipeline_state_objects();
+		create_command_signature();
+	}
+
+	// The material's permutation when it is compiled, otherwise the uber shader which is also the only one with the isolation modes
+	ID3D12PipelineState* get_draw_pipeline_state(ScenePipeline pipeline, const Material &material) {
+		if(pipeline == SCENE_PIPELINE_DEPTH_PREPASS) {
+			return (material.alphaMode == Material::ALPHAMODE_MASK) ? depth_prepass_masked_pso.get() : depth_prepass_pso.get();
+		}
+		if(current_isolation_mode_index == 0) {
+			uint32_t shader_permutation = material.shader_permutation;
+			if(pipeline == SCENE_PIPELINE_OPAQUE_EQUAL) {
+				shader_permutation &= ~SHADER_FEATURE_ALPHA_MASK;
+			}
+			if(auto p_pso = a_permutation_psos[shader_permutation][pipeline].get()) {
+				return p_pso;
+			}
+		}
+		switch(pipeline) {
+			case SCENE_PIPELINE_OPAQUE_EQUAL: return scene_opaque_equal_pso.get();
+			case SCENE_PIPELINE_ALPHA_BLEND: return (current_isolation_mode_index == 0) ? com_scene_alpha_blend_pso.Get() : com_scene_opaque_pso.Get();
+			default: return com_scene_opaque_pso.Get();
+		}
+	}
+
+	// The scene's opaque draws, or the ones occlusion culling left of them with the LODs of this frame
+	const vector<DrawInfo>& get_opaque_draw_list() {
+		return p_frame_packet->has_opaque_draws ? p_frame_packet->v_opaque_draws : scene_manager::get_opaque_draw_list(current_scene_index);
+	}
+
+	// After a depth pre-pass the alpha test is already resolved in the depth buffer, EQUAL rejects the discarded samples
+	ScenePipeline get_opaque_shading_pipeline() {
+		return is_depth_prepass_enabled ? SCENE_PIPELINE_OPAQUE_EQUAL : SCENE_PIPELINE_OPAQUE;
+	}
+
+	// The draw list comes batched by shader permutation, so every pipeline state is one range unless the buffers run out of room
+	void update_indirect_commands(const Camera &camera, GuiData &gui_data) {
+		auto& opaque_draw_list = get_opaque_draw_list();
+		auto& material_list = scene_manager::get_material_list(current_scene_index);
+		uint32_t num_draws = static_cast<uint32_t>(opaque_draw_list.size());
+		uint32_t num_commands = 0;
+		ScenePipeline pipeline = get_opaque_shading_pipeline();
+		v_indirect_ranges.clear();
+		for(; num_commands < min(num_draws, max_indirect_draw_count); ++num_commands) {
+			auto p_pso = get_draw_pipeline_state(pipeline, material_list[opaque_draw_list[num_commands].material_index]);
+			if(v_indirect_ranges.empty() || v_indirect_ranges.back().p_pso != p_pso) {
+				if(v_indirect_ranges.size() == max_indirect_range_count) { break; }
+				v_indirect_ranges.push_back({ p_pso, num_commands, 0 });
+			}
+			v_indirect_ranges.back().num_commands++;
+		}
+		first_direct_draw_index = num_commands;
+
+		bool is_cpu_culled = (current_draw_submission_mode == DRAW_SUBMISSION_INDIRECT_CPU_CULLED);
+		auto p_commands = is_cpu_culled ? v_packed_commands.data() : reinterpret_cast<draw_cull::IndirectCommand*>(indirect_command_upload_buffer.get_cpu_address());
+		auto p_bounds = reinterpret_cast<draw_cull::DrawBounds*>(draw_bounds_upload_buffer.get_cpu_address());
+		for(uint32_t draw_index = 0; draw_index < num_commands; ++draw_index) {
+			auto& draw_info = opaque_draw_list[draw_index];
+			auto& mesh = a_meshes[draw_info.mesh_index];
+			draw_cull::IndirectCommand command = {};
+			command.first_instance_index = draw_info.first_instance;
+			command.material_index = draw_info.material_index;
+			command.vbv = mesh.vbv;
+			command.ibv = mesh.ibv;
+			command.draw_arguments.IndexCountPerInstance = draw_info.draw_index_count;
+			command.draw_arguments.InstanceCount = draw_info.instance_count;
+			command.draw_arguments.StartIndexLocation = draw_info.draw_first_index;
+			command.draw_arguments.BaseVertexLocation = draw_info.draw_base_vertex;
+			command.draw_arguments.StartInstanceLocation = 0;
+			p_commands[draw_index] = command;
+
+			draw_cull::DrawBounds bounds = {};
+			bounds.center_ws = XMFLOAT4(draw_info.bbox_center_ws.x, draw_info.bbox_center_ws.y, draw_info.bbox_center_ws.z, 1.0f);
+			bounds.extents_ws = XMFLOAT4(draw_info.bbox_extents_ws.x, draw_info.bbox_extents_ws.y, draw_info.bbox_extents_ws.z, 0.0f);
+			p_bounds[draw_index] = bounds;
+		}
+
+		draw_cull::extract_frustum_planes(camera, cull_cb.constants.a_frustum_planes);
+		cull_cb.update();
+
+		if(is_cpu_culled) {
+			auto p_dst_commands = reinterpret_cast<draw_cull::IndirectCommand*>(indirect_command_upload_buffer.get_cpu_address());
+			for(auto& range : v_indirect_ranges) {
+				uint32_t first = range.first_command;
+				range.num_commands = draw_cull::cull_draws(cull_cb.constants.a_frustum_planes, p_commands + first, p_bounds + first, range.num_commands, p_dst_commands + first);
+			}
+		}
+
+		auto& statistics = gui_data.indirect_draw_statistics;
+		statistics.num_draws = num_draws;
+		statistics.num_indirect_draws = num_commands;
+		statistics.num_direct_draws = num_draws - num_commands;
+		statistics.num_ranges = static_cast<uint32_t>(v_indirect_ranges.size());
 	}
 
-	void update(const GuiData& gui_data, uint32_t start_index_into_textures, uint32_t num_used_textures, const Camera& camera) {
+	// Marks the heaps of everything this frame draws with, then evicts the least recently used heaps while over the budget
+	void update_residency(GuiData &gui_data) {
+		mark_pool_heap_used(a_textures[0].heap_pool, a_textures[0].allocation);
+		uint32_t env_first_tex_index = 1 + current_env_index * num_descriptor_per_environment;
+		for(uint32_t tex_index = env_first_tex_index; tex_index < env_first_tex_index + num_descriptor_per_environment; ++tex_index) {
+			mark_pool_heap_used(a_textures[tex_index].heap_pool, a_textures[tex_index].allocation);
+		}
+		for(auto& material : scene_manager::get_material_list(current_scene_index)) {
+			for(int descriptor_index : { material.base_color_texture_index, material.normal_texture_index, material.metallic_roughness_texture_index, material.emissive_texture_index, material.occlusion_texture_index }) {
+				if(descriptor_index >= 0) {
+					auto& tex = a_textures[v_texture_indices_by_descriptor_index[descriptor_index]];
+					mark_pool_heap_used(tex.heap_pool, tex.allocation);
+				}
+			}
+		}
+		for(auto p_draw_list : { &scene_manager::get_opaque_draw_list(current_scene_index), &scene_manager::get_alpha_blend_draw_list(current_scene_index) }) {
+			for(auto& draw_info : *p_draw_list) {
+				auto& mesh = a_meshes[draw_info.mesh_index];
+				mark_pool_heap_used(HEAP_POOL_BUFFERS, mesh.vertex_allocation);
+				mark_pool_heap_used(HEAP_POOL_BUFFERS, mesh.index_allocation);
+			}
+		}
+
+		// Whatever else the process has in video memory is left out of the budget of the pool heaps
+		DXGI_QUERY_VIDEO_MEMORY_INFO memory_info = {};
+		CHECK_DXGI_CALL(com_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memory_info));
+		uint64_t untracked_usage = (memory_info.CurrentUsage > residency_manager.resident_size) ? memory_info.CurrentUsage - residency_manager.resident_size : 0;
+		uint64_t budget = (memory_info.Budget > untracked_usage) ? memory_info.Budget - untracked_usage : 0;
+		if(gui_data.is_residency_budget_simulated) {
+			budget = uint64_t(gui_data.simulated_residency_budget_in_mb) * 1024 * 1024;
+		}
+
+		auto decisions = residency::update(residency_manager, budget);
+		auto get_pageables = [&](const vector<uint32_t> &v_pageable_indices) {
+			vector<ID3D12Pageable*> v_pageables;
+			for(uint32_t heap_pool = 0; heap_pool < heap_pool_count; ++heap_pool) {
+				for(uint32_t page_index = 0; page_index < a_v_pool_heap_pageable_indices[heap_pool].size(); ++page_index) {
+					if(find(v_pageable_indices.begin(), v_pageable_indices.end(), a_v_pool_heap_pageable_indices[heap_pool][page_index]) != v_pageable_indices.end()) {
+						v_pageables.push_back(a_v_com_pool_heaps[heap_pool][page_index].Get());
+					}
+				}
+			}
+			return v_pageables;
+		};
+		if(!decisions.v_make_resident_indices.empty()) {
+			auto v_pageables = get_pageables(decisions.v_make_resident_indices);
+			CHECK_D3D12_CALL(com_device->MakeResident(static_cast<UINT>(v_pageables.size()), v_pageables.data()), "");
+		}
+		if(!decisions.v_evict_indices.empty()) {
+			auto v_pageables = get_pageables(decisions.v_evict_indices);
+			CHECK_D3D12_CALL(com_device->Evict(static_cast<UINT>(v_pageables.size()), v_pageables.data()), "");
+		}
+
+		auto& statistics = gui_data.residency_statistics;
+		statistics = residency::get_statistics(residency_manager);
+		statistics.budget = budget;
+		statistics.os_budget = memory_info.Budget;
+		statistics.os_usage = memory_info.CurrentUsage;
+	}
+
+	void update(FramePacket &frame_packet) {
+		p_frame_packet = &frame_packet;
+		current_scene_index = frame_packet.scene_index;
+		GuiData &gui_data = frame_packet.gui_data;
+		const Camera &camera = frame_packet.camera;
+		if(gui_data.max_frame_latency != max_frame_latency && gui_data.max_frame_latency > 0) {
+			max_frame_latency = gui_data.max_frame_latency;
+			CHECK_DXGI_CALL(com_swap_chain->SetMaximumFrameLatency(max_frame_latency));
+		}
+		if(gui_data.is_heap_defragmentation_requested) {
+			defragment_texture_heap_pools();
+			gui_data.is_heap_defragmentation_requested = false;
+		}
+		for(uint32_t pool_index = 0; pool_index < heap_pool_count; ++pool_index) {
+			gui_data.a_heap_statistics[pool_index] = heap_allocator::get_statistics(a_heap_pools[pool_index]);
+		}
+
 		current_env_index = gui_data.ibl_environment_index;
 		current_background_index = gui_data.background_env_map_type;
 		current_specular_mip_level = gui_data.background_specular_irradiance_mip_level;
 		current_isolation_mode_index = gui_data.isolation_mode_index;
+		current_draw_submission_mode = gui_data.draw_submission_mode;
+		for(auto p_deferred_pso : { &scene_opaque_equal_pso, &depth_prepass_pso, &depth_prepass_masked_pso }) {
+			p_deferred_pso->poll();
+		}
+		for(auto& permutation_psos : a_permutation_psos) {
+			for(auto& deferred_pso : permutation_psos) {
+				deferred_pso.poll();
+			}
+		}
+		is_depth_prepass_enabled = gui_data.is_depth_prepass_enabled && depth_prepass_pso.get() && depth_prepass_masked_pso.get() && scene_opaque_equal_pso.get();
+		is_front_to_back_sorting_enabled = gui_data.is_front_to_back_sorting_enabled;
 		test = gui_data.test;
-		auto num_used_descs = num_used_textures;
-		auto start_index_to_desc_heap = a_textures[start_index_into_textures].srv_descriptor_table_index;
+		update_residency(gui_data);
 
 		{ // Update constant buffers
 			{
@@ -937,109 +1753,222 @@ namespace renderer {
 				per_frame_cb.constants.view_from_world = camera.view_from_world;
 				per_frame_cb.constants.world_from_view = camera.world_from_view;
 				per_frame_cb.constants.cam_pos_ws = camera.pos_ws;
+				// Environment textures follow the brdf lut as radiance, irradiance, specular triplets, switching one is only an index change
+				uint32_t env_first_tex_index = 1 + current_env_index * num_descriptor_per_environment;
+				auto& specular_texture = a_textures[env_first_tex_index + 2];
+				per_frame_cb.constants.specular_max_mip_level = static_cast<float>(specular_texture.mip_levels - 1);
+				per_frame_cb.constants.brdf_lut_index = a_textures[0].srv_descriptor_table_index;
+				per_frame_cb.constants.radiance_index = a_textures[env_first_tex_index].srv_descriptor_table_index;
+				per_frame_cb.constants.irradiance_index = a_textures[env_first_tex_index + 1].srv_descriptor_table_index;
+				per_frame_cb.constants.specular_index = specular_texture.srv_descriptor_table_index;
+				per_frame_cb.constants.hdr_buffer_index = is_msaa_enabled ? hdr_buffer_resolved.srv_descriptor_table_index : hdr_buffer.srv_descriptor_table_index;
 				per_frame_cb.update();
 			}
 
 			{
-				auto& transformation_list = scene_manager::get_transformation_list();
+				auto& transformation_list = scene_manager::get_transformation_list(current_scene_index);
 				auto num_transformations = transformation_list.size();
 				memcpy(&transformations_cb.constants, transformation_list.data(), sizeof(XMFLOAT4X4) * num_transformations);
 				transformations_cb.update();
 			}
 
 			{
-				auto& material_list = scene_manager::get_material_list();
+				auto& material_list = scene_manager::get_material_list(current_scene_index);
 				auto num_materials = material_list.size();
 				memcpy(&material_list_cb.constants, material_list.data(), sizeof(Material) * num_materials);
 				material_list_cb.update();
 			}
-		}
-		{ // Update srv descriptor table
-			
-			uint32_t num_source_static_descs = (is_msaa_enabled ? 2 : 1) + 1; // render_buffer srvs +  brdf_lut srv;
-			uint32_t target_heap_start_index = frame_index * max_descriptor_count_per_frame + 1;
-
-			// Copy Environment Map Descriptors
-			com_device->CopyDescriptorsSimple(
-				num_source_static_descs,
-				target_srv_desc_heap.get_cpu_handle(target_heap_start_index),
-				source_srv_desc_heap.get_cpu_handle(0),
-				D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
-			);
-
-			// Copy Environment Map Descriptors
-			com_device->CopyDescriptorsSimple(
-				num_descriptor_per_environment,
-				target_srv_desc_heap.get_cpu_handle(target_heap_start_index + num_source_static_descs),
-				source_srv_desc_heap.get_cpu_handle(num_source_static_descs + current_env_index * num_descriptor_per_environment),
-				D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
-			);
-
-			// Copy Scene Texture Descriptors
-			com_device->CopyDescriptorsSimple(
-				num_used_descs,
-				target_srv_desc_heap.get_cpu_handle(target_heap_start_index + num_source_static_descs + num_descriptor_per_environment),
-				source_srv_desc_heap.get_cpu_handle(start_index_to_desc_heap),
-				D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
-			);
+
+			{
+				auto& instance_transform_index_list = scene_manager::get_instance_transform_index_list(current_scene_index);
+				auto num_instances = min(static_cast<uint32_t>(instance_transform_index_list.size()), max_instance_count_per_scene);
+				memcpy(instance_transform_index_upload_buffer.get_cpu_address(), instance_transform_index_list.data(), sizeof(uint32_t) * num_instances);
+			}
+
+			if(current_draw_submission_mode != DRAW_SUBMISSION_DIRECT) {
+				update_indirect_commands(camera, gui_data);
+			}
 		}
 	}
 
 	void begin_render() {
 		CHECK_D3D12_CALL(a_com_command_allocators[frame_index]->Reset(), "");
 		CHECK_D3D12_CALL(com_command_list->Reset(a_com_command_allocators[frame_index].Get(), com_background_pso.Get()), "");
+		CHECK_D3D12_CALL(a_com_epilogue_command_allocators[frame_index]->Reset(), "");
+		CHECK_D3D12_CALL(com_epilogue_command_list->Reset(a_com_epilogue_command_allocators[frame_index].Get(), nullptr), "");
 
-		D3D12_RESOURCE_BARRIER resource_barrier = {};
-		resource_barrier.Transition.pResource = a_back_buffers[frame_index].com_resource.Get();
-		resource_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-		resource_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-		com_command_list->ResourceBarrier(1, &resource_barrier);
-
-		if constexpr(!is_msaa_enabled) {
-			D3D12_RESOURCE_BARRIER resource_barrier = {};
-			resource_barrier.Transition.pResource = hdr_buffer.com_resource.Get();
-			resource_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-			resource_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			com_command_list->ResourceBarrier(1, &resource_barrier);
-		}
+		com_command_list->EndQuery(com_timestamp_query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * frame_index);
+		a_timestamp_frame_numbers[frame_index] = p_frame_packet->frame_number;
+		record_pass_preamble(com_command_list.Get(), scene_pass_index);
 	}
 
-	void draw(const vector<DrawInfo>& draw_list) {
-		for(auto& draw_info : draw_list) {
-			auto& mesh = a_meshes[draw_info.mesh_index];
-			com_command_list->IASetIndexBuffer(&mesh.ibv);
-			com_command_list->IASetVertexBuffers(0, 1, &mesh.vbv);
-			uint32_t a_root_constants[] = { draw_info.transformation_index, draw_info.material_index, current_isolation_mode_index, *reinterpret_cast<uint32_t*>(&test) };
-			com_command_list->SetGraphicsRoot32BitConstants(0, count_of(a_root_constants), a_root_constants, 0);
-			com_command_list->DrawIndexedInstanced(draw_info.draw_index_count, 1, draw_info.draw_first_index, 0, 0);
-		}
-	}
-
-	void render() {
-		float clear_color[] = { 0.f, 0.f, 0.f, 0.f };
-		com_command_list->SetGraphicsRootSignature(com_root_signature.Get());
+	void set_scene_pass_state(ID3D12GraphicsCommandList *p_command_list) {
+		p_command_list->SetGraphicsRootSignature(com_root_signature.Get());
 
 		D3D12_VIEWPORT viewport = {};
 		viewport.Width = back_buffer_width;
 		viewport.Height = back_buffer_height;
 		viewport.MaxDepth = 1.0;
-		com_command_list->RSSetViewports(1, &viewport);
+		p_command_list->RSSetViewports(1, &viewport);
 		D3D12_RECT rect = {};
 		rect.right = back_buffer_width;
 		rect.bottom = back_buffer_height;
-		com_command_list->RSSetScissorRects(1, &rect);
+		p_command_list->RSSetScissorRects(1, &rect);
+
+		ID3D12DescriptorHeap *a_heaps[] = { srv_desc_heap.com_heap.Get() };
+		p_command_list->SetDescriptorHeaps(count_of(a_heaps), a_heaps);
+		p_command_list->SetGraphicsRootConstantBufferView(1, per_frame_cb.get_gpu_address());
+		p_command_list->SetGraphicsRootConstantBufferView(2, transformations_cb.get_gpu_address());
+		p_command_list->SetGraphicsRootConstantBufferView(3, material_list_cb.get_gpu_address());
+		p_command_list->SetGraphicsRootDescriptorTable(4, srv_desc_heap.get_gpu_handle(0));
+		p_command_list->SetGraphicsRootShaderResourceView(5, instance_transform_index_upload_buffer.get_gpu_address());
+
+		D3D12_CPU_DESCRIPTOR_HANDLE rtv_cpu_handle(rtv_desc_heap.get_cpu_handle(hdr_buffer.rtv_descriptor_table_index));
+		D3D12_CPU_DESCRIPTOR_HANDLE dsv_cpu_handle(dsv_desc_heap.get_cpu_handle(depth_buffer.rtv_descriptor_table_index));
+		p_command_list->OMSetRenderTargets(1, &rtv_cpu_handle, FALSE, &dsv_cpu_handle);
+		p_command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+		// The last two per draw constants only change once per frame
+		uint32_t a_per_frame_root_constants[] = { current_isolation_mode_index, *reinterpret_cast<uint32_t*>(&test) };
+		p_command_list->SetGraphicsRoot32BitConstants(0, count_of(a_per_frame_root_constants), a_per_frame_root_constants, 2);
+	}
+
+	void draw(ID3D12GraphicsCommandList *p_command_list, CommandListState &state, ScenePipeline pipeline, const DrawInfo *p_draw_infos, size_t num_draw_infos) {
+		auto& material_list = scene_manager::get_material_list(current_scene_index);
+		for(size_t draw_index = 0; draw_index < num_draw_infos; ++draw_index) {
+			auto& draw_info = p_draw_infos[draw_index];
+			auto p_draw_pso = get_draw_pipeline_state(pipeline, material_list[draw_info.material_index]);
+			if(state.p_pso != p_draw_pso) {
+				p_command_list->SetPipelineState(p_draw_pso);
+				state.p_pso = p_draw_pso;
+			}
+			auto& mesh = a_meshes[draw_info.mesh_index];
+			if(state.p_mesh != &mesh) {
+				p_command_list->IASetIndexBuffer(&mesh.ibv);
+				p_command_list->IASetVertexBuffers(0, 1, &mesh.vbv);
+				state.p_mesh = &mesh;
+			}
+			uint32_t a_root_constants[] = { draw_info.first_instance, draw_info.material_index };
+			p_command_list->SetGraphicsRoot32BitConstants(0, count_of(a_root_constants), a_root_constants, 0);
+			p_command_list->DrawIndexedInstanced(draw_info.draw_index_count, draw_info.instance_count, draw_info.draw_first_index, draw_info.draw_base_vertex, 0);
+		}
+	}
+
+	enum OpaquePass { OPAQUE_PASS_DEPTH_PREPASS, OPAQUE_PASS_SHADING };
+
+	void record_opaque_draws(uint32_t list_index, OpaquePass pass, const DrawInfo *p_draw_infos, size_t num_draw_infos) {
+		ScenePipeline pipeline = (pass == OPAQUE_PASS_DEPTH_PREPASS) ? SCENE_PIPELINE_DEPTH_PREPASS : get_opaque_shading_pipeline();
+
+		auto& com_worker_command_list = a_com_worker_command_lists[list_index];
+		CHECK_D3D12_CALL(a_com_worker_command_allocators[frame_index][list_index]->Reset(), "");
+		CHECK_D3D12_CALL(com_worker_command_list->Reset(a_com_worker_command_allocators[frame_index][list_index].Get(), nullptr), "");
+
+		CommandListState state;
+		set_scene_pass_state(com_worker_command_list.Get());
+		draw(com_worker_command_list.Get(), state, pipeline, p_draw_infos, num_draw_infos);
+
+		CHECK_D3D12_CALL(com_worker_command_list->Close(), "");
+	}
+
+	// Splits one opaque pass across the recording threads once the list is big enough to amortize the fork.
+	// The first chunk is recorded on the calling thread, the others are left to the job system under recording_counter.
+	uint32_t record_opaque_pass(OpaquePass pass, uint32_t first_list_index, const vector<DrawInfo> &draw_list, job_system::Counter &recording_counter) {
+		size_t num_draws = draw_list.size();
+		size_t num_chunks = (num_draws + min_draw_count_per_recording_thread - 1) / min_draw_count_per_recording_thread;
+		num_chunks = max(size_t(1), min(num_chunks, size_t(max_recording_thread_count)));
+		size_t chunk_size = (num_draws + num_chunks - 1) / num_chunks;
+
+		for(uint32_t chunk_index = 1; chunk_index < num_chunks; ++chunk_index) {
+			size_t first_draw = min(num_draws, chunk_index * chunk_size);
+			size_t num_chunk_draws = min(num_draws - first_draw, chunk_size);
+			const DrawInfo *p_chunk_draws = draw_list.data() + first_draw;
+			uint32_t list_index = first_list_index + chunk_index;
+			job_system::run([list_index, pass, p_chunk_draws, num_chunk_draws]() { record_opaque_draws(list_index, pass, p_chunk_draws, num_chunk_draws); }, recording_counter);
+		}
+		record_opaque_draws(first_list_index, pass, draw_list.data(), min(num_draws, chunk_size));
+		return static_cast<uint32_t>(num_chunks);
+	}
+
+	void record_indirect_opaque_draws(uint32_t list_index) {
+		auto& com_worker_command_list = a_com_worker_command_lists[list_index];
+		CHECK_D3D12_CALL(a_com_worker_command_allocators[frame_index][list_index]->Reset(), "");
+		CHECK_D3D12_CALL(com_worker_command_list->Reset(a_com_worker_command_allocators[frame_index][list_index].Get(), nullptr), "");
 
-		// Draw Scene
-		ID3D12DescriptorHeap *a_heaps[] = { target_srv_desc_heap.com_heap.Get() };
-		com_command_list->SetDescriptorHeaps(count_of(a_heaps), a_heaps);
-		com_command_list->SetGraphicsRootConstantBufferView(1, per_frame_cb.get_gpu_address());
-		com_command_list->SetGraphicsRootConstantBufferView(2, transformations_cb.get_gpu_address());
-		com_command_list->SetGraphicsRootConstantBufferView(3, material_list_cb.get_gpu_address());
-		com_command_list->SetGraphicsRootDescriptorTable(4, target_srv_desc_heap.get_gpu_handle(1 + max_descriptor_count_per_frame * frame_index));
+		uint32_t num_ranges = static_cast<uint32_t>(v_indirect_ranges.size());
+		bool is_gpu_culled = (current_draw_submission_mode == DRAW_SUBMISSION_INDIRECT_GPU_CULLED) && num_ranges > 0;
+		D3D12_RESOURCE_BARRIER a_resource_barriers[2] = {};
+		if(is_gpu_culled) {
+			com_worker_command_list->CopyBufferRegion(com_culled_command_count_buffer.Get(), 0, com_zero_count_upload_buffer.Get(), 0, sizeof(uint32_t) * num_ranges);
+
+			D3D12_RESOURCE_BARRIER resource_barrier = {};
+			resource_barrier.Transition.pResource = com_culled_command_count_buffer.Get();
+			resource_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+			resource_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+			com_worker_command_list->ResourceBarrier(1, &resource_barrier);
+
+			com_worker_command_list->SetComputeRootSignature(com_cull_root_signature.Get());
+			com_worker_command_list->SetPipelineState(com_cull_pso.Get());
+			com_worker_command_list->SetComputeRootConstantBufferView(0, cull_cb.get_gpu_address());
+			com_worker_command_list->SetComputeRootShaderResourceView(1, indirect_command_upload_buffer.get_gpu_address());
+			com_worker_command_list->SetComputeRootShaderResourceView(2, draw_bounds_upload_buffer.get_gpu_address());
+			com_worker_command_list->SetComputeRootUnorderedAccessView(3, com_culled_command_buffer->GetGPUVirtualAddress());
+			com_worker_command_list->SetComputeRootUnorderedAccessView(4, com_culled_command_count_buffer->GetGPUVirtualAddress());
+			// Ranges write disjoint parts of the outputs, the dispatches need no barrier between them
+			for(uint32_t range_index = 0; range_index < num_ranges; ++range_index) {
+				auto& range = v_indirect_ranges[range_index];
+				uint32_t a_range_constants[] = { range.first_command, range.num_commands, range_index };
+				com_worker_command_list->SetComputeRoot32BitConstants(5, count_of(a_range_constants), a_range_constants, 0);
+				com_worker_command_list->Dispatch((range.num_commands + 63) / 64, 1, 1);
+			}
+
+			a_resource_barriers[0].Transition.pResource = com_culled_command_buffer.Get();
+			a_resource_barriers[0].Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+			a_resource_barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+			a_resource_barriers[1].Transition.pResource = com_culled_command_count_buffer.Get();
+			a_resource_barriers[1].Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+			a_resource_barriers[1].Transition.StateAfter = D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+			com_worker_command_list->ResourceBarrier(count_of(a_resource_barriers), a_resource_barriers);
+		}
+
+		// The command signature rebinds everything but the pipeline state, which changes between ranges
+		set_scene_pass_state(com_worker_command_list.Get());
+		for(uint32_t range_index = 0; range_index < num_ranges; ++range_index) {
+			auto& range = v_indirect_ranges[range_index];
+			if(range.num_commands == 0) { continue; }
+			com_worker_command_list->SetPipelineState(range.p_pso);
+			uint64_t command_offset = sizeof(draw_cull::IndirectCommand) * range.first_command;
+			if(is_gpu_culled) {
+				com_worker_command_list->ExecuteIndirect(com_draw_command_signature.Get(), range.num_commands, com_culled_command_buffer.Get(), command_offset, com_culled_command_count_buffer.Get(), sizeof(uint32_t) * range_index);
+			}
+			else {
+				com_worker_command_list->ExecuteIndirect(com_draw_command_signature.Get(), range.num_commands, indirect_command_upload_buffer.com_buffer.Get(), indirect_command_upload_buffer.get_offset() + command_offset, nullptr, 0);
+			}
+		}
+
+		if(is_gpu_culled) {
+			a_resource_barriers[0].Transition.StateBefore = D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+			a_resource_barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+			a_resource_barriers[1].Transition.StateBefore = D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+			a_resource_barriers[1].Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_DEST;
+			com_worker_command_list->ResourceBarrier(count_of(a_resource_barriers), a_resource_barriers);
+		}
+
+		// Draws past the capacity of the indirect buffers are not dropped, they are drawn directly and without culling
+		auto& opaque_draw_list = get_opaque_draw_list();
+		if(first_direct_draw_index < opaque_draw_list.size()) {
+			CommandListState state;
+			draw(com_worker_command_list.Get(), state, get_opaque_shading_pipeline(), opaque_draw_list.data() + first_direct_draw_index, opaque_draw_list.size() - first_direct_draw_index);
+		}
+
+		CHECK_D3D12_CALL(com_worker_command_list->Close(), "");
+	}
+
+	void render() {
+		float clear_color[] = { 0.f, 0.f, 0.f, 0.f };
+		set_scene_pass_state(com_command_list.Get());
 
 		D3D12_CPU_DESCRIPTOR_HANDLE rtv_cpu_handle(rtv_desc_heap.get_cpu_handle(hdr_buffer.rtv_descriptor_table_index));
 		D3D12_CPU_DESCRIPTOR_HANDLE dsv_cpu_handle(dsv_desc_heap.get_cpu_handle(depth_buffer.rtv_descriptor_table_index));
-		com_command_list->OMSetRenderTargets(1, &rtv_cpu_handle, FALSE, &dsv_cpu_handle);
 		com_command_list->ClearRenderTargetView(rtv_cpu_handle, clear_color, 0, nullptr);
 		com_command_list->ClearDepthStencilView(dsv_cpu_handle, D3D12_CLEAR_FLAG_DEPTH, 1.0, 0, 0, NULL);
 
@@ -1048,64 +1977,76 @@ namespace renderer {
 		uint32_t a_root_constants[] = { current_background_index, current_specular_mip_level };
 		com_command_list->SetGraphicsRoot32BitConstants(0, count_of(a_root_constants), a_root_constants, 0);
 		com_command_list->DrawInstanced(4, 1, 0, 0);
+		CHECK_D3D12_CALL(com_command_list->Close(), "");
 
-		// Draw Opaque objects
-		com_command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		com_command_list->SetPipelineState(com_scene_opaque_pso.Get());
-		draw(scene_manager::get_opaque_draw_list());
+		// Draw Opaque objects, optionally preceded by a depth-only pass so that the shading pass has no overdraw
+		{
+			auto& opaque_draw_list = get_opaque_draw_list();
+			auto& front_to_back_draw_list = is_front_to_back_sorting_enabled ? p_frame_packet->v_front_to_back_opaque_draws : opaque_draw_list;
+
+			// With a pre-pass the shading order no longer matters for overdraw, keep the state-sorted order for it.
+			// The pre-pass is recorded directly in every submission mode, indirect draws are shaded in the order of their ranges.
+			job_system::Counter recording_counter;
+			uint32_t num_prepass_lists = 0;
+			if(is_depth_prepass_enabled) {
+				num_prepass_lists = record_opaque_pass(OPAQUE_PASS_DEPTH_PREPASS, 0, front_to_back_draw_list, recording_counter);
+			}
+			uint32_t num_shading_lists = 1;
+			if(current_draw_submission_mode != DRAW_SUBMISSION_DIRECT) {
+				record_indirect_opaque_draws(num_prepass_lists);
+			}
+			else {
+				auto& shading_draw_list = is_depth_prepass_enabled ? opaque_draw_list : front_to_back_draw_list;
+				num_shading_lists = record_opaque_pass(OPAQUE_PASS_SHADING, num_prepass_lists, shading_draw_list, recording_counter);
+			}
+			num_used_worker_command_lists = num_prepass_lists + num_shading_lists;
+			job_system::wait(recording_counter);
+		}
 
 		// Draw Alpha Blended objects
-		if(current_isolation_mode_index == 0) com_command_list->SetPipelineState(com_scene_alpha_blend_pso.Get());
-		draw(scene_manager::get_alpha_blend_draw_list());
-
-		if constexpr(is_msaa_enabled) {
-			D3D12_RESOURCE_BARRIER a_resource_barriers[2] = {};
-			a_resource_barriers[0].Transition.pResource = hdr_buffer.com_resource.Get();
-			a_resource_barriers[0].Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			a_resource_barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_RESOLVE_SOURCE;
-			a_resource_barriers[1].Transition.pResource = hdr_buffer_resolved.com_resource.Get();
-			a_resource_barriers[1].Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-			a_resource_barriers[1].Transition.StateAfter = D3D12_RESOURCE_STATE_RESOLVE_DEST;
-			com_command_list->ResourceBarrier(count_of(a_resource_barriers), a_resource_barriers);
-			com_command_list->ResolveSubresource(hdr_buffer_resolved.com_resource.Get(), 0, hdr_buffer.com_resource.Get(), 0, hdr_buffer.format);
-			a_resource_barriers[0].Transition.StateBefore = D3D12_RESOURCE_STATE_RESOLVE_SOURCE;
-			a_resource_barriers[0].Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			a_resource_barriers[1].Transition.StateBefore = D3D12_RESOURCE_STATE_RESOLVE_DEST;
-			a_resource_barriers[1].Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-			com_command_list->ResourceBarrier(count_of(a_resource_barriers), a_resource_barriers);
+		set_scene_pass_state(com_epilogue_command_list.Get());
+		{
+			CommandListState state;
+			auto& alpha_blend_draw_list = p_frame_packet->v_sorted_alpha_blend_draws;
+			draw(com_epilogue_command_list.Get(), state, SCENE_PIPELINE_ALPHA_BLEND, alpha_blend_draw_list.data(), alpha_blend_draw_list.size());
 		}
 
-		// Copy
-		if constexpr(!is_msaa_enabled) {
-			D3D12_RESOURCE_BARRIER resource_barrier = {};
-			resource_barrier.Transition.pResource = hdr_buffer.com_resource.Get();
-			resource_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			resource_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-			com_command_list->ResourceBarrier(1, &resource_barrier);
+		if(resolve_pass_index != render_graph::invalid_index) {
+			record_pass_preamble(com_epilogue_command_list.Get(), resolve_pass_index);
+			com_epilogue_command_list->ResolveSubresource(hdr_buffer_resolved.com_resource.Get(), 0, hdr_buffer.com_resource.Get(), 0, hdr_buffer.format);
 		}
 
-		com_command_list->SetPipelineState(com_final_pso.Get());
+		// Copy
+		record_pass_preamble(com_epilogue_command_list.Get(), final_pass_index);
+		com_epilogue_command_list->SetPipelineState(com_final_pso.Get());
 		rtv_cpu_handle = rtv_desc_heap.get_cpu_handle(a_back_buffers[frame_index].rtv_descriptor_table_index);
-		com_command_list->OMSetRenderTargets(1, &rtv_cpu_handle, FALSE, nullptr);
-		com_command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-		com_command_list->DrawInstanced(4, 1, 0, 0);
+		com_epilogue_command_list->OMSetRenderTargets(1, &rtv_cpu_handle, FALSE, nullptr);
+		com_epilogue_command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+		com_epilogue_command_list->DrawInstanced(4, 1, 0, 0);
 
 		// Prepare the command list for imgui commands
-		com_command_list->OMSetRenderTargets(1, &rtv_cpu_handle, FALSE, nullptr);
-		com_command_list->SetDescriptorHeaps(count_of(a_heaps), a_heaps);
+		ID3D12DescriptorHeap *a_heaps[] = { srv_desc_heap.com_heap.Get() };
+		com_epilogue_command_list->OMSetRenderTargets(1, &rtv_cpu_handle, FALSE, nullptr);
+		com_epilogue_command_list->SetDescriptorHeaps(count_of(a_heaps), a_heaps);
 	}
 
 	void end_render() {
-		D3D12_RESOURCE_BARRIER resource_barrier = {};
-		resource_barrier.Transition.pResource = a_back_buffers[frame_index].com_resource.Get();
-		resource_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-		resource_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-		com_command_list->ResourceBarrier(1, &resource_barrier);
-
-		CHECK_D3D12_CALL(com_command_list->Close(), "");
-
-		ID3D12CommandList *a_command_lists[] = { com_command_list.Get() };
-		com_command_queue->ExecuteCommandLists(count_of(a_command_lists), a_command_lists);
+		record_barriers(com_epilogue_command_list.Get(), compiled_frame_graph.v_final_barriers);
+
+		com_epilogue_command_list->EndQuery(com_timestamp_query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * frame_index + 1);
+		com_epilogue_command_list->ResolveQueryData(com_timestamp_query_heap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * frame_index, 2,
+			com_timestamp_readback_buffer.Get(), sizeof(uint64_t) * 2 * frame_index);
+		CHECK_D3D12_CALL(com_epilogue_command_list->Close(), "");
+
+		// Submit in recording order: prologue, depth pre-pass chunks, opaque chunks, epilogue
+		array<ID3D12CommandList*, max_worker_command_list_count + 2> a_command_lists{};
+		uint32_t num_command_lists = 0;
+		a_command_lists[num_command_lists++] = com_command_list.Get();
+		for(uint32_t list_index = 0; list_index < num_used_worker_command_lists; ++list_index) {
+			a_command_lists[num_command_lists++] = a_com_worker_command_lists[list_index].Get();
+		}
+		a_command_lists[num_command_lists++] = com_epilogue_command_list.Get();
+		com_command_queue->ExecuteCommandLists(num_command_lists, a_command_lists.data());
 	}
 
 	void execute_initial_commands() {
@@ -1116,18 +2057,93 @@ namespace renderer {
 
 		// Release upload buffers
 		for(auto& tex : a_textures) {
-			tex.com_upload.Reset();
+			release_placed_resource(HEAP_POOL_UPLOAD_BUFFERS, tex.com_upload, tex.upload_allocation);
 		}
 		for(auto& mesh : a_meshes) {
-			mesh.com_vertex_upload_buffer.Reset();
-			mesh.com_index_upload_buffer.Reset();
+			release_placed_resource(HEAP_POOL_UPLOAD_BUFFERS, mesh.com_vertex_upload_buffer, mesh.vertex_upload_allocation);
+			release_placed_resource(HEAP_POOL_UPLOAD_BUFFERS, mesh.com_index_upload_buffer, mesh.index_upload_allocation);
 		}
+		release_pool_heaps(HEAP_POOL_UPLOAD_BUFFERS, heap_allocator::release_empty_pages(a_heap_pools[HEAP_POOL_UPLOAD_BUFFERS]));
+	}
+
+	// Moves the textures out of the least used pages of the texture pools and releases those pages, stalls on the GPU
+	void defragment_texture_heap_pools() {
+		wait_for_gpu();
+		CHECK_D3D12_CALL(a_com_command_allocators[frame_index]->Reset(), "");
+		CHECK_D3D12_CALL(com_command_list->Reset(a_com_command_allocators[frame_index].Get(), nullptr), "");
+
+		array<vector<heap_allocator::DefragmentationMove>, heap_pool_count> a_v_moves;
+		vector<ComPtr<ID3D12Resource>> v_com_moved_resources;
+		for(auto heap_pool : { HEAP_POOL_SMALL_TEXTURES, HEAP_POOL_TEXTURES }) {
+			// Evicted heaps can neither be copied from nor into
+			for(uint32_t page_index = 0; page_index < a_v_com_pool_heaps[heap_pool].size(); ++page_index) {
+				if(a_v_com_pool_heaps[heap_pool][page_index]) {
+					make_pool_heap_resident_now(heap_pool, page_index);
+				}
+			}
+			a_v_moves[heap_pool] = heap_allocator::begin_defragmentation(a_heap_pools[heap_pool], UINT64_MAX);
+			for(auto& move : a_v_moves[heap_pool]) {
+				auto& tex = a_textures[move.user_data];
+				D3D12_RESOURCE_DESC resource_desc = tex.com_resource->GetDesc();
+				ComPtr<ID3D12Resource> com_resource;
+				CHECK_D3D12_CALL(com_device->CreatePlacedResource(get_pool_heap(heap_pool, move.destination.page_index), move.destination.offset, &resource_desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&com_resource)), "");
+
+				D3D12_RESOURCE_BARRIER resource_barrier = {};
+				resource_barrier.Transition.pResource = tex.com_resource.Get();
+				resource_barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+				resource_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+				resource_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_SOURCE;
+				com_command_list->ResourceBarrier(1, &resource_barrier);
+				com_command_list->CopyResource(com_resource.Get(), tex.com_resource.Get());
+				resource_barrier.Transition.pResource = com_resource.Get();
+				resource_barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+				resource_barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+				com_command_list->ResourceBarrier(1, &resource_barrier);
+
+				// Shaders keep using the same descriptor slot, only the view is rewritten
+				v_com_moved_resources.push_back(tex.com_resource);
+				tex.com_resource = com_resource;
+				tex.allocation = move.destination;
+				com_device->CreateShaderResourceView(tex.com_resource.Get(), &tex.srv_desc, srv_desc_heap.get_cpu_handle(tex.srv_descriptor_table_index));
+			}
+		}
+
+		CHECK_D3D12_CALL(com_command_list->Close(), "");
+		ID3D12CommandList* pp_command_lists[] = { com_command_list.Get() };
+		com_command_queue->ExecuteCommandLists(count_of(pp_command_lists), pp_command_lists);
+		wait_for_gpu();
+
+		v_com_moved_resources.clear();
+		for(auto heap_pool : { HEAP_POOL_SMALL_TEXTURES, HEAP_POOL_TEXTURES }) {
+			release_pool_heaps(heap_pool, heap_allocator::end_defragmentation(a_heap_pools[heap_pool], a_v_moves[heap_pool]));
+		}
+	}
+
+	void clean_up() {
+		for(auto p_deferred_pso : { &scene_opaque_equal_pso, &depth_prepass_pso, &depth_prepass_masked_pso }) {
+			p_deferred_pso->wait();
+		}
+		for(auto& permutation_psos : a_permutation_psos) {
+			for(auto& deferred_pso : permutation_psos) {
+				deferred_pso.wait();
+			}
+		}
+		if(pso_cache.is_dirty) {
+			pipeline_cache::save(pipeline_cache_file_address, pso_cache);
+		}
+		CloseHandle(h_frame_latency_waitable);
 	}
 
 	void present() {
 		CHECK_DXGI_CALL(com_swap_chain->Present(1, 0));
 	}
 
+	// Returns once the swap chain would take another frame without queuing it behind more than max_frame_latency others.
+	// Waiting here before sampling input keeps the input of a frame as fresh as the queue allows; false when it timed out.
+	bool wait_for_frame_latency(DWORD timeout_ms) {
+		return WaitForSingleObjectEx(h_frame_latency_waitable, timeout_ms, TRUE) == WAIT_OBJECT_0;
+	}
+
 	bool resize(LPARAM lparam) {
 		if(com_swap_chain) {
 			back_buffer_width = (UINT)LOWORD(lparam);
@@ -1158,20 +2174,21 @@ namespace renderer {
 			create_render_buffer(a_back_buffers[1], &rtv_desc_heap, nullptr, "back_buffer_1", 1);
 			create_render_buffer(a_back_buffers[2], &rtv_desc_heap, nullptr, "back_buffer_2", 2);
 
+			for(auto p_render_buffer : { &hdr_buffer_resolved, &hdr_buffer, &depth_buffer }) {
+				p_render_buffer->com_resource.Reset();
+				p_render_buffer->width = back_buffer_width;
+				p_render_buffer->height = back_buffer_height;
+			}
+			uint32_t page_index = frame_graph_allocation.page_index;
+			if(heap_allocator::deallocate(a_heap_pools[HEAP_POOL_RENDER_TARGETS], frame_graph_allocation)) {
+				release_pool_heaps(HEAP_POOL_RENDER_TARGETS, { page_index });
+			}
+			create_frame_graph();
+
 			if constexpr(is_msaa_enabled) {
-				hdr_buffer_resolved.com_resource.Reset();
-				hdr_buffer_resolved.width = back_buffer_width;
-				hdr_buffer_resolved.height = back_buffer_height;
-				create_render_buffer(hdr_buffer_resolved, &rtv_desc_heap, &source_srv_desc_heap, "hdr_buffer_resolved", 3, 0);
+				create_render_buffer(hdr_buffer_resolved, &rtv_desc_heap, &srv_desc_heap, "hdr_buffer_resolved", 3, hdr_buffer_resolved.srv_descriptor_table_index);
 			}
-			hdr_buffer.com_resource.Reset();
-			hdr_buffer.width = back_buffer_width;
-			hdr_buffer.height = back_buffer_height;
-			create_render_buffer(hdr_buffer, &rtv_desc_heap, &source_srv_desc_heap, "hdr_buffer", is_msaa_enabled ? 4 : 3, 1);
-			
-			depth_buffer.com_resource.Reset();
-			depth_buffer.width = back_buffer_width;
-			depth_buffer.height = back_buffer_height;
+			create_render_buffer(hdr_buffer, &rtv_desc_heap, &srv_desc_heap, "hdr_buffer", is_msaa_enabled ? 4 : 3, hdr_buffer.srv_descriptor_table_index);
 			create_depth_buffer(depth_buffer, &dsv_desc_heap, "depth_buffer", 0);
 
 			return true;
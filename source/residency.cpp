@@ -0,0 +1,137 @@
+namespace residency
+{
+	// LRU residency policy over pageable objects, which are the heaps of the pools for the renderer.
+	// Every frame the renderer marks the pageables it is going to use, update() then says which ones have to be made resident
+	// and which least recently used ones to evict so that the resident ones fit into the budget.
+	// Nothing here touches the device, so the policy can be run against any budget.
+	constexpr uint32_t invalid_index{ UINT32_MAX };
+
+	struct Pageable {
+		uint64_t size;
+		uint64_t last_used_frame;
+		bool is_registered;
+		bool is_resident;
+		bool is_evictable;
+	};
+
+	struct Manager {
+		vector<Pageable> v_pageables;
+		vector<uint32_t> v_unused_pageable_indices;
+		uint64_t current_frame;
+		// The GPU may still be using what the last frames used, those are never evicted
+		uint32_t num_frames_in_flight;
+		uint64_t resident_size;
+		uint64_t registered_size;
+		uint64_t num_evictions;
+		uint64_t num_make_residents;
+	};
+
+	struct Decisions {
+		vector<uint32_t> v_make_resident_indices;
+		vector<uint32_t> v_evict_indices;
+	};
+
+	void init(Manager &manager, uint32_t num_frames_in_flight) {
+		manager = {};
+		manager.num_frames_in_flight = num_frames_in_flight;
+	}
+
+	// Pageables are resident and count as used when they are created
+	uint32_t add_pageable(Manager &manager, uint64_t size, bool is_evictable) {
+		uint32_t pageable_index;
+		if(!manager.v_unused_pageable_indices.empty()) {
+			pageable_index = manager.v_unused_pageable_indices.back();
+			manager.v_unused_pageable_indices.pop_back();
+		}
+		else {
+			pageable_index = static_cast<uint32_t>(manager.v_pageables.size());
+			manager.v_pageables.push_back({});
+		}
+		manager.v_pageables[pageable_index] = { size, manager.current_frame, true, true, is_evictable };
+		manager.resident_size += size;
+		manager.registered_size += size;
+		return pageable_index;
+	}
+
+	void remove_pageable(Manager &manager, uint32_t pageable_index) {
+		auto& pageable = manager.v_pageables[pageable_index];
+		if(pageable.is_resident) {
+			manager.resident_size -= pageable.size;
+		}
+		manager.registered_size -= pageable.size;
+		pageable = {};
+		manager.v_unused_pageable_indices.push_back(pageable_index);
+	}
+
+	void set_evictable(Manager &manager, uint32_t pageable_index, bool is_evictable) {
+		manager.v_pageables[pageable_index].is_evictable = is_evictable;
+	}
+
+	void mark_used(Manager &manager, uint32_t pageable_index) {
+		manager.v_pageables[pageable_index].last_used_frame = manager.current_frame;
+	}
+
+	// For uses outside of the frame, returns true when the pageable was evicted and the caller has to make it resident right away
+	bool mark_used_now(Manager &manager, uint32_t pageable_index) {
+		auto& pageable = manager.v_pageables[pageable_index];
+		pageable.last_used_frame = manager.current_frame;
+		if(pageable.is_resident) {
+			return false;
+		}
+		pageable.is_resident = true;
+		manager.resident_size += pageable.size;
+		manager.num_make_residents++;
+		return true;
+	}
+
+	// Called once per frame after everything the frame uses has been marked, budget is the memory the pageables may occupy.
+	// What the frame uses is always made resident, even if that alone does not fit into the budget.
+	Decisions update(Manager &manager, uint64_t budget) {
+		Decisions decisions;
+		vector<uint32_t> v_eviction_candidates;
+		for(uint32_t pageable_index = 0; pageable_index < manager.v_pageables.size(); ++pageable_index) {
+			auto& pageable = manager.v_pageables[pageable_index];
+			if(!pageable.is_registered) { continue; }
+
+			if(!pageable.is_resident && pageable.last_used_frame == manager.current_frame) {
+				pageable.is_resident = true;
+				manager.resident_size += pageable.size;
+				manager.num_make_residents++;
+				decisions.v_make_resident_indices.push_back(pageable_index);
+			}
+			else if(pageable.is_resident && pageable.is_evictable && pageable.last_used_frame + manager.num_frames_in_flight <= manager.current_frame) {
+				v_eviction_candidates.push_back(pageable_index);
+			}
+		}
+
+		if(manager.resident_size > budget) {
+			sort(v_eviction_candidates.begin(), v_eviction_candidates.end(), [&](uint32_t a, uint32_t b) {
+				return manager.v_pageables[a].last_used_frame < manager.v_pageables[b].last_used_frame;
+			});
+			for(uint32_t pageable_index : v_eviction_candidates) {
+				if(manager.resident_size <= budget) { break; }
+				auto& pageable = manager.v_pageables[pageable_index];
+				pageable.is_resident = false;
+				manager.resident_size -= pageable.size;
+				manager.num_evictions++;
+				decisions.v_evict_indices.push_back(pageable_index);
+			}
+		}
+		manager.current_frame++;
+		return decisions;
+	}
+
+	ResidencyStatistics get_statistics(const Manager &manager) {
+		ResidencyStatistics statistics = {};
+		for(auto& pageable : manager.v_pageables) {
+			if(!pageable.is_registered) { continue; }
+			statistics.num_pageables++;
+			statistics.num_resident_pageables += pageable.is_resident ? 1 : 0;
+		}
+		statistics.resident_size = manager.resident_size;
+		statistics.registered_size = manager.registered_size;
+		statistics.num_evictions = manager.num_evictions;
+		statistics.num_make_residents = manager.num_make_residents;
+		return statistics;
+	}
+}
@@ -9,7 +9,28 @@ namespace scene_manager
 		BoundingBox bbox;
 		uint32_t first_index;
 		uint32_t index_count;
+		int32_t base_vertex;
 		uint32_t material_index;
+		// Range of the scene's LODs, the first of them is the primitive itself
+		uint32_t first_lod;
+		uint32_t lod_count;
+	};
+
+	// Index range of a level of detail of a primitive and its error, relative to the diagonal of the primitive's bounds, and the
+	// scene's meshlets that split the range
+	struct MeshLod {
+		uint32_t first_index;
+		uint32_t index_count;
+		float error;
+		uint32_t first_meshlet;
+		uint32_t meshlet_count;
+	};
+
+	// Indices of every primitive of a scene, relative to the base vertex of their primitive and as narrow as the largest primitive allows
+	struct IndexBuffer {
+		vector<uint8_t> v_data;
+		uint32_t index_size;
+		uint32_t index_count;
 	};
 
 	struct Node {
@@ -58,6 +79,25 @@ namespace scene_manager
 		}
 	}
 
+	// Transforms an object space box with a post-multiplied (M * v) world matrix, returns a world space center/extents pair
+	inline void transform_bounding_box(const BoundingBox &bbox, const XMFLOAT4X4 &world_from_object, XMFLOAT3 &center_ws, XMFLOAT3 &extents_ws) {
+		XMMATRIX xm_world_from_object = XMMatrixTranspose(XMLoadFloat4x4(&world_from_object));
+		XMVECTOR xm_min = XMLoadFloat3(&bbox.min);
+		XMVECTOR xm_max = XMLoadFloat3(&bbox.max);
+		XMVECTOR xm_center = XMVector3Transform((xm_min + xm_max) * 0.5f, xm_world_from_object);
+		XMVECTOR xm_extents = (xm_max - xm_min) * 0.5f;
+
+		XMMATRIX xm_abs_rotation;
+		xm_abs_rotation.r[0] = XMVectorAbs(xm_world_from_object.r[0]);
+		xm_abs_rotation.r[1] = XMVectorAbs(xm_world_from_object.r[1]);
+		xm_abs_rotation.r[2] = XMVectorAbs(xm_world_from_object.r[2]);
+		xm_abs_rotation.r[3] = XMVectorZero();
+		xm_extents = XMVector3TransformNormal(xm_extents, xm_abs_rotation);
+
+		XMStoreFloat3(&center_ws, xm_center);
+		XMStoreFloat3(&extents_ws, xm_extents);
+	}
+
 	inline XMMATRIX Node::get_local_transform() {
 		return XMMatrixTranspose(XMMatrixTranslationFromVector(xm_translation)) * XMMatrixTranspose(XMMatrixRotationQuaternion(xm_rotation)) * XMMatrixScalingFromVector(xm_scale) * xm_transform;
 	}
@@ -91,18 +131,31 @@ namespace scene_manager
 		XMMATRIX global_transform;
 		vector<DrawInfo> opaque_draw_info_list;
 		vector<DrawInfo> alpha_blend_draw_info_list;
+		vector<uint32_t> instance_transform_indices;
 		vector<Material> materials;
 		vector<XMFLOAT4X4> node_transformations;
 		vector<Node*> nodes;
 		vector<Node*> linear_nodes;
 		BoundingBox bbox;
-		uint32_t start_index_into_textures;
-		uint32_t num_used_textures;
-
-		Scene() {
+		occlusion_culler::OccluderMesh occluder_mesh;
+		vector<MeshLod> v_lods;
+		// Triangles of the scene's primitives at every level, those with fewer LODs counted at their coarsest
+		uint32_t num_lod_levels;
+		uint32_t a_num_lod_triangles[max_lod_count];
+		float lod_build_ms;
+		// Index ranges relative to their LOD's first index
+		vector<meshlet_builder::Meshlet> v_meshlets;
+		float meshlet_build_ms;
+		vector<bool> v_is_material_double_sided;
+		// Renderer texture of every packed texture of the scene, scenes share textures made from the same content
+		vector<uint32_t> v_tex_indices;
+		float load_ms;
+		bool is_mapped;
+		// Images the load decoded, those of textures found in the texture cache are not decoded
+		vector<ImageDecodeTiming> v_image_decode_timings;
+
+		Scene() : num_lod_levels{ 0 }, a_num_lod_triangles{}, lod_build_ms{ 0.f }, meshlet_build_ms{ 0.f } {
 			global_transform = XMMatrixIdentity();
-			start_index_into_textures = 0;
-			num_used_textures = 0;
 			bbox.min.x = bbox.min.y = bbox.min.z = FLT_MAX;
 			bbox.max.x = bbox.max.y = bbox.max.z = -FLT_MAX;
 		};
@@ -126,38 +179,59 @@ namespace scene_manager
 		}
 	}
 	
+	// Speed the camera approaches while a movement key is held and how quickly it gets there or comes to rest, per 1/60 s
+	constexpr float camera_move_speed_mps{ 40.f * .06f };
+	constexpr float camera_acceleration_damping{ 0.6f };
+	constexpr float camera_deceleration_damping{ 0.8f };
+
+	// Camera movement advances in the fixed steps of simulation_clock, camera.pos_ws is interpolated between its last two steps
+	struct CameraMotion {
+		XMFLOAT3 velocity_vs;
+		XMFLOAT3 previous_pos_ws;
+		XMFLOAT3 pos_ws;
+	};
+
+	struct ModelSceneDesc {
+		const char *p_asset_filename;
+		bool flip_forward;
+	};
+
+	const ModelSceneDesc a_model_scene_descs[] = {
+		{ "cvc_helmet/scene.gltf", true },
+		{ "damaged_helmet/damagedHelmet.gltf", true },
+		{ "pony_cartoon/scene.gltf", false },
+		{ "vintage_suitcase/scene.gltf", false },
+	};
+	static_assert(count_of(a_model_scene_descs) == model_scene_count, "The gui lists model_scene_count scenes");
+
 	vector<unique_ptr<Scene>> scenes{};
+	texture_cache::Cache processed_texture_cache;
 	Camera camera;
+	CameraMotion camera_motion;
+	frame_timing::Clock simulation_clock;
 	uint32_t current_scene_index = 0;
+	occlusion_culler::Culler occlusion_culler_state;
+	// Opaque primitives largest first are occluders until the next one would go over this
+	constexpr uint32_t max_occluder_triangle_count{ 100000 };
 	
-	void load_texture(tinygltf::Image &image, bool is_srgb, uint32_t &tex_index) {
-		size_t image_size = 0;
-		uint8_t *p_image_data = nullptr;
-		{
-			if(image.component == 3) {
-				image_size = image.width * image.height * 4;
-				p_image_data = new uint8_t[image_size];
-				uint8_t* p_rgba = p_image_data;
-				uint8_t* p_rgb = &image.image[0];
-				for(size_t i = 0; i < image.width * image.height; ++i) {
-					p_rgba[0] = p_rgb[0];
-					p_rgba[1] = p_rgb[1];
-					p_rgba[2] = p_rgb[2];
-					p_rgba[3] = 255;
-					p_rgba += 4;
-					p_rgb += 3;
-				}
-			}
-			else {
-				p_image_data = &image.image[0];
-				image_size = image.image.size();
-			}
+	// Reads channel of a pixel of an 8-bit glTF image as if it had rgba channels, grey images repeat their value in rgb
+	uint8_t get_channel(const uint8_t *p_pixels, int component, size_t pixel_index, int channel) {
+		switch(component) {
+			case 1: return (channel < 3) ? p_pixels[pixel_index] : 255;
+			case 2: return p_pixels[pixel_index * 2 + ((channel < 3) ? 0 : 1)];
+			case 3: return (channel < 3) ? p_pixels[pixel_index * 3 + channel] : 255;
+			default: return p_pixels[pixel_index * 4 + channel];
 		}
+	}
+
+	// Generates the mip chain of square power of 2 rgba images right after the pixels in v_image_data, uploads them and stores them in the texture cache.
+	// No copy is made when v_image_data already reserved gltf_loader::get_mip_chain_size(), only the pixels are left in it afterwards.
+	void load_texture(const string &name, int width, int height, vector<uint8_t> &v_image_data, bool is_srgb, uint64_t cache_key, uint32_t &tex_index) {
+		size_t image_size = size_t(width) * height * 4;
 
 		// Mipmap generation!
 		int mip_levels = 1;
 		size_t image_with_mips_size = image_size;
-		uint8_t *p_image_with_mips_data = p_image_data;
 		if(is_mipchain_generation_enabled)
 		{
 			auto is_power_of_2 = [](int value, int &power) {
@@ -178,15 +252,13 @@ namespace scene_manager
 
 			// For now only deal with square images with power of 2 width!
 			int power = 0;
-			if((image.width == image.height) && is_power_of_2(image.width, power)) {
-				int size = image.width;
+			if((width == height) && is_power_of_2(width, power)) {
+				int size = width;
 				mip_levels = power + 1;
 				const int pixel_size = 4;
-				unsigned char *p_input = p_image_data;
-				unsigned char *p_output = reinterpret_cast<unsigned char *>(malloc(size*(size >> 1) * 3 * pixel_size));
-				memcpy(p_output, p_input, image_size);
-				p_image_with_mips_data = p_output;
-				p_output += image_size;
+				v_image_data.resize(gltf_loader::get_mip_chain_size(width, height));
+				const unsigned char *p_input = v_image_data.data();
+				unsigned char *p_output = v_image_data.data() + image_size;
 
 				int success = 1;
 				while((size > 1) && success) {
@@ -206,16 +278,14 @@ namespace scene_manager
 
 				if(!success) {
 					mip_levels = 1;
-					free(p_image_with_mips_data);
-					p_image_with_mips_data = p_image_data;
 					image_with_mips_size = image_size;
 				}
 			}
 		}
 
 		OctarineImageHeader header = {};
-		header.width = image.width;
-		header.height = image.height;
+		header.width = width;
+		header.height = height;
 		header.depth = 1;
 		header.array_size = 1;
 		header.format = octarine_image_make_format_from_dxgi_format(is_srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM);
@@ -223,68 +293,251 @@ namespace scene_manager
 		header.size_of_data = image_with_mips_size;
 		header.flags = 0;
 
-		renderer::load_texture(header, image.name, p_image_with_mips_data, tex_index);
-		if(is_mipchain_generation_enabled) {
-			free(p_image_with_mips_data);
-		}
-
-		if(image.component == 3) delete[](p_image_data);
+		renderer::load_texture(header, name, v_image_data.data(), tex_index);
+		texture_cache::store_file(processed_texture_cache, cache_key, header, v_image_data.data());
+		v_image_data.resize(image_size);
 	}
 
-	void load_textures(tinygltf::Model &gltf_model, Scene& scene) {
+	enum PackedTextureUsage : uint32_t {
+		PACKED_TEXTURE_USAGE_COLOR,
+		PACKED_TEXTURE_USAGE_NORMAL,
+		PACKED_TEXTURE_USAGE_ORM
+	};
 
-		vector<int> srgb_image_indices;
-		srgb_image_indices.reserve(gltf_model.images.size());
+	// A texture of the scene built out of unique glTF images. Color and normal textures are copies of image_index.
+	// ORM textures take occlusion from the red channel of occlusion_image_index and roughness/metallic from the green/blue channels of image_index,
+	// a missing image leaves its channels at 255 so that the material factors alone apply.
+	struct PackedTexture {
+		PackedTextureUsage usage;
+		int image_index;
+		int occlusion_image_index;
 
-		for(auto &material : gltf_model.materials) {
-			auto it = material.values.find("baseColorTexture");
-			if(it != material.values.end()) {
-				srgb_image_indices.push_back(gltf_model.textures[it->second.TextureIndex()].source);
+		bool operator<(const PackedTexture &other) const {
+			return tie(usage, image_index, occlusion_image_index) < tie(other.usage, other.image_index, other.occlusion_image_index);
+		}
+	};
+
+	// Packed texture indices of a material, -1 when absent
+	struct MaterialTextures {
+		int base_color;
+		int normal;
+		int orm;
+		int emissive;
+		bool has_occlusion;
+	};
+
+	// FNV-1a over 64-bit words, every image is hashed on load so a bytewise hash would be too slow
+	uint64_t hash_image_data(const uint8_t *p_data, size_t size) {
+		uint64_t hash = 0xcbf29ce484222325ull;
+		size_t num_words = size / sizeof(uint64_t);
+		for(size_t word_index = 0; word_index < num_words; ++word_index) {
+			uint64_t word;
+			memcpy(&word, p_data + word_index * sizeof(uint64_t), sizeof(uint64_t));
+			hash = (hash ^ word) * 0x100000001b3ull;
+		}
+		for(size_t byte_index = num_words * sizeof(uint64_t); byte_index < size; ++byte_index) {
+			hash = (hash ^ p_data[byte_index]) * 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	// Images are identified by their encoded bytes so that nothing has to be decoded to find duplicates or cached textures.
+	// Maps every glTF image to the first image with the same encoded bytes, hash matches are confirmed bytewise.
+	vector<int> get_unique_image_indices(const gltf_loader::Document &document, vector<uint64_t> &v_image_hashes) {
+		size_t num_images = document.model.images.size();
+		vector<int> v_unique_image_indices(num_images);
+		v_image_hashes.resize(num_images);
+		map<uint64_t, vector<int>> image_indices_by_hash;
+		for(int image_index = 0; image_index < static_cast<int>(num_images); ++image_index) {
+			const auto& encoded_image = document.v_encoded_images[image_index];
+			uint64_t hash = hash_image_data(encoded_image.p_data, encoded_image.size);
+			v_image_hashes[image_index] = hash;
+
+			v_unique_image_indices[image_index] = image_index;
+			auto& v_candidate_indices = image_indices_by_hash[hash];
+			for(int candidate_index : v_candidate_indices) {
+				const auto& candidate = document.v_encoded_images[candidate_index];
+				if(candidate.size == encoded_image.size && memcmp(candidate.p_data, encoded_image.p_data, encoded_image.size) == 0) {
+					v_unique_image_indices[image_index] = candidate_index;
+					break;
+				}
 			}
-			it = material.additionalValues.find("emissiveTexture");
-			if(it != material.additionalValues.end()) {
-				srgb_image_indices.push_back(gltf_model.textures[it->second.TextureIndex()].source);
+			if(v_unique_image_indices[image_index] == image_index) {
+				v_candidate_indices.push_back(image_index);
 			}
 		}
+		return v_unique_image_indices;
+	}
 
-		auto is_srgb = [&](int image_index) {
-			return find(srgb_image_indices.begin(), srgb_image_indices.end(), image_index) != srgb_image_indices.end();
-		};
+	// Everything that decides the content of a packed texture, missing images hash to 0
+	uint64_t get_cache_key(const PackedTexture &packed_texture, const vector<uint64_t> &v_image_hashes) {
+		uint64_t key = pipeline_cache::hash_value(pipeline_cache::fnv_offset_basis, texture_cache::key_version);
+		key = pipeline_cache::hash_value(key, packed_texture.usage);
+		key = pipeline_cache::hash_value(key, (packed_texture.image_index >= 0) ? v_image_hashes[packed_texture.image_index] : 0ull);
+		key = pipeline_cache::hash_value(key, (packed_texture.occlusion_image_index >= 0) ? v_image_hashes[packed_texture.occlusion_image_index] : 0ull);
+		key = pipeline_cache::hash_value(key, is_mipchain_generation_enabled);
+		return key;
+	}
 
-		uint32_t image_count{ 0 };
-		uint32_t last_tex_index{ 0 };
-		for(auto &image : gltf_model.images) {
-			load_texture(image, is_srgb(image_count++), last_tex_index);
+	// Color and normal textures of rgba images generate their mips in the decoded image itself, the rest is packed into a new rgba image first
+	void load_packed_texture(tinygltf::Model &gltf_model, const PackedTexture &packed_texture, uint64_t cache_key, uint32_t &tex_index) {
+		tinygltf::Image *p_image = (packed_texture.image_index >= 0) ? &gltf_model.images[packed_texture.image_index] : nullptr;
+		const tinygltf::Image *p_occlusion_image = (packed_texture.occlusion_image_index >= 0) ? &gltf_model.images[packed_texture.occlusion_image_index] : nullptr;
+		const tinygltf::Image &size_image = p_image ? *p_image : *p_occlusion_image;
+		int width = size_image.width;
+		int height = size_image.height;
+		size_t num_pixels = size_t(width) * height;
+
+		bool is_srgb = packed_texture.usage == PACKED_TEXTURE_USAGE_COLOR;
+		if(packed_texture.usage != PACKED_TEXTURE_USAGE_ORM && p_image->component == 4) {
+			load_texture(p_image->name, width, height, p_image->image, is_srgb, cache_key, tex_index);
+			return;
 		}
-		assert(last_tex_index >= image_count);
-		scene.start_index_into_textures = last_tex_index - image_count + 1;
-		scene.num_used_textures = image_count;
+
+		vector<uint8_t> v_rgba;
+		v_rgba.reserve(gltf_loader::get_mip_chain_size(width, height));
+		v_rgba.resize(num_pixels * 4);
+		if(packed_texture.usage != PACKED_TEXTURE_USAGE_ORM) {
+			for(size_t pixel_index = 0; pixel_index < num_pixels; ++pixel_index) {
+				for(int channel = 0; channel < 4; ++channel) {
+					v_rgba[pixel_index * 4 + channel] = get_channel(p_image->image.data(), p_image->component, pixel_index, channel);
+				}
+			}
+			load_texture(p_image->name, width, height, v_rgba, is_srgb, cache_key, tex_index);
+			return;
+		}
+
+		// Occlusion is resampled when its image does not match the metallic roughness one
+		const uint8_t *p_occlusion_pixels = p_occlusion_image ? p_occlusion_image->image.data() : nullptr;
+		vector<uint8_t> v_resized_occlusion;
+		if(p_occlusion_image && (p_occlusion_image->width != width || p_occlusion_image->height != height)) {
+			v_resized_occlusion.resize(num_pixels * p_occlusion_image->component);
+			stbir_resize_uint8(p_occlusion_pixels, p_occlusion_image->width, p_occlusion_image->height, 0, v_resized_occlusion.data(), width, height, 0, p_occlusion_image->component);
+			p_occlusion_pixels = v_resized_occlusion.data();
+		}
+		for(size_t pixel_index = 0; pixel_index < num_pixels; ++pixel_index) {
+			uint8_t *p_pixel = &v_rgba[pixel_index * 4];
+			p_pixel[0] = p_occlusion_pixels ? get_channel(p_occlusion_pixels, p_occlusion_image->component, pixel_index, 0) : 255;
+			p_pixel[1] = p_image ? get_channel(p_image->image.data(), p_image->component, pixel_index, 1) : 255;
+			p_pixel[2] = p_image ? get_channel(p_image->image.data(), p_image->component, pixel_index, 2) : 255;
+			p_pixel[3] = 255;
+		}
+		load_texture(size_image.name + "_orm", width, height, v_rgba, false, cache_key, tex_index);
 	}
 
-	void load_materials(const tinygltf::Model &gltf_model, Scene &scene) {
+	// What prepare_textures() leaves for upload_textures(): the distinct textures of a scene and where each one comes from
+	struct TexturePreparation {
+		vector<PackedTexture> v_packed_textures;
+		vector<uint64_t> v_cache_keys;
+		vector<uint32_t> v_missed_texture_indices;
+		vector<pair<uint32_t, image_stream::Stream>> v_cached_textures;
+	};
 
-		for(auto &mat : gltf_model.materials) {
-			Material material;
+	// Packs occlusion, roughness and metallic into ORM textures and finds every distinct texture the materials use.
+	// Only the images of textures that are neither loaded by an earlier scene nor in the texture cache folder are decoded.
+	// Cached files are opened before decoding starts, so they are paged in while the images of the other textures decode.
+	// Touches neither the device nor anything but this scene and the texture cache, so it runs as a job beside the geometry.
+	void prepare_textures(gltf_loader::Document &document, Scene& scene, vector<MaterialTextures> &v_material_textures, TexturePreparation &preparation) {
+		tinygltf::Model &gltf_model = document.model;
+		vector<uint64_t> v_image_hashes;
+		vector<int> v_unique_image_indices = get_unique_image_indices(document, v_image_hashes);
+		auto get_image_index = [&](const tinygltf::ParameterMap &values, const char *p_name) {
+			auto it = values.find(p_name);
+			return (it == values.end()) ? -1 : v_unique_image_indices[gltf_model.textures[it->second.TextureIndex()].source];
+		};
 
-			if(auto it = mat.values.find("baseColorTexture"); it != mat.values.end()) {
-				material.base_color_texture_index = it->second.TextureIndex();
+		auto& v_packed_textures = preparation.v_packed_textures;
+		map<PackedTexture, int> packed_texture_indices;
+		auto get_packed_texture_index = [&](const PackedTexture &packed_texture) {
+			if(packed_texture.image_index < 0 && packed_texture.occlusion_image_index < 0) {
+				return -1;
 			}
-
-			if(auto it = mat.additionalValues.find("normalTexture"); it != mat.additionalValues.end()) {
-				material.normal_texture_index = it->second.TextureIndex();
+			auto [it, is_inserted] = packed_texture_indices.try_emplace(packed_texture, static_cast<int>(v_packed_textures.size()));
+			if(is_inserted) {
+				v_packed_textures.push_back(packed_texture);
 			}
+			return it->second;
+		};
+
+		for(auto &material : gltf_model.materials) {
+			int occlusion_image_index = get_image_index(material.additionalValues, "occlusionTexture");
+			MaterialTextures material_textures;
+			material_textures.base_color = get_packed_texture_index({ PACKED_TEXTURE_USAGE_COLOR, get_image_index(material.values, "baseColorTexture"), -1 });
+			material_textures.normal = get_packed_texture_index({ PACKED_TEXTURE_USAGE_NORMAL, get_image_index(material.additionalValues, "normalTexture"), -1 });
+			material_textures.orm = get_packed_texture_index({ PACKED_TEXTURE_USAGE_ORM, get_image_index(material.values, "metallicRoughnessTexture"), occlusion_image_index });
+			material_textures.emissive = get_packed_texture_index({ PACKED_TEXTURE_USAGE_COLOR, get_image_index(material.additionalValues, "emissiveTexture"), -1 });
+			material_textures.has_occlusion = occlusion_image_index >= 0;
+			v_material_textures.push_back(material_textures);
+		}
 
-			if(auto it = mat.additionalValues.find("occlusionTexture"); it != mat.additionalValues.end()) {
-				material.occlusion_texture_index = it->second.TextureIndex();
+		auto& v_cache_keys = preparation.v_cache_keys;
+		auto& v_missed_texture_indices = preparation.v_missed_texture_indices;
+		auto& v_cached_textures = preparation.v_cached_textures;
+		vector<bool> v_is_image_needed(gltf_model.images.size(), false);
+		scene.v_tex_indices.resize(v_packed_textures.size());
+		for(uint32_t texture_index = 0; texture_index < v_packed_textures.size(); ++texture_index) {
+			const auto& packed_texture = v_packed_textures[texture_index];
+			uint64_t cache_key = get_cache_key(packed_texture, v_image_hashes);
+			v_cache_keys.push_back(cache_key);
+			uint32_t& tex_index = scene.v_tex_indices[texture_index];
+			if(texture_cache::find_texture(processed_texture_cache, cache_key, tex_index)) {
+				continue;
 			}
 
-			if(auto it = mat.values.find("metallicRoughnessTexture"); it != mat.values.end()) {
-				material.metallic_roughness_texture_index = it->second.TextureIndex();
+			string file_address;
+			image_stream::Stream stream;
+			if(texture_cache::find_file(processed_texture_cache, cache_key, file_address) && image_stream::open(file_address, stream)) {
+				v_cached_textures.push_back({ texture_index, stream });
+				continue;
 			}
 
-			if(auto it = mat.additionalValues.find("emissiveTexture"); it != mat.additionalValues.end()) {
-				material.emissive_texture_index = it->second.TextureIndex();
+			v_missed_texture_indices.push_back(texture_index);
+			for(int image_index : { packed_texture.image_index, packed_texture.occlusion_image_index }) {
+				if(image_index >= 0) { v_is_image_needed[image_index] = true; }
 			}
+		}
+		if(!v_missed_texture_indices.empty()) {
+			vector<ImageDecodeTiming> v_image_decode_timings;
+			gltf_loader::decode_images(document, v_image_decode_timings, v_is_image_needed);
+			for(uint32_t image_index = 0; image_index < v_image_decode_timings.size(); ++image_index) {
+				if(v_is_image_needed[image_index]) {
+					scene.v_image_decode_timings.push_back(v_image_decode_timings[image_index]);
+				}
+			}
+		}
+	}
+
+	// Uploads what prepare_textures() found, on the thread that owns the device
+	void upload_textures(tinygltf::Model &gltf_model, Scene& scene, TexturePreparation &preparation) {
+		auto& [v_packed_textures, v_cache_keys, v_missed_texture_indices, v_cached_textures] = preparation;
+		auto& statistics = processed_texture_cache.statistics;
+		for(auto& [texture_index, stream] : v_cached_textures) {
+			const auto& packed_texture = v_packed_textures[texture_index];
+			const auto& name_image = gltf_model.images[(packed_texture.image_index >= 0) ? packed_texture.image_index : packed_texture.occlusion_image_index];
+			uint32_t& tex_index = scene.v_tex_indices[texture_index];
+			renderer::load_texture(stream, (packed_texture.usage == PACKED_TEXTURE_USAGE_ORM) ? name_image.name + "_orm" : name_image.name, tex_index);
+			image_stream::close(stream);
+			texture_cache::add_texture(processed_texture_cache, v_cache_keys[texture_index], tex_index);
+			statistics.num_disk_hits++;
+		}
+		for(uint32_t texture_index : v_missed_texture_indices) {
+			uint32_t& tex_index = scene.v_tex_indices[texture_index];
+			load_packed_texture(gltf_model, v_packed_textures[texture_index], v_cache_keys[texture_index], tex_index);
+			texture_cache::add_texture(processed_texture_cache, v_cache_keys[texture_index], tex_index);
+			statistics.num_misses++;
+		}
+	}
+
+	// Texture indices are turned into slots of the bindless srv heap so that materials of every scene can be indexed directly
+	void load_materials(const tinygltf::Model &gltf_model, Scene &scene, const vector<MaterialTextures> &v_material_textures) {
+		auto get_descriptor_index = [&](int texture_index) {
+			return (texture_index < 0) ? -1 : static_cast<int>(renderer::get_texture_descriptor_index(scene.v_tex_indices[texture_index]));
+		};
+
+		for(size_t material_index = 0; material_index < gltf_model.materials.size(); ++material_index) {
+			const auto &mat = gltf_model.materials[material_index];
+			const auto &material_textures = v_material_textures[material_index];
+			Material material;
 
 			if(auto it = mat.values.find("roughnessFactor"); it != mat.values.end()) {
 				material.roughness_factor = static_cast<float>(it->second.Factor());
@@ -312,11 +565,243 @@ namespace scene_manager
 				material.alpha_cutoff = static_cast<float>(it->second.Factor());
 			}
 
+			// Occlusion shares the ORM texture with metallic and roughness
+			material.base_color_texture_index = get_descriptor_index(material_textures.base_color);
+			material.normal_texture_index = get_descriptor_index(material_textures.normal);
+			material.metallic_roughness_texture_index = get_descriptor_index(material_textures.orm);
+			material.occlusion_texture_index = material_textures.has_occlusion ? material.metallic_roughness_texture_index : -1;
+			material.emissive_texture_index = get_descriptor_index(material_textures.emissive);
+
+			// Occlusion comes with the ORM texture so it does not select a permutation of its own, blended materials need no mask
+			if(material.base_color_texture_index >= 0) { material.shader_permutation |= SHADER_FEATURE_BASE_COLOR_TEXTURE; }
+			if(material.normal_texture_index >= 0) { material.shader_permutation |= SHADER_FEATURE_NORMAL_TEXTURE; }
+			if(material.metallic_roughness_texture_index >= 0) { material.shader_permutation |= SHADER_FEATURE_METALLIC_ROUGHNESS_TEXTURE; }
+			if(material.emissive_texture_index >= 0) { material.shader_permutation |= SHADER_FEATURE_EMISSIVE_TEXTURE; }
+			if(material.alphaMode == Material::ALPHAMODE_MASK) { material.shader_permutation |= SHADER_FEATURE_ALPHA_MASK; }
+			renderer::prepare_shader_permutation(material);
+
 			scene.materials.push_back(material);
+			auto it = mat.additionalValues.find("doubleSided");
+			scene.v_is_material_double_sided.push_back(it != mat.additionalValues.end() && it->second.bool_value);
+		}
+	}
+
+	// 16-bit indices are enough unless a primitive has more vertices than they can address
+	uint32_t get_index_size(const tinygltf::Model &model) {
+		for(auto& mesh : model.meshes) {
+			for(auto& primitive : mesh.primitives) {
+				auto it = primitive.attributes.find("POSITION");
+				if(primitive.indices >= 0 && it != primitive.attributes.end() && model.accessors[it->second].count > 65536) {
+					return sizeof(uint32_t);
+				}
+			}
+		}
+		return sizeof(uint16_t);
+	}
+
+	// Appends count glTF indices straight from the glTF buffer, widening or narrowing them 8 or 16 at a time when the widths differ
+	void copy_indices(const uint8_t *p_src, int component_type, size_t count, IndexBuffer &index_buffer) {
+		size_t dst_offset = index_buffer.v_data.size();
+		index_buffer.v_data.resize(dst_offset + count * index_buffer.index_size);
+		index_buffer.index_count += static_cast<uint32_t>(count);
+		uint8_t *p_dst = index_buffer.v_data.data() + dst_offset;
+		const __m128i zero = _mm_setzero_si128();
+		size_t index = 0;
+
+		if(index_buffer.index_size == sizeof(uint16_t)) {
+			auto p_dst_indices = reinterpret_cast<uint16_t*>(p_dst);
+			switch(component_type) {
+				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+				{
+					memcpy(p_dst, p_src, count * sizeof(uint16_t));
+					index = count;
+				} break;
+				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
+				{
+					for(; index + 16 <= count; index += 16) {
+						__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_src + index));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst_indices + index), _mm_unpacklo_epi8(bytes, zero));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst_indices + index + 8), _mm_unpackhi_epi8(bytes, zero));
+					}
+					for(; index < count; ++index) {
+						p_dst_indices[index] = p_src[index];
+					}
+				} break;
+				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+				{
+					// Every index is below 65536 here, the bias keeps them inside the range of the signed saturating pack
+					auto p_src_indices = reinterpret_cast<const uint32_t*>(p_src);
+					const __m128i bias_32 = _mm_set1_epi32(0x8000);
+					const __m128i bias_16 = _mm_set1_epi16(static_cast<short>(0x8000));
+					for(; index + 8 <= count; index += 8) {
+						__m128i low = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p_src_indices + index)), bias_32);
+						__m128i high = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p_src_indices + index + 4)), bias_32);
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst_indices + index), _mm_xor_si128(_mm_packs_epi32(low, high), bias_16));
+					}
+					for(; index < count; ++index) {
+						p_dst_indices[index] = static_cast<uint16_t>(p_src_indices[index]);
+					}
+				} break;
+				default: throw exception("Index component type not supported!");
+			}
+		}
+		else {
+			auto p_dst_indices = reinterpret_cast<uint32_t*>(p_dst);
+			switch(component_type) {
+				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+				{
+					memcpy(p_dst, p_src, count * sizeof(uint32_t));
+					index = count;
+				} break;
+				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+				{
+					auto p_src_indices = reinterpret_cast<const uint16_t*>(p_src);
+					for(; index + 8 <= count; index += 8) {
+						__m128i shorts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_src_indices + index));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst_indices + index), _mm_unpacklo_epi16(shorts, zero));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst_indices + index + 4), _mm_unpackhi_epi16(shorts, zero));
+					}
+					for(; index < count; ++index) {
+						p_dst_indices[index] = p_src_indices[index];
+					}
+				} break;
+				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
+				{
+					for(; index + 16 <= count; index += 16) {
+						__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_src + index));
+						__m128i low_shorts = _mm_unpacklo_epi8(bytes, zero);
+						__m128i high_shorts = _mm_unpackhi_epi8(bytes, zero);
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst_indices + index), _mm_unpacklo_epi16(low_shorts, zero));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst_indices + index + 4), _mm_unpackhi_epi16(low_shorts, zero));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst_indices + index + 8), _mm_unpacklo_epi16(high_shorts, zero));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(p_dst_indices + index + 12), _mm_unpackhi_epi16(high_shorts, zero));
+					}
+					for(; index < count; ++index) {
+						p_dst_indices[index] = p_src[index];
+					}
+				} break;
+				default: throw exception("Index component type not supported!");
+			}
+		}
+	}
+
+	// Vertex and index range of a primitive without glTF tangents, they are generated once every primitive of the scene is loaded
+	struct TangentGenerationRange {
+		uint32_t first_vertex;
+		uint32_t vertex_count;
+		uint32_t first_index;
+		uint32_t index_count;
+	};
+
+	uint32_t get_index(const IndexBuffer &index_buffer, uint32_t index) {
+		if(index_buffer.index_size == sizeof(uint16_t)) {
+			return reinterpret_cast<const uint16_t*>(index_buffer.v_data.data())[index];
 		}
+		return reinterpret_cast<const uint32_t*>(index_buffer.v_data.data())[index];
 	}
 
-	void load_node(Node *p_parent, const tinygltf::Node &node, uint32_t node_index, const tinygltf::Model &model, vector<uint32_t>& index_buffer, vector<Vertex>& vertex_buffer, Scene& scene) {
+	void set_index(IndexBuffer &index_buffer, uint32_t index, uint32_t value) {
+		if(index_buffer.index_size == sizeof(uint16_t)) {
+			reinterpret_cast<uint16_t*>(index_buffer.v_data.data())[index] = static_cast<uint16_t>(value);
+		}
+		else {
+			reinterpret_cast<uint32_t*>(index_buffer.v_data.data())[index] = value;
+		}
+	}
+
+	// MikkTSpace style tangents: the uv gradient of every triangle is projected onto the tangent plane of each corner and accumulated weighted by the corner angle,
+	// the accumulated bitangent only decides the handedness so that mirrored uvs get a flipped w
+	void generate_tangents(const TangentGenerationRange &range, const IndexBuffer &index_buffer, Vertex *p_vertices) {
+		Vertex *p_range_vertices = p_vertices + range.first_vertex;
+		vector<XMFLOAT3> v_bitangents(range.vertex_count, XMFLOAT3(0.f, 0.f, 0.f));
+
+		for(uint32_t index = 0; index + 2 < range.index_count; index += 3) {
+			uint32_t a_corners[3];
+			XMVECTOR a_xm_positions[3];
+			for(uint32_t corner = 0; corner < 3; ++corner) {
+				a_corners[corner] = get_index(index_buffer, range.first_index + index + corner);
+				a_xm_positions[corner] = XMLoadFloat3(&p_range_vertices[a_corners[corner]].pos);
+			}
+			const XMFLOAT2 &uv_0 = p_range_vertices[a_corners[0]].uv;
+			const XMFLOAT2 &uv_1 = p_range_vertices[a_corners[1]].uv;
+			const XMFLOAT2 &uv_2 = p_range_vertices[a_corners[2]].uv;
+			float du_1 = uv_1.x - uv_0.x, dv_1 = uv_1.y - uv_0.y;
+			float du_2 = uv_2.x - uv_0.x, dv_2 = uv_2.y - uv_0.y;
+			float determinant = du_1 * dv_2 - du_2 * dv_1;
+			if(fabsf(determinant) < 1e-12f) { continue; }
+
+			XMVECTOR xm_edge_1 = a_xm_positions[1] - a_xm_positions[0];
+			XMVECTOR xm_edge_2 = a_xm_positions[2] - a_xm_positions[0];
+			if(XMVectorGetX(XMVector3LengthSq(XMVector3Cross(xm_edge_1, xm_edge_2))) < 1e-20f) { continue; }
+			XMVECTOR xm_tangent = (xm_edge_1 * dv_2 - xm_edge_2 * dv_1) / determinant;
+			XMVECTOR xm_bitangent = (xm_edge_2 * du_1 - xm_edge_1 * du_2) / determinant;
+
+			for(uint32_t corner = 0; corner < 3; ++corner) {
+				auto& vertex = p_range_vertices[a_corners[corner]];
+				XMVECTOR xm_normal = XMLoadFloat3(&vertex.normal);
+				XMVECTOR xm_corner_tangent = XMVector3Normalize(xm_tangent - xm_normal * XMVector3Dot(xm_normal, xm_tangent));
+				XMVECTOR xm_corner_bitangent = XMVector3Normalize(xm_bitangent - xm_normal * XMVector3Dot(xm_normal, xm_bitangent));
+				float angle = XMVectorGetX(XMVector3AngleBetweenVectors(a_xm_positions[(corner + 1) % 3] - a_xm_positions[corner], a_xm_positions[(corner + 2) % 3] - a_xm_positions[corner]));
+
+				XMVECTOR xm_sum = XMLoadFloat4(&vertex.tangent) + xm_corner_tangent * angle;
+				XMStoreFloat4(&vertex.tangent, xm_sum);
+				xm_sum = XMLoadFloat3(&v_bitangents[a_corners[corner]]) + xm_corner_bitangent * angle;
+				XMStoreFloat3(&v_bitangents[a_corners[corner]], xm_sum);
+			}
+		}
+
+		for(uint32_t v = 0; v < range.vertex_count; ++v) {
+			auto& vertex = p_range_vertices[v];
+			XMVECTOR xm_normal = XMLoadFloat3(&vertex.normal);
+			XMVECTOR xm_tangent = XMVectorSetW(XMLoadFloat4(&vertex.tangent), 0.f);
+			xm_tangent = xm_tangent - xm_normal * XMVector3Dot(xm_normal, xm_tangent);
+			if(XMVectorGetX(XMVector3LengthSq(xm_tangent)) < 1e-12f) {
+				// Degenerate uvs, any tangent orthogonal to the normal will do
+				XMVECTOR xm_axis = (fabsf(vertex.normal.x) < 0.9f) ? XMVectorSet(1.f, 0.f, 0.f, 0.f) : XMVectorSet(0.f, 1.f, 0.f, 0.f);
+				xm_tangent = XMVector3Cross(xm_normal, xm_axis);
+			}
+			xm_tangent = XMVector3Normalize(xm_tangent);
+			float handedness = (XMVectorGetX(XMVector3Dot(XMVector3Cross(xm_normal, xm_tangent), XMLoadFloat3(&v_bitangents[v]))) < 0.f) ? -1.f : 1.f;
+			XMStoreFloat4(&vertex.tangent, XMVectorSetW(xm_tangent, handedness));
+		}
+	}
+
+	// Ranges write disjoint vertices, consecutive ranges are grouped into chunks of similar vertex counts and the last chunk runs on the calling thread
+	void generate_tangents(const vector<TangentGenerationRange> &v_ranges, const IndexBuffer &index_buffer, vector<Vertex> &vertex_buffer) {
+		size_t num_vertices = 0;
+		for(auto& range : v_ranges) {
+			num_vertices += range.vertex_count;
+		}
+		size_t num_chunks = (num_vertices + min_vertex_count_per_tangent_thread - 1) / min_vertex_count_per_tangent_thread;
+		num_chunks = max(size_t(1), min(num_chunks, size_t(job_system::get_worker_count())));
+		size_t chunk_vertex_count = (num_vertices + num_chunks - 1) / num_chunks;
+
+		job_system::Counter counter;
+		size_t first_range = 0;
+		while(first_range < v_ranges.size()) {
+			size_t end_range = first_range;
+			size_t num_chunk_vertices = 0;
+			while(end_range < v_ranges.size() && num_chunk_vertices < chunk_vertex_count) {
+				num_chunk_vertices += v_ranges[end_range++].vertex_count;
+			}
+			auto generate_chunk = [&v_ranges, &index_buffer, &vertex_buffer, first_range, end_range]() {
+				for(size_t range_index = first_range; range_index < end_range; ++range_index) {
+					generate_tangents(v_ranges[range_index], index_buffer, vertex_buffer.data());
+				}
+			};
+			if(end_range == v_ranges.size()) {
+				generate_chunk();
+			}
+			else {
+				job_system::run(generate_chunk, counter);
+			}
+			first_range = end_range;
+		}
+		job_system::wait(counter);
+	}
+
+	void load_node(Node *p_parent, const tinygltf::Node &node, uint32_t node_index, const gltf_loader::Document &document, IndexBuffer& index_buffer, vector<Vertex>& vertex_buffer, vector<TangentGenerationRange>& v_tangent_ranges, map<int, vector<Primitive>>& loaded_mesh_primitives, Scene& scene) {
+		const tinygltf::Model &model = document.model;
 		Node *p_node = new Node{};
 		p_node->index = node_index;
 		p_node->p_parent = p_parent;
@@ -351,12 +836,16 @@ namespace scene_manager
 		// Node with children
 		if(node.children.size() > 0) {
 			for(auto i = 0; i < node.children.size(); i++) {
-				load_node(p_node, model.nodes[node.children[i]], node.children[i], model, index_buffer, vertex_buffer, scene);
+				load_node(p_node, model.nodes[node.children[i]], node.children[i], document, index_buffer, vertex_buffer, v_tangent_ranges, loaded_mesh_primitives, scene);
 			}
 		}
 
-		// Node contains mesh data
-		if(node.mesh > -1) {
+		// Node contains mesh data, meshes referenced by several nodes share their index ranges so that they can be instanced
+		if(auto it = loaded_mesh_primitives.find(node.mesh); node.mesh > -1 && it != loaded_mesh_primitives.end()) {
+			p_node->primitives = it->second;
+			p_node->mesh_index = 0; // patched with the scene mesh index once every node is loaded
+		}
+		else if(node.mesh > -1) {
 			const auto gltf_mesh = model.meshes[node.mesh];
 			BoundingBox bbox;
 			for(size_t i = 0; i < gltf_mesh.primitives.size(); i++) {
@@ -364,22 +853,23 @@ namespace scene_manager
 				if(gltf_primitive.indices < 0) {
 					continue;
 				}
-				uint32_t index_buffer_start = static_cast<uint32_t>(index_buffer.size());
+				uint32_t index_buffer_start = index_buffer.index_count;
 				uint32_t vertex_buffer_start = static_cast<uint32_t>(vertex_buffer.size());
 				uint32_t index_count = 0;
+				bool is_tangent_generated = false;
 				// Vertices
 				{
 					const float *p_pos_buffer = nullptr;
 					const float *p_nor_buffer = nullptr;
 					const float *p_uv_buffer = nullptr;
+					const float *p_tangent_buffer = nullptr;
 
 					// Position attribute is required
 					auto it = gltf_primitive.attributes.find("POSITION");
 					assert(it != gltf_primitive.attributes.end());
 
 					const tinygltf::Accessor &posAccessor = model.accessors[it->second];
-					const tinygltf::BufferView &posView = model.bufferViews[posAccessor.bufferView];
-					p_pos_buffer = reinterpret_cast<const float *>(&(model.buffers[posView.buffer].data[posAccessor.byteOffset + posView.byteOffset]));
+					p_pos_buffer = reinterpret_cast<const float *>(gltf_loader::get_accessor_data(document, posAccessor));
 
 					bbox.min = { static_cast<float>(posAccessor.minValues[0]), static_cast<float>(posAccessor.minValues[1]), static_cast<float>(posAccessor.minValues[2]) };
 					bbox.max = { static_cast<float>(posAccessor.maxValues[0]), static_cast<float>(posAccessor.maxValues[1]), static_cast<float>(posAccessor.maxValues[2]) };
@@ -387,16 +877,21 @@ namespace scene_manager
 					it = gltf_primitive.attributes.find("NORMAL");
 					if(it != gltf_primitive.attributes.end()) {
 						const tinygltf::Accessor &normAccessor = model.accessors[it->second];
-						const tinygltf::BufferView &normView = model.bufferViews[normAccessor.bufferView];
-						p_nor_buffer = reinterpret_cast<const float *>(&(model.buffers[normView.buffer].data[normAccessor.byteOffset + normView.byteOffset]));
+						p_nor_buffer = reinterpret_cast<const float *>(gltf_loader::get_accessor_data(document, normAccessor));
 					}
 
 					it = gltf_primitive.attributes.find("TEXCOORD_0");
 					if(it != gltf_primitive.attributes.end()) {
 						const tinygltf::Accessor &uvAccessor = model.accessors[it->second];
-						const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-						p_uv_buffer = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+						p_uv_buffer = reinterpret_cast<const float *>(gltf_loader::get_accessor_data(document, uvAccessor));
+					}
+
+					it = gltf_primitive.attributes.find("TANGENT");
+					if(it != gltf_primitive.attributes.end()) {
+						const tinygltf::Accessor &tangentAccessor = model.accessors[it->second];
+						p_tangent_buffer = reinterpret_cast<const float *>(gltf_loader::get_accessor_data(document, tangentAccessor));
 					}
+					is_tangent_generated = !p_tangent_buffer && p_nor_buffer && p_uv_buffer;
 
 					for(size_t v = 0; v < posAccessor.count; v++) {
 						Vertex vert{};
@@ -409,62 +904,38 @@ namespace scene_manager
 						if(p_uv_buffer) {
 							vert.uv = XMFLOAT2(p_uv_buffer + (v * 2));
 						}
+						if(p_tangent_buffer) {
+							vert.tangent = XMFLOAT4(p_tangent_buffer + (v * 4));
+						}
+						else if(!is_tangent_generated) {
+							vert.tangent = XMFLOAT4(1.f, 0.f, 0.f, 1.f);
+						}
 						vertex_buffer.push_back(vert);
 					}
 				}
 				// Indices
 				{
 					const tinygltf::Accessor &accessor = model.accessors[gltf_primitive.indices];
-					const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-					const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
 
 					index_count = static_cast<uint32_t>(accessor.count);
 
-					switch(accessor.componentType) {
-						case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
-						{
-							uint32_t *buf = new uint32_t[accessor.count];
-							memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint32_t));
-							for(size_t index = 0; index < accessor.count; index++) {
-								index_buffer.push_back(buf[index] + vertex_buffer_start);
-							}
-							delete[] buf;
-							break;
-						}
-						case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
-						{
-							uint16_t *buf = new uint16_t[accessor.count];
-							memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint16_t));
-							for(size_t index = 0; index < accessor.count; index++) {
-								index_buffer.push_back(buf[index] + vertex_buffer_start);
-							}
-							delete[] buf;
-							break;
-						}
-						case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
-						{
-							uint8_t *buf = new uint8_t[accessor.count];
-							memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint8_t));
-							for(size_t index = 0; index < accessor.count; index++) {
-								index_buffer.push_back(buf[index] + vertex_buffer_start);
-							}
-							delete[] buf;
-							break;
-						}
-						default: throw exception("Index component type not supported!");
-					}
+					copy_indices(gltf_loader::get_accessor_data(document, accessor), accessor.componentType, accessor.count, index_buffer);
 				}
 				Primitive primitive;
 				primitive.material_index = gltf_primitive.material;
 				primitive.first_index = index_buffer_start;
+				primitive.base_vertex = static_cast<int32_t>(vertex_buffer_start);
 				primitive.index_count = index_count;
 				primitive.bbox = bbox;
 				p_node->primitives.push_back(primitive);
+
+				if(is_tangent_generated) {
+					v_tangent_ranges.push_back({ vertex_buffer_start, static_cast<uint32_t>(vertex_buffer.size()) - vertex_buffer_start, index_buffer_start, index_count });
+				}
 			}
 
-			uint32_t mesh_index = 0;
-			renderer::load_mesh(vertex_buffer.size(), index_buffer.size(), static_cast<const void*>(vertex_buffer.data()), static_cast<const void*>(index_buffer.data()), mesh_index);
-			p_node->mesh_index = mesh_index;
+			loaded_mesh_primitives[node.mesh] = p_node->primitives;
+			p_node->mesh_index = 0; // patched with the scene mesh index once every node is loaded
 		}
 
 		p_node->compute_bounding_box();
@@ -478,26 +949,227 @@ namespace scene_manager
 		scene.linear_nodes.push_back(p_node);
 	}
 
-	void load_scene(const string& asset_filename, Scene &scene, bool flip_forward = false) {
-		tinygltf::Model gltf_model;
-		tinygltf::TinyGLTF gltf_ctx;
+	// .gltf and .glb files go through the mapped gltf_loader path, files it does not handle fall back to tinygltf.
+	// Touches nothing but its arguments, so the documents of all scenes are loaded as parallel jobs; load_ms starts with the time this takes.
+	void load_document(const string& asset_filename, gltf_loader::Document &document, Scene &scene) {
+		auto start = chrono::high_resolution_clock::now();
 		string err;
 
 		const string asset_file_address{ asset_folder + asset_filename };
 
-		bool is_loaded = gltf_ctx.LoadASCIIFromFile(&gltf_model, &err, asset_file_address.c_str());
-		if(!is_loaded) { throw exception(err.c_str()); }
+		scene.is_mapped = gltf_loader::load(asset_file_address, document, err);
+		if(!scene.is_mapped) {
+			bool is_loaded = gltf_loader::load_with_tinygltf(asset_file_address, document, err);
+			if(!is_loaded) { throw exception(err.c_str()); }
+		}
+		scene.load_ms = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+	}
 
-		load_textures(gltf_model, scene);
-		load_materials(gltf_model, scene);
+	// Surface area of a primitive's world space bounds, how much it is likely to hide
+	inline float get_occluder_size(const Primitive &primitive, const XMFLOAT4X4 &world_from_object) {
+		XMFLOAT3 center_ws, extents_ws;
+		transform_bounding_box(primitive.bbox, world_from_object, center_ws, extents_ws);
+		return extents_ws.x * extents_ws.y + extents_ws.y * extents_ws.z + extents_ws.z * extents_ws.x;
+	}
 
-		vector<uint32_t> index_buffer;
-		vector<Vertex> vertex_buffer;
+	// Copies the triangles of the largest opaque primitives into one world space mesh, only the vertices they use are kept.
+	// Alpha masked and blended primitives have holes or let what is behind them through so they never hide anything.
+	void build_occluder_mesh(const IndexBuffer &index_buffer, const vector<Vertex> &vertex_buffer, Scene &scene) {
+		struct Candidate {
+			const Node *p_node;
+			const Primitive *p_primitive;
+			float size;
+		};
+		vector<Candidate> v_candidates;
+		for(auto p_node : scene.linear_nodes) {
+			if(p_node->mesh_index < 0) { continue; }
+			for(auto& primitive : p_node->primitives) {
+				if(scene.materials[primitive.material_index].alphaMode == Material::ALPHAMODE_OPAQUE) {
+					v_candidates.push_back({ p_node, &primitive, get_occluder_size(primitive, scene.node_transformations[p_node->transformation_index]) });
+				}
+			}
+		}
+		sort(v_candidates.begin(), v_candidates.end(), [](const Candidate &a, const Candidate &b) { return a.size > b.size; });
+
+		auto& occluder_mesh = scene.occluder_mesh;
+		vector<uint32_t> v_vertex_remap;
+		for(auto& candidate : v_candidates) {
+			const Primitive &primitive = *candidate.p_primitive;
+			if(occluder_mesh.v_indices.size() + primitive.index_count > max_occluder_triangle_count * 3) { continue; }
+			XMMATRIX xm_world_from_object = XMMatrixTranspose(XMLoadFloat4x4(&scene.node_transformations[candidate.p_node->transformation_index]));
+			v_vertex_remap.clear();
+			for(uint32_t index = 0; index < primitive.index_count; ++index) {
+				uint32_t local_index = get_index(index_buffer, primitive.first_index + index);
+				if(local_index >= v_vertex_remap.size()) {
+					v_vertex_remap.resize(local_index + 1, UINT32_MAX);
+				}
+				uint32_t &occluder_index = v_vertex_remap[local_index];
+				if(occluder_index == UINT32_MAX) {
+					occluder_index = static_cast<uint32_t>(occluder_mesh.v_positions_ws.size());
+					XMFLOAT3 pos_ws;
+					XMStoreFloat3(&pos_ws, XMVector3Transform(XMLoadFloat3(&vertex_buffer[primitive.base_vertex + local_index].pos), xm_world_from_object));
+					occluder_mesh.v_positions_ws.push_back(pos_ws);
+				}
+				occluder_mesh.v_indices.push_back(occluder_index);
+			}
+		}
+	}
+
+	// The primitives of a mesh used by several nodes once, in the order build_lods(), build_meshlets() and append_lods() share
+	vector<const Primitive*> get_loaded_primitives(const map<int, vector<Primitive>> &loaded_mesh_primitives) {
+		vector<const Primitive*> v_p_primitives;
+		for(auto& [mesh, primitives] : loaded_mesh_primitives) {
+			for(auto& primitive : primitives) {
+				v_p_primitives.push_back(&primitive);
+			}
+		}
+		return v_p_primitives;
+	}
+
+	// Indices of the primitive relative to its base vertex, returns the number of vertices they use
+	uint32_t get_primitive_indices(const IndexBuffer &index_buffer, const Primitive &primitive, vector<uint32_t> &v_indices) {
+		v_indices.resize(primitive.index_count);
+		uint32_t num_vertices = 0;
+		for(uint32_t index = 0; index < primitive.index_count; ++index) {
+			v_indices[index] = get_index(index_buffer, primitive.first_index + index);
+			num_vertices = max(num_vertices, v_indices[index] + 1);
+		}
+		return num_vertices;
+	}
+
+	// The LODs of every primitive. Runs as a job next to tangent generation, which only writes tangents, and leaves the index
+	// buffer alone: append_lods() adds the LODs to it afterwards.
+	void build_lods(const map<int, vector<Primitive>> &loaded_mesh_primitives, const IndexBuffer &index_buffer, const vector<Vertex> &vertex_buffer, vector<vector<mesh_simplifier::Lod>> &a_v_lods) {
+		vector<const Primitive*> v_p_primitives = get_loaded_primitives(loaded_mesh_primitives);
+		a_v_lods.resize(v_p_primitives.size());
+		job_system::parallel_for(static_cast<uint32_t>(v_p_primitives.size()), mesh_simplifier::min_primitives_per_batch, [&](uint32_t begin, uint32_t end) {
+			vector<uint32_t> v_indices;
+			for(uint32_t primitive_index = begin; primitive_index < end; ++primitive_index) {
+				const Primitive &primitive = *v_p_primitives[primitive_index];
+				uint32_t num_vertices = get_primitive_indices(index_buffer, primitive, v_indices);
+				mesh_simplifier::build_lods(vertex_buffer.data() + primitive.base_vertex, num_vertices, v_indices.data(), primitive.index_count, a_v_lods[primitive_index]);
+			}
+		});
+	}
+
+	// Meshlets of every level of a primitive, the indices of level 0 reordered by them; the LODs' indices are reordered in place
+	struct PrimitiveMeshlets {
+		vector<uint32_t> v_indices;
+		vector<vector<meshlet_builder::Meshlet>> a_v_level_meshlets;
+	};
+
+	// Runs after build_lods() in the same job, so the index buffer is still only read
+	void build_meshlets(const map<int, vector<Primitive>> &loaded_mesh_primitives, const IndexBuffer &index_buffer, const vector<Vertex> &vertex_buffer, vector<vector<mesh_simplifier::Lod>> &a_v_lods, vector<PrimitiveMeshlets> &v_primitive_meshlets) {
+		vector<const Primitive*> v_p_primitives = get_loaded_primitives(loaded_mesh_primitives);
+		v_primitive_meshlets.resize(v_p_primitives.size());
+		job_system::parallel_for(static_cast<uint32_t>(v_p_primitives.size()), meshlet_builder::min_primitives_per_batch, [&](uint32_t begin, uint32_t end) {
+			for(uint32_t primitive_index = begin; primitive_index < end; ++primitive_index) {
+				const Primitive &primitive = *v_p_primitives[primitive_index];
+				const Vertex *p_vertices = vertex_buffer.data() + primitive.base_vertex;
+				auto& primitive_meshlets = v_primitive_meshlets[primitive_index];
+				auto& v_lods = a_v_lods[primitive_index];
+				uint32_t num_vertices = get_primitive_indices(index_buffer, primitive, primitive_meshlets.v_indices);
+				primitive_meshlets.a_v_level_meshlets.resize(v_lods.size() + 1);
+				meshlet_builder::build_meshlets(p_vertices, num_vertices, primitive_meshlets.v_indices, primitive_meshlets.a_v_level_meshlets[0]);
+				for(uint32_t lod_index = 0; lod_index < v_lods.size(); ++lod_index) {
+					meshlet_builder::build_meshlets(p_vertices, num_vertices, v_lods[lod_index].v_indices, primitive_meshlets.a_v_level_meshlets[lod_index + 1]);
+				}
+			}
+		});
+	}
 
-		const tinygltf::Scene &gltf_scene = gltf_model.scenes[gltf_model.defaultScene];
-		for(size_t i = 0; i < gltf_scene.nodes.size(); i++) {
-			const tinygltf::Node node = gltf_model.nodes[gltf_scene.nodes[i]];
-			load_node(nullptr, node, gltf_scene.nodes[i], gltf_model, index_buffer, vertex_buffer, scene);
+	// The nodes' copies of a primitive are found by its first index
+	void append_lods(const vector<vector<mesh_simplifier::Lod>> &a_v_lods, const vector<PrimitiveMeshlets> &v_primitive_meshlets, map<int, vector<Primitive>> &loaded_mesh_primitives, IndexBuffer &index_buffer, Scene &scene) {
+		map<uint32_t, const Primitive*> p_primitives_by_first_index;
+		uint32_t primitive_index = 0;
+		for(auto& [mesh, primitives] : loaded_mesh_primitives) {
+			for(auto& primitive : primitives) {
+				const auto& v_lods = a_v_lods[primitive_index];
+				const auto& primitive_meshlets = v_primitive_meshlets[primitive_index++];
+				for(uint32_t index = 0; index < primitive.index_count; ++index) {
+					set_index(index_buffer, primitive.first_index + index, primitive_meshlets.v_indices[index]);
+				}
+				primitive.first_lod = static_cast<uint32_t>(scene.v_lods.size());
+				primitive.lod_count = static_cast<uint32_t>(v_lods.size()) + 1;
+				scene.v_lods.push_back({ primitive.first_index, primitive.index_count, 0.f });
+				for(auto& lod : v_lods) {
+					scene.v_lods.push_back({ index_buffer.index_count, static_cast<uint32_t>(lod.v_indices.size()), lod.error });
+					copy_indices(reinterpret_cast<const uint8_t*>(lod.v_indices.data()), TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT, lod.v_indices.size(), index_buffer);
+				}
+				for(uint32_t level = 0; level < primitive.lod_count; ++level) {
+					const auto& v_meshlets = primitive_meshlets.a_v_level_meshlets[level];
+					auto& lod = scene.v_lods[primitive.first_lod + level];
+					lod.first_meshlet = static_cast<uint32_t>(scene.v_meshlets.size());
+					lod.meshlet_count = static_cast<uint32_t>(v_meshlets.size());
+					scene.v_meshlets.insert(scene.v_meshlets.end(), v_meshlets.begin(), v_meshlets.end());
+				}
+				scene.num_lod_levels = max(scene.num_lod_levels, primitive.lod_count);
+				for(uint32_t level = 0; level < max_lod_count; ++level) {
+					scene.a_num_lod_triangles[level] += scene.v_lods[primitive.first_lod + min(level, primitive.lod_count - 1)].index_count / 3;
+				}
+				p_primitives_by_first_index[primitive.first_index] = &primitive;
+			}
+		}
+		for(auto p_node : scene.linear_nodes) {
+			for(auto& primitive : p_node->primitives) {
+				const Primitive &loaded_primitive = *p_primitives_by_first_index[primitive.first_index];
+				primitive.first_lod = loaded_primitive.first_lod;
+				primitive.lod_count = loaded_primitive.lod_count;
+			}
+		}
+	}
+
+	// The geometry is gathered and its tangents generated while the textures are prepared, both as jobs.
+	// Everything that records into the command list runs afterwards on the calling thread.
+	void load_scene(gltf_loader::Document &document, Scene &scene, bool flip_forward = false) {
+		auto start = chrono::high_resolution_clock::now();
+		const tinygltf::Model &gltf_model = document.model;
+
+		vector<MaterialTextures> v_material_textures;
+		TexturePreparation texture_preparation;
+		IndexBuffer index_buffer{};
+		index_buffer.index_size = get_index_size(gltf_model);
+		vector<Vertex> vertex_buffer;
+		vector<TangentGenerationRange> v_tangent_ranges;
+		map<int, vector<Primitive>> loaded_mesh_primitives;
+
+		job_system::TaskGraph load_graph;
+		job_system::add_task(load_graph, [&]() { prepare_textures(document, scene, v_material_textures, texture_preparation); });
+		uint32_t geometry_task = job_system::add_task(load_graph, [&]() {
+			const tinygltf::Scene &gltf_scene = gltf_model.scenes[gltf_model.defaultScene];
+			for(size_t i = 0; i < gltf_scene.nodes.size(); i++) {
+				const tinygltf::Node node = gltf_model.nodes[gltf_scene.nodes[i]];
+				load_node(nullptr, node, gltf_scene.nodes[i], document, index_buffer, vertex_buffer, v_tangent_ranges, loaded_mesh_primitives, scene);
+			}
+		});
+		uint32_t tangent_task = job_system::add_task(load_graph, [&]() { generate_tangents(v_tangent_ranges, index_buffer, vertex_buffer); });
+		job_system::add_dependency(load_graph, tangent_task, geometry_task);
+		vector<vector<mesh_simplifier::Lod>> a_v_lods;
+		vector<PrimitiveMeshlets> v_primitive_meshlets;
+		uint32_t lod_task = job_system::add_task(load_graph, [&]() {
+			auto lod_start = chrono::high_resolution_clock::now();
+			build_lods(loaded_mesh_primitives, index_buffer, vertex_buffer, a_v_lods);
+			auto meshlet_start = chrono::high_resolution_clock::now();
+			build_meshlets(loaded_mesh_primitives, index_buffer, vertex_buffer, a_v_lods, v_primitive_meshlets);
+			scene.lod_build_ms = chrono::duration<float, milli>(meshlet_start - lod_start).count();
+			scene.meshlet_build_ms = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - meshlet_start).count();
+		});
+		job_system::add_dependency(load_graph, lod_task, geometry_task);
+		job_system::run_and_wait(load_graph);
+		append_lods(a_v_lods, v_primitive_meshlets, loaded_mesh_primitives, index_buffer, scene);
+
+		upload_textures(document.model, scene, texture_preparation);
+		load_materials(gltf_model, scene, v_material_textures);
+
+		// Every node of a scene draws from a single vertex/index buffer pair
+		if(vertex_buffer.size() > 0) {
+			uint32_t mesh_index = 0;
+			renderer::load_mesh(vertex_buffer.size(), index_buffer.index_count, index_buffer.index_size, static_cast<const void*>(vertex_buffer.data()), static_cast<const void*>(index_buffer.v_data.data()), mesh_index);
+			for(auto p_node : scene.linear_nodes) {
+				if(p_node->mesh_index >= 0) {
+					p_node->mesh_index = mesh_index;
+				}
+			}
 		}
 
 		scene.compute_bounding_box();
@@ -518,6 +1190,10 @@ namespace scene_manager
 				node->update(scene.node_transformations, scene.global_transform);
 			}
 		}
+		build_occluder_mesh(index_buffer, vertex_buffer, scene);
+
+		gltf_loader::release(document);
+		scene.load_ms += chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
 	}
 
 	void init_camera() {
@@ -529,6 +1205,9 @@ namespace scene_manager
 		camera.pos_ws = { 1.5f, -2.0f, 0.5f };
 		camera.yaw_rad = XMConvertToRadians(50.0);
 		camera.pitch_rad = XMConvertToRadians(20.0);
+		camera_motion = {};
+		camera_motion.previous_pos_ws = camera.pos_ws;
+		camera_motion.pos_ws = camera.pos_ws;
 		//camera.dir_ws = { -1.0f, -1.0f, 0.0f };
 		//camera.up_ws = { 0.0f, 0.0f, 1.0f };
 
@@ -569,8 +1248,67 @@ namespace scene_manager
 		XMStoreFloat4x4(&camera.world_from_view, xm_world_from_view);
 	}
 
+	// The front to back sort of the opaque draws runs as a job while the calling thread sorts the alpha blended draws, so each has its own buffers
+	struct SortBuffers {
+		vector<uint64_t> v_keys;
+		vector<uint32_t> v_indices;
+		vector<uint64_t> v_scratch_keys;
+		vector<uint32_t> v_scratch_indices;
+	};
+	SortBuffers opaque_sort_buffers;
+	SortBuffers alpha_blend_sort_buffers;
+	// Blended draws that pass occlusion culling only feed the sort, the packet keeps the sorted ones
+	vector<DrawInfo> v_visible_alpha_blend_draws;
+	// Meshlet culling writes here and swaps with the packet's opaque draws, which may be its input
+	vector<DrawInfo> v_meshlet_culled_draws;
+	vector<meshlet_builder::IndexRange> v_meshlet_ranges;
+	vector<uint32_t> v_meshlet_gaps;
+
+	inline void merge_bounds(DrawInfo &draw_info, const XMFLOAT3 &center_ws, const XMFLOAT3 &extents_ws) {
+		XMVECTOR xm_min = XMVectorMin(XMLoadFloat3(&draw_info.bbox_center_ws) - XMLoadFloat3(&draw_info.bbox_extents_ws), XMLoadFloat3(&center_ws) - XMLoadFloat3(&extents_ws));
+		XMVECTOR xm_max = XMVectorMax(XMLoadFloat3(&draw_info.bbox_center_ws) + XMLoadFloat3(&draw_info.bbox_extents_ws), XMLoadFloat3(&center_ws) + XMLoadFloat3(&extents_ws));
+		XMStoreFloat3(&draw_info.bbox_center_ws, (xm_min + xm_max) * 0.5f);
+		XMStoreFloat3(&draw_info.bbox_extents_ws, (xm_max - xm_min) * 0.5f);
+	}
+
+	// Sorts the opaque draws by key, grouping them by shader permutation with the alpha masked ones last, and merges runs that draw the same index range with the same material into one instanced draw
+	void batch_opaque_draws(Scene &scene, vector<DrawInfo> &draw_info_list) {
+		auto& [sort_keys, sort_indices, sort_scratch_keys, sort_scratch_indices] = opaque_sort_buffers;
+		sort_keys.resize(draw_info_list.size());
+		sort_indices.resize(draw_info_list.size());
+		for(uint32_t draw_index = 0; draw_index < draw_info_list.size(); ++draw_index) {
+			auto& draw_info = draw_info_list[draw_index];
+			uint32_t pso_index = scene.materials[draw_info.material_index].shader_permutation;
+			sort_keys[draw_index] = draw_sort::make_opaque_batch_key(pso_index, draw_info.mesh_index, draw_info.material_index, draw_info.draw_first_index);
+			sort_indices[draw_index] = draw_index;
+		}
+		draw_sort::radix_sort(sort_keys, sort_indices, sort_scratch_keys, sort_scratch_indices);
+
+		for(uint32_t sorted_index = 0; sorted_index < sort_indices.size(); ++sorted_index) {
+			auto draw_info = draw_info_list[sort_indices[sorted_index]];
+			uint32_t transformation_index = draw_info.transformation_index;
+			auto& batches = scene.opaque_draw_info_list;
+			if(batches.size() > 0) {
+				auto& batch = batches.back();
+				if(batch.mesh_index == draw_info.mesh_index && batch.material_index == draw_info.material_index &&
+					batch.draw_first_index == draw_info.draw_first_index && batch.draw_index_count == draw_info.draw_index_count && batch.draw_base_vertex == draw_info.draw_base_vertex) {
+					scene.instance_transform_indices.push_back(transformation_index);
+					batch.instance_count++;
+					merge_bounds(batch, draw_info.bbox_center_ws, draw_info.bbox_extents_ws);
+					batch.lod_size_ws = max(batch.lod_size_ws, draw_info.lod_size_ws);
+					continue;
+				}
+			}
+			draw_info.first_instance = static_cast<uint32_t>(scene.instance_transform_indices.size());
+			draw_info.instance_count = 1;
+			scene.instance_transform_indices.push_back(transformation_index);
+			batches.push_back(draw_info);
+		}
+	}
+
 	void prepare_draw_lists() {
 		for(auto& p_scene : scenes) {
+			vector<DrawInfo> opaque_draw_info_list;
 			for(auto p_node : p_scene->linear_nodes) {
 				if(p_node->mesh_index >= 0) {
 					for(auto& primitive : p_node->primitives) {
@@ -581,13 +1319,18 @@ namespace scene_manager
 						draw_info.material_index = primitive.material_index;
 						draw_info.draw_index_count = primitive.index_count;
 						draw_info.draw_first_index = primitive.first_index;
+						draw_info.draw_base_vertex = primitive.base_vertex;
+						transform_bounding_box(primitive.bbox, p_scene->node_transformations[p_node->transformation_index], draw_info.bbox_center_ws, draw_info.bbox_extents_ws);
+						draw_info.first_lod = primitive.first_lod;
+						draw_info.lod_count = primitive.lod_count;
+						draw_info.lod_size_ws = 2.f * XMVectorGetX(XMVector3Length(XMLoadFloat3(&draw_info.bbox_extents_ws)));
 
 						auto& material = p_scene->materials[primitive.material_index];
 						switch(material.alphaMode) {
 							case Material::ALPHAMODE_OPAQUE:
 							case Material::ALPHAMODE_MASK:
 							{
-								p_scene->opaque_draw_info_list.push_back(draw_info);
+								opaque_draw_info_list.push_back(draw_info);
 							} break;
 							case Material::ALPHAMODE_BLEND:
 							{
@@ -598,49 +1341,214 @@ namespace scene_manager
 					}
 				}
 			}
+
+			batch_opaque_draws(*p_scene, opaque_draw_info_list);
+
+			// Blended draws are never instanced, each one gets its own instance slot
+			for(auto& draw_info : p_scene->alpha_blend_draw_info_list) {
+				draw_info.first_instance = static_cast<uint32_t>(p_scene->instance_transform_indices.size());
+				draw_info.instance_count = 1;
+				p_scene->instance_transform_indices.push_back(draw_info.transformation_index);
+			}
 		}
 	}
 
-	void init() {
-		{ // Load environment map sets
-			uint32_t tex_index;
-			renderer::load_texture("brdf_lut.octrn", tex_index);
-			renderer::load_texture("courtyard_night_cube_radiance.octrn", tex_index);
-			renderer::load_texture("courtyard_night_cube_irradiance.octrn", tex_index);
-			renderer::load_texture("courtyard_night_cube_specular.octrn", tex_index);
-			renderer::load_texture("ninomaru_teien_8k_cube_radiance.octrn", tex_index);
-			renderer::load_texture("ninomaru_teien_8k_cube_irradiance.octrn", tex_index);
-			renderer::load_texture("ninomaru_teien_8k_cube_specular.octrn", tex_index);
-			renderer::load_texture("paul_lobe_haus_8k_cube_radiance.octrn", tex_index);
-			renderer::load_texture("paul_lobe_haus_8k_cube_irradiance.octrn", tex_index);
-			renderer::load_texture("paul_lobe_haus_8k_cube_specular.octrn", tex_index);
+	// Distance along the view axis to the closest point of the draw's bounds
+	inline float get_nearest_view_depth(const XMMATRIX &xm_view_from_world, const DrawInfo &draw_info) {
+		XMVECTOR xm_view_axis = xm_view_from_world.r[2];
+		XMVECTOR xm_center = XMVectorSet(draw_info.bbox_center_ws.x, draw_info.bbox_center_ws.y, draw_info.bbox_center_ws.z, 1.0f);
+		float center_depth = XMVectorGetX(XMVector4Dot(xm_view_axis, xm_center));
+		float radius = XMVectorGetX(XMVector3Dot(XMVectorAbs(xm_view_axis), XMLoadFloat3(&draw_info.bbox_extents_ws)));
+		return center_depth - radius;
+	}
+
+	// Opaque draws first, then alpha masked ones, each group nearest first
+	void sort_opaque_draws_front_to_back(const Scene &scene, const vector<DrawInfo> &draw_info_list, vector<DrawInfo> &v_sorted_draws) {
+		XMMATRIX xm_view_from_world = XMLoadFloat4x4(&camera.view_from_world);
+		auto& [sort_keys, sort_indices, sort_scratch_keys, sort_scratch_indices] = opaque_sort_buffers;
+		sort_keys.resize(draw_info_list.size());
+		sort_indices.resize(draw_info_list.size());
+		for(uint32_t draw_index = 0; draw_index < draw_info_list.size(); ++draw_index) {
+			auto& draw_info = draw_info_list[draw_index];
+			uint32_t pso_index = (scene.materials[draw_info.material_index].alphaMode == Material::ALPHAMODE_MASK) ? 1 : 0;
+			sort_keys[draw_index] = draw_sort::make_depth_draw_key(pso_index, get_nearest_view_depth(xm_view_from_world, draw_info));
+			sort_indices[draw_index] = draw_index;
 		}
+		draw_sort::radix_sort(sort_keys, sort_indices, sort_scratch_keys, sort_scratch_indices);
 
-		{ // Load sample scenes
-			unique_ptr<Scene> p_scene = nullptr;
+		v_sorted_draws.resize(draw_info_list.size());
+		for(uint32_t sorted_index = 0; sorted_index < sort_indices.size(); ++sorted_index) {
+			v_sorted_draws[sorted_index] = draw_info_list[sort_indices[sorted_index]];
+		}
+	}
 
-			p_scene = make_unique<Scene>();
-			load_scene("cvc_helmet/scene.gltf", *p_scene, true);
-			scenes.push_back(move(p_scene));
+	void sort_alpha_blend_draws(const vector<DrawInfo> &draw_info_list, vector<DrawInfo> &v_sorted_draws) {
+		XMMATRIX xm_view_from_world = XMLoadFloat4x4(&camera.view_from_world);
+		auto& [sort_keys, sort_indices, sort_scratch_keys, sort_scratch_indices] = alpha_blend_sort_buffers;
+		sort_keys.resize(draw_info_list.size());
+		sort_indices.resize(draw_info_list.size());
+		for(uint32_t draw_index = 0; draw_index < draw_info_list.size(); ++draw_index) {
+			auto& center_ws = draw_info_list[draw_index].bbox_center_ws;
+			float view_depth = XMVectorGetX(XMVector4Dot(xm_view_from_world.r[2], XMVectorSet(center_ws.x, center_ws.y, center_ws.z, 1.0f)));
+			sort_keys[draw_index] = draw_sort::make_alpha_blend_draw_key(view_depth);
+			sort_indices[draw_index] = draw_index;
+		}
+		draw_sort::radix_sort(sort_keys, sort_indices, sort_scratch_keys, sort_scratch_indices);
 
-			p_scene = make_unique<Scene>();
-			load_scene("damaged_helmet/damagedHelmet.gltf", *p_scene, true);
-			scenes.push_back(move(p_scene));
+		v_sorted_draws.resize(draw_info_list.size());
+		for(uint32_t sorted_index = 0; sorted_index < sort_indices.size(); ++sorted_index) {
+			v_sorted_draws[sorted_index] = draw_info_list[sort_indices[sorted_index]];
+		}
+	}
 
-			p_scene = make_unique<Scene>();
-			load_scene("pony_cartoon/scene.gltf", *p_scene);
-			scenes.push_back(move(p_scene));
+	void init() {
+		// Environment files are opened and scene files parsed as jobs, uploads stay on this thread since it owns the command list
+		const char *a_p_environment_filenames[] = {
+			"brdf_lut.octrn",
+			"courtyard_night_cube_radiance.octrn",
+			"courtyard_night_cube_irradiance.octrn",
+			"courtyard_night_cube_specular.octrn",
+			"ninomaru_teien_8k_cube_radiance.octrn",
+			"ninomaru_teien_8k_cube_irradiance.octrn",
+			"ninomaru_teien_8k_cube_specular.octrn",
+			"paul_lobe_haus_8k_cube_radiance.octrn",
+			"paul_lobe_haus_8k_cube_irradiance.octrn",
+			"paul_lobe_haus_8k_cube_specular.octrn",
+		};
+		image_stream::Stream a_streams[count_of(a_p_environment_filenames)];
+		gltf_loader::Document a_documents[model_scene_count];
+		for(uint32_t scene_index = 0; scene_index < model_scene_count; ++scene_index) {
+			scenes.push_back(make_unique<Scene>());
+		}
+		{
+			job_system::TaskGraph load_graph;
+			for(uint32_t file_index = 0; file_index < count_of(a_p_environment_filenames); ++file_index) {
+				job_system::add_task(load_graph, [&, file_index]() {
+					if(!image_stream::open(asset_folder + a_p_environment_filenames[file_index], a_streams[file_index])) {
+						string msg = string("File error: ") + a_p_environment_filenames[file_index];
+						throw exception(msg.c_str());
+					}
+				});
+			}
+			for(uint32_t scene_index = 0; scene_index < model_scene_count; ++scene_index) {
+				job_system::add_task(load_graph, [&, scene_index]() {
+					load_document(a_model_scene_descs[scene_index].p_asset_filename, a_documents[scene_index], *scenes[scene_index]);
+				});
+			}
+			job_system::run_and_wait(load_graph);
+		}
+
+		{ // Load environment map sets, every file was opened first so that all of them are read while the first ones are placed and copied
+			for(uint32_t file_index = 0; file_index < count_of(a_p_environment_filenames); ++file_index) {
+				uint32_t tex_index;
+				renderer::load_texture(a_streams[file_index], a_p_environment_filenames[file_index], tex_index);
+				image_stream::close(a_streams[file_index]);
+			}
+		}
 
-			p_scene = make_unique<Scene>();
-			load_scene("vintage_suitcase/scene.gltf", *p_scene);
-			scenes.push_back(move(p_scene));
+		{ // Load sample scenes
+			texture_cache::init(processed_texture_cache, texture_cache_folder);
+			for(uint32_t scene_index = 0; scene_index < model_scene_count; ++scene_index) {
+				load_scene(a_documents[scene_index], *scenes[scene_index], a_model_scene_descs[scene_index].flip_forward);
+			}
+			texture_cache::evict(processed_texture_cache, max_texture_cache_size);
 		}
 
 		init_camera();
 		prepare_draw_lists();
+		occlusion_culler::init(occlusion_culler_state, occlusion_culler::is_avx2_supported() ? OCCLUSION_ISA_AVX2 : OCCLUSION_ISA_SSE);
+	}
+
+	// Rasterizes the scene's occluders from the camera and leaves the opaque draws that pass in the packet, in the scene's order
+	void cull_occluded_draws(const Scene &scene, GuiData &gui_data, FramePacket &frame_packet, vector<DrawInfo> &v_visible_alpha_blend_draws) {
+		XMMATRIX xm_clip_from_world = XMMatrixMultiply(XMLoadFloat4x4(&camera.clip_from_view), XMLoadFloat4x4(&camera.view_from_world));
+		auto& statistics = gui_data.occlusion_culling_statistics;
+
+		auto start = chrono::high_resolution_clock::now();
+		occlusion_culler::rasterize_occluders(occlusion_culler_state, scene.occluder_mesh, xm_clip_from_world);
+		auto rasterized = chrono::high_resolution_clock::now();
+		statistics.num_culled_draws = occlusion_culler::cull_draws(occlusion_culler_state, xm_clip_from_world, scene.opaque_draw_info_list, frame_packet.v_opaque_draws);
+		statistics.num_culled_draws += occlusion_culler::cull_draws(occlusion_culler_state, xm_clip_from_world, scene.alpha_blend_draw_info_list, v_visible_alpha_blend_draws);
+		auto tested = chrono::high_resolution_clock::now();
+
+		statistics.num_occluder_triangles = static_cast<uint32_t>(scene.occluder_mesh.v_indices.size() / 3);
+		statistics.num_draws = static_cast<uint32_t>(scene.opaque_draw_info_list.size() + scene.alpha_blend_draw_info_list.size());
+		statistics.rasterize_ms = chrono::duration<float, milli>(rasterized - start).count();
+		statistics.test_ms = chrono::duration<float, milli>(tested - rasterized).count();
+		statistics.is_avx2_used = occlusion_culler_state.isa == OCCLUSION_ISA_AVX2;
+	}
+
+	// Picks the coarsest LOD of every draw whose error, projected at the nearest point of its bounds, stays within the threshold.
+	// The LOD errors are relative to the primitive's size, which for batched instances is that of the largest instance.
+	void select_lods(const Scene &scene, GuiData &gui_data, const vector<DrawInfo> &draw_info_list, vector<DrawInfo> &v_selected_draws) {
+		XMMATRIX xm_view_from_world = XMLoadFloat4x4(&camera.view_from_world);
+		float pixels_per_unit_at_unit_depth = camera.clip_from_view._22 * back_buffer_height * 0.5f;
+		auto& statistics = gui_data.lod_selection_statistics;
+		if(&draw_info_list != &v_selected_draws) {
+			v_selected_draws = draw_info_list;
+		}
+		for(auto& draw_info : v_selected_draws) {
+			uint32_t lod_level = 0;
+			float depth = get_nearest_view_depth(xm_view_from_world, draw_info);
+			if(depth > camera.near_plane_in_meters) {
+				float error_to_pixels = draw_info.lod_size_ws * pixels_per_unit_at_unit_depth / depth;
+				while(lod_level + 1 < draw_info.lod_count && scene.v_lods[draw_info.first_lod + lod_level + 1].error * error_to_pixels <= gui_data.lod_error_threshold_px) {
+					lod_level++;
+				}
+			}
+			const MeshLod &lod = scene.v_lods[draw_info.first_lod + lod_level];
+			statistics.num_full_triangles += draw_info.draw_index_count / 3 * draw_info.instance_count;
+			statistics.num_selected_triangles += lod.index_count / 3 * draw_info.instance_count;
+			statistics.a_num_draws_per_lod[lod_level]++;
+			draw_info.draw_first_index = lod.first_index;
+			draw_info.draw_index_count = lod.index_count;
+			draw_info.lod_level = lod_level;
+		}
+	}
+
+	// Splits every draw of a single instance into the index ranges of its meshlets in the frustum that, unless the material is
+	// double sided, face the camera. Instanced draws are kept whole, their meshlets would need testing per instance.
+	void cull_meshlets(const Scene &scene, GuiData &gui_data, const vector<DrawInfo> &draw_info_list, vector<DrawInfo> &v_visible_draws) {
+		XMMATRIX xm_clip_from_world = XMMatrixMultiply(XMLoadFloat4x4(&camera.clip_from_view), XMLoadFloat4x4(&camera.view_from_world));
+		XMVECTOR xm_eye_ws = XMLoadFloat3(&camera.pos_ws);
+		auto& statistics = gui_data.meshlet_culling_statistics;
+		statistics = {};
+
+		auto start = chrono::high_resolution_clock::now();
+		v_visible_draws.clear();
+		for(auto& draw_info : draw_info_list) {
+			const MeshLod &lod = scene.v_lods[draw_info.first_lod + draw_info.lod_level];
+			if(draw_info.instance_count != 1 || lod.meshlet_count == 0) {
+				v_visible_draws.push_back(draw_info);
+				continue;
+			}
+			XMMATRIX xm_world_from_object = XMLoadFloat4x4(&scene.node_transformations[draw_info.transformation_index]);
+			XMMATRIX xm_object_from_world = XMMatrixInverse(nullptr, xm_world_from_object);
+			meshlet_builder::CullView view;
+			meshlet_builder::make_cull_view(XMMatrixMultiply(xm_clip_from_world, xm_world_from_object), XMVector3TransformCoord(xm_eye_ws, XMMatrixTranspose(xm_object_from_world)), view);
+			bool is_backface_culling_enabled = !scene.v_is_material_double_sided[draw_info.material_index];
+			meshlet_builder::cull_meshlets(view, &scene.v_meshlets[lod.first_meshlet], lod.meshlet_count, is_backface_culling_enabled, v_meshlet_ranges, v_meshlet_gaps, statistics);
+			for(auto& range : v_meshlet_ranges) {
+				DrawInfo &visible_draw = v_visible_draws.emplace_back(draw_info);
+				visible_draw.draw_first_index = lod.first_index + range.first_index;
+				visible_draw.draw_index_count = range.index_count;
+			}
+		}
+		statistics.cull_ms = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Places the camera at rest, the next update() keeps it there unless there is input
+	void set_camera_pose(const XMFLOAT3 &pos_ws, float yaw_rad, float pitch_rad) {
+		camera.pos_ws = pos_ws;
+		camera.yaw_rad = yaw_rad;
+		camera.pitch_rad = pitch_rad;
+		camera_motion = {};
+		camera_motion.previous_pos_ws = pos_ws;
+		camera_motion.pos_ws = pos_ws;
 	}
 
-	void update(GuiData& gui_data) {
+	// Leaves everything the renderer needs of this frame in frame_packet, the scene itself is not changed after init()
+	void update(GuiData& gui_data, FramePacket &frame_packet) {
 		current_scene_index = (gui_data.model_scene_index < scenes.size()) ? gui_data.model_scene_index : 0;
 
 		// update camera
@@ -667,54 +1575,46 @@ namespace scene_manager
 			pitch_rad = XMMax(-XM_PIDIV2, pitch_rad);
 			camera.pitch_rad = pitch_rad;
 
-			static float move_speed_mps = 40.0f;
-			static float speed_scale = .06f;
-			static float delta_time_s = 0.016666f;
-
-			float forward = move_speed_mps * speed_scale * ((gui_data.is_w_pressed ? delta_time_s : 0.0f) + (gui_data.is_s_pressed ? -delta_time_s : 0.0f));
-			float strafe = move_speed_mps * speed_scale * ((gui_data.is_d_pressed ? delta_time_s : 0.0f) + (gui_data.is_a_pressed ? -delta_time_s : 0.0f));
-			float ascent = move_speed_mps * speed_scale * ((gui_data.is_e_pressed ? delta_time_s : 0.0f) + (gui_data.is_q_pressed ? -delta_time_s : 0.0f));
-
-			static float prev_forward = 0.0f;
-			static float prev_strafe = 0.0f;
-			static float prev_ascent = 0.0f;
-
-			auto dampen_motion = [&](float &prev_val, float &new_val) {
-				float blended_val;
-				XMVECTOR xm_blended_val;
-				XMVECTOR xm_prev_val = XMLoadFloat(&prev_val);
-				XMVECTOR xm_new_val = XMLoadFloat(&new_val);
-				if(abs(new_val) > abs(prev_val))
-					xm_blended_val = XMVectorLerp(xm_new_val, xm_prev_val, pow(0.6f, delta_time_s * 60.0f));
-				else
-					xm_blended_val = XMVectorLerp(xm_new_val, xm_prev_val, pow(0.8f, delta_time_s * 60.0f));
-				XMStoreFloat(&blended_val, xm_blended_val);
-				prev_val = blended_val;
-				new_val = blended_val;
+			// Left-handed +y : up, +x: right View Space -> Right-handed +z : up, -y: right World Space
+			static const XMMATRIX xm_change_of_basis = { 
+				0.0, 0.0,-1.0, 0,
+				1.0, 0.0, 0.0, 0,
+				0.0, 1.0, 0.0, 0,
+				0.0, 0.0, 0.0, 1.0
 			};
 
-			dampen_motion(prev_forward, forward);
-			dampen_motion(prev_strafe, strafe);
-			dampen_motion(prev_ascent, ascent);
+			auto xm_rotate_y = XMMatrixRotationY(-camera.yaw_rad);
+			auto xm_rotate_x = XMMatrixRotationX(-camera.pitch_rad);
+			auto xm_world_from_view = xm_change_of_basis * xm_rotate_y * xm_rotate_x;
+			auto xm_world_from_view_direction = XMMatrixTranspose(xm_world_from_view);
+
+			auto get_key_axis = [](bool is_positive_pressed, bool is_negative_pressed) {
+				return (is_positive_pressed ? 1.0f : 0.0f) - (is_negative_pressed ? 1.0f : 0.0f);
+			};
+			float a_target_velocity_vs[3] = {
+				camera_move_speed_mps * get_key_axis(gui_data.is_d_pressed, gui_data.is_a_pressed),
+				camera_move_speed_mps * get_key_axis(gui_data.is_e_pressed, gui_data.is_q_pressed),
+				camera_move_speed_mps * get_key_axis(gui_data.is_w_pressed, gui_data.is_s_pressed),
+			};
+
+			frame_timing::FrameTime frame_time = frame_timing::tick(simulation_clock, gui_data.is_fixed_delta_time_enabled);
+			float steps_per_60th = frame_time.fixed_step_s * 60.0f;
+			float acceleration_blend = pow(camera_acceleration_damping, steps_per_60th);
+			float deceleration_blend = pow(camera_deceleration_damping, steps_per_60th);
+			for(uint32_t step_index = 0; step_index < frame_time.num_fixed_steps; ++step_index) {
+				float *p_velocity_vs = &camera_motion.velocity_vs.x;
+				for(uint32_t axis = 0; axis < 3; ++axis) {
+					float blend = (abs(a_target_velocity_vs[axis]) > abs(p_velocity_vs[axis])) ? acceleration_blend : deceleration_blend;
+					p_velocity_vs[axis] = a_target_velocity_vs[axis] + (p_velocity_vs[axis] - a_target_velocity_vs[axis]) * blend;
+				}
+				auto xm_velocity_ws = XMVector3Transform(XMLoadFloat3(&camera_motion.velocity_vs), xm_world_from_view_direction);
+				camera_motion.previous_pos_ws = camera_motion.pos_ws;
+				XMStoreFloat3(&camera_motion.pos_ws, XMLoadFloat3(&camera_motion.pos_ws) + xm_velocity_ws * frame_time.fixed_step_s);
+			}
+			gui_data.frame_timing_statistics = simulation_clock.statistics;
 
 			{
-				// Left-handed +y : up, +x: right View Space -> Right-handed +z : up, -y: right World Space
-				static const XMMATRIX xm_change_of_basis = { 
-					0.0, 0.0,-1.0, 0,
-					1.0, 0.0, 0.0, 0,
-					0.0, 1.0, 0.0, 0,
-					0.0, 0.0, 0.0, 1.0
-				};
-
-				auto xm_rotate_y = XMMatrixRotationY(-camera.yaw_rad);
-				auto xm_rotate_x = XMMatrixRotationX(-camera.pitch_rad);
-				auto xm_world_from_view = xm_change_of_basis * xm_rotate_y * xm_rotate_x;
-
-				XMVECTOR xm_movement_vs = { strafe, ascent, forward };
-				auto xm_movement_ws = XMVector3Transform(xm_movement_vs, XMMatrixTranspose(xm_world_from_view));
-
-				XMVECTOR xm_offset = XMLoadFloat3(&camera.pos_ws);
-				xm_offset += xm_movement_ws;
+				XMVECTOR xm_offset = XMVectorLerp(XMLoadFloat3(&camera_motion.previous_pos_ws), XMLoadFloat3(&camera_motion.pos_ws), frame_time.interpolation_alpha);
 				XMStoreFloat3(&camera.pos_ws, xm_offset);
 
 				auto xm_translation = XMMatrixTranspose(XMMatrixTranslationFromVector(xm_offset));
@@ -730,31 +1630,126 @@ namespace scene_manager
 			gui_data.camera_pitch = camera.pitch_rad;
 			gui_data.camera_pos = camera.pos_ws;
 		}
-	}
 
-	const vector<DrawInfo>& get_opaque_draw_list() {
-		return scenes[current_scene_index]->opaque_draw_info_list;
+		// The two sorts share nothing but the camera, the opaque one runs as a job while this thread sorts the blended draws
+		{
+			const Scene &scene = *scenes[current_scene_index];
+			const vector<DrawInfo> *p_opaque_draws = &scene.opaque_draw_info_list;
+			const vector<DrawInfo> *p_alpha_blend_draws = &scene.alpha_blend_draw_info_list;
+			frame_packet.has_opaque_draws = false;
+			if(gui_data.is_occlusion_culling_enabled) {
+				cull_occluded_draws(scene, gui_data, frame_packet, v_visible_alpha_blend_draws);
+				p_opaque_draws = &frame_packet.v_opaque_draws;
+				p_alpha_blend_draws = &v_visible_alpha_blend_draws;
+				frame_packet.has_opaque_draws = true;
+			}
+			if(gui_data.is_lod_selection_enabled) {
+				gui_data.lod_selection_statistics = {};
+				select_lods(scene, gui_data, *p_opaque_draws, frame_packet.v_opaque_draws);
+				select_lods(scene, gui_data, *p_alpha_blend_draws, v_visible_alpha_blend_draws);
+				p_opaque_draws = &frame_packet.v_opaque_draws;
+				p_alpha_blend_draws = &v_visible_alpha_blend_draws;
+				frame_packet.has_opaque_draws = true;
+			}
+			if(gui_data.is_meshlet_culling_enabled) {
+				cull_meshlets(scene, gui_data, *p_opaque_draws, v_meshlet_culled_draws);
+				swap(frame_packet.v_opaque_draws, v_meshlet_culled_draws);
+				p_opaque_draws = &frame_packet.v_opaque_draws;
+				frame_packet.has_opaque_draws = true;
+			}
+			job_system::Counter sort_counter;
+			if(gui_data.is_front_to_back_sorting_enabled) {
+				job_system::run([&scene, p_opaque_draws, &frame_packet]() { sort_opaque_draws_front_to_back(scene, *p_opaque_draws, frame_packet.v_front_to_back_opaque_draws); }, sort_counter);
+			}
+			sort_alpha_blend_draws(*p_alpha_blend_draws, frame_packet.v_sorted_alpha_blend_draws);
+			job_system::wait(sort_counter);
+		}
+		frame_packet.camera = camera;
+		frame_packet.scene_index = current_scene_index;
+
+		if(gui_data.is_sort_benchmark_requested) {
+			auto result = draw_sort::run_benchmark();
+			gui_data.sort_benchmark_num_keys = result.num_keys;
+			gui_data.sort_benchmark_radix_sort_ms = result.radix_sort_ms;
+			gui_data.sort_benchmark_std_sort_ms = result.std_sort_ms;
+			gui_data.is_sort_benchmark_requested = false;
+		}
+
+		if(gui_data.is_job_benchmark_requested) {
+			gui_data.job_benchmark_result = job_system::run_benchmark();
+			gui_data.is_job_benchmark_requested = false;
+		}
+
+		if(gui_data.is_occlusion_benchmark_requested) {
+			const Scene &scene = *scenes[current_scene_index];
+			XMMATRIX xm_clip_from_world = XMMatrixMultiply(XMLoadFloat4x4(&camera.clip_from_view), XMLoadFloat4x4(&camera.view_from_world));
+			gui_data.occlusion_benchmark_result = occlusion_culler::run_benchmark(scene.occluder_mesh, scene.opaque_draw_info_list, xm_clip_from_world);
+			gui_data.is_occlusion_benchmark_requested = false;
+			gui_data.is_occlusion_benchmark_done = true;
+		}
+
+		if(gui_data.is_simplification_benchmark_requested) {
+			const Scene &scene = *scenes[current_scene_index];
+			auto& result = gui_data.simplification_benchmark_result;
+			result = mesh_simplifier::run_benchmark();
+			result.num_scene_lods = scene.num_lod_levels;
+			copy_n(scene.a_num_lod_triangles, max_lod_count, result.a_num_scene_triangles);
+			result.scene_lod_build_ms = scene.lod_build_ms;
+			gui_data.is_simplification_benchmark_requested = false;
+			gui_data.is_simplification_benchmark_done = true;
+		}
+
+		if(gui_data.is_meshlet_benchmark_requested) {
+			const Scene &scene = *scenes[current_scene_index];
+			auto& result = gui_data.meshlet_benchmark_result;
+			result = meshlet_builder::run_benchmark();
+			result.num_scene_meshlets = static_cast<uint32_t>(scene.v_meshlets.size());
+			for(auto& meshlet : scene.v_meshlets) {
+				result.num_scene_triangles += meshlet.index_count / 3;
+			}
+			result.scene_meshlet_build_ms = scene.meshlet_build_ms;
+			gui_data.is_meshlet_benchmark_requested = false;
+			gui_data.is_meshlet_benchmark_done = true;
+		}
+
+		gui_data.texture_cache_statistics = processed_texture_cache.statistics;
+		for(uint32_t scene_index = 0; scene_index < scenes.size(); ++scene_index) {
+			gui_data.a_scene_load_ms[scene_index] = scenes[scene_index]->load_ms;
+			gui_data.a_is_scene_mapped[scene_index] = scenes[scene_index]->is_mapped;
+			auto& v_image_timings = scenes[scene_index]->v_image_decode_timings;
+			gui_data.a_num_scene_image_decode_timings[scene_index] = min(static_cast<uint32_t>(v_image_timings.size()), max_image_decode_timing_count);
+			copy_n(v_image_timings.begin(), gui_data.a_num_scene_image_decode_timings[scene_index], gui_data.a_scene_image_decode_timings[scene_index]);
+		}
+		if(gui_data.is_gltf_load_comparison_requested) {
+			for(uint32_t scene_index = 0; scene_index < model_scene_count; ++scene_index) {
+				vector<ImageDecodeTiming> v_image_timings;
+				gui_data.a_gltf_load_timings[scene_index] = gltf_loader::compare_load_times(asset_folder + a_model_scene_descs[scene_index].p_asset_filename, v_image_timings);
+				gui_data.a_num_image_decode_timings[scene_index] = min(static_cast<uint32_t>(v_image_timings.size()), max_image_decode_timing_count);
+				copy_n(v_image_timings.begin(), gui_data.a_num_image_decode_timings[scene_index], gui_data.a_image_decode_timings[scene_index]);
+			}
+			gui_data.is_gltf_load_comparison_requested = false;
+			gui_data.is_gltf_load_comparison_done = true;
+		}
 	}
 
-	const vector<DrawInfo>& get_alpha_blend_draw_list() {
-		return scenes[current_scene_index]->alpha_blend_draw_info_list;
+	const vector<DrawInfo>& get_opaque_draw_list(uint32_t scene_index) {
+		return scenes[scene_index]->opaque_draw_info_list;
 	}
 
-	const vector<XMFLOAT4X4>& get_transformation_list() {
-		return scenes[current_scene_index]->node_transformations;
+	const vector<DrawInfo>& get_alpha_blend_draw_list(uint32_t scene_index) {
+		return scenes[scene_index]->alpha_blend_draw_info_list;
 	}
 
-	const vector<Material>& get_material_list() {
-		return scenes[current_scene_index]->materials;
+	const vector<uint32_t>& get_instance_transform_index_list(uint32_t scene_index) {
+		return scenes[scene_index]->instance_transform_indices;
 	}
 
-	const Camera& get_camera() {
-		return camera;
+	const vector<XMFLOAT4X4>& get_transformation_list(uint32_t scene_index) {
+		return scenes[scene_index]->node_transformations;
 	}
 
-	pair<uint32_t, uint32_t> get_scene_texture_usage() {
-		auto& p_scene = scenes[current_scene_index];
-		return make_pair(p_scene->start_index_into_textures,p_scene->num_used_textures);
+	const vector<Material>& get_material_list(uint32_t scene_index) {
+		return scenes[scene_index]->materials;
 	}
 
 } // namespace scene_amanger
\ No newline at end of file
@@ -8,14 +8,27 @@ struct PsOutput {
     float4 color : SV_TARGET;
 };
 
+cbuffer PerFrameConstants : register(b0) {
+    float4x4 clip_from_view;
+    float4x4 view_from_clip;
+    float4x4 view_from_world;
+    float4x4 world_from_view;
+    float3 cam_pos_ws;
+    float specular_max_mip_level;
+    // Slots in the bindless srv heap
+    uint brdf_lut_index;
+    uint radiance_index;
+    uint irradiance_index;
+    uint specular_index;
+    uint hdr_buffer_index;
+}
+
 cbuffer PerDrawConstants : register(b2) {
     uint background_index;
     uint mip_level;
 }
 
-TextureCube env_map_radiance    : register(t1, space1);
-TextureCube env_map_irradiance  : register(t2, space1);
-TextureCube env_map_specular    : register(t3, space1);
+TextureCube a_cube_textures[]   : register(t0, space1);
 
 SamplerState trilinear_clamp    : register(s0);
 
@@ -25,13 +38,13 @@ PsOutput ps_main(PsInput input)
     float3 radiance = 0;
     float3 view_ray_ws = normalize(input.view_ray_ws);
     if (background_index == 0) {
-        radiance = env_map_radiance.Sample(trilinear_clamp, view_ray_ws).rgb;
+        radiance = a_cube_textures[radiance_index].Sample(trilinear_clamp, view_ray_ws).rgb;
     }
     else if (background_index == 1) {
-        radiance = env_map_irradiance.Sample(trilinear_clamp, view_ray_ws).rgb;
+        radiance = a_cube_textures[irradiance_index].Sample(trilinear_clamp, view_ray_ws).rgb;
     }
     else {
-        radiance = env_map_specular.SampleLevel(trilinear_clamp, view_ray_ws, mip_level).rgb;
+        radiance = a_cube_textures[specular_index].SampleLevel(trilinear_clamp, view_ray_ws, mip_level).rgb;
     }
 
     // Gamma correction
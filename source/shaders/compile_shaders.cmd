@@ -0,0 +1,56 @@
+@echo off
+rem Compiles every shader variant used by the renderer into a header that embeds its bytecode as g_<variant name>.
+rem Usage: compile_shaders.cmd <path to fxc.exe> <output folder> <Debug|Release>
+setlocal
+
+set FXC=%~1
+set OUTPUT_FOLDER=%~2
+set FXC_FLAGS=/nologo /Zpr /enable_unbounded_descriptor_tables
+if /I "%~3"=="Debug" (set FXC_FLAGS=%FXC_FLAGS% /Zi /Od) else (set FXC_FLAGS=%FXC_FLAGS% /O3)
+
+if not exist "%OUTPUT_FOLDER%" mkdir "%OUTPUT_FOLDER%"
+pushd "%~dp0"
+
+rem              source file            entry     profile  variant name                 defines
+call :compile    pbs_vs.hlsl            vs_main   vs_5_1   pbs_vs                                                              || goto :failed
+call :compile    pbs_ps.hlsl            ps_main   ps_5_1   pbs_ps                                                              || goto :failed
+call :compile    depth_ps.hlsl          ps_main   ps_5_1   depth_alpha_test_ps          "/D ALPHA_TO_COVERAGE=0"                 || goto :failed
+call :compile    depth_ps.hlsl          ps_main   ps_5_1   depth_alpha_to_coverage_ps   "/D ALPHA_TO_COVERAGE=1"                 || goto :failed
+call :compile    full_screen_vs.hlsl    vs_main   vs_5_1   full_screen_vs                                                      || goto :failed
+call :compile    background_ps.hlsl     ps_main   ps_5_1   background_ps                                                       || goto :failed
+call :compile    copy_ps.hlsl           ps_main   ps_5_1   copy_ps                                                             || goto :failed
+call :compile    cull_cs.hlsl           cs_main   cs_5_1   cull_cs                                                             || goto :failed
+
+rem One pbs_ps.hlsl permutation per ShaderFeature combination, masked ones also get an alpha to coverage variant
+for /L %%p in (0,1,31) do (
+    call :compile pbs_ps.hlsl ps_main ps_5_1 pbs_ps_%%p "/D PERMUTATION=%%p /D ALPHA_TO_COVERAGE=0" || goto :failed
+)
+for /L %%p in (16,1,31) do (
+    call :compile pbs_ps.hlsl ps_main ps_5_1 pbs_alpha_to_coverage_ps_%%p "/D PERMUTATION=%%p /D ALPHA_TO_COVERAGE=1" || goto :failed
+)
+call :write_permutation_table > "%OUTPUT_FOLDER%\pbs_ps_permutations.h" || goto :failed
+
+popd
+exit /b 0
+
+:compile
+"%FXC%" %FXC_FLAGS% /T %3 /E %2 %~5 /Vn g_%4 /Fh "%OUTPUT_FOLDER%\%4.h" %1 > nul
+exit /b %errorlevel%
+
+:write_permutation_table
+echo // Generated by compile_shaders.cmd, indexed by the ShaderFeature bits of a material
+for /L %%p in (0,1,31) do echo #include "pbs_ps_%%p.h"
+for /L %%p in (16,1,31) do echo #include "pbs_alpha_to_coverage_ps_%%p.h"
+echo const D3D12_SHADER_BYTECODE a_pbs_ps_permutations[] = {
+for /L %%p in (0,1,31) do echo 	{ g_pbs_ps_%%p, sizeof(g_pbs_ps_%%p) },
+echo };
+echo const D3D12_SHADER_BYTECODE a_pbs_alpha_to_coverage_ps_permutations[] = {
+for /L %%p in (0,1,15) do echo 	{ nullptr, 0 },
+for /L %%p in (16,1,31) do echo 	{ g_pbs_alpha_to_coverage_ps_%%p, sizeof(g_pbs_alpha_to_coverage_ps_%%p) },
+echo };
+exit /b 0
+
+:failed
+popd
+echo compile_shaders.cmd: error: shader compilation failed
+exit /b 1
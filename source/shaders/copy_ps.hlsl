@@ -8,13 +8,28 @@ struct PsOutput {
     float4 color : SV_TARGET;
 };
 
-Texture2D hdr_buffer : register(t0, space0);
+cbuffer PerFrameConstants : register(b0) {
+    float4x4 clip_from_view;
+    float4x4 view_from_clip;
+    float4x4 view_from_world;
+    float4x4 world_from_view;
+    float3 cam_pos_ws;
+    float specular_max_mip_level;
+    // Slots in the bindless srv heap
+    uint brdf_lut_index;
+    uint radiance_index;
+    uint irradiance_index;
+    uint specular_index;
+    uint hdr_buffer_index;
+}
+
+Texture2D a_textures[] : register(t0, space2);
 SamplerState trilinear_clamp : register(s0);
 
 PsOutput ps_main(PsInput input) {
     PsOutput result = (PsOutput) 0;
 
-    float3 radiance = hdr_buffer.Sample(trilinear_clamp, input.uv).rgb;
+    float3 radiance = a_textures[hdr_buffer_index].Sample(trilinear_clamp, input.uv).rgb;
     // Gamma correction
     result.color = float4(pow(radiance, 1.0 / 2.2), 1.0);
     return result;
@@ -0,0 +1,66 @@
+// Layout must match draw_cull::IndirectCommand
+struct IndirectCommand {
+    uint first_instance_index;
+    uint material_index;
+    uint2 vbv_buffer_location;
+    uint vbv_size_in_bytes;
+    uint vbv_stride_in_bytes;
+    uint2 ibv_buffer_location;
+    uint ibv_size_in_bytes;
+    uint ibv_format;
+    uint index_count_per_instance;
+    uint instance_count;
+    uint start_index_location;
+    int base_vertex_location;
+    uint start_instance_location;
+    uint padding;
+};
+
+struct DrawBounds {
+    float4 center_ws;
+    float4 extents_ws;
+};
+
+cbuffer CullConstants : register(b0) {
+    float4 frustum_planes[6];
+}
+
+// One dispatch per pipeline state range, its survivors are compacted to the front of the range and counted in its own slot
+cbuffer CullRange : register(b1) {
+    uint first_draw;
+    uint num_draws;
+    uint range_index;
+}
+
+StructuredBuffer<IndirectCommand> input_commands    : register(t0);
+StructuredBuffer<DrawBounds> draw_bounds            : register(t1);
+RWStructuredBuffer<IndirectCommand> output_commands : register(u0);
+RWByteAddressBuffer output_command_count            : register(u1);
+
+bool is_inside_frustum(float3 center_ws, float3 extents_ws) {
+    [unroll]
+    for (uint plane_index = 0; plane_index < 6; ++plane_index) {
+        float4 plane = frustum_planes[plane_index];
+        float distance = dot(plane.xyz, center_ws) + plane.w;
+        float radius = dot(abs(plane.xyz), extents_ws);
+        if (distance + radius < 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+[numthreads(64, 1, 1)]
+void cs_main(uint3 dispatch_thread_id : SV_DispatchThreadID) {
+    if (dispatch_thread_id.x >= num_draws) {
+        return;
+    }
+    uint draw_index = first_draw + dispatch_thread_id.x;
+
+    DrawBounds bounds = draw_bounds[draw_index];
+    if (is_inside_frustum(bounds.center_ws.xyz, bounds.extents_ws.xyz)) {
+        uint output_index = 0;
+        output_command_count.InterlockedAdd(range_index * 4, 1, output_index);
+        output_commands[first_draw + output_index] = input_commands[draw_index];
+    }
+}
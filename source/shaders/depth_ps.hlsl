@@ -0,0 +1,75 @@
+
+struct MaterialData{
+    float4 base_color_factor;
+    float metallic_factor;
+    float roughness_factor;
+    float alpha_cutoff;
+    int base_color_texture_index;
+    int normal_texture_index;
+    int metallic_roughness_texture_index;
+    int emissive_texture_index;
+    int occlusion_texture_index;
+    int alpha_mode;
+    uint shader_permutation;
+    int2 padding;
+};
+
+cbuffer MaterialDataCB : register(b1) {
+    MaterialData a_material_data[32];
+}
+
+cbuffer PerDrawConstants : register(b2) {
+    uint first_instance_index;
+    uint material_index;
+    uint isolation_mode_index;
+    uint test_factor;
+}
+
+struct PsInput {
+    float4 pos_ss   : SV_POSITION;
+    float3 pos_vs   : POSITION_VS;
+    float3 pos_ws   : POSITION_WS;
+    float3 normal_ws: NORMAL_WS;
+    float2 uv       : TEXCOORD;
+    float4 tangent_ws: TANGENT_WS;
+};
+
+Texture2D a_textures[] : register(t0, space2);
+
+SamplerState aniso_wrap: register(s1);
+
+// Under MSAA, turns alpha into a coverage value with a sharp edge at the cutoff instead of a dithered ramp
+float sharpen_alpha_to_coverage(float alpha, float alpha_cutoff) {
+    return (alpha - alpha_cutoff) / max(fwidth(alpha), 0.0001) + 0.5;
+}
+
+#if ALPHA_TO_COVERAGE
+struct PsOutput {
+    float4 color    : SV_TARGET;
+};
+
+// Alpha to coverage depth-only pass for ALPHAMODE_MASK materials, the render target write mask is zero
+PsOutput ps_main(PsInput input) {
+    MaterialData mat_data = a_material_data[material_index];
+
+    float alpha = mat_data.base_color_factor.a;
+    if (mat_data.base_color_texture_index >= 0) {
+        alpha *= a_textures[mat_data.base_color_texture_index].Sample(aniso_wrap, input.uv).a;
+    }
+
+    PsOutput result = (PsOutput) 0;
+    result.color.a = sharpen_alpha_to_coverage(alpha, mat_data.alpha_cutoff);
+    return result;
+}
+#else
+// Alpha tested depth-only pass for ALPHAMODE_MASK materials, opaque materials use a null pixel shader
+void ps_main(PsInput input) {
+    MaterialData mat_data = a_material_data[material_index];
+
+    float alpha = mat_data.base_color_factor.a;
+    if (mat_data.base_color_texture_index >= 0) {
+        alpha *= a_textures[mat_data.base_color_texture_index].Sample(aniso_wrap, input.uv).a;
+    }
+    clip(alpha - mat_data.alpha_cutoff);
+}
+#endif
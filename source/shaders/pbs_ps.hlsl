@@ -5,19 +5,28 @@ cbuffer PerFrameConstants : register(b0) {
     float4x4 view_from_world;
     float4x4 world_from_view;
     float3 cam_pos_ws;
+    float specular_max_mip_level;
+    // Slots in the bindless srv heap
+    uint brdf_lut_index;
+    uint radiance_index;
+    uint irradiance_index;
+    uint specular_index;
+    uint hdr_buffer_index;
 }
 
 struct MaterialData{
     float4 base_color_factor;
     float metallic_factor;
     float roughness_factor;
-    float alpha_mask_cutoff;
+    float alpha_cutoff;
     int base_color_texture_index;
     int normal_texture_index;
     int metallic_roughness_texture_index;
     int emissive_texture_index;
     int occlusion_texture_index;
-    int is_alpha_masked;
+    int alpha_mode;
+    uint shader_permutation;
+    int2 padding;
 };
 
 cbuffer MaterialDataCB : register(b1) {
@@ -25,7 +34,7 @@ cbuffer MaterialDataCB : register(b1) {
 }
 
 cbuffer PerDrawConstants : register(b2) {
-    uint transform_index;
+    uint first_instance_index;
     uint material_index;
     uint isolation_mode_index;
     uint test_factor;
@@ -37,52 +46,48 @@ struct PsInput {
     float3 pos_ws   : POSITION_WS;
     float3 normal_ws: NORMAL_WS;
     float2 uv       : TEXCOORD;
+    float4 tangent_ws: TANGENT_WS;
 };
 
 struct PsOutput {
     float4 color    : SV_TARGET;
 };
 
-Texture2D env_brdf_lut          : register(t0, space1);
-TextureCube env_map_irradiance  : register(t2, space1);
-TextureCube env_map_specular    : register(t3, space1);
-
-Texture2D a_material_textures[] : register(t0, space2);
+// Both alias the whole bindless srv heap
+TextureCube a_cube_textures[]   : register(t0, space1);
+Texture2D a_textures[]          : register(t0, space2);
 
 SamplerState trilinear_clamp    : register(s0);
 SamplerState aniso_wrap: register(s1);
 
 static const float k_min_roughness = 0.04;
-
-// See http://www.thetenthplanet.de/archives/1180
-float3x3 cotangent_frame(float3 normal_ws, float3 pos_ws, float2 uv) {
-    // get edge vectors of the pixel triangle
-    float3 dp1 = ddx_fine(pos_ws);
-    float3 dp2 = ddy_fine(pos_ws);
-    float2 duv1 = ddx_fine(uv);
-    float2 duv2 = ddy_fine(uv);
- 
-    // solve the linear system
-    float3 dp2perp = cross(dp2, normal_ws);
-    float3 dp1perp = cross(normal_ws, dp1);
-    float3 tangent_ws = dp2perp * duv1.x + dp1perp * duv2.x;
-    float3 bitangent_ws = dp2perp * duv1.y + dp1perp * duv2.y;
- 
-    // construct a scale-invariant frame 
-    float inv_max = 1.0 / sqrt(max(dot(tangent_ws, tangent_ws), dot(bitangent_ws, bitangent_ws)));
-    //float3x3(tangent_ws * inv_max, bitangent_ws * inv_max, normal_ws) INVESTIGATE the difference!
-    return transpose(float3x3(bitangent_ws * inv_max, tangent_ws * inv_max,  normal_ws));
-}
-
+static const int k_alpha_mode_mask = 1;
+
+// Feature bits of a shader permutation, must match ShaderFeature in common.cpp
+#define FEATURE_BASE_COLOR_TEXTURE          0x1
+#define FEATURE_NORMAL_TEXTURE              0x2
+#define FEATURE_METALLIC_ROUGHNESS_TEXTURE  0x4
+#define FEATURE_EMISSIVE_TEXTURE            0x8
+#define FEATURE_ALPHA_MASK                  0x10
+
+#if defined(PERMUTATION)
+// Features are known at compile time so the branches of absent features fold away
+#define HAS_FEATURE(feature, runtime_condition) ((PERMUTATION & (feature)) != 0)
+#else
+// Uber variant for the isolation modes and for materials whose permutation is still compiling, features are resolved per material
+#define HAS_FEATURE(feature, runtime_condition) (runtime_condition)
+#endif
+
+// Tangents are MikkTSpace ones from the vertex stream, the bitangent is rebuilt with the glTF convention
 float3 compute_normal(PsInput input, float3 normal_ws, Texture2D normal_texture) {
-    float3x3 world_from_tangent = cotangent_frame(normal_ws, input.pos_ws, input.uv); 
-    float3 normal_ts = normalize(normal_texture.Sample(aniso_wrap, input.uv).rgb * 2.0 - 1.0);
-    normal_ws = normalize(mul(world_from_tangent, normal_ts));
+    float3 tangent_ws = normalize(input.tangent_ws.xyz);
+    float3 bitangent_ws = cross(normal_ws, tangent_ws) * input.tangent_ws.w;
+    float3 normal_ts = normal_texture.Sample(aniso_wrap, input.uv).rgb * 2.0 - 1.0;
+    normal_ws = normalize(normal_ts.x * tangent_ws + normal_ts.y * bitangent_ws + normal_ts.z * normal_ws);
     
     return normal_ws;
 }
 
-
 float3 f_schlick_roughness(float cos_theta, float3 F0, float roughness) {
     return F0 + ( max((float3)(1.0 - roughness), F0) - F0 ) * pow(1.0 - cos_theta, 5.0);
 }
@@ -91,29 +96,43 @@ float3 specular_reflection(float reflectance0, float reflectance90, float VdotH)
     return reflectance0 + (reflectance90 - reflectance0) * pow(clamp(1.0 - VdotH, 0.0, 1.0), 5.0);
 }
 
+// Under MSAA, turns alpha into a coverage value with a sharp edge at the cutoff instead of a dithered ramp
+float sharpen_alpha_to_coverage(float alpha, float alpha_cutoff) {
+    return (alpha - alpha_cutoff) / max(fwidth(alpha), 0.0001) + 0.5;
+}
+
 PsOutput ps_main(PsInput input) {
     
     PsOutput result = (PsOutput) 0;
     MaterialData mat_data = a_material_data[material_index];
     
     float4 base_color = mat_data.base_color_factor;
-    if (mat_data.base_color_texture_index >= 0) {
-        base_color *= a_material_textures[mat_data.base_color_texture_index].Sample(aniso_wrap, input.uv);
+    if (HAS_FEATURE(FEATURE_BASE_COLOR_TEXTURE, mat_data.base_color_texture_index >= 0)) {
+        base_color *= a_textures[mat_data.base_color_texture_index].Sample(aniso_wrap, input.uv);
+    }
+    bool is_alpha_masked = HAS_FEATURE(FEATURE_ALPHA_MASK, mat_data.alpha_mode == k_alpha_mode_mask);
+#if !ALPHA_TO_COVERAGE
+    if (is_alpha_masked) {
+        clip(base_color.a - mat_data.alpha_cutoff);
     }
+#endif
 
     float metallic = mat_data.metallic_factor;
     float roughness = mat_data.roughness_factor;
-    if (mat_data.metallic_roughness_texture_index >= 0) {
-        float2 metallic_roughness = a_material_textures[mat_data.metallic_roughness_texture_index].Sample(aniso_wrap, input.uv).bg; // WARNING! it is called metallicRoughnes texture but mapped to out of order channels: roughness -> g, metallic -> b!
-        metallic *= metallic_roughness.x;
-        roughness *= metallic_roughness.y;
+    float occlusion = 1.0;
+    if (HAS_FEATURE(FEATURE_METALLIC_ROUGHNESS_TEXTURE, mat_data.metallic_roughness_texture_index >= 0)) {
+        // Packed at load time: occlusion -> r, roughness -> g, metallic -> b, channels without a source image are 1
+        float3 orm = a_textures[mat_data.metallic_roughness_texture_index].Sample(aniso_wrap, input.uv).rgb;
+        occlusion = orm.r;
+        metallic *= orm.b;
+        roughness *= orm.g;
     }
     metallic = clamp(metallic, 0.0, 1.0);
     roughness = clamp(roughness, k_min_roughness, 1.0);
 
     float3 normal_ws = normalize(input.normal_ws);
-    if (mat_data.normal_texture_index >= 0) {
-        normal_ws = compute_normal(input, normal_ws, a_material_textures[mat_data.normal_texture_index]);  
+    if (HAS_FEATURE(FEATURE_NORMAL_TEXTURE, mat_data.normal_texture_index >= 0)) {
+        normal_ws = compute_normal(input, normal_ws, a_textures[mat_data.normal_texture_index]);  
     }
 
     float3 f0 = 0.04;
@@ -125,26 +144,24 @@ PsOutput ps_main(PsInput input) {
     float3 reflected_ws = -normalize(reflect(view_ws, normal_ws));
     float NdotV = clamp(abs(dot(normal_ws, view_ws)), 0.001, 1.0);
 
-    float2 brdf = env_brdf_lut.Sample(trilinear_clamp, float2(NdotV, 1.0 - roughness)).xy;
-    float3 diffuse_irradiance = env_map_irradiance.Sample(trilinear_clamp, normal_ws).rgb;
-    
-    uint mip_level = 0, width = 0, height = 0, mip_count = 0;
-    env_map_specular.GetDimensions(mip_level, width, height, mip_count);
-    float3 specular_irradiance = env_map_specular.SampleLevel(trilinear_clamp, reflected_ws, roughness * (mip_count - 1)).rgb;
+    float2 brdf = a_textures[brdf_lut_index].Sample(trilinear_clamp, float2(NdotV, 1.0 - roughness)).xy;
+    float3 diffuse_irradiance = a_cube_textures[irradiance_index].Sample(trilinear_clamp, normal_ws).rgb;
+    float3 specular_irradiance = a_cube_textures[specular_index].SampleLevel(trilinear_clamp, reflected_ws, roughness * specular_max_mip_level).rgb;
 
     float3 diffuse = diffuse_irradiance * diffuse_color;
     float3 specular = specular_irradiance * (specular_color * brdf.x + brdf.y);
 
-    float3 color = diffuse + specular;
+    float3 color = (diffuse + specular) * occlusion;
 
     float3 emission = 0;
-    if (mat_data.emissive_texture_index >= 0) {
-        emission = a_material_textures[mat_data.emissive_texture_index].Sample(aniso_wrap, input.uv).rgb;
+    if (HAS_FEATURE(FEATURE_EMISSIVE_TEXTURE, mat_data.emissive_texture_index >= 0)) {
+        emission = a_textures[mat_data.emissive_texture_index].Sample(aniso_wrap, input.uv).rgb;
         color += emission;
     }
  
     result.color = float4(color.rgb, base_color.a);
-    
+
+#if !defined(PERMUTATION)
     switch (isolation_mode_index) {
         case 1: result.color = base_color; break;
         case 2: result.color = (float4) metallic; break;
@@ -154,8 +171,13 @@ PsOutput ps_main(PsInput input) {
         case 6: result.color = float4(emission, 1.0); break;
         case 7: result.color = float4(diffuse, 1.0); break;
         case 8: result.color = float4(specular, 1.0); break;
+        case 9: result.color = (float4) occlusion; break;
         default: break;
     }
+#endif
+#if ALPHA_TO_COVERAGE
+    result.color.a = sharpen_alpha_to_coverage(base_color.a, mat_data.alpha_cutoff);
+#endif
         
     return result;
 }
@@ -12,13 +12,16 @@ cbuffer Transformations : register(b1) {
 }
 
 cbuffer PerDrawConstants : register(b2) {
-    uint transform_index;
+    uint first_instance_index;
 }
 
+StructuredBuffer<uint> a_instance_transform_indices : register(t0, space3);
+
 struct VsInput {
     float3 pos_os   : POSITION;
     float3 normal_os: NORMAL;
     float2 uv       : UV;
+    float4 tangent_os: TANGENT;
 };
 
 struct VsOutput {
@@ -27,12 +30,14 @@ struct VsOutput {
     float3 pos_ws   : POSITION_WS;
     float3 normal_ws: NORMAL_WS;
     float2 uv       : TEXCOORD;
+    float4 tangent_ws: TANGENT_WS;
 };
 
-VsOutput vs_main(VsInput input) {
+VsOutput vs_main(VsInput input, uint instance_id : SV_InstanceID) {
     
     VsOutput result = (VsOutput) 0;
     
+    uint transform_index = a_instance_transform_indices[first_instance_index + instance_id];
     float4x4 world_from_object = a_world_from_object[transform_index];
     float3 pos_ws = mul(world_from_object, float4(input.pos_os, 1.0)).xyz;
     float3 pos_vs = mul(view_from_world, float4(pos_ws, 1.0)).xyz;
@@ -42,6 +47,9 @@ VsOutput vs_main(VsInput input) {
     result.pos_cs = mul(clip_from_view, float4(pos_vs, 1.0));
     result.normal_ws = mul(world_from_object, float4(normalize(input.normal_os), 0.0)).xyz;// assume uniform scale
     result.uv = input.uv;
+    // A mirroring transform flips the bitangent as well
+    float handedness = determinant((float3x3) world_from_object) < 0.0 ? -input.tangent_os.w : input.tangent_os.w;
+    result.tangent_ws = float4(mul(world_from_object, float4(input.tangent_os.xyz, 0.0)).xyz, handedness);
 
     return result;
 }
@@ -0,0 +1,120 @@
+namespace texture_cache
+{
+	// Processed textures keyed by what they were made from: the encoded bytes of their source images and the way they were processed.
+	// In memory a key maps to the renderer texture that already holds it, so scenes share its slot and descriptor.
+	// On disk a key maps to an .octrn file with the whole mip chain, so a later launch uploads it without decoding anything.
+	// The folder is kept under a size limit by deleting the least recently used files, a hit refreshes the write time of its file.
+	// Bump key_version whenever the processing of textures changes so that stale files are never hit.
+	constexpr uint32_t key_version{ 1 };
+
+	struct FileEntry {
+		string file_name;
+		uint64_t size;
+		uint64_t last_used_time;
+	};
+
+	struct Cache {
+		string folder;
+		map<uint64_t, uint32_t> tex_indices_by_key;
+		TextureCacheStatistics statistics;
+	};
+
+	void init(Cache &cache, const string &folder) {
+		cache = {};
+		cache.folder = folder;
+		CreateDirectoryA(folder.c_str(), nullptr);
+	}
+
+	string get_file_address(const Cache &cache, uint64_t key) {
+		char a_file_name[32];
+		snprintf(a_file_name, sizeof(a_file_name), "%016llx.octrn", static_cast<unsigned long long>(key));
+		return cache.folder + a_file_name;
+	}
+
+	bool find_texture(Cache &cache, uint64_t key, uint32_t &tex_index) {
+		auto it = cache.tex_indices_by_key.find(key);
+		if(it == cache.tex_indices_by_key.end()) { return false; }
+		tex_index = it->second;
+		cache.statistics.num_memory_hits++;
+		return true;
+	}
+
+	void add_texture(Cache &cache, uint64_t key, uint32_t tex_index) {
+		cache.tex_indices_by_key[key] = tex_index;
+	}
+
+	// Returns false when there is no file for the key, otherwise marks the file as used now
+	bool find_file(Cache &cache, uint64_t key, string &file_address) {
+		file_address = get_file_address(cache, key);
+		HANDLE h_file = CreateFileA(file_address.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if(h_file == INVALID_HANDLE_VALUE) { return false; }
+		FILETIME now;
+		GetSystemTimeAsFileTime(&now);
+		SetFileTime(h_file, nullptr, nullptr, &now);
+		CloseHandle(h_file);
+		return true;
+	}
+
+	// The file is written under a temporary name and renamed, a launch that dies halfway never leaves a truncated file behind.
+	// Failing to write only costs the next launch the processing, so errors are not reported.
+	void store_file(Cache &cache, uint64_t key, OctarineImageHeader header, const void *p_data) {
+		string file_address = get_file_address(cache, key);
+		string temporary_file_address = file_address + ".tmp";
+		if(octarine_image_write_to_file(temporary_file_address.c_str(), &header, p_data) != OCTARINE_IMAGE::OCTARINE_IMAGE_OK ||
+			!MoveFileExA(temporary_file_address.c_str(), file_address.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+			DeleteFileA(temporary_file_address.c_str());
+			return;
+		}
+		cache.statistics.num_stored_files++;
+	}
+
+	// Least recently used entries first until the rest fits into max_size, nothing here touches the file system
+	vector<uint32_t> select_evictions(const vector<FileEntry> &v_entries, uint64_t max_size) {
+		uint64_t size = 0;
+		vector<uint32_t> v_entry_indices(v_entries.size());
+		for(uint32_t entry_index = 0; entry_index < v_entries.size(); ++entry_index) {
+			v_entry_indices[entry_index] = entry_index;
+			size += v_entries[entry_index].size;
+		}
+		sort(v_entry_indices.begin(), v_entry_indices.end(), [&](uint32_t a, uint32_t b) {
+			return v_entries[a].last_used_time < v_entries[b].last_used_time;
+		});
+
+		vector<uint32_t> v_evict_indices;
+		for(uint32_t entry_index : v_entry_indices) {
+			if(size <= max_size) { break; }
+			size -= v_entries[entry_index].size;
+			v_evict_indices.push_back(entry_index);
+		}
+		return v_evict_indices;
+	}
+
+	void evict(Cache &cache, uint64_t max_size) {
+		vector<FileEntry> v_entries;
+		WIN32_FIND_DATAA find_data;
+		HANDLE h_find = FindFirstFileA((cache.folder + "*.octrn").c_str(), &find_data);
+		if(h_find != INVALID_HANDLE_VALUE) {
+			do {
+				FileEntry entry;
+				entry.file_name = find_data.cFileName;
+				entry.size = (uint64_t(find_data.nFileSizeHigh) << 32) | find_data.nFileSizeLow;
+				entry.last_used_time = (uint64_t(find_data.ftLastWriteTime.dwHighDateTime) << 32) | find_data.ftLastWriteTime.dwLowDateTime;
+				v_entries.push_back(move(entry));
+			} while(FindNextFileA(h_find, &find_data));
+			FindClose(h_find);
+		}
+
+		cache.statistics.num_files = static_cast<uint32_t>(v_entries.size());
+		cache.statistics.disk_size = 0;
+		for(auto& entry : v_entries) {
+			cache.statistics.disk_size += entry.size;
+		}
+		for(uint32_t entry_index : select_evictions(v_entries, max_size)) {
+			if(DeleteFileA((cache.folder + v_entries[entry_index].file_name).c_str())) {
+				cache.statistics.num_files--;
+				cache.statistics.disk_size -= v_entries[entry_index].size;
+				cache.statistics.num_evicted_files++;
+			}
+		}
+	}
+} // namespace texture_cache
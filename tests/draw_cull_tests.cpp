@@ -0,0 +1,191 @@
+namespace draw_cull_tests
+{
+	using draw_cull::IndirectCommand;
+	using draw_cull::DrawBounds;
+
+	// The camera the scene manager would build looking from eye along dir, its matrices post-multiplied like the scene manager's
+	Camera make_camera(XMVECTOR xm_eye, XMVECTOR xm_dir, float fov_degrees, float aspect_ratio) {
+		Camera camera = {};
+		XMMATRIX xm_view_from_world = XMMatrixLookToLH(xm_eye, xm_dir, XMVectorSet(0.f, 1.f, 0.f, 0.f));
+		XMMATRIX xm_clip_from_view = XMMatrixPerspectiveFovLH(XMConvertToRadians(fov_degrees), aspect_ratio, 0.1f, 100.f);
+		XMStoreFloat4x4(&camera.view_from_world, XMMatrixTranspose(xm_view_from_world));
+		XMStoreFloat4x4(&camera.clip_from_view, XMMatrixTranspose(xm_clip_from_view));
+		return camera;
+	}
+
+	DrawBounds make_bounds(XMFLOAT3 center, XMFLOAT3 extents) {
+		return { XMFLOAT4(center.x, center.y, center.z, 1.f), XMFLOAT4(extents.x, extents.y, extents.z, 0.f) };
+	}
+
+	// The clip space inequalities -w <= x <= w, -w <= y <= w and 0 <= z <= w as values that are negative outside, in the order
+	// of the extracted planes
+	array<float, 6> get_clip_margins(const Camera &camera, XMVECTOR xm_position_ws) {
+		XMMATRIX xm_clip_from_world = XMMatrixMultiply(XMLoadFloat4x4(&camera.clip_from_view), XMLoadFloat4x4(&camera.view_from_world));
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(XMVectorSetW(xm_position_ws, 1.f), XMMatrixTranspose(xm_clip_from_world)));
+		return { clip.w + clip.x, clip.w - clip.x, clip.w + clip.y, clip.w - clip.y, clip.z, clip.w - clip.z };
+	}
+
+	// A box is culled when all of its corners are outside one clip plane, boxes with a corner within tolerance of the plane
+	// that decides are left undecided
+	enum Expectation { EXPECT_VISIBLE, EXPECT_CULLED, EXPECT_EITHER };
+
+	Expectation get_expectation(const Camera &camera, const DrawBounds &bounds) {
+		constexpr float margin_tolerance{ 1e-3f };
+		array<float, 6> a_max_margins;
+		a_max_margins.fill(-FLT_MAX);
+		for(uint32_t corner = 0; corner < 8; ++corner) {
+			XMVECTOR xm_corner = XMVectorSet(
+				bounds.center_ws.x + ((corner & 1) ? bounds.extents_ws.x : -bounds.extents_ws.x),
+				bounds.center_ws.y + ((corner & 2) ? bounds.extents_ws.y : -bounds.extents_ws.y),
+				bounds.center_ws.z + ((corner & 4) ? bounds.extents_ws.z : -bounds.extents_ws.z), 1.f);
+			array<float, 6> a_margins = get_clip_margins(camera, xm_corner);
+			for(uint32_t plane_index = 0; plane_index < 6; ++plane_index) {
+				a_max_margins[plane_index] = max(a_max_margins[plane_index], a_margins[plane_index]);
+			}
+		}
+		float min_max_margin = *min_element(a_max_margins.begin(), a_max_margins.end());
+		if(abs(min_max_margin) < margin_tolerance) { return EXPECT_EITHER; }
+		return (min_max_margin < 0.f) ? EXPECT_CULLED : EXPECT_VISIBLE;
+	}
+
+	// Each command carries the index of its draw, so that the compacted output shows which draws survived in which order.
+	// Slots past the returned count keep their marker.
+	uint32_t cull(const Camera &camera, const vector<DrawBounds> &v_bounds, vector<IndirectCommand> &v_dst_commands) {
+		constexpr uint32_t untouched_marker{ 0xFFFFFFFF };
+		uint32_t num_draws = static_cast<uint32_t>(v_bounds.size());
+		vector<IndirectCommand> v_src_commands(num_draws);
+		for(uint32_t draw_index = 0; draw_index < num_draws; ++draw_index) {
+			v_src_commands[draw_index] = {};
+			v_src_commands[draw_index].first_instance_index = draw_index;
+			v_src_commands[draw_index].draw_arguments.IndexCountPerInstance = 3 * draw_index;
+		}
+		IndirectCommand untouched = {};
+		untouched.first_instance_index = untouched_marker;
+		v_dst_commands.assign(num_draws, untouched);
+
+		XMFLOAT4 a_planes[6];
+		draw_cull::extract_frustum_planes(camera, a_planes);
+		uint32_t num_visible_draws = draw_cull::cull_draws(a_planes, v_src_commands.data(), v_bounds.data(), num_draws, v_dst_commands.data());
+		uint32_t num_touched_slots = 0;
+		for(auto& command : v_dst_commands) {
+			num_touched_slots += (command.first_instance_index != untouched_marker) ? 1 : 0;
+		}
+		CHECK(num_visible_draws <= num_draws && num_touched_slots == num_visible_draws);
+		return num_visible_draws;
+	}
+
+	// Planes point inwards with unit normals and agree with the clip space inequalities for points away from them
+	void test_planes() {
+		mt19937 generator(27);
+		uniform_real_distribution<float> position(-60.f, 60.f), fov(20.f, 100.f), aspect_ratio(0.5f, 2.5f);
+		uint32_t num_unnormalized_planes = 0;
+		uint32_t num_disagreements = 0;
+		for(uint32_t camera_index = 0; camera_index < 16; ++camera_index) {
+			XMVECTOR xm_eye = XMVectorSet(position(generator), position(generator), position(generator), 1.f);
+			XMVECTOR xm_dir = XMVectorSet(position(generator), position(generator) * 0.5f, position(generator), 0.f);
+			Camera camera = make_camera(xm_eye, xm_dir, fov(generator), aspect_ratio(generator));
+			XMFLOAT4 a_planes[6];
+			draw_cull::extract_frustum_planes(camera, a_planes);
+			for(auto& plane : a_planes) {
+				num_unnormalized_planes += (abs(XMVectorGetX(XMVector3Length(XMLoadFloat4(&plane))) - 1.f) < 1e-5f) ? 0 : 1;
+			}
+			for(uint32_t point_index = 0; point_index < 256; ++point_index) {
+				XMVECTOR xm_point = XMVectorSet(position(generator), position(generator), position(generator), 1.f);
+				array<float, 6> a_margins = get_clip_margins(camera, xm_point);
+				for(uint32_t plane_index = 0; plane_index < 6; ++plane_index) {
+					float distance = XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&a_planes[plane_index]), xm_point));
+					bool is_undecided = abs(a_margins[plane_index]) < 1e-3f;
+					num_disagreements += (is_undecided || (distance < 0.f) == (a_margins[plane_index] < 0.f)) ? 0 : 1;
+				}
+			}
+		}
+		CHECK(num_unnormalized_planes == 0);
+		CHECK(num_disagreements == 0);
+	}
+
+	// Looking down +z from the origin: boxes in front are kept, boxes behind the eye, between it and the near plane, past the
+	// far plane or off to a side are culled, and boxes whose center is outside but which reach into the frustum are kept
+	void test_boxes() {
+		Camera camera = make_camera(XMVectorSet(0.f, 0.f, 0.f, 1.f), XMVectorSet(0.f, 0.f, 1.f, 0.f), 90.f, 1.f);
+		vector<pair<DrawBounds, bool>> v_cases = {
+			{ make_bounds({ 0.f, 0.f, 10.f }, { 1.f, 1.f, 1.f }), true },
+			{ make_bounds({ 4.f, -3.f, 20.f }, { 0.5f, 0.5f, 0.5f }), true },
+			{ make_bounds({ 0.f, 0.f, 50.f }, { 40.f, 40.f, 40.f }), true },
+			{ make_bounds({ 0.f, 0.f, -10.f }, { 1.f, 1.f, 1.f }), false },
+			{ make_bounds({ 0.f, 0.f, 120.f }, { 1.f, 1.f, 1.f }), false },
+			{ make_bounds({ -30.f, 0.f, 10.f }, { 1.f, 1.f, 1.f }), false },
+			{ make_bounds({ 0.f, 30.f, 10.f }, { 1.f, 1.f, 1.f }), false },
+			{ make_bounds({ -12.f, 0.f, 10.f }, { 3.f, 1.f, 1.f }), true },
+			{ make_bounds({ 0.f, -11.f, 10.f }, { 1.f, 2.f, 1.f }), true },
+			{ make_bounds({ 0.f, 0.f, -2.f }, { 1.f, 1.f, 3.f }), true },
+			{ make_bounds({ 0.f, 0.f, 99.f }, { 1.f, 1.f, 2.f }), true },
+			{ make_bounds({ 0.f, 0.f, 0.05f }, { 0.01f, 0.01f, 0.02f }), false },
+		};
+		vector<DrawBounds> v_bounds;
+		for(auto& [bounds, is_visible] : v_cases) {
+			CHECK(get_expectation(camera, bounds) == (is_visible ? EXPECT_VISIBLE : EXPECT_CULLED));
+			v_bounds.push_back(bounds);
+		}
+
+		vector<IndirectCommand> v_dst_commands;
+		uint32_t num_visible_draws = cull(camera, v_bounds, v_dst_commands);
+		vector<uint32_t> v_visible_draws;
+		for(uint32_t command_index = 0; command_index < num_visible_draws; ++command_index) {
+			v_visible_draws.push_back(v_dst_commands[command_index].first_instance_index);
+		}
+		CHECK((v_visible_draws == vector<uint32_t>{ 0, 1, 2, 7, 8, 9, 10 }));
+		CHECK(num_visible_draws > 0 && v_dst_commands[num_visible_draws - 1].draw_arguments.IndexCountPerInstance == 30);
+
+		CHECK(cull(camera, {}, v_dst_commands) == 0);
+	}
+
+	// Random boxes seen by random cameras: the survivors are exactly the boxes not wholly outside a clip plane, in input order
+	void test_random_boxes() {
+		mt19937 generator(27);
+		uniform_real_distribution<float> position(-60.f, 60.f), extent(0.05f, 12.f), fov(20.f, 100.f), aspect_ratio(0.5f, 2.5f);
+		uint32_t num_wrongly_culled_draws = 0;
+		uint32_t num_wrongly_kept_draws = 0;
+		uint32_t num_order_violations = 0;
+		uint32_t num_culled_draws = 0;
+		uint32_t num_kept_draws = 0;
+		for(uint32_t camera_index = 0; camera_index < 32; ++camera_index) {
+			XMVECTOR xm_eye = XMVectorSet(position(generator), position(generator), position(generator), 1.f);
+			XMVECTOR xm_dir = XMVectorSet(position(generator), position(generator) * 0.5f, position(generator), 0.f);
+			Camera camera = make_camera(xm_eye, xm_dir, fov(generator), aspect_ratio(generator));
+			vector<DrawBounds> v_bounds(512);
+			for(auto& bounds : v_bounds) {
+				bounds = make_bounds({ position(generator), position(generator), position(generator) }, { extent(generator), extent(generator), extent(generator) });
+			}
+
+			vector<IndirectCommand> v_dst_commands;
+			uint32_t num_visible_draws = cull(camera, v_bounds, v_dst_commands);
+			vector<bool> v_is_kept(v_bounds.size(), false);
+			for(uint32_t command_index = 0; command_index < num_visible_draws; ++command_index) {
+				uint32_t draw_index = v_dst_commands[command_index].first_instance_index;
+				num_order_violations += (draw_index < v_bounds.size() && (command_index == 0 || draw_index > v_dst_commands[command_index - 1].first_instance_index)) ? 0 : 1;
+				num_order_violations += (v_dst_commands[command_index].draw_arguments.IndexCountPerInstance == 3 * draw_index) ? 0 : 1;
+				if(draw_index < v_bounds.size()) {
+					v_is_kept[draw_index] = true;
+				}
+			}
+			for(uint32_t draw_index = 0; draw_index < v_bounds.size(); ++draw_index) {
+				Expectation expectation = get_expectation(camera, v_bounds[draw_index]);
+				num_wrongly_culled_draws += (expectation == EXPECT_VISIBLE && !v_is_kept[draw_index]) ? 1 : 0;
+				num_wrongly_kept_draws += (expectation == EXPECT_CULLED && v_is_kept[draw_index]) ? 1 : 0;
+				num_culled_draws += v_is_kept[draw_index] ? 0 : 1;
+				num_kept_draws += v_is_kept[draw_index] ? 1 : 0;
+			}
+		}
+		CHECK(num_wrongly_culled_draws == 0);
+		CHECK(num_wrongly_kept_draws == 0);
+		CHECK(num_order_violations == 0);
+		CHECK(num_culled_draws > 0 && num_kept_draws > 0);
+	}
+
+	void run() {
+		test_planes();
+		test_boxes();
+		test_random_boxes();
+	}
+} // namespace draw_cull_tests
@@ -0,0 +1,154 @@
+namespace gltf_loader_tests
+{
+	// The parts of a one triangle document the cases below replace, the defaults describe the bin chunk of make_bin()
+	struct DocumentJson {
+		string buffers = R"([{ "byteLength": 44 }])";
+		string buffer_views = R"([{ "buffer": 0, "byteOffset": 0, "byteLength": 36 }, { "buffer": 0, "byteOffset": 36, "byteLength": 6 }])";
+		string accessors = R"([{ "bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3", "min": [0, 0, 0], "max": [1, 1, 0] },
+			{ "bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR" }])";
+		string meshes = R"([{ "primitives": [{ "attributes": { "POSITION": 0 }, "indices": 1 }] }])";
+		string images = "[]";
+	};
+
+	const float a_positions[9] = { 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f };
+	const uint16_t a_indices[3] = { 0, 1, 2 };
+
+	string make_json(const DocumentJson &document_json) {
+		return R"({ "asset": { "version": "2.0" }, "buffers": )" + document_json.buffers + R"(, "bufferViews": )" + document_json.buffer_views +
+			R"(, "accessors": )" + document_json.accessors + R"(, "meshes": )" + document_json.meshes + R"(, "images": )" + document_json.images +
+			R"(, "nodes": [{ "mesh": 0 }], "scenes": [{ "nodes": [0] }], "scene": 0 })";
+	}
+
+	// The positions followed by the indices and two bytes of padding
+	vector<uint8_t> make_bin() {
+		vector<uint8_t> v_bin(44, 0);
+		memcpy(v_bin.data(), a_positions, sizeof(a_positions));
+		memcpy(v_bin.data() + sizeof(a_positions), a_indices, sizeof(a_indices));
+		return v_bin;
+	}
+
+	// Chunks padded to 4 bytes as the glb layout has them, the json with spaces and the bin chunk with zeros
+	vector<uint8_t> make_glb(string json, vector<uint8_t> v_bin) {
+		json.resize((json.size() + 3) & ~size_t(3), ' ');
+		v_bin.resize((v_bin.size() + 3) & ~size_t(3), 0);
+		vector<uint8_t> v_glb;
+		auto append = [&v_glb](const void *p_data, size_t size) {
+			v_glb.insert(v_glb.end(), reinterpret_cast<const uint8_t*>(p_data), reinterpret_cast<const uint8_t*>(p_data) + size);
+		};
+		uint32_t total_size = static_cast<uint32_t>(gltf_loader::glb_header_size + gltf_loader::glb_chunk_header_size + json.size() + (v_bin.empty() ? 0 : gltf_loader::glb_chunk_header_size + v_bin.size()));
+		uint32_t a_header[3] = { gltf_loader::glb_magic, 2, total_size };
+		append(a_header, sizeof(a_header));
+		uint32_t a_json_chunk_header[2] = { static_cast<uint32_t>(json.size()), gltf_loader::glb_chunk_type_json };
+		append(a_json_chunk_header, sizeof(a_json_chunk_header));
+		append(json.data(), json.size());
+		if(!v_bin.empty()) {
+			uint32_t a_bin_chunk_header[2] = { static_cast<uint32_t>(v_bin.size()), gltf_loader::glb_chunk_type_bin };
+			append(a_bin_chunk_header, sizeof(a_bin_chunk_header));
+			append(v_bin.data(), v_bin.size());
+		}
+		return v_glb;
+	}
+
+	// Writes the bytes to a file and loads it with the mapped path, check gets the document while the file is still mapped.
+	// A failed load has to say why.
+	template<typename F>
+	bool load_file(const vector<uint8_t> &v_bytes, F check) {
+		const string file_address = "gltf_loader_test.glb";
+		{
+			ofstream file(file_address, ios::binary);
+			file.write(reinterpret_cast<const char*>(v_bytes.data()), v_bytes.size());
+		}
+		gltf_loader::Document document;
+		string err;
+		bool is_loaded = gltf_loader::load(file_address, document, err);
+		CHECK(is_loaded == err.empty());
+		if(is_loaded) {
+			check(document);
+		}
+		gltf_loader::release(document);
+		remove(file_address.c_str());
+		return is_loaded;
+	}
+
+	bool load_file(const vector<uint8_t> &v_bytes) {
+		return load_file(v_bytes, [](const gltf_loader::Document&) {});
+	}
+
+	// The accessors of a well formed file read the bytes of the bin chunk, also when the last element of a strided accessor
+	// ends exactly at the end of its view
+	void test_valid_files() {
+		bool is_loaded = load_file(make_glb(make_json({}), make_bin()), [](const gltf_loader::Document &document) {
+			auto& model = document.model;
+			CHECK(model.accessors.size() == 2 && model.meshes.size() == 1 && document.v_buffer_sizes == vector<size_t>{ 44 });
+			if(model.accessors.size() == 2) {
+				CHECK(memcmp(gltf_loader::get_accessor_data(document, model.accessors[0]), a_positions, sizeof(a_positions)) == 0);
+				CHECK(memcmp(gltf_loader::get_accessor_data(document, model.accessors[1]), a_indices, sizeof(a_indices)) == 0);
+			}
+		});
+		CHECK(is_loaded);
+
+		DocumentJson document_json;
+		document_json.buffer_views = R"([{ "buffer": 0, "byteOffset": 0, "byteLength": 44, "byteStride": 16 }, { "buffer": 0, "byteOffset": 36, "byteLength": 6 }])";
+		CHECK(load_file(make_glb(make_json(document_json), make_bin())));
+	}
+
+	// Every index and byte range that points outside of what the file has makes load() fail, so that the scene manager falls back
+	// to tinygltf instead of reading out of bounds
+	void test_malformed_files() {
+		vector<uint8_t> v_glb = make_glb(make_json({}), make_bin());
+		CHECK(!load_file(vector<uint8_t>(v_glb.begin(), v_glb.end() - 8)));
+		CHECK(!load_file(make_glb(make_json({}), {})));
+		vector<uint8_t> v_bin = make_bin();
+		CHECK(!load_file(make_glb(make_json({}), vector<uint8_t>(v_bin.begin(), v_bin.begin() + 40))));
+
+		vector<pair<string DocumentJson::*, string>> v_cases = {
+			{ &DocumentJson::buffers, R"([{ "byteLength": 48 }])" },
+			{ &DocumentJson::buffer_views, R"([{ "buffer": 1, "byteOffset": 0, "byteLength": 36 }, { "buffer": 0, "byteOffset": 36, "byteLength": 6 }])" },
+			{ &DocumentJson::buffer_views, R"([{ "byteOffset": 0, "byteLength": 36 }, { "buffer": 0, "byteOffset": 36, "byteLength": 6 }])" },
+			{ &DocumentJson::buffer_views, R"([{ "buffer": 0, "byteOffset": 0, "byteLength": 36 }, { "buffer": 0, "byteOffset": 40, "byteLength": 6 }])" },
+			{ &DocumentJson::buffer_views, R"([{ "buffer": 0, "byteOffset": 0, "byteLength": 36 }, { "buffer": 0, "byteOffset": 1e19, "byteLength": 6 }])" },
+			{ &DocumentJson::buffer_views, R"([{ "buffer": 0, "byteOffset": 0, "byteLength": 36, "byteStride": 16 }, { "buffer": 0, "byteOffset": 36, "byteLength": 6 }])" },
+			{ &DocumentJson::accessors, R"([{ "bufferView": 2, "componentType": 5126, "count": 3, "type": "VEC3" }, { "bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR" }])" },
+			{ &DocumentJson::accessors, R"([{ "componentType": 5126, "count": 3, "type": "VEC3" }, { "bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR" }])" },
+			{ &DocumentJson::accessors, R"([{ "bufferView": 0, "componentType": 5126, "count": 4, "type": "VEC3" }, { "bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR" }])" },
+			{ &DocumentJson::accessors, R"([{ "bufferView": 0, "byteOffset": 4, "componentType": 5126, "count": 3, "type": "VEC3" }, { "bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR" }])" },
+			{ &DocumentJson::accessors, R"([{ "bufferView": 0, "componentType": 5126, "count": 1e18, "type": "VEC3" }, { "bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR" }])" },
+			{ &DocumentJson::accessors, R"([{ "bufferView": 0, "componentType": 1234, "count": 3, "type": "VEC3" }, { "bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR" }])" },
+			{ &DocumentJson::accessors, R"([{ "bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC5" }, { "bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR" }])" },
+			{ &DocumentJson::accessors, R"([{ "bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3" }, { "bufferView": 1, "componentType": 5125, "count": 3, "type": "SCALAR" }])" },
+			{ &DocumentJson::meshes, R"([{ "primitives": [{ "attributes": { "POSITION": 5 }, "indices": 1 }] }])" },
+			{ &DocumentJson::meshes, R"([{ "primitives": [{ "attributes": { "POSITION": 0 }, "indices": 7 }] }])" },
+			{ &DocumentJson::images, R"([{ "bufferView": 9, "mimeType": "image/png" }])" },
+		};
+		uint32_t num_loaded_cases = 0;
+		for(auto& [p_member, json] : v_cases) {
+			DocumentJson document_json;
+			document_json.*p_member = json;
+			num_loaded_cases += load_file(make_glb(make_json(document_json), make_bin())) ? 1 : 0;
+		}
+		CHECK(num_loaded_cases == 0);
+	}
+
+	// Numbers are read up to the end of the mapping and no further and longer ones than fit the token buffer are rejected. Nesting
+	// is capped before it exhausts the stack, while documents as deep as exporters write them still load.
+	void test_json_limits() {
+		string json = make_json({});
+		string nested_extras = string(100, '[') + "1" + string(100, ']');
+		CHECK(load_file(make_glb(R"({ "extras": )" + nested_extras + ", " + json.substr(1), make_bin())));
+		CHECK(!load_file(make_glb(string(100000, '['), make_bin())));
+		CHECK(!load_file(make_glb(R"({ "extras": )" + string(1000, '[') + "1" + string(1000, ']') + ", " + json.substr(1), make_bin())));
+		CHECK(!load_file(make_glb(R"({ "extras": )" + string(100, '1') + ", " + json.substr(1), make_bin())));
+
+		// A page sized .gltf file that ends in the middle of a number
+		string truncated_json = R"({ "asset": { "version": "2.0" }, "scene": )";
+		truncated_json.resize(4095, ' ');
+		truncated_json += '0';
+		CHECK(!load_file(vector<uint8_t>(truncated_json.begin(), truncated_json.end())));
+	}
+
+	void run() {
+		test_valid_files();
+		test_malformed_files();
+		test_json_limits();
+	}
+} // namespace gltf_loader_tests
@@ -0,0 +1,208 @@
+namespace heap_allocator_tests
+{
+	using heap_allocator::invalid_index;
+
+	struct LiveAllocation {
+		heap_allocator::Allocation allocation;
+		uint64_t alignment;
+	};
+
+	// Walks the physical chain and the free lists of every page: blocks tile the page, free neighbours are merged,
+	// every free block is in the list its size maps to and the bitmaps flag exactly the non-empty lists
+	bool is_pool_consistent(const heap_allocator::Pool &pool) {
+		bool is_valid = true;
+		for(uint32_t page_index = 0; page_index < pool.v_pages.size(); ++page_index) {
+			auto& page = pool.v_pages[page_index];
+			if(page.is_released) { continue; }
+
+			uint64_t offset = 0;
+			uint64_t allocated_size = 0;
+			uint32_t num_allocations = 0;
+			uint32_t num_free_blocks = 0;
+			uint32_t prev_index = invalid_index;
+			bool is_prev_free = false;
+			for(uint32_t block_index = page.first_block_index; block_index != invalid_index; block_index = pool.v_blocks[block_index].next_physical_index) {
+				auto& block = pool.v_blocks[block_index];
+				is_valid &= block.page_index == page_index && block.offset == offset && block.prev_physical_index == prev_index;
+				is_valid &= block.size > 0 && block.size % heap_allocator::min_block_size == 0;
+				is_valid &= !(block.is_free && is_prev_free);
+				if(block.is_free) {
+					num_free_blocks++;
+				}
+				else {
+					allocated_size += block.size;
+					num_allocations++;
+				}
+				offset += block.size;
+				prev_index = block_index;
+				is_prev_free = block.is_free;
+			}
+			is_valid &= offset == page.size && allocated_size == page.allocated_size && num_allocations == page.num_allocations;
+
+			uint32_t num_listed_blocks = 0;
+			for(uint32_t first_level = 0; first_level < heap_allocator::first_level_count; ++first_level) {
+				bool is_first_level_used = false;
+				for(uint32_t second_level = 0; second_level < heap_allocator::second_level_count; ++second_level) {
+					uint32_t list_prev_index = invalid_index;
+					uint32_t head_index = page.a_free_list_heads[first_level][second_level];
+					for(uint32_t block_index = head_index; block_index != invalid_index; block_index = pool.v_blocks[block_index].next_free_index) {
+						auto& block = pool.v_blocks[block_index];
+						uint32_t block_first_level, block_second_level;
+						heap_allocator::get_free_list_indices(block.size, block_first_level, block_second_level);
+						is_valid &= block.is_free && block.page_index == page_index && block.prev_free_index == list_prev_index;
+						is_valid &= block_first_level == first_level && block_second_level == second_level;
+						list_prev_index = block_index;
+						num_listed_blocks++;
+					}
+					bool is_bit_set = (page.a_second_level_bitmaps[first_level] >> second_level) & 1;
+					is_valid &= is_bit_set == (head_index != invalid_index);
+					is_first_level_used |= is_bit_set;
+				}
+				is_valid &= (((page.first_level_bitmap >> first_level) & 1) != 0) == is_first_level_used;
+			}
+			is_valid &= num_listed_blocks == num_free_blocks;
+		}
+		return is_valid;
+	}
+
+	// Live allocations are aligned, inside their page and never overlap each other
+	bool are_allocations_valid(const heap_allocator::Pool &pool, const map<uint64_t, LiveAllocation> &live_allocations) {
+		bool is_valid = true;
+		vector<tuple<uint32_t, uint64_t, uint64_t>> v_ranges;
+		for(auto& [id, live] : live_allocations) {
+			auto& allocation = live.allocation;
+			is_valid &= allocation.is_valid() && allocation.offset % live.alignment == 0;
+			is_valid &= allocation.page_index < pool.v_pages.size() && !pool.v_pages[allocation.page_index].is_released;
+			is_valid &= allocation.offset + allocation.size <= pool.v_pages[allocation.page_index].size;
+			is_valid &= pool.v_blocks[allocation.block_index].user_data == id && !pool.v_blocks[allocation.block_index].is_free;
+			v_ranges.emplace_back(allocation.page_index, allocation.offset, allocation.offset + allocation.size);
+		}
+		sort(v_ranges.begin(), v_ranges.end());
+		for(size_t range_index = 1; range_index < v_ranges.size(); ++range_index) {
+			auto& [prev_page_index, prev_begin, prev_end] = v_ranges[range_index - 1];
+			auto& [page_index, begin, end] = v_ranges[range_index];
+			is_valid &= page_index != prev_page_index || prev_end <= begin;
+		}
+		return is_valid;
+	}
+
+	// Sources are unique and come from pages that receive nothing, and the moved size stays within the budget
+	bool are_moves_valid(const vector<heap_allocator::DefragmentationMove> &v_moves, uint64_t max_moved_size) {
+		bool is_valid = true;
+		set<uint32_t> source_page_indices, destination_page_indices;
+		set<pair<uint32_t, uint32_t>> source_blocks;
+		uint64_t moved_size = 0;
+		for(auto& move : v_moves) {
+			source_page_indices.insert(move.source.page_index);
+			destination_page_indices.insert(move.destination.page_index);
+			is_valid &= source_blocks.emplace(move.source.page_index, move.source.block_index).second;
+			is_valid &= move.source.size <= move.destination.size;
+			moved_size += move.source.size;
+		}
+		for(uint32_t page_index : source_page_indices) {
+			is_valid &= destination_page_indices.count(page_index) == 0;
+		}
+		return is_valid && moved_size <= max_moved_size;
+	}
+
+	void test_random_operations() {
+		constexpr uint64_t page_size{ 4 * 1024 * 1024 };
+		const uint64_t a_alignments[] = { 256, 4 * 1024, 64 * 1024, 4 * 1024 * 1024 };
+		mt19937 generator(35);
+		heap_allocator::Pool pool;
+		heap_allocator::init(pool, "test", page_size);
+
+		map<uint64_t, LiveAllocation> live_allocations;
+		uint64_t next_id = 1;
+		uint32_t num_inconsistent_pools = 0;
+		uint32_t num_invalid_allocations = 0;
+		uint32_t num_invalid_defragmentations = 0;
+		for(uint32_t operation_index = 0; operation_index < 5000; ++operation_index) {
+			uint32_t operation = generator() % 100;
+			if(operation < 50 || live_allocations.empty()) {
+				// Mostly small sizes, some that need a page of their own
+				uint64_t size = (generator() % 16 == 0) ? page_size / 2 + generator() % (2 * page_size) : 1 + generator() % (256 * 1024);
+				uint64_t alignment = a_alignments[generator() % count_of(a_alignments)];
+				uint64_t id = next_id++;
+				auto allocation = heap_allocator::allocate(pool, size, alignment, id);
+				num_invalid_allocations += (allocation.size >= size) ? 0 : 1;
+				live_allocations[id] = { allocation, alignment };
+			}
+			else if(operation < 99) {
+				auto it = live_allocations.begin();
+				advance(it, generator() % live_allocations.size());
+				heap_allocator::deallocate(pool, it->second.allocation);
+				live_allocations.erase(it);
+			}
+			else {
+				uint64_t max_moved_size = (generator() % 2) ? UINT64_MAX : page_size * (1 + generator() % 4);
+				auto v_moves = heap_allocator::begin_defragmentation(pool, max_moved_size);
+				num_invalid_defragmentations += are_moves_valid(v_moves, max_moved_size) ? 0 : 1;
+				for(auto& move : v_moves) {
+					auto& live = live_allocations[move.user_data];
+					num_invalid_defragmentations += (live.allocation.block_index == move.source.block_index) ? 0 : 1;
+					live.allocation = move.destination;
+				}
+				heap_allocator::end_defragmentation(pool, v_moves);
+			}
+			num_inconsistent_pools += is_pool_consistent(pool) ? 0 : 1;
+			num_invalid_allocations += are_allocations_valid(pool, live_allocations) ? 0 : 1;
+		}
+		CHECK(num_inconsistent_pools == 0);
+		CHECK(num_invalid_allocations == 0);
+		CHECK(num_invalid_defragmentations == 0);
+
+		for(auto& [id, live] : live_allocations) {
+			heap_allocator::deallocate(pool, live.allocation);
+		}
+		heap_allocator::release_empty_pages(pool);
+		auto statistics = heap_allocator::get_statistics(pool);
+		CHECK(statistics.num_pages == 0 && statistics.num_allocations == 0 && statistics.allocated_size == 0);
+	}
+
+	// The sparsest page moves into the first page, which is sparse enough to be evacuated next but must keep what it received.
+	// The fullest page then moves into it as well.
+	void test_defragmentation() {
+		constexpr uint64_t page_size{ 1024 * 1024 };
+		constexpr uint64_t block_size{ 16 * 1024 };
+		heap_allocator::Pool pool;
+		heap_allocator::init(pool, "test", page_size);
+		map<uint64_t, LiveAllocation> live_allocations;
+		vector<heap_allocator::Allocation> v_fillers;
+		uint64_t a_page_fills[] = { page_size / 8, page_size / 16, 3 * page_size / 4 };
+		uint64_t next_id = 1;
+		for(uint32_t page_index = 0; page_index < count_of(a_page_fills); ++page_index) {
+			// Fillers take the rest of each page until every page is built, so that the blocks of a page cannot land in an earlier one
+			v_fillers.push_back(heap_allocator::allocate(pool, page_size - a_page_fills[page_index], 256, next_id++));
+			CHECK(v_fillers.back().page_index == page_index);
+			for(uint64_t offset = 0; offset < a_page_fills[page_index]; offset += block_size) {
+				uint64_t id = next_id++;
+				live_allocations[id] = { heap_allocator::allocate(pool, block_size, 256, id), 256 };
+				CHECK(live_allocations[id].allocation.page_index == page_index);
+			}
+		}
+		for(auto& filler : v_fillers) {
+			heap_allocator::deallocate(pool, filler);
+		}
+		auto statistics_before = heap_allocator::get_statistics(pool);
+		CHECK(statistics_before.num_pages == 3);
+
+		auto v_moves = heap_allocator::begin_defragmentation(pool, UINT64_MAX);
+		CHECK(are_moves_valid(v_moves, UINT64_MAX));
+		CHECK(v_moves.size() == (a_page_fills[1] + a_page_fills[2]) / block_size);
+		for(auto& move : v_moves) {
+			CHECK(move.destination.page_index == 0);
+			live_allocations[move.user_data].allocation = move.destination;
+		}
+		auto v_released_page_indices = heap_allocator::end_defragmentation(pool, v_moves);
+		CHECK(is_pool_consistent(pool) && are_allocations_valid(pool, live_allocations));
+		CHECK(v_released_page_indices.size() == 2);
+		auto statistics_after = heap_allocator::get_statistics(pool);
+		CHECK(statistics_after.num_pages == 1 && statistics_after.allocated_size == statistics_before.allocated_size);
+	}
+
+	void run() {
+		test_random_operations();
+		test_defragmentation();
+	}
+} // namespace heap_allocator_tests
@@ -0,0 +1,140 @@
+namespace image_stream_tests
+{
+	// Both layouts of an image: the subresources tightly packed in subresource index order the way .octrn files store them,
+	// and upload footprints the way GetCopyableFootprints places them, with rows and subresources aligned
+	struct Layout {
+		vector<uint64_t> v_src_offsets;
+		vector<uint64_t> v_src_row_sizes;
+		uint64_t src_size;
+		vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> v_dst_footprints;
+		vector<UINT> v_dst_num_rows;
+		vector<UINT64> v_dst_row_sizes;
+		uint64_t dst_size;
+	};
+
+	uint64_t align(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// block_dim is 4 for block compressed formats and 1 otherwise, block_size the bytes of a block or of a pixel
+	Layout make_layout(uint32_t width, uint32_t height, uint32_t depth, uint32_t mip_levels, uint32_t array_size, uint32_t block_dim, uint32_t block_size) {
+		Layout layout = {};
+		for(uint32_t array_index = 0; array_index < array_size; ++array_index) {
+			for(uint32_t mip_level = 0; mip_level < mip_levels; ++mip_level) {
+				uint32_t mip_width = max(width >> mip_level, 1u);
+				uint32_t mip_height = max(height >> mip_level, 1u);
+				uint32_t mip_depth = max(depth >> mip_level, 1u);
+				uint32_t num_rows = (mip_height + block_dim - 1) / block_dim;
+				uint64_t row_size = uint64_t((mip_width + block_dim - 1) / block_dim) * block_size;
+
+				layout.v_src_offsets.push_back(layout.src_size);
+				layout.v_src_row_sizes.push_back(row_size);
+				layout.src_size += row_size * num_rows * mip_depth;
+
+				D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+				footprint.Offset = align(layout.dst_size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+				footprint.Footprint.Width = mip_width;
+				footprint.Footprint.Height = mip_height;
+				footprint.Footprint.Depth = mip_depth;
+				footprint.Footprint.RowPitch = static_cast<UINT>(align(row_size, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT));
+				layout.v_dst_footprints.push_back(footprint);
+				layout.v_dst_num_rows.push_back(num_rows);
+				layout.v_dst_row_sizes.push_back(row_size);
+				layout.dst_size = footprint.Offset + uint64_t(footprint.Footprint.RowPitch) * num_rows * mip_depth;
+			}
+		}
+		return layout;
+	}
+
+	vector<image_stream::SliceCopy> get_slice_copies(const Layout &layout, uint64_t src_size) {
+		return image_stream::get_slice_copies(static_cast<uint32_t>(layout.v_dst_footprints.size()), layout.v_src_offsets.data(), layout.v_src_row_sizes.data(), src_size,
+			layout.v_dst_footprints.data(), layout.v_dst_num_rows.data(), layout.v_dst_row_sizes.data());
+	}
+
+	uint8_t get_src_byte(uint64_t offset) {
+		return static_cast<uint8_t>((offset * 2654435761u) >> 13);
+	}
+
+	// Copies every slice into a cleared upload buffer, then walks both layouts row by row: every row of every slice lands in its
+	// footprint and the row padding and the gaps between the footprints keep their clear value
+	void check_copies(const Layout &layout) {
+		constexpr uint8_t clear_value{ 0xCD };
+		vector<uint8_t> v_src(layout.src_size);
+		for(uint64_t offset = 0; offset < v_src.size(); ++offset) {
+			v_src[offset] = get_src_byte(offset);
+		}
+		vector<uint8_t> v_dst(layout.dst_size, clear_value);
+		vector<bool> v_is_dst_written(layout.dst_size, false);
+
+		auto v_slice_copies = get_slice_copies(layout, layout.src_size);
+		for(auto& slice_copy : v_slice_copies) {
+			image_stream::copy_slice(slice_copy, v_src.data(), v_dst.data());
+		}
+
+		uint32_t num_slices = 0;
+		uint32_t num_wrong_bytes = 0;
+		for(uint32_t subresource_index = 0; subresource_index < layout.v_dst_footprints.size(); ++subresource_index) {
+			auto& footprint = layout.v_dst_footprints[subresource_index];
+			uint32_t num_rows = layout.v_dst_num_rows[subresource_index];
+			uint64_t row_size = layout.v_dst_row_sizes[subresource_index];
+			for(uint32_t slice_index = 0; slice_index < footprint.Footprint.Depth; ++slice_index) {
+				for(uint32_t row_index = 0; row_index < num_rows; ++row_index) {
+					uint64_t src_offset = layout.v_src_offsets[subresource_index] + row_size * (uint64_t(slice_index) * num_rows + row_index);
+					uint64_t dst_offset = footprint.Offset + uint64_t(footprint.Footprint.RowPitch) * (uint64_t(slice_index) * num_rows + row_index);
+					for(uint64_t byte_index = 0; byte_index < row_size; ++byte_index) {
+						num_wrong_bytes += (v_dst[dst_offset + byte_index] == v_src[src_offset + byte_index]) ? 0 : 1;
+						v_is_dst_written[dst_offset + byte_index] = true;
+					}
+				}
+			}
+			num_slices += footprint.Footprint.Depth;
+		}
+		uint32_t num_overwritten_bytes = 0;
+		for(uint64_t offset = 0; offset < v_dst.size(); ++offset) {
+			num_overwritten_bytes += (!v_is_dst_written[offset] && v_dst[offset] != clear_value) ? 1 : 0;
+		}
+		CHECK(v_slice_copies.size() == num_slices);
+		CHECK(num_wrong_bytes == 0);
+		CHECK(num_overwritten_bytes == 0);
+	}
+
+	void test_layouts() {
+		// Rgba8 mip chain: the large mips need no padding and are copied at once, the small ones are padded to the row pitch alignment
+		check_copies(make_layout(256, 256, 1, 9, 1, 1, 4));
+		// BC7 cube map whose sizes are not multiples of the block size
+		check_copies(make_layout(100, 60, 1, 7, 6, 4, 16));
+		// Rgba16f volume whose mips have fewer slices
+		check_copies(make_layout(33, 17, 9, 4, 1, 1, 8));
+		// Single row images
+		check_copies(make_layout(1, 1, 1, 1, 1, 1, 4));
+		check_copies(make_layout(4096, 1, 1, 13, 2, 1, 4));
+	}
+
+	void test_truncated_data() {
+		auto layout = make_layout(64, 64, 8, 2, 2, 1, 4);
+		bool has_thrown = false;
+		try {
+			get_slice_copies(layout, layout.src_size - 1);
+		}
+		catch(const exception&) {
+			has_thrown = true;
+		}
+		CHECK(has_thrown);
+
+		// A destination row longer than the packed source row would read into the next row of the file
+		layout.v_dst_row_sizes.back()++;
+		has_thrown = false;
+		try {
+			get_slice_copies(layout, layout.src_size);
+		}
+		catch(const exception&) {
+			has_thrown = true;
+		}
+		CHECK(has_thrown);
+	}
+
+	void run() {
+		test_layouts();
+		test_truncated_data();
+	}
+} // namespace image_stream_tests
@@ -0,0 +1,263 @@
+namespace job_system_tests
+{
+	// Single threaded the owner takes its newest job and thieves the oldest, a full queue refuses pushes
+	void test_queue_order() {
+		auto up_queue = make_unique<job_system::WorkStealingQueue>();
+		up_queue->bottom = 0;
+		up_queue->top = 0;
+		vector<job_system::Job> v_jobs(job_system::queue_capacity + 1);
+
+		CHECK(job_system::pop(*up_queue) == nullptr && job_system::steal(*up_queue) == nullptr);
+		for(uint32_t job_index = 0; job_index < 3; ++job_index) {
+			job_system::push(*up_queue, &v_jobs[job_index]);
+		}
+		CHECK(job_system::pop(*up_queue) == &v_jobs[2]);
+		CHECK(job_system::steal(*up_queue) == &v_jobs[0]);
+		CHECK(job_system::pop(*up_queue) == &v_jobs[1]);
+		CHECK(job_system::pop(*up_queue) == nullptr && job_system::steal(*up_queue) == nullptr);
+
+		uint32_t num_pushed_jobs = 0;
+		for(auto& job : v_jobs) {
+			num_pushed_jobs += job_system::push(*up_queue, &job) ? 1 : 0;
+		}
+		CHECK(num_pushed_jobs == job_system::queue_capacity);
+		CHECK(job_system::steal(*up_queue) == &v_jobs[0]);
+		CHECK(job_system::push(*up_queue, &v_jobs[job_system::queue_capacity]));
+	}
+
+	// The owner pushes and pops batches while thieves steal, every job has to be taken exactly once.
+	// Batches of one job make the owner and the thieves race for the last job.
+	void test_queue_steals() {
+		constexpr uint32_t num_jobs{ 200000 };
+		constexpr uint32_t num_thieves{ 3 };
+		auto up_queue = make_unique<job_system::WorkStealingQueue>();
+		up_queue->bottom = 0;
+		up_queue->top = 0;
+		vector<job_system::Job> v_jobs(num_jobs);
+		vector<atomic<uint32_t>> v_num_takes(num_jobs);
+		atomic<uint32_t> num_stolen_jobs{ 0 };
+		atomic<bool> is_done{ false };
+
+		auto take = [&](job_system::Job *p_job) {
+			v_num_takes[p_job - v_jobs.data()].fetch_add(1, memory_order_relaxed);
+		};
+		vector<thread> v_thieves;
+		for(uint32_t thief_index = 0; thief_index < num_thieves; ++thief_index) {
+			v_thieves.emplace_back([&]() {
+				while(!is_done.load()) {
+					if(job_system::Job *p_job = job_system::steal(*up_queue)) {
+						take(p_job);
+						num_stolen_jobs.fetch_add(1, memory_order_relaxed);
+					}
+				}
+			});
+		}
+
+		mt19937 random(44);
+		uint32_t next_job_index = 0;
+		while(next_job_index < num_jobs) {
+			uint32_t num_batch_jobs = min(num_jobs - next_job_index, (random() % 4 == 0) ? 1u : 1u + static_cast<uint32_t>(random() % 64));
+			for(uint32_t batch_job_index = 0; batch_job_index < num_batch_jobs; ++batch_job_index) {
+				while(!job_system::push(*up_queue, &v_jobs[next_job_index])) {
+					if(job_system::Job *p_job = job_system::pop(*up_queue)) { take(p_job); }
+				}
+				next_job_index++;
+			}
+			for(uint32_t num_pops = random() % (num_batch_jobs + 1); num_pops > 0; --num_pops) {
+				if(job_system::Job *p_job = job_system::pop(*up_queue)) { take(p_job); }
+			}
+		}
+		while(job_system::Job *p_job = job_system::pop(*up_queue)) {
+			take(p_job);
+		}
+		is_done = true;
+		for(auto& thief : v_thieves) {
+			thief.join();
+		}
+
+		uint32_t num_wrong_takes = 0;
+		for(auto& num_takes : v_num_takes) {
+			num_wrong_takes += (num_takes.load() != 1) ? 1 : 0;
+		}
+		CHECK(num_wrong_takes == 0);
+		CHECK(num_stolen_jobs.load() > 0);
+		CHECK(job_system::steal(*up_queue) == nullptr);
+	}
+
+	struct Batch {
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	// Runs parallel_for and returns its batches sorted, checks that every element was visited exactly once
+	vector<Batch> run_parallel_for(uint32_t count, uint32_t min_batch_size, uint32_t max_num_batches) {
+		vector<atomic<uint32_t>> v_num_visits(count);
+		vector<Batch> v_batches;
+		mutex batch_mutex;
+		job_system::parallel_for(count, min_batch_size, [&](uint32_t begin, uint32_t end) {
+			for(uint32_t element_index = begin; element_index < end; ++element_index) {
+				v_num_visits[element_index].fetch_add(1, memory_order_relaxed);
+			}
+			lock_guard<mutex> lock(batch_mutex);
+			v_batches.push_back({ begin, end });
+		}, max_num_batches);
+
+		uint32_t num_wrong_visits = 0;
+		for(auto& num_visits : v_num_visits) {
+			num_wrong_visits += (num_visits.load() != 1) ? 1 : 0;
+		}
+		CHECK(num_wrong_visits == 0);
+		sort(v_batches.begin(), v_batches.end(), [](const Batch &a, const Batch &b) { return a.begin < b.begin; });
+		return v_batches;
+	}
+
+	// Batches tile [0, count) without overlap, all but the last have at least min_batch_size elements and there are no more
+	// than max_num_batches of them, nor more than a few per worker
+	void test_parallel_for() {
+		job_system::init(4);
+		CHECK(job_system::get_worker_count() == 4);
+
+		uint32_t num_wrong_tilings = 0;
+		uint32_t num_small_batches = 0;
+		uint32_t num_excess_batch_counts = 0;
+		for(uint32_t count : { 1u, 7u, 1000u, 100003u }) {
+			for(uint32_t min_batch_size : { 0u, 1u, 64u, 1024u }) {
+				for(uint32_t max_num_batches : { 0u, 1u, 3u, UINT32_MAX }) {
+					vector<Batch> v_batches = run_parallel_for(count, min_batch_size, max_num_batches);
+					uint32_t expected_begin = 0;
+					for(auto& batch : v_batches) {
+						num_wrong_tilings += (batch.begin != expected_begin || batch.end <= batch.begin) ? 1 : 0;
+						expected_begin = batch.end;
+						bool is_last = (batch.end == count);
+						num_small_batches += (!is_last && batch.end - batch.begin < min_batch_size) ? 1 : 0;
+					}
+					num_wrong_tilings += (expected_begin != count) ? 1 : 0;
+					uint32_t max_batch_count = min(max(1u, max_num_batches), job_system::get_worker_count() * job_system::num_batches_per_worker);
+					num_excess_batch_counts += (v_batches.size() > max_batch_count) ? 1 : 0;
+				}
+			}
+		}
+		CHECK(num_wrong_tilings == 0);
+		CHECK(num_small_batches == 0);
+		CHECK(num_excess_batch_counts == 0);
+		CHECK(run_parallel_for(100000, 1, UINT32_MAX).size() == 4 * job_system::num_batches_per_worker);
+		CHECK(run_parallel_for(1000, 400, UINT32_MAX).size() == 2);
+
+		bool is_rethrown = false;
+		try {
+			job_system::parallel_for(1000, 1, [](uint32_t begin, uint32_t) {
+				if(begin > 0) { throw exception("parallel_for test"); }
+			});
+		}
+		catch(const exception&) {
+			is_rethrown = true;
+		}
+		CHECK(is_rethrown);
+		job_system::shutdown();
+	}
+
+	// Random graphs whose edges go from lower to higher indices, every task starts after all of its dependencies finished
+	// and runs once per run_and_wait(), also when the graph runs again
+	void test_task_graph() {
+		job_system::init(4);
+		mt19937 random(44);
+		constexpr uint32_t num_tasks{ 200 };
+		uint32_t num_wrong_runs = 0;
+		uint32_t num_early_starts = 0;
+		for(uint32_t graph_index = 0; graph_index < 10; ++graph_index) {
+			atomic<uint32_t> sequence{ 0 };
+			vector<uint32_t> v_start_sequences(num_tasks);
+			vector<uint32_t> v_finish_sequences(num_tasks);
+			vector<atomic<uint32_t>> v_num_runs(num_tasks);
+			job_system::TaskGraph graph;
+			vector<vector<uint32_t>> v_v_dependency_indices(num_tasks);
+			for(uint32_t task_index = 0; task_index < num_tasks; ++task_index) {
+				job_system::add_task(graph, [&, task_index]() {
+					v_start_sequences[task_index] = sequence.fetch_add(1);
+					v_num_runs[task_index].fetch_add(1);
+					this_thread::yield();
+					v_finish_sequences[task_index] = sequence.fetch_add(1);
+				});
+				for(uint32_t num_dependencies = (task_index > 0) ? random() % 4 : 0; num_dependencies > 0; --num_dependencies) {
+					uint32_t dependency_index = random() % task_index;
+					job_system::add_dependency(graph, task_index, dependency_index);
+					v_v_dependency_indices[task_index].push_back(dependency_index);
+				}
+			}
+
+			for(uint32_t run_index = 1; run_index <= 2; ++run_index) {
+				job_system::run_and_wait(graph);
+				for(uint32_t task_index = 0; task_index < num_tasks; ++task_index) {
+					num_wrong_runs += (v_num_runs[task_index].load() != run_index) ? 1 : 0;
+					for(uint32_t dependency_index : v_v_dependency_indices[task_index]) {
+						num_early_starts += (v_start_sequences[task_index] < v_finish_sequences[dependency_index]) ? 1 : 0;
+					}
+				}
+			}
+		}
+		CHECK(num_wrong_runs == 0);
+		CHECK(num_early_starts == 0);
+
+		// A task that throws keeps its successors from starting, the others still run
+		job_system::TaskGraph graph;
+		atomic<uint32_t> num_runs{ 0 };
+		uint32_t root_index = job_system::add_task(graph, [&num_runs]() { num_runs++; });
+		uint32_t throwing_index = job_system::add_task(graph, []() { throw exception("task graph test"); });
+		uint32_t successor_index = job_system::add_task(graph, [&num_runs]() { num_runs += 100; });
+		uint32_t sibling_index = job_system::add_task(graph, [&num_runs]() { num_runs++; });
+		job_system::add_dependency(graph, throwing_index, root_index);
+		job_system::add_dependency(graph, successor_index, throwing_index);
+		job_system::add_dependency(graph, sibling_index, root_index);
+		bool is_rethrown = false;
+		try {
+			job_system::run_and_wait(graph);
+		}
+		catch(const exception&) {
+			is_rethrown = true;
+		}
+		CHECK(is_rethrown);
+		CHECK(num_runs.load() == 2);
+		job_system::shutdown();
+	}
+
+	// A thread the caller creates runs its jobs inline until it attaches, then queues them in its own worker slot
+	void test_external_thread() {
+		constexpr uint32_t num_jobs{ 1000 };
+		job_system::init(2, 1);
+		CHECK(job_system::get_worker_count() == 3);
+
+		bool is_inline = false;
+		uint32_t attached_worker_index = job_system::invalid_worker_index;
+		uint32_t num_slot_jobs = 0;
+		atomic<uint32_t> num_finished_jobs{ 0 };
+		thread external_thread([&]() {
+			job_system::Counter inline_counter;
+			job_system::run([&num_finished_jobs]() { num_finished_jobs++; }, inline_counter);
+			is_inline = (inline_counter.value.load() == 0 && num_finished_jobs.load() == 1);
+
+			job_system::attach_external_thread(0);
+			attached_worker_index = job_system::worker_index;
+			job_system::Counter counter;
+			for(uint32_t job_index = 0; job_index < num_jobs; ++job_index) {
+				job_system::run([&num_finished_jobs]() { num_finished_jobs++; }, counter);
+			}
+			job_system::wait(counter);
+			num_slot_jobs = job_system::v_up_workers[2]->next_job_index;
+		});
+		external_thread.join();
+
+		CHECK(is_inline);
+		CHECK(attached_worker_index == 2);
+		CHECK(num_slot_jobs == num_jobs);
+		CHECK(num_finished_jobs.load() == num_jobs + 1);
+		job_system::shutdown();
+	}
+
+	void run() {
+		test_queue_order();
+		test_queue_steals();
+		test_parallel_for();
+		test_task_graph();
+		test_external_thread();
+	}
+} // namespace job_system_tests
@@ -0,0 +1,373 @@
+namespace mesh_simplifier_tests
+{
+	using mesh_simplifier::MeshData;
+	using mesh_simplifier::Lod;
+
+	// A LOD breaks the error bound when the distance measured from it is above error_bound_factor times the error it reports,
+	// or when that is 0 and the measured one is not
+	constexpr float error_bound_factor{ 2.f };
+	constexpr float zero_error_tolerance{ 1e-5f };
+
+	// A uv sphere of unit radius, the first and last columns of every row are the same position with u 0 and 1
+	void make_sphere(uint32_t num_columns, uint32_t num_rows, MeshData &mesh) {
+		for(uint32_t row = 0; row <= num_rows; ++row) {
+			float v = float(row) / num_rows;
+			float theta = v * XM_PI;
+			for(uint32_t column = 0; column <= num_columns; ++column) {
+				float u = float(column) / num_columns;
+				float phi = (column == num_columns) ? 0.f : u * XM_2PI;
+				Vertex vertex{};
+				vertex.pos = { sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi) };
+				if(row == 0 || row == num_rows) {
+					vertex.pos.x = vertex.pos.z = 0.f;
+				}
+				vertex.normal = vertex.pos;
+				vertex.uv = { u, v };
+				mesh.v_vertices.push_back(vertex);
+			}
+		}
+		for(uint32_t row = 0; row < num_rows; ++row) {
+			for(uint32_t column = 0; column < num_columns; ++column) {
+				uint32_t i00 = row * (num_columns + 1) + column;
+				uint32_t i01 = i00 + 1;
+				uint32_t i10 = i00 + num_columns + 1;
+				uint32_t i11 = i10 + 1;
+				if(row > 0) {
+					mesh.v_indices.insert(mesh.v_indices.end(), { i00, i01, i10 });
+				}
+				if(row + 1 < num_rows) {
+					mesh.v_indices.insert(mesh.v_indices.end(), { i01, i11, i10 });
+				}
+			}
+		}
+	}
+
+	// A cube from -1 to 1 with a grid of quads on every face, faces have vertices of their own with the face's normal
+	void make_cube(uint32_t num_quads_per_side, MeshData &mesh) {
+		for(uint32_t face = 0; face < 6; ++face) {
+			uint32_t axis = face / 2;
+			float sign = (face % 2 == 0) ? 1.f : -1.f;
+			XMFLOAT3 normal = {};
+			(&normal.x)[axis] = sign;
+			uint32_t axis_u = (axis + 1) % 3;
+			uint32_t axis_v = (axis + 2) % 3;
+			uint32_t first_vertex = static_cast<uint32_t>(mesh.v_vertices.size());
+			for(uint32_t row = 0; row <= num_quads_per_side; ++row) {
+				for(uint32_t column = 0; column <= num_quads_per_side; ++column) {
+					Vertex vertex{};
+					(&vertex.pos.x)[axis] = sign;
+					(&vertex.pos.x)[axis_u] = 2.f * column / num_quads_per_side - 1.f;
+					(&vertex.pos.x)[axis_v] = 2.f * row / num_quads_per_side - 1.f;
+					vertex.normal = normal;
+					vertex.uv = { float(column) / num_quads_per_side, float(row) / num_quads_per_side };
+					mesh.v_vertices.push_back(vertex);
+				}
+			}
+			for(uint32_t row = 0; row < num_quads_per_side; ++row) {
+				for(uint32_t column = 0; column < num_quads_per_side; ++column) {
+					uint32_t i00 = first_vertex + row * (num_quads_per_side + 1) + column;
+					uint32_t i01 = i00 + 1;
+					uint32_t i10 = i00 + num_quads_per_side + 1;
+					uint32_t i11 = i10 + 1;
+					if(sign > 0.f) {
+						mesh.v_indices.insert(mesh.v_indices.end(), { i00, i01, i11, i00, i11, i10 });
+					}
+					else {
+						mesh.v_indices.insert(mesh.v_indices.end(), { i00, i11, i01, i00, i10, i11 });
+					}
+				}
+			}
+		}
+	}
+
+	// Surfaces the sphere and the cube approximate, as the distance of a point from them
+	float get_sphere_distance(XMVECTOR xm_p) {
+		return abs(XMVectorGetX(XMVector3Length(xm_p)) - 1.f);
+	}
+
+	float get_cube_distance(XMVECTOR xm_p) {
+		XMFLOAT3 p;
+		XMStoreFloat3(&p, XMVectorAbs(xm_p));
+		return 1.f - max(p.x, max(p.y, p.z));
+	}
+
+	// How far a LOD strays from the surface its mesh approximates: the farthest of the points of each triangle nearest the
+	// center and of its centroid, as a fraction of the diagonal of the bounds
+	template<typename GetDistance>
+	float measure_error(const MeshData &mesh, const vector<uint32_t> &v_indices, GetDistance get_distance) {
+		float max_distance = 0.f;
+		XMVECTOR xm_origin = XMVectorZero();
+		for(size_t index = 0; index < v_indices.size(); index += 3) {
+			XMVECTOR xm_a = XMLoadFloat3(&mesh.v_vertices[v_indices[index]].pos);
+			XMVECTOR xm_b = XMLoadFloat3(&mesh.v_vertices[v_indices[index + 1]].pos);
+			XMVECTOR xm_c = XMLoadFloat3(&mesh.v_vertices[v_indices[index + 2]].pos);
+			max_distance = max(max_distance, get_distance(mesh_simplifier::get_closest_point_on_triangle(xm_origin, xm_a, xm_b, xm_c)));
+			max_distance = max(max_distance, get_distance((xm_a + xm_b + xm_c) / 3.f));
+		}
+		return max_distance / (2.f * sqrt(3.f));
+	}
+
+	// A triangle across a seam has corners from both sides of it: uvs from both ends of a sphere's rows or normals of two cube faces
+	bool is_across_uv_seam(const Vertex &a, const Vertex &b, const Vertex &c) {
+		return max(a.uv.x, max(b.uv.x, c.uv.x)) - min(a.uv.x, min(b.uv.x, c.uv.x)) > 0.5f;
+	}
+
+	bool is_across_normal_seam(const Vertex &a, const Vertex &b, const Vertex &c) {
+		return memcmp(&a.normal, &b.normal, sizeof(XMFLOAT3)) != 0 || memcmp(&a.normal, &c.normal, sizeof(XMFLOAT3)) != 0;
+	}
+
+	struct SurfaceViolations {
+		uint32_t num_error_bound_violations;
+		uint32_t num_seam_violations;
+	};
+
+	// Measures every LOD against the exact surface, with the error of the mesh itself as the floor of the bound
+	template<typename GetDistance, typename IsAcrossSeam>
+	SurfaceViolations check_surface(const MeshData &mesh, const vector<Lod> &v_lods, GetDistance get_distance, IsAcrossSeam is_across_seam) {
+		SurfaceViolations result = {};
+		float mesh_error = measure_error(mesh, mesh.v_indices, get_distance);
+		for(auto& lod : v_lods) {
+			float bound = max(lod.error * error_bound_factor, zero_error_tolerance + mesh_error);
+			result.num_error_bound_violations += (measure_error(mesh, lod.v_indices, get_distance) > bound) ? 1 : 0;
+			for(size_t index = 0; index < lod.v_indices.size(); index += 3) {
+				const auto& v_vertices = mesh.v_vertices;
+				result.num_seam_violations += is_across_seam(v_vertices[lod.v_indices[index]], v_vertices[lod.v_indices[index + 1]], v_vertices[lod.v_indices[index + 2]]) ? 1 : 0;
+			}
+		}
+		return result;
+	}
+
+	// A grid of quads in the xy plane from 0 to num_quads_per_side with random heights up to max_height. The column at
+	// num_quads_per_side / 2 is split into two vertices with u 0 on the left and 1 on the right, a seam through the middle.
+	void make_grid(uint32_t num_quads_per_side, float max_height, mt19937 &generator, MeshData &mesh) {
+		uniform_real_distribution<float> height(0.f, max_height);
+		uint32_t seam_column = num_quads_per_side / 2;
+		uint32_t num_columns = num_quads_per_side + 2;
+		for(uint32_t row = 0; row <= num_quads_per_side; ++row) {
+			float seam_height = height(generator);
+			for(uint32_t column = 0; column < num_columns; ++column) {
+				uint32_t x = (column <= seam_column) ? column : column - 1;
+				Vertex vertex{};
+				vertex.pos = { float(x), float(row), (x == seam_column) ? seam_height : height(generator) };
+				vertex.normal = { 0.f, 0.f, 1.f };
+				vertex.uv = { (column <= seam_column) ? 0.f : 1.f, 0.f };
+				mesh.v_vertices.push_back(vertex);
+			}
+		}
+		for(uint32_t row = 0; row < num_quads_per_side; ++row) {
+			for(uint32_t x = 0; x < num_quads_per_side; ++x) {
+				uint32_t i00 = row * num_columns + ((x < seam_column) ? x : x + 1);
+				uint32_t i01 = i00 + 1;
+				uint32_t i10 = i00 + num_columns;
+				uint32_t i11 = i10 + 1;
+				mesh.v_indices.insert(mesh.v_indices.end(), { i00, i01, i11, i00, i11, i10 });
+			}
+		}
+	}
+
+	float get_diagonal(const MeshData &mesh) {
+		XMVECTOR xm_min = XMVectorReplicate(FLT_MAX);
+		XMVECTOR xm_max = XMVectorReplicate(-FLT_MAX);
+		for(auto& vertex : mesh.v_vertices) {
+			xm_min = XMVectorMin(xm_min, XMLoadFloat3(&vertex.pos));
+			xm_max = XMVectorMax(xm_max, XMLoadFloat3(&vertex.pos));
+		}
+		return XMVectorGetX(XMVector3Length(xm_max - xm_min));
+	}
+
+	// Farthest any vertex of the mesh is from the nearest triangle of the LOD, relative to the diagonal of the bounds
+	float get_max_vertex_distance(const MeshData &mesh, const vector<uint32_t> &v_indices) {
+		float max_distance = 0.f;
+		for(auto& vertex : mesh.v_vertices) {
+			XMVECTOR xm_p = XMLoadFloat3(&vertex.pos);
+			float min_distance = FLT_MAX;
+			for(size_t index = 0; index < v_indices.size(); index += 3) {
+				XMVECTOR xm_a = XMLoadFloat3(&mesh.v_vertices[v_indices[index]].pos);
+				XMVECTOR xm_b = XMLoadFloat3(&mesh.v_vertices[v_indices[index + 1]].pos);
+				XMVECTOR xm_c = XMLoadFloat3(&mesh.v_vertices[v_indices[index + 2]].pos);
+				XMVECTOR xm_closest = mesh_simplifier::get_closest_point_on_triangle(xm_p, xm_a, xm_b, xm_c);
+				min_distance = min(min_distance, XMVectorGetX(XMVector3Length(xm_closest - xm_p)));
+			}
+			max_distance = max(max_distance, min_distance);
+		}
+		return max_distance / get_diagonal(mesh);
+	}
+
+	// Directed edges no triangle has the other way round, between the positions of the corners so that seams do not count
+	set<pair<uint32_t, uint32_t>> get_open_edges(const vector<uint32_t> &v_indices, const vector<uint32_t> &v_remap) {
+		set<pair<uint32_t, uint32_t>> edges;
+		for(size_t index = 0; index < v_indices.size(); index += 3) {
+			for(uint32_t corner = 0; corner < 3; ++corner) {
+				edges.insert({ v_remap[v_indices[index + corner]], v_remap[v_indices[index + (corner + 1) % 3]] });
+			}
+		}
+		set<pair<uint32_t, uint32_t>> open_edges;
+		for(auto& edge : edges) {
+			if(edges.count({ edge.second, edge.first }) == 0) {
+				open_edges.insert(edge);
+			}
+		}
+		return open_edges;
+	}
+
+	// The chain invariants every mesh keeps. A LOD is a list of whole triangles of the mesh's own vertices, has no triangle collapsed to a line,
+	// keeps at most min_lod_reduction of the triangles of the one before and reports an error no smaller than it. No vertex is
+	// farther from it than error_bound_factor times that error. Its open edges run between positions on the mesh's own border
+	// and the positions the simplifier locks, where seams and borders meet, keep triangles in every LOD.
+	void check_lods(const MeshData &mesh, const vector<Lod> &v_lods) {
+		using namespace mesh_simplifier;
+		constexpr float distance_tolerance{ 1e-4f };
+		uint32_t num_vertices = static_cast<uint32_t>(mesh.v_vertices.size());
+		Simplifier simplifier;
+		init(simplifier, mesh.v_vertices.data(), num_vertices, mesh.v_indices.data(), static_cast<uint32_t>(mesh.v_indices.size()));
+		const auto& v_remap = simplifier.v_remap;
+		vector<bool> v_is_border(num_vertices, false);
+		for(auto& edge : get_open_edges(mesh.v_indices, v_remap)) {
+			v_is_border[edge.first] = v_is_border[edge.second] = true;
+		}
+
+		CHECK(!v_lods.empty() && v_lods.size() < max_lod_count);
+		uint32_t num_out_of_range_indices = 0;
+		uint32_t num_degenerate_triangles = 0;
+		uint32_t num_too_large_lods = 0;
+		uint32_t num_decreasing_errors = 0;
+		uint32_t num_error_bound_violations = 0;
+		uint32_t num_moved_border_edges = 0;
+		uint32_t num_lost_locked_positions = 0;
+		size_t num_previous_triangles = mesh.v_indices.size() / 3;
+		float previous_error = 0.f;
+		for(auto& lod : v_lods) {
+			size_t num_triangles = lod.v_indices.size() / 3;
+			num_too_large_lods += (num_triangles > 0 && num_triangles <= num_previous_triangles * min_lod_reduction) ? 0 : 1;
+			num_decreasing_errors += (lod.error >= previous_error) ? 0 : 1;
+			num_previous_triangles = num_triangles;
+			previous_error = lod.error;
+
+			if(lod.v_indices.size() % 3 != 0) {
+				num_out_of_range_indices++;
+				continue;
+			}
+			vector<bool> v_is_used(num_vertices, false);
+			for(size_t index = 0; index < lod.v_indices.size(); index += 3) {
+				const uint32_t *p_triangle = &lod.v_indices[index];
+				if(p_triangle[0] >= num_vertices || p_triangle[1] >= num_vertices || p_triangle[2] >= num_vertices) {
+					num_out_of_range_indices++;
+					continue;
+				}
+				uint32_t a_positions[3] = { v_remap[p_triangle[0]], v_remap[p_triangle[1]], v_remap[p_triangle[2]] };
+				num_degenerate_triangles += (a_positions[0] == a_positions[1] || a_positions[1] == a_positions[2] || a_positions[2] == a_positions[0]) ? 1 : 0;
+				v_is_used[a_positions[0]] = v_is_used[a_positions[1]] = v_is_used[a_positions[2]] = true;
+			}
+			if(num_out_of_range_indices > 0) { continue; }
+
+			float distance = get_max_vertex_distance(mesh, lod.v_indices);
+			num_error_bound_violations += (distance <= lod.error * error_bound_factor + distance_tolerance) ? 0 : 1;
+			for(auto& edge : get_open_edges(lod.v_indices, v_remap)) {
+				num_moved_border_edges += (v_is_border[edge.first] && v_is_border[edge.second]) ? 0 : 1;
+			}
+			for(uint32_t vertex = 0; vertex < num_vertices; ++vertex) {
+				num_lost_locked_positions += (simplifier.v_kinds[vertex] == VERTEX_KIND_LOCKED && !v_is_used[v_remap[vertex]]) ? 1 : 0;
+			}
+		}
+		CHECK(num_out_of_range_indices == 0);
+		CHECK(num_degenerate_triangles == 0);
+		CHECK(num_too_large_lods == 0);
+		CHECK(num_decreasing_errors == 0);
+		CHECK(num_error_bound_violations == 0);
+		CHECK(num_moved_border_edges == 0);
+		CHECK(num_lost_locked_positions == 0);
+	}
+
+	// Triangles around a pole of a sphere span any range of u, the uv seam only runs between the poles
+	bool is_across_sphere_seam(const Vertex &a, const Vertex &b, const Vertex &c) {
+		bool is_at_pole = abs(a.pos.y) == 1.f || abs(b.pos.y) == 1.f || abs(c.pos.y) == 1.f;
+		return !is_at_pole && is_across_uv_seam(a, b, c);
+	}
+
+	// The spheres and cubes of the benchmark, their errors also bounded against the exact surfaces they approximate and no
+	// triangle taking corners from both sides of a uv or normal seam
+	void test_closed_meshes() {
+		using namespace mesh_simplifier;
+		vector<MeshData> v_meshes(4);
+		make_sphere(48, 24, v_meshes[0]);
+		make_sphere(96, 48, v_meshes[1]);
+		make_cube(8, v_meshes[2]);
+		make_cube(24, v_meshes[3]);
+		vector<vector<Lod>> a_v_lods;
+		build_lods(v_meshes, a_v_lods);
+		CHECK(a_v_lods.size() == v_meshes.size());
+		for(uint32_t mesh_index = 0; mesh_index < v_meshes.size(); ++mesh_index) {
+			const MeshData &mesh = v_meshes[mesh_index];
+			check_lods(mesh, a_v_lods[mesh_index]);
+			bool is_sphere = mesh_index < 2;
+			const vector<Lod> &v_lods = a_v_lods[mesh_index];
+			auto violations = is_sphere ? check_surface(mesh, v_lods, get_sphere_distance, is_across_sphere_seam) :
+				check_surface(mesh, v_lods, get_cube_distance, is_across_normal_seam);
+			CHECK(violations.num_error_bound_violations == 0);
+			CHECK(violations.num_seam_violations == 0);
+			// A sphere cannot lose triangles without straying from its surface, a cube's flat faces can
+			CHECK(!v_lods.empty() && (is_sphere ? v_lods.back().error > 0.f : v_lods.back().error < zero_error_tolerance));
+		}
+
+		// Building a batch of meshes gives each one the LODs building it alone does
+		vector<Lod> v_lods;
+		build_lods(v_meshes[3].v_vertices.data(), static_cast<uint32_t>(v_meshes[3].v_vertices.size()), v_meshes[3].v_indices.data(), static_cast<uint32_t>(v_meshes[3].v_indices.size()), v_lods);
+		bool is_equal = v_lods.size() == a_v_lods[3].size();
+		for(uint32_t lod_index = 0; is_equal && lod_index < v_lods.size(); ++lod_index) {
+			is_equal = v_lods[lod_index].v_indices == a_v_lods[3][lod_index].v_indices && v_lods[lod_index].error == a_v_lods[3][lod_index].error;
+		}
+		CHECK(is_equal);
+	}
+
+	// Grids with an open border and a seam. A flat one simplifies without error and keeps covering the same square without
+	// turning a triangle over, rough ones report an error. No triangle of any takes corners from both sides of the seam.
+	void test_open_meshes() {
+		using namespace mesh_simplifier;
+		mt19937 generator(49);
+		for(float max_height : { 0.f, 0.5f, 2.f }) {
+			MeshData mesh;
+			make_grid(32, max_height, generator, mesh);
+			vector<Lod> v_lods;
+			build_lods(mesh.v_vertices.data(), static_cast<uint32_t>(mesh.v_vertices.size()), mesh.v_indices.data(), static_cast<uint32_t>(mesh.v_indices.size()), v_lods);
+			check_lods(mesh, v_lods);
+			if(v_lods.empty()) { continue; }
+
+			uint32_t num_seam_violations = 0;
+			uint32_t num_wrong_flat_lods = 0;
+			for(auto& lod : v_lods) {
+				uint32_t num_turned_triangles = 0;
+				double area = 0.0;
+				for(size_t index = 0; index < lod.v_indices.size(); index += 3) {
+					const Vertex &a = mesh.v_vertices[lod.v_indices[index]];
+					const Vertex &b = mesh.v_vertices[lod.v_indices[index + 1]];
+					const Vertex &c = mesh.v_vertices[lod.v_indices[index + 2]];
+					num_seam_violations += is_across_uv_seam(a, b, c) ? 1 : 0;
+					double projected_area = 0.5 * (double(b.pos.x - a.pos.x) * (c.pos.y - a.pos.y) - double(b.pos.y - a.pos.y) * (c.pos.x - a.pos.x));
+					num_turned_triangles += (projected_area > 0.0) ? 0 : 1;
+					area += projected_area;
+				}
+				if(max_height == 0.f) {
+					num_wrong_flat_lods += (lod.error == 0.f && num_turned_triangles == 0 && abs(area - 32.0 * 32.0) < 1e-3) ? 0 : 1;
+				}
+			}
+			CHECK(num_seam_violations == 0);
+			CHECK(num_wrong_flat_lods == 0);
+			CHECK(max_height == 0.f || v_lods.back().error > zero_error_tolerance);
+		}
+	}
+
+	// Too few triangles to simplify leaves the chain empty
+	void test_small_mesh() {
+		MeshData mesh;
+		make_cube(2, mesh);
+		vector<Lod> v_lods = { {} };
+		mesh_simplifier::build_lods(mesh.v_vertices.data(), static_cast<uint32_t>(mesh.v_vertices.size()), mesh.v_indices.data(), static_cast<uint32_t>(mesh.v_indices.size()), v_lods);
+		CHECK(mesh.v_indices.size() / 3 <= mesh_simplifier::min_lod_triangle_count && v_lods.empty());
+	}
+
+	void run() {
+		test_closed_meshes();
+		test_open_meshes();
+		test_small_mesh();
+	}
+} // namespace mesh_simplifier_tests
@@ -0,0 +1,394 @@
+namespace meshlet_builder_tests
+{
+	using mesh_simplifier::MeshData;
+	using meshlet_builder::Meshlet;
+
+	// A sphere whose vertices are pushed in and out a little at random, its cones are wider than a smooth sphere's and the
+	// radius of a meshlet's sphere matters when the eye is close
+	void make_bumpy_sphere(mt19937 &generator, MeshData &mesh) {
+		mesh_simplifier_tests::make_sphere(96, 48, mesh);
+		uniform_real_distribution<float> scale(0.98f, 1.02f);
+		for(auto& vertex : mesh.v_vertices) {
+			XMStoreFloat3(&vertex.pos, XMLoadFloat3(&vertex.pos) * scale(generator));
+		}
+	}
+
+	// Looks from eye towards the origin with the given field of view
+	XMMATRIX get_clip_from_object(XMVECTOR xm_eye, float fov_degrees) {
+		XMMATRIX xm_view_from_object = XMMatrixLookToLH(xm_eye, -xm_eye, XMVectorSet(0.f, 1.f, 0.f, 0.f));
+		XMMATRIX xm_clip_from_view = XMMatrixPerspectiveFovLH(XMConvertToRadians(fov_degrees), 16.f / 9.f, 0.1f, 100.f);
+		return XMMatrixTranspose(xm_view_from_object * xm_clip_from_view);
+	}
+
+	// Every meshlet is a contiguous range of whole triangles within the limits, the ranges cover the indices in order and hold
+	// the triangles the mesh had with their winding. Every vertex is in its meshlet's sphere and every normal within its cone.
+	void check_meshlets(const MeshData &mesh, const vector<uint32_t> &v_indices, const vector<Meshlet> &v_meshlets) {
+		using namespace meshlet_builder;
+		constexpr float cone_tolerance{ 1e-5f };
+		uint32_t num_wrong_ranges = 0;
+		uint32_t num_limit_violations = 0;
+		uint32_t num_bound_violations = 0;
+		uint32_t num_cone_violations = 0;
+		uint32_t next_index = 0;
+		for(auto& meshlet : v_meshlets) {
+			bool is_range_wrong = meshlet.first_index != next_index || meshlet.index_count == 0 || meshlet.index_count % 3 != 0 || meshlet.first_index + meshlet.index_count > v_indices.size();
+			num_wrong_ranges += is_range_wrong ? 1 : 0;
+			next_index = meshlet.first_index + meshlet.index_count;
+			if(is_range_wrong) { continue; }
+
+			set<uint32_t> vertices(v_indices.begin() + meshlet.first_index, v_indices.begin() + meshlet.first_index + meshlet.index_count);
+			bool is_over_limits = vertices.size() != meshlet.vertex_count || vertices.size() > max_meshlet_vertex_count || meshlet.index_count > 3 * max_meshlet_triangle_count;
+			num_limit_violations += is_over_limits ? 1 : 0;
+			for(uint32_t vertex : vertices) {
+				float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&mesh.v_vertices[vertex].pos) - XMLoadFloat3(&meshlet.center)));
+				num_bound_violations += (distance <= meshlet.radius * (1.f + 1e-5f)) ? 0 : 1;
+			}
+
+			XMVECTOR xm_axis = XMLoadFloat3(&meshlet.cone_axis);
+			bool is_cone_wrong = meshlet.cone_cos < 0.f || meshlet.cone_cos > 1.f || abs(meshlet.cone_cos * meshlet.cone_cos + meshlet.cone_sin * meshlet.cone_sin - 1.f) > cone_tolerance;
+			is_cone_wrong |= meshlet.cone_cos > 0.f && abs(XMVectorGetX(XMVector3Length(xm_axis)) - 1.f) > cone_tolerance;
+			for(uint32_t index = meshlet.first_index; meshlet.cone_cos > 0.f && index < meshlet.first_index + meshlet.index_count; index += 3) {
+				XMVECTOR xm_a = XMLoadFloat3(&mesh.v_vertices[v_indices[index]].pos);
+				XMVECTOR xm_normal = XMVector3Cross(XMLoadFloat3(&mesh.v_vertices[v_indices[index + 1]].pos) - xm_a, XMLoadFloat3(&mesh.v_vertices[v_indices[index + 2]].pos) - xm_a);
+				float length = XMVectorGetX(XMVector3Length(xm_normal));
+				is_cone_wrong |= length > 0.f && XMVectorGetX(XMVector3Dot(xm_normal, xm_axis)) < (meshlet.cone_cos - cone_tolerance) * length;
+			}
+			num_cone_violations += is_cone_wrong ? 1 : 0;
+		}
+		CHECK(num_wrong_ranges == 0 && next_index == v_indices.size());
+		CHECK(num_limit_violations == 0);
+		CHECK(num_bound_violations == 0);
+		CHECK(num_cone_violations == 0);
+
+		// Triangles as their corners rotated to start at the lowest index, which keeps the winding
+		auto get_sorted_triangles = [](const vector<uint32_t> &v_indices) {
+			vector<array<uint32_t, 3>> v_triangles;
+			for(size_t index = 0; index + 3 <= v_indices.size(); index += 3) {
+				array<uint32_t, 3> triangle = { v_indices[index], v_indices[index + 1], v_indices[index + 2] };
+				rotate(triangle.begin(), min_element(triangle.begin(), triangle.end()), triangle.end());
+				v_triangles.push_back(triangle);
+			}
+			sort(v_triangles.begin(), v_triangles.end());
+			return v_triangles;
+		};
+		CHECK(v_indices.size() == mesh.v_indices.size() && get_sorted_triangles(v_indices) == get_sorted_triangles(mesh.v_indices));
+	}
+
+	// The benchmark's spheres and cubes and a bumpy sphere, built as a batch of jobs, give each mesh the meshlets building it
+	// alone does
+	void test_build() {
+		mt19937 generator(50);
+		vector<MeshData> v_meshes(4);
+		mesh_simplifier_tests::make_sphere(64, 32, v_meshes[0]);
+		mesh_simplifier_tests::make_sphere(160, 80, v_meshes[1]);
+		mesh_simplifier_tests::make_cube(24, v_meshes[2]);
+		make_bumpy_sphere(generator, v_meshes[3]);
+		vector<meshlet_builder::MeshletMesh> v_meshlet_meshes(v_meshes.size());
+		for(uint32_t mesh_index = 0; mesh_index < v_meshes.size(); ++mesh_index) {
+			v_meshlet_meshes[mesh_index].p_mesh = &v_meshes[mesh_index];
+		}
+		meshlet_builder::build_meshlets(v_meshlet_meshes);
+		for(uint32_t mesh_index = 0; mesh_index < v_meshes.size(); ++mesh_index) {
+			auto& meshlet_mesh = v_meshlet_meshes[mesh_index];
+			check_meshlets(v_meshes[mesh_index], meshlet_mesh.v_indices, meshlet_mesh.v_meshlets);
+
+			vector<uint32_t> v_indices = v_meshes[mesh_index].v_indices;
+			vector<Meshlet> v_meshlets;
+			meshlet_builder::build_meshlets(v_meshes[mesh_index].v_vertices.data(), static_cast<uint32_t>(v_meshes[mesh_index].v_vertices.size()), v_indices, v_meshlets);
+			bool is_equal = v_indices == meshlet_mesh.v_indices && v_meshlets.size() == meshlet_mesh.v_meshlets.size();
+			for(uint32_t meshlet_index = 0; is_equal && meshlet_index < v_meshlets.size(); ++meshlet_index) {
+				is_equal = memcmp(&v_meshlets[meshlet_index], &meshlet_mesh.v_meshlets[meshlet_index], sizeof(Meshlet)) == 0;
+			}
+			CHECK(is_equal);
+		}
+	}
+
+	// Triangles that share no vertices still fill meshlets up to the vertex limit rather than making one meshlet each, many
+	// triangles over a few vertices fill them up to the triangle limit, and a mesh without triangles has no meshlets
+	void test_limits() {
+		using namespace meshlet_builder;
+		mt19937 generator(50);
+		uniform_real_distribution<float> position(-1.f, 1.f);
+		auto build = [](const MeshData &mesh, vector<uint32_t> &v_indices, vector<Meshlet> &v_meshlets) {
+			v_indices = mesh.v_indices;
+			build_meshlets(mesh.v_vertices.data(), static_cast<uint32_t>(mesh.v_vertices.size()), v_indices, v_meshlets);
+			check_meshlets(mesh, v_indices, v_meshlets);
+		};
+		vector<uint32_t> v_indices;
+		vector<Meshlet> v_meshlets;
+
+		constexpr uint32_t num_disconnected_triangles{ 300 };
+		constexpr uint32_t num_triangles_per_meshlet{ max_meshlet_vertex_count / 3 };
+		MeshData mesh;
+		for(uint32_t index = 0; index < 3 * num_disconnected_triangles; ++index) {
+			Vertex vertex{};
+			vertex.pos = { position(generator), position(generator), position(generator) };
+			mesh.v_vertices.push_back(vertex);
+			mesh.v_indices.push_back(index);
+		}
+		build(mesh, v_indices, v_meshlets);
+		CHECK(v_meshlets.size() == (num_disconnected_triangles + num_triangles_per_meshlet - 1) / num_triangles_per_meshlet);
+
+		constexpr uint32_t num_shared_vertices{ 16 };
+		constexpr uint32_t num_shared_vertex_triangles{ 1000 };
+		mesh.v_vertices.resize(num_shared_vertices);
+		mesh.v_indices.clear();
+		for(uint32_t triangle = 0; triangle < num_shared_vertex_triangles; ++triangle) {
+			uint32_t a = generator() % num_shared_vertices;
+			uint32_t b = (a + 1 + generator() % (num_shared_vertices - 1)) % num_shared_vertices;
+			uint32_t c = b;
+			while(c == a || c == b) { c = generator() % num_shared_vertices; }
+			mesh.v_indices.insert(mesh.v_indices.end(), { a, b, c });
+		}
+		build(mesh, v_indices, v_meshlets);
+		CHECK(v_meshlets.size() == (num_shared_vertex_triangles + max_meshlet_triangle_count - 1) / max_meshlet_triangle_count);
+
+		mesh.v_indices.clear();
+		v_meshlets.resize(1);
+		build(mesh, v_indices, v_meshlets);
+		CHECK(v_meshlets.empty());
+	}
+
+	// Culls the meshlets from random eyes, half of them close to the surface and some inside the meshes, with fields of view
+	// down to a few degrees. A meshlet culled as outside the frustum has all its vertices outside one clip plane, and one with
+	// a vertex farther outside a plane than the diameter of its sphere is culled. One culled as backfacing has no triangle
+	// facing the eye. The ranges are the visible meshlets' in order, separate and at most max_ranges_per_draw of them.
+	void test_culling() {
+		using namespace meshlet_builder;
+		constexpr float distance_tolerance{ 1e-5f };
+		mt19937 generator(50);
+		vector<MeshData> v_meshes(3);
+		mesh_simplifier_tests::make_sphere(160, 80, v_meshes[0]);
+		mesh_simplifier_tests::make_cube(32, v_meshes[1]);
+		make_bumpy_sphere(generator, v_meshes[2]);
+		uniform_real_distribution<float> direction(-1.f, 1.f), near_distance(1.02f, 1.3f), far_distance(0.5f, 6.f), fov(2.f, 90.f);
+		uint32_t num_wrong_frustum_culls = 0;
+		uint32_t num_missed_frustum_culls = 0;
+		uint32_t num_wrong_backface_culls = 0;
+		uint32_t num_wrong_ranges = 0;
+		uint32_t num_wrong_statistics = 0;
+		MeshletCullingStatistics statistics = {};
+		for(auto& mesh : v_meshes) {
+			vector<uint32_t> v_indices = mesh.v_indices;
+			vector<Meshlet> v_meshlets;
+			build_meshlets(mesh.v_vertices.data(), static_cast<uint32_t>(mesh.v_vertices.size()), v_indices, v_meshlets);
+			vector<IndexRange> v_ranges;
+			vector<uint32_t> v_gaps;
+			for(uint32_t view_index = 0; view_index < 64; ++view_index) {
+				float distance = (view_index % 2 == 0) ? near_distance(generator) : far_distance(generator);
+				XMVECTOR xm_eye = XMVector3Normalize(XMVectorSet(direction(generator), direction(generator), direction(generator), 0.f)) * distance;
+				XMMATRIX xm_clip_from_object = get_clip_from_object(xm_eye, fov(generator));
+				CullView view;
+				make_cull_view(xm_clip_from_object, xm_eye, view);
+				bool is_backface_culling_enabled = view_index % 4 != 3;
+				MeshletCullingStatistics view_statistics = {};
+				cull_meshlets(view, v_meshlets.data(), static_cast<uint32_t>(v_meshlets.size()), is_backface_culling_enabled, v_ranges, v_gaps, view_statistics);
+
+				// Clip space x and y against -w and w and z against 0 and w, scaled to distances in the space of the meshlets
+				XMMATRIX xm_object_to_clip = XMMatrixTranspose(xm_clip_from_object);
+				const XMVECTOR *p_rows = xm_clip_from_object.r;
+				XMVECTOR a_xm_planes[6] = { p_rows[3] + p_rows[0], p_rows[3] - p_rows[0], p_rows[3] + p_rows[1], p_rows[3] - p_rows[1], p_rows[2], p_rows[3] - p_rows[2] };
+				float a_plane_scales[6];
+				for(uint32_t plane_index = 0; plane_index < 6; ++plane_index) {
+					a_plane_scales[plane_index] = 1.f / XMVectorGetX(XMVector3Length(a_xm_planes[plane_index]));
+				}
+
+				uint32_t num_visible_meshlets = 0;
+				uint32_t range_index = 0;
+				for(auto& meshlet : v_meshlets) {
+					array<float, 6> a_min_distances, a_max_distances;
+					a_min_distances.fill(FLT_MAX);
+					a_max_distances.fill(-FLT_MAX);
+					bool has_front_facing_triangle = false;
+					for(uint32_t index = meshlet.first_index; index < meshlet.first_index + meshlet.index_count; index += 3) {
+						XMVECTOR a_xm_corners[3];
+						for(uint32_t corner = 0; corner < 3; ++corner) {
+							a_xm_corners[corner] = XMLoadFloat3(&mesh.v_vertices[v_indices[index + corner]].pos);
+							XMFLOAT4 clip;
+							XMStoreFloat4(&clip, XMVector4Transform(XMVectorSetW(a_xm_corners[corner], 1.f), xm_object_to_clip));
+							float a_distances[6] = { clip.w + clip.x, clip.w - clip.x, clip.w + clip.y, clip.w - clip.y, clip.z, clip.w - clip.z };
+							for(uint32_t plane_index = 0; plane_index < 6; ++plane_index) {
+								a_min_distances[plane_index] = min(a_min_distances[plane_index], a_distances[plane_index] * a_plane_scales[plane_index]);
+								a_max_distances[plane_index] = max(a_max_distances[plane_index], a_distances[plane_index] * a_plane_scales[plane_index]);
+							}
+						}
+						XMVECTOR xm_normal = XMVector3Cross(a_xm_corners[1] - a_xm_corners[0], a_xm_corners[2] - a_xm_corners[0]);
+						XMVECTOR xm_to_triangle = a_xm_corners[0] - xm_eye;
+						float facing = XMVectorGetX(XMVector3Dot(xm_normal, xm_to_triangle));
+						has_front_facing_triangle |= facing < -distance_tolerance * XMVectorGetX(XMVector3Length(xm_normal)) * XMVectorGetX(XMVector3Length(xm_to_triangle));
+					}
+					bool is_outside = false;
+					bool is_far_outside = false;
+					for(uint32_t plane_index = 0; plane_index < 6; ++plane_index) {
+						is_outside |= a_max_distances[plane_index] < distance_tolerance;
+						is_far_outside |= a_min_distances[plane_index] < -2.f * meshlet.radius - distance_tolerance;
+					}
+
+					MeshletVisibility visibility = get_visibility(view, meshlet, is_backface_culling_enabled);
+					num_wrong_frustum_culls += (visibility == MESHLET_OUTSIDE_FRUSTUM && !is_outside) ? 1 : 0;
+					num_missed_frustum_culls += (visibility != MESHLET_OUTSIDE_FRUSTUM && is_far_outside) ? 1 : 0;
+					num_wrong_backface_culls += (visibility == MESHLET_BACKFACING && (!is_backface_culling_enabled || has_front_facing_triangle)) ? 1 : 0;
+					if(visibility == MESHLET_VISIBLE) {
+						num_visible_meshlets++;
+						while(range_index < v_ranges.size() && v_ranges[range_index].first_index + v_ranges[range_index].index_count <= meshlet.first_index) { range_index++; }
+						bool is_in_range = range_index < v_ranges.size() && v_ranges[range_index].first_index <= meshlet.first_index;
+						num_wrong_ranges += is_in_range ? 0 : 1;
+					}
+				}
+
+				// Ranges start and end at visible meshlets, gaps between them hold only culled ones
+				auto is_visible_between = [&](uint32_t first_index, uint32_t end_index) {
+					return any_of(v_meshlets.begin(), v_meshlets.end(), [&](const Meshlet &meshlet) {
+						bool is_at = meshlet.first_index == first_index || meshlet.first_index + meshlet.index_count == end_index;
+						return is_at && get_visibility(view, meshlet, is_backface_culling_enabled) == MESHLET_VISIBLE;
+					});
+				};
+				uint32_t num_drawn_triangles = 0;
+				for(uint32_t index = 0; index < v_ranges.size(); ++index) {
+					auto& range = v_ranges[index];
+					bool is_separate = index == 0 || v_ranges[index - 1].first_index + v_ranges[index - 1].index_count < range.first_index;
+					bool is_range_right = range.index_count > 0 && is_separate && is_visible_between(range.first_index, UINT32_MAX) && is_visible_between(UINT32_MAX, range.first_index + range.index_count);
+					num_wrong_ranges += is_range_right ? 0 : 1;
+					num_drawn_triangles += range.index_count / 3;
+				}
+				num_wrong_ranges += (v_ranges.size() <= max_ranges_per_draw) ? 0 : 1;
+				uint32_t num_culled_meshlets = view_statistics.num_frustum_culled_meshlets + view_statistics.num_backface_culled_meshlets;
+				bool is_statistics_wrong = view_statistics.num_meshlets != v_meshlets.size() || num_culled_meshlets + num_visible_meshlets != v_meshlets.size();
+				is_statistics_wrong |= view_statistics.num_triangles != v_indices.size() / 3 || view_statistics.num_drawn_triangles != num_drawn_triangles;
+				is_statistics_wrong |= view_statistics.num_ranges != v_ranges.size();
+				num_wrong_statistics += is_statistics_wrong ? 1 : 0;
+				statistics.num_frustum_culled_meshlets += view_statistics.num_frustum_culled_meshlets;
+				statistics.num_backface_culled_meshlets += view_statistics.num_backface_culled_meshlets;
+			}
+		}
+		CHECK(num_wrong_frustum_culls == 0);
+		CHECK(num_missed_frustum_culls == 0);
+		CHECK(num_wrong_backface_culls == 0);
+		CHECK(num_wrong_ranges == 0);
+		CHECK(num_wrong_statistics == 0);
+		CHECK(statistics.num_frustum_culled_meshlets > 0 && statistics.num_backface_culled_meshlets > 0);
+	}
+
+	struct BackfaceCulling {
+		uint32_t num_wrongly_culled_meshlets;
+		float culled_triangle_fraction;
+		float backfacing_triangle_fraction;
+	};
+
+	// Backface culling from num_views eyes in Fibonacci sphere directions at view_distance, with a frustum that holds everything.
+	// A culled meshlet is wrong when it has a triangle facing the eye; the ideal culls every triangle facing away.
+	BackfaceCulling cull_from_around(const MeshData &mesh, const meshlet_builder::MeshletMesh &meshlet_mesh, uint32_t num_views, float view_distance) {
+		using namespace meshlet_builder;
+		BackfaceCulling result = {};
+		CullView view = {};
+		for(auto& plane : view.a_planes) {
+			plane = { 0.f, 0.f, 0.f, 1.f };
+		}
+		MeshletCullingStatistics statistics = {};
+		vector<IndexRange> v_ranges;
+		vector<uint32_t> v_gaps;
+		uint32_t num_backfacing_triangles = 0;
+		for(uint32_t view_index = 0; view_index < num_views; ++view_index) {
+			float y = 1.f - 2.f * (view_index + 0.5f) / num_views;
+			float ring_radius = sqrt(max(0.f, 1.f - y * y));
+			float phi = view_index * XM_PI * (3.f - sqrt(5.f));
+			XMVECTOR xm_eye = XMVectorSet(ring_radius * cos(phi), y, ring_radius * sin(phi), 0.f) * view_distance;
+			XMStoreFloat3(&view.eye, xm_eye);
+			cull_meshlets(view, meshlet_mesh.v_meshlets.data(), static_cast<uint32_t>(meshlet_mesh.v_meshlets.size()), true, v_ranges, v_gaps, statistics);
+
+			for(auto& meshlet : meshlet_mesh.v_meshlets) {
+				bool is_culled = get_visibility(view, meshlet, true) == MESHLET_BACKFACING;
+				bool is_wrong = false;
+				for(uint32_t index = meshlet.first_index; index < meshlet.first_index + meshlet.index_count; index += 3) {
+					XMVECTOR xm_a = XMLoadFloat3(&mesh.v_vertices[meshlet_mesh.v_indices[index]].pos);
+					XMVECTOR xm_b = XMLoadFloat3(&mesh.v_vertices[meshlet_mesh.v_indices[index + 1]].pos);
+					XMVECTOR xm_c = XMLoadFloat3(&mesh.v_vertices[meshlet_mesh.v_indices[index + 2]].pos);
+					bool is_backfacing = XMVectorGetX(XMVector3Dot(XMVector3Cross(xm_b - xm_a, xm_c - xm_a), xm_a - xm_eye)) >= 0.f;
+					num_backfacing_triangles += is_backfacing ? 1 : 0;
+					is_wrong |= is_culled && !is_backfacing;
+				}
+				result.num_wrongly_culled_meshlets += is_wrong ? 1 : 0;
+			}
+		}
+		float num_tested_triangles = static_cast<float>(statistics.num_triangles);
+		result.culled_triangle_fraction = (num_tested_triangles - statistics.num_drawn_triangles) / max(num_tested_triangles, 1.f);
+		result.backfacing_triangle_fraction = num_backfacing_triangles / max(num_tested_triangles, 1.f);
+		return result;
+	}
+
+	// Cones cull a large share of what faces away on closed meshes seen from all around, and nothing facing the eye from near
+	// or far, also on a bumpy sphere
+	void test_backface_culling() {
+		using namespace meshlet_builder;
+		mt19937 generator(50);
+		vector<MeshData> v_meshes(3);
+		mesh_simplifier_tests::make_sphere(160, 80, v_meshes[0]);
+		mesh_simplifier_tests::make_cube(32, v_meshes[1]);
+		make_bumpy_sphere(generator, v_meshes[2]);
+		uint32_t num_wrongly_culled_meshlets = 0;
+		for(uint32_t mesh_index = 0; mesh_index < v_meshes.size(); ++mesh_index) {
+			auto& mesh = v_meshes[mesh_index];
+			MeshletMesh meshlet_mesh = { &mesh, mesh.v_indices, {} };
+			build_meshlets(mesh.v_vertices.data(), static_cast<uint32_t>(mesh.v_vertices.size()), meshlet_mesh.v_indices, meshlet_mesh.v_meshlets);
+			for(float view_distance : { 1.02f, 1.1f, 3.f }) {
+				BackfaceCulling culling = cull_from_around(mesh, meshlet_mesh, 128, view_distance);
+				num_wrongly_culled_meshlets += culling.num_wrongly_culled_meshlets;
+				if(mesh_index < 2 && view_distance == 3.f) {
+					CHECK(culling.culled_triangle_fraction > 0.5f * culling.backfacing_triangle_fraction);
+				}
+			}
+		}
+		CHECK(num_wrongly_culled_meshlets == 0);
+	}
+
+	// Past max_ranges_per_draw the ranges separated by the smallest gaps are merged, the largest gaps are kept
+	void test_merge_ranges() {
+		using namespace meshlet_builder;
+		mt19937 generator(50);
+		for(uint32_t num_ranges : { max_ranges_per_draw + 1, 100u, 1000u }) {
+			vector<IndexRange> v_ranges;
+			uint32_t first_index = 0;
+			for(uint32_t range_index = 0; range_index < num_ranges; ++range_index) {
+				first_index += 3 * (1 + generator() % 4);
+				v_ranges.push_back({ first_index, 3 * (1 + static_cast<uint32_t>(generator() % 8)) });
+				first_index += v_ranges.back().index_count;
+			}
+			vector<IndexRange> v_merged_ranges = v_ranges;
+			vector<uint32_t> v_gaps;
+			merge_ranges(v_merged_ranges, v_gaps);
+			CHECK(v_merged_ranges.size() == max_ranges_per_draw);
+
+			// Every range is inside a merged one, a merged range spans the ranges it starts and ends with
+			uint32_t num_uncovered_ranges = 0;
+			uint32_t max_merged_gap = 0;
+			uint32_t min_kept_gap = UINT32_MAX;
+			uint32_t merged_index = 0;
+			for(uint32_t range_index = 0; range_index < num_ranges; ++range_index) {
+				auto& range = v_ranges[range_index];
+				while(merged_index < v_merged_ranges.size() && v_merged_ranges[merged_index].first_index + v_merged_ranges[merged_index].index_count < range.first_index + range.index_count) { merged_index++; }
+				bool is_covered = merged_index < v_merged_ranges.size() && v_merged_ranges[merged_index].first_index <= range.first_index;
+				num_uncovered_ranges += is_covered ? 0 : 1;
+				if(range_index == 0 || !is_covered) { continue; }
+				uint32_t gap = range.first_index - (v_ranges[range_index - 1].first_index + v_ranges[range_index - 1].index_count);
+				if(v_merged_ranges[merged_index].first_index == range.first_index) {
+					min_kept_gap = min(min_kept_gap, gap);
+				}
+				else {
+					max_merged_gap = max(max_merged_gap, gap);
+				}
+			}
+			CHECK(num_uncovered_ranges == 0);
+			CHECK(v_merged_ranges.front().first_index == v_ranges.front().first_index);
+			CHECK(v_merged_ranges.back().first_index + v_merged_ranges.back().index_count == v_ranges.back().first_index + v_ranges.back().index_count);
+			CHECK(max_merged_gap <= min_kept_gap);
+		}
+	}
+
+	void run() {
+		test_build();
+		test_limits();
+		test_culling();
+		test_backface_culling();
+		test_merge_ranges();
+	}
+} // namespace meshlet_builder_tests
@@ -0,0 +1,351 @@
+namespace occlusion_culler_tests
+{
+	vector<OcclusionIsa> get_supported_isas() {
+		vector<OcclusionIsa> v_isas = { OCCLUSION_ISA_SSE };
+		if(occlusion_culler::is_avx2_supported()) {
+			v_isas.push_back(OCCLUSION_ISA_AVX2);
+		}
+		return v_isas;
+	}
+
+	void add_box(const XMFLOAT3 &min_ws, const XMFLOAT3 &max_ws, occlusion_culler::OccluderMesh &occluder_mesh) {
+		static const uint32_t a_box_indices[36] = {
+			0, 2, 1, 1, 2, 3,	4, 5, 6, 5, 7, 6,
+			0, 1, 4, 1, 5, 4,	2, 6, 3, 3, 6, 7,
+			0, 4, 2, 2, 4, 6,	1, 3, 5, 3, 7, 5
+		};
+		uint32_t first_vertex = static_cast<uint32_t>(occluder_mesh.v_positions_ws.size());
+		for(uint32_t corner = 0; corner < 8; ++corner) {
+			occluder_mesh.v_positions_ws.push_back({ (corner & 1) ? max_ws.x : min_ws.x, (corner & 2) ? max_ws.y : min_ws.y, (corner & 4) ? max_ws.z : min_ws.z });
+		}
+		for(uint32_t index : a_box_indices) {
+			occluder_mesh.v_indices.push_back(first_vertex + index);
+		}
+	}
+
+	DrawInfo make_box_draw(const XMFLOAT3 &min_ws, const XMFLOAT3 &max_ws) {
+		DrawInfo draw_info = {};
+		draw_info.bbox_center_ws = { (min_ws.x + max_ws.x) * 0.5f, (min_ws.y + max_ws.y) * 0.5f, (min_ws.z + max_ws.z) * 0.5f };
+		draw_info.bbox_extents_ws = { (max_ws.x - min_ws.x) * 0.5f, (max_ws.y - min_ws.y) * 0.5f, (max_ws.z - min_ws.z) * 0.5f };
+		return draw_info;
+	}
+
+	// Blocks of buildings on a grid with cars in the streets between them, seen from street level down a street.
+	// The buildings are the occluders and, like the cars, also draws to cull.
+	void make_city(uint32_t num_blocks_per_side, occlusion_culler::OccluderMesh &occluder_mesh, vector<DrawInfo> &v_draws, XMMATRIX &xm_clip_from_world) {
+		constexpr float block_size{ 12.f };
+		constexpr float street_width{ 4.f };
+		uint64_t state = 0x9E3779B97F4A7C15ull;
+		auto get_random = [&state]() {
+			state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+			return float(state >> 40) / float(1 << 24);
+		};
+
+		float origin = -0.5f * num_blocks_per_side * (block_size + street_width);
+		for(uint32_t block_z = 0; block_z < num_blocks_per_side; ++block_z) {
+			for(uint32_t block_x = 0; block_x < num_blocks_per_side; ++block_x) {
+				float x = origin + block_x * (block_size + street_width);
+				float z = origin + block_z * (block_size + street_width);
+				float inset = get_random() * 2.f;
+				XMFLOAT3 min_ws = { x + inset, 0.f, z + inset };
+				XMFLOAT3 max_ws = { x + block_size - inset, 6.f + get_random() * 40.f, z + block_size - inset };
+				add_box(min_ws, max_ws, occluder_mesh);
+				v_draws.push_back(make_box_draw(min_ws, max_ws));
+				for(uint32_t car_index = 0; car_index < 4; ++car_index) {
+					float along = get_random() * block_size;
+					XMFLOAT3 car_min_ws = (car_index & 1) ? XMFLOAT3{ x + along, 0.f, z + block_size + 0.5f } : XMFLOAT3{ x + block_size + 0.5f, 0.f, z + along };
+					XMFLOAT3 car_max_ws = (car_index & 1) ? XMFLOAT3{ car_min_ws.x + 4.f, 1.5f, car_min_ws.z + 1.8f } : XMFLOAT3{ car_min_ws.x + 1.8f, 1.5f, car_min_ws.z + 4.f };
+					v_draws.push_back(make_box_draw(car_min_ws, car_max_ws));
+				}
+			}
+		}
+
+		float street_center = origin - 0.5f * street_width;
+		XMVECTOR xm_eye = XMVectorSet(street_center, 1.7f, street_center, 1.f);
+		XMVECTOR xm_direction = XMVectorSet(1.f, -0.05f, 0.35f, 0.f);
+		XMMATRIX xm_view_from_world = XMMatrixLookToLH(xm_eye, xm_direction, XMVectorSet(0.f, 1.f, 0.f, 0.f));
+		XMMATRIX xm_clip_from_view = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.f), float(occlusion_culler::depth_buffer_width) / occlusion_culler::depth_buffer_height, 0.1f, 1000.f);
+		xm_clip_from_world = XMMatrixTranspose(xm_view_from_world * xm_clip_from_view);
+	}
+
+	// Point sampled with exact depths at reference_scale times the resolution. Where a triangle covers a whole pixel the
+	// culler's depth is never nearer than the reference's, boxes it culls and the reference does not are seen through gaps
+	// at silhouettes smaller than its pixels.
+	constexpr uint32_t reference_scale{ 4 };
+
+	struct ReferenceDepthBuffer {
+		uint32_t width;
+		uint32_t height;
+		vector<float> v_depths;
+	};
+
+	void rasterize_reference(const occlusion_culler::Culler &culler, ReferenceDepthBuffer &buffer) {
+		buffer.width = occlusion_culler::depth_buffer_width * reference_scale;
+		buffer.height = occlusion_culler::depth_buffer_height * reference_scale;
+		buffer.v_depths.assign(buffer.width * buffer.height, 1.f);
+		float scale = float(reference_scale);
+		for(const auto& triangle : culler.v_triangles) {
+			int32_t x_begin, y_begin, x_end, y_end;
+			if(!triangle.is_valid || !occlusion_culler::get_pixel_bounds(triangle, x_begin, y_begin, x_end, y_end)) { continue; }
+			float a_x[3], a_y[3];
+			for(uint32_t corner = 0; corner < 3; ++corner) {
+				a_x[corner] = triangle.a_x[corner] * scale;
+				a_y[corner] = triangle.a_y[corner] * scale;
+			}
+			float area = (a_x[1] - a_x[0]) * (a_y[2] - a_y[0]) - (a_x[2] - a_x[0]) * (a_y[1] - a_y[0]);
+			for(uint32_t y = y_begin * reference_scale; y < y_end * reference_scale; ++y) {
+				for(uint32_t x = x_begin * reference_scale; x < x_end * reference_scale; ++x) {
+					float sample_x = x + 0.5f, sample_y = y + 0.5f;
+					float w0 = ((a_x[1] - sample_x) * (a_y[2] - sample_y) - (a_x[2] - sample_x) * (a_y[1] - sample_y)) / area;
+					float w1 = ((a_x[2] - sample_x) * (a_y[0] - sample_y) - (a_x[0] - sample_x) * (a_y[2] - sample_y)) / area;
+					float w2 = 1.f - w0 - w1;
+					if(w0 < 0.f || w1 < 0.f || w2 < 0.f) { continue; }
+					float z = w0 * triangle.a_z[0] + w1 * triangle.a_z[1] + w2 * triangle.a_z[2];
+					float &depth = buffer.v_depths[y * buffer.width + x];
+					depth = min(depth, z);
+				}
+			}
+		}
+	}
+
+	bool is_visible_reference(const ReferenceDepthBuffer &buffer, const XMMATRIX &xm_transform, const DrawInfo &draw_info) {
+		int32_t x_begin, y_begin, x_end, y_end;
+		float min_z;
+		bool is_crossing_near_plane;
+		if(!occlusion_culler::project_box(xm_transform, draw_info.bbox_center_ws, draw_info.bbox_extents_ws, x_begin, y_begin, x_end, y_end, min_z, is_crossing_near_plane)) {
+			return is_crossing_near_plane;
+		}
+		for(uint32_t y = y_begin * reference_scale; y < y_end * reference_scale; ++y) {
+			for(uint32_t x = x_begin * reference_scale; x < x_end * reference_scale; ++x) {
+				if(buffer.v_depths[y * buffer.width + x] >= min_z) { return true; }
+			}
+		}
+		return false;
+	}
+
+	// Looks down +z from the origin, the near plane is far enough for depths to differ measurably between neighbouring pixels
+	XMMATRIX get_clip_from_world() {
+		XMMATRIX xm_view_from_world = XMMatrixLookToLH(XMVectorSet(0.f, 0.f, 0.f, 1.f), XMVectorSet(0.f, 0.f, 1.f, 0.f), XMVectorSet(0.f, 1.f, 0.f, 0.f));
+		XMMATRIX xm_clip_from_view = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.f), float(occlusion_culler::depth_buffer_width) / occlusion_culler::depth_buffer_height, 1.f, 100.f);
+		return XMMatrixTranspose(xm_view_from_world * xm_clip_from_view);
+	}
+
+	// Boxes of random sizes and orientations, some of them crossing the near plane or behind the camera
+	void make_random_occluders(mt19937 &generator, uint32_t num_boxes, occlusion_culler::OccluderMesh &occluder_mesh) {
+		uniform_real_distribution<float> position(-12.f, 12.f), depth(-4.f, 40.f), size(0.2f, 6.f), angle(0.f, XM_2PI);
+		for(uint32_t box_index = 0; box_index < num_boxes; ++box_index) {
+			uint32_t first_vertex = static_cast<uint32_t>(occluder_mesh.v_positions_ws.size());
+			XMFLOAT3 center = { position(generator), position(generator), depth(generator) };
+			XMFLOAT3 extents = { size(generator), size(generator), size(generator) };
+			add_box({ -extents.x, -extents.y, -extents.z }, extents, occluder_mesh);
+			XMMATRIX xm_rotation = XMMatrixRotationRollPitchYaw(angle(generator), angle(generator), angle(generator));
+			for(uint32_t vertex_index = first_vertex; vertex_index < occluder_mesh.v_positions_ws.size(); ++vertex_index) {
+				auto& position_ws = occluder_mesh.v_positions_ws[vertex_index];
+				XMStoreFloat3(&position_ws, XMVector3Transform(XMLoadFloat3(&position_ws), xm_rotation) + XMLoadFloat3(&center));
+			}
+		}
+	}
+
+	// Farthest depth the triangle's plane has over the pixel, never beyond the triangle's farthest vertex
+	float get_farthest_depth(const occlusion_culler::ScreenTriangle &triangle, uint32_t x, uint32_t y) {
+		const float *p_x = triangle.a_x, *p_y = triangle.a_y, *p_z = triangle.a_z;
+		double area = double(p_x[1] - p_x[0]) * (p_y[2] - p_y[0]) - double(p_x[2] - p_x[0]) * (p_y[1] - p_y[0]);
+		double z_dx = (double(p_z[1] - p_z[0]) * (p_y[2] - p_y[0]) - double(p_z[2] - p_z[0]) * (p_y[1] - p_y[0])) / area;
+		double z_dy = (double(p_z[2] - p_z[0]) * (p_x[1] - p_x[0]) - double(p_z[1] - p_z[0]) * (p_x[2] - p_x[0])) / area;
+		double z = p_z[0] + z_dx * (x + 0.5 - p_x[0]) + z_dy * (y + 0.5 - p_y[0]) + 0.5 * (abs(z_dx) + abs(z_dy));
+		return static_cast<float>(min(z, double(max({ p_z[0], p_z[1], p_z[2] }))));
+	}
+
+	// Smallest barycentric coordinate of the pixel center, negative outside of the triangle
+	double get_min_barycentric(const occlusion_culler::ScreenTriangle &triangle, uint32_t x, uint32_t y) {
+		const float *p_x = triangle.a_x, *p_y = triangle.a_y;
+		double sample_x = x + 0.5, sample_y = y + 0.5;
+		double area = double(p_x[1] - p_x[0]) * (p_y[2] - p_y[0]) - double(p_x[2] - p_x[0]) * (p_y[1] - p_y[0]);
+		double w0 = ((p_x[1] - sample_x) * (p_y[2] - sample_y) - (p_x[2] - sample_x) * (p_y[1] - sample_y)) / area;
+		double w1 = ((p_x[2] - sample_x) * (p_y[0] - sample_y) - (p_x[0] - sample_x) * (p_y[2] - sample_y)) / area;
+		return min({ w0, w1, 1.0 - w0 - w1 });
+	}
+
+	// Every pixel holds the farthest depth over the pixel of the nearest triangle covering its center. Centers within a rounding
+	// error of an edge may or may not be covered, so the depth is bounded by the triangles that surely cover the center and
+	// those that might. Tiles keep the farthest depth of their pixels.
+	void check_depths(const occlusion_culler::Culler &culler) {
+		using namespace occlusion_culler;
+		constexpr double edge_tolerance{ 1e-4 };
+		constexpr float depth_tolerance{ 1e-5f };
+		vector<float> v_lower_depths(depth_buffer_width * depth_buffer_height, 1.f);
+		vector<float> v_upper_depths(depth_buffer_width * depth_buffer_height, 1.f);
+		for(auto& triangle : culler.v_triangles) {
+			int32_t x_begin, y_begin, x_end, y_end;
+			if(!triangle.is_valid || !get_pixel_bounds(triangle, x_begin, y_begin, x_end, y_end)) { continue; }
+			for(int32_t y = y_begin; y < y_end; ++y) {
+				for(int32_t x = x_begin; x < x_end; ++x) {
+					double min_barycentric = get_min_barycentric(triangle, x, y);
+					if(min_barycentric < -edge_tolerance) { continue; }
+					float depth = get_farthest_depth(triangle, x, y);
+					uint32_t pixel_index = y * depth_buffer_width + x;
+					v_lower_depths[pixel_index] = min(v_lower_depths[pixel_index], depth);
+					if(min_barycentric > edge_tolerance) {
+						v_upper_depths[pixel_index] = min(v_upper_depths[pixel_index], depth);
+					}
+				}
+			}
+		}
+
+		uint32_t num_wrong_depths = 0;
+		for(uint32_t pixel_index = 0; pixel_index < culler.v_depths.size(); ++pixel_index) {
+			float depth = culler.v_depths[pixel_index];
+			num_wrong_depths += (depth >= v_lower_depths[pixel_index] - depth_tolerance && depth <= v_upper_depths[pixel_index] + depth_tolerance) ? 0 : 1;
+		}
+		uint32_t num_wrong_tiles = 0;
+		for(uint32_t tile_y = 0; tile_y < tile_count_y; ++tile_y) {
+			for(uint32_t tile_x = 0; tile_x < tile_count_x; ++tile_x) {
+				float max_depth = 0.f;
+				for(uint32_t y = tile_y * tile_height; y < (tile_y + 1) * tile_height; ++y) {
+					for(uint32_t x = tile_x * tile_width; x < (tile_x + 1) * tile_width; ++x) {
+						max_depth = max(max_depth, culler.v_depths[y * depth_buffer_width + x]);
+					}
+				}
+				num_wrong_tiles += (culler.v_tile_max_depths[tile_y * tile_count_x + tile_x] == max_depth) ? 0 : 1;
+			}
+		}
+		CHECK(num_wrong_depths == 0);
+		CHECK(num_wrong_tiles == 0);
+	}
+
+	// The box test walks tiles and vectors, it has to decide exactly as a test of every pixel the box touches does
+	bool is_visible_per_pixel(const occlusion_culler::Culler &culler, const XMMATRIX &xm_transform, const DrawInfo &draw_info) {
+		int32_t x_begin, y_begin, x_end, y_end;
+		float min_z;
+		bool is_crossing_near_plane;
+		if(!occlusion_culler::project_box(xm_transform, draw_info.bbox_center_ws, draw_info.bbox_extents_ws, x_begin, y_begin, x_end, y_end, min_z, is_crossing_near_plane)) {
+			return is_crossing_near_plane;
+		}
+		for(int32_t y = y_begin; y < y_end; ++y) {
+			for(int32_t x = x_begin; x < x_end; ++x) {
+				if(culler.v_depths[y * occlusion_culler::depth_buffer_width + x] >= min_z) { return true; }
+			}
+		}
+		return false;
+	}
+
+	void test_random_scenes() {
+		mt19937 generator(48);
+		uniform_real_distribution<float> position(-15.f, 15.f), depth(-2.f, 60.f), size(0.05f, 3.f);
+		XMMATRIX xm_clip_from_world = get_clip_from_world();
+		XMMATRIX xm_transform = XMMatrixTranspose(xm_clip_from_world);
+		for(uint32_t scene_index = 0; scene_index < 8; ++scene_index) {
+			occlusion_culler::OccluderMesh occluder_mesh;
+			make_random_occluders(generator, 4 + scene_index * 4, occluder_mesh);
+			vector<DrawInfo> v_draws;
+			for(uint32_t draw_index = 0; draw_index < 2000; ++draw_index) {
+				XMFLOAT3 min_ws = { position(generator), position(generator), depth(generator) };
+				v_draws.push_back(make_box_draw(min_ws, { min_ws.x + size(generator), min_ws.y + size(generator), min_ws.z + size(generator) }));
+			}
+
+			vector<uint8_t> v_sse_visibilities;
+			uint32_t num_isa_mismatches = 0;
+			for(OcclusionIsa isa : get_supported_isas()) {
+				occlusion_culler::Culler culler;
+				occlusion_culler::init(culler, isa);
+				occlusion_culler::rasterize_occluders(culler, occluder_mesh, xm_clip_from_world);
+				check_depths(culler);
+
+				vector<DrawInfo> v_visible_draws;
+				uint32_t num_culled_draws = occlusion_culler::cull_draws(culler, xm_clip_from_world, v_draws, v_visible_draws);
+				uint32_t num_wrong_decisions = 0;
+				for(uint32_t draw_index = 0; draw_index < v_draws.size(); ++draw_index) {
+					num_wrong_decisions += (bool(culler.v_is_draw_visible[draw_index]) == is_visible_per_pixel(culler, xm_transform, v_draws[draw_index])) ? 0 : 1;
+				}
+				CHECK(num_wrong_decisions == 0);
+				CHECK(num_culled_draws + v_visible_draws.size() == v_draws.size());
+				if(isa == OCCLUSION_ISA_SSE) {
+					v_sse_visibilities = culler.v_is_draw_visible;
+				}
+				else {
+					num_isa_mismatches += (culler.v_is_draw_visible == v_sse_visibilities) ? 0 : 1;
+				}
+			}
+			CHECK(num_isa_mismatches == 0);
+		}
+	}
+
+	// A wall in front of the camera and boxes around it
+	void test_wall() {
+		occlusion_culler::OccluderMesh occluder_mesh;
+		add_box({ -5.f, -5.f, 10.f }, { 5.f, 5.f, 11.f }, occluder_mesh);
+		vector<pair<DrawInfo, bool>> v_expectations = {
+			{ make_box_draw({ -1.f, -1.f, 20.f }, { 1.f, 1.f, 22.f }), false },		// behind the wall
+			{ make_box_draw({ 4.5f, -1.f, 20.f }, { 6.f, 1.f, 21.f }), false },		// behind the wall, past its edge in world space
+			{ make_box_draw({ 9.f, -1.f, 20.f }, { 11.f, 1.f, 21.f }), true },		// behind the wall, past its edge on screen
+			{ make_box_draw({ -1.f, -1.f, 5.f }, { 1.f, 1.f, 6.f }), true },			// in front of the wall
+			{ make_box_draw({ -1.f, -1.f, 9.5f }, { 1.f, 1.f, 12.f }), true },		// sticking out of the wall
+			{ make_box_draw({ -1.f, -1.f, -0.5f }, { 1.f, 1.f, 3.f }), true },		// crossing the near plane
+			{ make_box_draw({ -1.f, 30.f, 20.f }, { 1.f, 32.f, 22.f }), false },		// above the screen
+			{ make_box_draw({ -1.f, -1.f, 200.f }, { 1.f, 1.f, 202.f }), false },		// beyond the far plane
+		};
+		vector<DrawInfo> v_draws;
+		for(auto& expectation : v_expectations) {
+			v_draws.push_back(expectation.first);
+		}
+		XMMATRIX xm_clip_from_world = get_clip_from_world();
+		for(OcclusionIsa isa : get_supported_isas()) {
+			occlusion_culler::Culler culler;
+			occlusion_culler::init(culler, isa);
+			occlusion_culler::rasterize_occluders(culler, occluder_mesh, xm_clip_from_world);
+			vector<DrawInfo> v_visible_draws;
+			occlusion_culler::cull_draws(culler, xm_clip_from_world, v_draws, v_visible_draws);
+			uint32_t num_wrong_decisions = 0;
+			for(uint32_t draw_index = 0; draw_index < v_draws.size(); ++draw_index) {
+				num_wrong_decisions += (bool(culler.v_is_draw_visible[draw_index]) == v_expectations[draw_index].second) ? 0 : 1;
+			}
+			CHECK(num_wrong_decisions == 0);
+		}
+	}
+
+	// Against the supersampled reference the culler may only cull what is seen through gaps narrower than its pixels,
+	// and it culls nearly everything the reference culls
+	void test_city() {
+		occlusion_culler::OccluderMesh occluder_mesh;
+		vector<DrawInfo> v_draws;
+		XMMATRIX xm_clip_from_world;
+		make_city(32, occluder_mesh, v_draws, xm_clip_from_world);
+		XMMATRIX xm_transform = XMMatrixTranspose(xm_clip_from_world);
+
+		vector<uint8_t> v_sse_visibilities;
+		uint32_t num_isa_mismatches = 0;
+		for(OcclusionIsa isa : get_supported_isas()) {
+			occlusion_culler::Culler culler;
+			occlusion_culler::init(culler, isa);
+			occlusion_culler::rasterize_occluders(culler, occluder_mesh, xm_clip_from_world);
+			vector<DrawInfo> v_visible_draws;
+			uint32_t num_culled_draws = occlusion_culler::cull_draws(culler, xm_clip_from_world, v_draws, v_visible_draws);
+			if(isa != OCCLUSION_ISA_SSE) {
+				num_isa_mismatches += (culler.v_is_draw_visible == v_sse_visibilities) ? 0 : 1;
+				continue;
+			}
+			v_sse_visibilities = culler.v_is_draw_visible;
+
+			ReferenceDepthBuffer reference_buffer;
+			rasterize_reference(culler, reference_buffer);
+			uint32_t num_reference_culled_draws = 0;
+			uint32_t num_wrongly_culled_draws = 0;
+			for(uint32_t draw_index = 0; draw_index < v_draws.size(); ++draw_index) {
+				bool is_reference_visible = is_visible_reference(reference_buffer, xm_transform, v_draws[draw_index]);
+				num_reference_culled_draws += is_reference_visible ? 0 : 1;
+				num_wrongly_culled_draws += (is_reference_visible && !culler.v_is_draw_visible[draw_index]) ? 1 : 0;
+			}
+			uint32_t num_reference_visible_draws = static_cast<uint32_t>(v_draws.size()) - num_reference_culled_draws;
+			uint32_t num_kept_draws = num_reference_culled_draws + num_wrongly_culled_draws - num_culled_draws;
+			CHECK(num_reference_visible_draws > 0 && num_wrongly_culled_draws * 4 <= num_reference_visible_draws);
+			CHECK(num_kept_draws * 100 <= num_reference_culled_draws);
+		}
+		CHECK(num_isa_mismatches == 0);
+	}
+
+	void run() {
+		test_wall();
+		test_random_scenes();
+		test_city();
+	}
+} // namespace occlusion_culler_tests
@@ -0,0 +1,225 @@
+namespace pipeline_cache_tests
+{
+	const D3D12_INPUT_ELEMENT_DESC a_input_elements[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+
+	// A DXBC container only needs its magic and checksum to be hashed, the body is never parsed
+	vector<uint8_t> make_dxbc(uint64_t checksum, uint8_t body) {
+		vector<uint8_t> bytecode(32, body);
+		memcpy(bytecode.data(), "DXBC", 4);
+		memcpy(bytecode.data() + 4, &checksum, sizeof(checksum));
+		memcpy(bytecode.data() + 12, &checksum, sizeof(checksum));
+		return bytecode;
+	}
+
+	// Garbage in the padding between members must not reach the key, so every desc starts from a filled struct
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC make_graphics_desc(uint8_t padding_fill, const vector<uint8_t> &vs, const vector<uint8_t> &ps) {
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+		memset(&desc, padding_fill, sizeof(desc));
+		desc.pRootSignature = nullptr;
+		desc.VS = { vs.data(), vs.size() };
+		desc.PS = { ps.data(), ps.size() };
+		desc.DS = {};
+		desc.HS = {};
+		desc.GS = {};
+		desc.StreamOutput = {};
+		desc.BlendState = {};
+		for(auto& rt_blend : desc.BlendState.RenderTarget) {
+			rt_blend.SrcBlend = D3D12_BLEND_ONE;
+			rt_blend.DestBlend = D3D12_BLEND_ZERO;
+			rt_blend.BlendOp = D3D12_BLEND_OP_ADD;
+			rt_blend.SrcBlendAlpha = D3D12_BLEND_ONE;
+			rt_blend.DestBlendAlpha = D3D12_BLEND_ZERO;
+			rt_blend.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+			rt_blend.LogicOp = D3D12_LOGIC_OP_NOOP;
+			rt_blend.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+		}
+		desc.SampleMask = UINT_MAX;
+		desc.RasterizerState = {};
+		desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+		desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+		desc.RasterizerState.DepthClipEnable = TRUE;
+		desc.DepthStencilState = {};
+		desc.DepthStencilState.DepthEnable = TRUE;
+		desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+		desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+		desc.InputLayout = { a_input_elements, count_of(a_input_elements) };
+		desc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED;
+		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		desc.NumRenderTargets = 1;
+		for(auto& format : desc.RTVFormats) {
+			format = DXGI_FORMAT_UNKNOWN;
+		}
+		desc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+		desc.SampleDesc = { 1, 0 };
+		desc.NodeMask = 0;
+		desc.CachedPSO = {};
+		desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+		return desc;
+	}
+
+	void test_graphics_pipeline_key() {
+		auto vs = make_dxbc(0x1111, 0xAA);
+		auto ps = make_dxbc(0x2222, 0xBB);
+		auto desc = make_graphics_desc(0x00, vs, ps);
+		uint64_t key = pipeline_cache::compute_graphics_pipeline_key(desc, 1);
+
+		CHECK(pipeline_cache::compute_graphics_pipeline_key(make_graphics_desc(0xCD, vs, ps), 1) == key);
+		CHECK(pipeline_cache::compute_graphics_pipeline_key(desc, 2) != key);
+
+		// The key depends on the semantic names, not on where they are stored
+		string position_semantic = "POSITION";
+		D3D12_INPUT_ELEMENT_DESC a_copied_elements[count_of(a_input_elements)];
+		copy_n(a_input_elements, count_of(a_input_elements), a_copied_elements);
+		a_copied_elements[0].SemanticName = position_semantic.c_str();
+		auto copied_layout_desc = desc;
+		copied_layout_desc.InputLayout = { a_copied_elements, count_of(a_copied_elements) };
+		CHECK(pipeline_cache::compute_graphics_pipeline_key(copied_layout_desc, 1) == key);
+
+		// Unused render target formats are not part of the pipeline
+		auto unused_rt_desc = desc;
+		unused_rt_desc.RTVFormats[3] = DXGI_FORMAT_R8G8B8A8_UNORM;
+		CHECK(pipeline_cache::compute_graphics_pipeline_key(unused_rt_desc, 1) == key);
+
+		vector<function<void(D3D12_GRAPHICS_PIPELINE_STATE_DESC&)>> v_changes = {
+			[](auto &d) { d.RasterizerState.CullMode = D3D12_CULL_MODE_BACK; },
+			[](auto &d) { d.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_EQUAL; },
+			[](auto &d) { d.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO; },
+			[](auto &d) { d.BlendState.AlphaToCoverageEnable = TRUE; },
+			[](auto &d) { d.BlendState.RenderTarget[0].BlendEnable = TRUE; },
+			[](auto &d) { d.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM; },
+			[](auto &d) { d.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT; },
+			[](auto &d) { d.SampleDesc.Count = 8; },
+			[](auto &d) { d.NumRenderTargets = 2; },
+			[](auto &d) { d.InputLayout.NumElements = 1; },
+			[](auto &d) { d.PS = {}; },
+		};
+		vector<uint64_t> v_keys = { key };
+		for(auto& change : v_changes) {
+			auto changed_desc = desc;
+			change(changed_desc);
+			v_keys.push_back(pipeline_cache::compute_graphics_pipeline_key(changed_desc, 1));
+		}
+		sort(v_keys.begin(), v_keys.end());
+		CHECK(adjacent_find(v_keys.begin(), v_keys.end()) == v_keys.end());
+	}
+
+	void test_shader_hash() {
+		// DXBC shaders are identified by their checksum alone, anything else by its content
+		auto dxbc = make_dxbc(0x1234, 0x01);
+		auto same_checksum_dxbc = make_dxbc(0x1234, 0x02);
+		auto other_checksum_dxbc = make_dxbc(0x4321, 0x01);
+		CHECK(pipeline_cache::get_shader_hash({ dxbc.data(), dxbc.size() }) == pipeline_cache::get_shader_hash({ same_checksum_dxbc.data(), same_checksum_dxbc.size() }));
+		CHECK(pipeline_cache::get_shader_hash({ dxbc.data(), dxbc.size() }) != pipeline_cache::get_shader_hash({ other_checksum_dxbc.data(), other_checksum_dxbc.size() }));
+
+		vector<uint8_t> raw_a(32, 0x01), raw_b(32, 0x02);
+		CHECK(pipeline_cache::get_shader_hash({ raw_a.data(), raw_a.size() }) != pipeline_cache::get_shader_hash({ raw_b.data(), raw_b.size() }));
+		CHECK(pipeline_cache::get_shader_hash({ nullptr, 0 }) == 0);
+
+		D3D12_COMPUTE_PIPELINE_STATE_DESC compute_desc = {};
+		compute_desc.CS = { dxbc.data(), dxbc.size() };
+		uint64_t compute_key = pipeline_cache::compute_compute_pipeline_key(compute_desc, 1);
+		CHECK(pipeline_cache::compute_compute_pipeline_key(compute_desc, 2) != compute_key);
+		compute_desc.CS = { other_checksum_dxbc.data(), other_checksum_dxbc.size() };
+		CHECK(pipeline_cache::compute_compute_pipeline_key(compute_desc, 1) != compute_key);
+	}
+
+	void fill_cache(pipeline_cache::PipelineCache &cache) {
+		cache.device_hash = 0xDE71CE;
+		for(uint64_t key = 1; key <= 5; ++key) {
+			vector<uint8_t> blob(size_t(key * 37), uint8_t(key));
+			pipeline_cache::add_blob(cache, key * 0x9E3779B97F4A7C15ull, blob.data(), blob.size());
+		}
+	}
+
+	void test_serialize_round_trip() {
+		pipeline_cache::PipelineCache cache;
+		CHECK(!cache.is_dirty);
+		fill_cache(cache);
+		CHECK(cache.is_dirty);
+		auto data = pipeline_cache::serialize(cache);
+
+		pipeline_cache::PipelineCache loaded_cache;
+		loaded_cache.device_hash = cache.device_hash;
+		loaded_cache.is_dirty = true;
+		CHECK(pipeline_cache::deserialize(data.data(), data.size(), loaded_cache));
+		CHECK(loaded_cache.blobs == cache.blobs);
+		CHECK(!loaded_cache.is_dirty);
+
+		vector<uint8_t> blob;
+		uint64_t key = 3 * 0x9E3779B97F4A7C15ull;
+		CHECK(pipeline_cache::find_blob(loaded_cache, key, blob) && blob == cache.blobs[key]);
+		CHECK(!pipeline_cache::find_blob(loaded_cache, key + 1, blob));
+
+		pipeline_cache::PipelineCache empty_cache;
+		auto empty_data = pipeline_cache::serialize(empty_cache);
+		CHECK(pipeline_cache::deserialize(empty_data.data(), empty_data.size(), empty_cache) && empty_cache.blobs.empty());
+	}
+
+	// A rejected file leaves the cache as it was
+	void test_deserialize_rejects() {
+		pipeline_cache::PipelineCache cache;
+		fill_cache(cache);
+		auto data = pipeline_cache::serialize(cache);
+
+		auto is_rejected = [&](const vector<uint8_t> &file_data, uint64_t device_hash) {
+			pipeline_cache::PipelineCache loaded_cache;
+			loaded_cache.device_hash = device_hash;
+			uint8_t marker = 0x42;
+			pipeline_cache::add_blob(loaded_cache, 7, &marker, 1);
+			bool is_loaded = pipeline_cache::deserialize(file_data.data(), file_data.size(), loaded_cache);
+			return !is_loaded && loaded_cache.blobs.size() == 1 && loaded_cache.blobs.count(7) == 1;
+		};
+
+		CHECK(is_rejected(data, cache.device_hash + 1));
+		bool are_truncations_rejected = true;
+		for(size_t size = 0; size < data.size(); ++size) {
+			are_truncations_rejected &= is_rejected(vector<uint8_t>(data.begin(), data.begin() + size), cache.device_hash);
+		}
+		CHECK(are_truncations_rejected);
+		// Every byte but the header padding is covered by a check or by the payload hash
+		bool are_corruptions_rejected = true;
+		size_t padding_offset = offsetof(pipeline_cache::FileHeader, padding);
+		for(size_t offset = 0; offset < data.size(); ++offset) {
+			if(offset >= padding_offset && offset < padding_offset + sizeof(uint32_t)) { continue; }
+			auto corrupted_data = data;
+			corrupted_data[offset] ^= 0x10;
+			are_corruptions_rejected &= is_rejected(corrupted_data, cache.device_hash);
+		}
+		CHECK(are_corruptions_rejected);
+		// Trailing bytes are rejected even when the payload hash was written over them
+		auto extended_data = data;
+		extended_data.push_back(0);
+		pipeline_cache::FileHeader header;
+		memcpy(&header, extended_data.data(), sizeof(header));
+		header.payload_hash = pipeline_cache::hash_bytes(extended_data.data() + sizeof(header), extended_data.size() - sizeof(header));
+		memcpy(extended_data.data(), &header, sizeof(header));
+		CHECK(is_rejected(extended_data, cache.device_hash));
+	}
+
+	void test_save_load() {
+		const string file_address = "pipeline_cache_test.bin";
+		pipeline_cache::PipelineCache cache;
+		fill_cache(cache);
+		pipeline_cache::save(file_address, cache);
+		CHECK(!cache.is_dirty);
+
+		pipeline_cache::PipelineCache loaded_cache;
+		loaded_cache.device_hash = cache.device_hash;
+		CHECK(pipeline_cache::load(file_address, loaded_cache));
+		CHECK(loaded_cache.blobs == cache.blobs);
+		remove(file_address.c_str());
+		CHECK(!pipeline_cache::load(file_address, loaded_cache));
+	}
+
+	void run() {
+		test_graphics_pipeline_key();
+		test_shader_hash();
+		test_serialize_round_trip();
+		test_deserialize_rejects();
+		test_save_load();
+	}
+} // namespace pipeline_cache_tests
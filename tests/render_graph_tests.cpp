@@ -0,0 +1,248 @@
+namespace render_graph_tests
+{
+	using render_graph::Barrier;
+
+	// Replays the compiled barriers over a few frames and checks that every pass finds its resources in the states it declared,
+	// that every transition starts from the state the resource is really in and that the frame ends where it started
+	bool is_replay_valid(const render_graph::Graph &graph, const render_graph::CompiledGraph &compiled, uint32_t num_frames) {
+		uint32_t num_resources = static_cast<uint32_t>(graph.v_resources.size());
+		vector<D3D12_RESOURCE_STATES> v_states(num_resources);
+		for(uint32_t resource_index = 0; resource_index < num_resources; ++resource_index) {
+			auto& resource = graph.v_resources[resource_index];
+			v_states[resource_index] = resource.is_transient ? compiled.v_creation_states[resource_index] : resource.initial_state;
+		}
+
+		bool is_valid = true;
+		auto apply = [&](const Barrier &barrier) {
+			if(barrier.type != Barrier::TYPE_TRANSITION) { return; }
+			is_valid &= (v_states[barrier.resource_index] == barrier.state_before) && (barrier.state_before != barrier.state_after);
+			v_states[barrier.resource_index] = barrier.state_after;
+		};
+
+		vector<D3D12_RESOURCE_STATES> v_pass_states(num_resources);
+		vector<bool> v_is_written(num_resources);
+		for(uint32_t frame_index = 0; frame_index < num_frames; ++frame_index) {
+			for(uint32_t pass_index = 0; pass_index < graph.v_passes.size(); ++pass_index) {
+				auto& preamble = compiled.v_pass_preambles[pass_index];
+				for(auto& barrier : preamble.v_aliasing_barriers) {
+					apply(barrier);
+				}
+				for(uint32_t resource_index : preamble.v_discarded_resources) {
+					is_valid &= (v_states[resource_index] == graph.v_resources[resource_index].initialization_state);
+				}
+				for(auto& barrier : preamble.v_barriers) {
+					apply(barrier);
+				}
+
+				render_graph::get_pass_states(graph, pass_index, v_pass_states, v_is_written);
+				for(uint32_t resource_index = 0; resource_index < num_resources; ++resource_index) {
+					D3D12_RESOURCE_STATES needed_state = v_pass_states[resource_index];
+					if(needed_state == D3D12_RESOURCE_STATE_COMMON) { continue; }
+					D3D12_RESOURCE_STATES state = v_states[resource_index];
+					is_valid &= v_is_written[resource_index] ? (state == needed_state) : ((state & needed_state) == needed_state && render_graph::is_read_only(state));
+				}
+			}
+			for(auto& barrier : compiled.v_final_barriers) {
+				apply(barrier);
+			}
+			for(uint32_t resource_index = 0; resource_index < num_resources; ++resource_index) {
+				auto& resource = graph.v_resources[resource_index];
+				if(!resource.is_transient) {
+					is_valid &= (v_states[resource_index] == resource.final_state);
+					v_states[resource_index] = resource.initial_state;
+				}
+				else {
+					is_valid &= (v_states[resource_index] == compiled.v_creation_states[resource_index]);
+				}
+			}
+		}
+		return is_valid;
+	}
+
+	// Transient resources whose lifetimes overlap never share memory, and those that do share it start with an aliasing barrier.
+	// Lifetimes are recomputed here: from the first to the last pass, or the whole frame for a resource read before it is written.
+	bool is_placement_valid(const render_graph::Graph &graph, const render_graph::CompiledGraph &compiled) {
+		uint32_t num_resources = static_cast<uint32_t>(graph.v_resources.size());
+		uint32_t num_passes = static_cast<uint32_t>(graph.v_passes.size());
+		vector<uint32_t> v_begins(num_resources, render_graph::invalid_index), v_ends(num_resources, 0);
+		for(uint32_t pass_index = 0; pass_index < num_passes; ++pass_index) {
+			for(auto& access : graph.v_passes[pass_index].v_accesses) {
+				v_begins[access.resource_index] = min(v_begins[access.resource_index], pass_index);
+				v_ends[access.resource_index] = pass_index;
+			}
+		}
+
+		bool is_valid = true;
+		uint64_t total_size = 0;
+		vector<uint32_t> v_used;
+		for(uint32_t resource_index = 0; resource_index < num_resources; ++resource_index) {
+			auto& resource = graph.v_resources[resource_index];
+			if(!resource.is_transient || v_begins[resource_index] == render_graph::invalid_index) { continue; }
+			// Any write in the first pass counts, the graph combines the accesses of a pass
+			bool is_written_first = false;
+			for(auto& access : graph.v_passes[v_begins[resource_index]].v_accesses) {
+				is_written_first |= (access.resource_index == resource_index && access.is_write);
+			}
+			if(!is_written_first) {
+				v_begins[resource_index] = 0;
+				v_ends[resource_index] = num_passes - 1;
+			}
+			uint64_t offset = compiled.v_heap_offsets[resource_index];
+			is_valid &= (offset % resource.alignment == 0) && (offset + resource.size <= compiled.heap_size);
+			total_size += resource.size;
+			v_used.push_back(resource_index);
+		}
+		is_valid &= (compiled.heap_size <= compiled.unaliased_heap_size) && (total_size <= compiled.unaliased_heap_size);
+
+		for(uint32_t resource_index : v_used) {
+			uint64_t begin = compiled.v_heap_offsets[resource_index];
+			uint64_t end = begin + graph.v_resources[resource_index].size;
+			bool is_sharing = false;
+			for(uint32_t other_index : v_used) {
+				if(other_index == resource_index) { continue; }
+				uint64_t other_begin = compiled.v_heap_offsets[other_index];
+				uint64_t other_end = other_begin + graph.v_resources[other_index].size;
+				bool is_memory_overlapping = begin < other_end && other_begin < end;
+				bool is_lifetime_overlapping = v_begins[resource_index] <= v_ends[other_index] && v_begins[other_index] <= v_ends[resource_index];
+				is_valid &= !(is_memory_overlapping && is_lifetime_overlapping);
+				is_sharing |= is_memory_overlapping;
+			}
+			if(is_sharing) {
+				auto& v_aliasing_barriers = compiled.v_pass_preambles[v_begins[resource_index]].v_aliasing_barriers;
+				is_valid &= any_of(v_aliasing_barriers.begin(), v_aliasing_barriers.end(), [&](const Barrier &barrier) {
+					return barrier.type == Barrier::TYPE_ALIASING && barrier.resource_index == resource_index;
+				});
+			}
+		}
+		return is_valid;
+	}
+
+	uint32_t count_barriers(const render_graph::CompiledGraph &compiled, Barrier::Type type) {
+		uint32_t num_barriers = 0;
+		for(auto& preamble : compiled.v_pass_preambles) {
+			for(auto p_barriers : { &preamble.v_aliasing_barriers, &preamble.v_barriers }) {
+				num_barriers += static_cast<uint32_t>(count_if(p_barriers->begin(), p_barriers->end(), [type](const Barrier &barrier) { return barrier.type == type; }));
+			}
+		}
+		return num_barriers;
+	}
+
+	// The renderer's frame: scene into an MSAA target, resolve, then copy to the back buffer
+	void test_frame_graph() {
+		constexpr uint64_t mb{ 1024 * 1024 };
+		render_graph::Graph graph;
+		uint32_t back_buffer = render_graph::add_imported_resource(graph, "back_buffer", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+		uint32_t hdr_buffer = render_graph::add_transient_resource(graph, "hdr_buffer", 64 * mb, 4 * mb, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		uint32_t depth_buffer = render_graph::add_transient_resource(graph, "depth_buffer", 32 * mb, 4 * mb, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+		uint32_t hdr_buffer_resolved = render_graph::add_transient_resource(graph, "hdr_buffer_resolved", 8 * mb, 64 * 1024, D3D12_RESOURCE_STATE_COMMON);
+
+		uint32_t scene_pass = render_graph::add_pass(graph, "scene");
+		render_graph::write(graph, scene_pass, hdr_buffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		render_graph::write(graph, scene_pass, depth_buffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+		uint32_t resolve_pass = render_graph::add_pass(graph, "resolve");
+		render_graph::read(graph, resolve_pass, hdr_buffer, D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
+		render_graph::write(graph, resolve_pass, hdr_buffer_resolved, D3D12_RESOURCE_STATE_RESOLVE_DEST);
+		uint32_t final_pass = render_graph::add_pass(graph, "final");
+		render_graph::read(graph, final_pass, hdr_buffer_resolved, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		render_graph::write(graph, final_pass, back_buffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+		auto compiled = render_graph::compile(graph);
+		CHECK(is_replay_valid(graph, compiled, 3));
+		CHECK(is_placement_valid(graph, compiled));
+		// The depth buffer is dead after the scene pass, the resolved buffer can take its memory
+		CHECK(compiled.heap_size < compiled.unaliased_heap_size);
+		CHECK(compiled.v_last_pass_indices[depth_buffer] == scene_pass && compiled.v_first_pass_indices[hdr_buffer_resolved] == resolve_pass);
+		CHECK(compiled.v_final_barriers.size() == 1 && compiled.v_final_barriers[0].resource_index == back_buffer);
+	}
+
+	// Passes that only read share one transition, consecutive UAV writes are separated by UAV barriers instead of transitions
+	void test_barrier_merging() {
+		render_graph::Graph graph;
+		uint32_t buffer = render_graph::add_transient_resource(graph, "buffer", 1024, 256, D3D12_RESOURCE_STATE_COMMON);
+		uint32_t write_pass = render_graph::add_pass(graph, "write");
+		render_graph::write(graph, write_pass, buffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		uint32_t second_write_pass = render_graph::add_pass(graph, "second_write");
+		render_graph::write(graph, second_write_pass, buffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		for(auto read_state : { D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE }) {
+			uint32_t read_pass = render_graph::add_pass(graph, "read");
+			render_graph::read(graph, read_pass, buffer, read_state);
+		}
+
+		auto compiled = render_graph::compile(graph);
+		CHECK(is_replay_valid(graph, compiled, 2));
+		CHECK(count_barriers(compiled, Barrier::TYPE_UAV) == 1);
+		CHECK(compiled.v_pass_preambles[2].v_barriers.size() == 1);
+		CHECK(compiled.v_pass_preambles[3].v_barriers.empty() && compiled.v_pass_preambles[4].v_barriers.empty());
+		auto& transition = compiled.v_pass_preambles[2].v_barriers[0];
+		CHECK(transition.state_after == (D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_COPY_SOURCE));
+	}
+
+	void test_invalid_accesses() {
+		render_graph::Graph graph;
+		uint32_t buffer = render_graph::add_transient_resource(graph, "buffer", 1024, 256, D3D12_RESOURCE_STATE_COMMON);
+		uint32_t pass = render_graph::add_pass(graph, "pass");
+		auto is_throwing = [](auto function) {
+			try { function(); }
+			catch(const exception&) { return true; }
+			return false;
+		};
+		CHECK(is_throwing([&] { render_graph::read(graph, pass, buffer, D3D12_RESOURCE_STATE_RENDER_TARGET); }));
+		CHECK(is_throwing([&] { render_graph::write(graph, pass, buffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE); }));
+		render_graph::read(graph, pass, buffer + 1, D3D12_RESOURCE_STATE_COPY_SOURCE);
+		CHECK(is_throwing([&] { render_graph::compile(graph); }));
+	}
+
+	// Random graphs of transient and imported resources, including ones read before they are written
+	void test_random_graphs() {
+		const D3D12_RESOURCE_STATES a_read_states[] = { D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RESOLVE_SOURCE };
+		const D3D12_RESOURCE_STATES a_write_states[] = { D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_DEPTH_WRITE };
+		const D3D12_RESOURCE_STATES a_initialization_states[] = { D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_DEPTH_WRITE };
+		mt19937 generator(31);
+		uint32_t num_invalid_replays = 0;
+		uint32_t num_invalid_placements = 0;
+		for(uint32_t graph_index = 0; graph_index < 500; ++graph_index) {
+			render_graph::Graph graph;
+			uint32_t num_resources = 1 + generator() % 8;
+			for(uint32_t resource_index = 0; resource_index < num_resources; ++resource_index) {
+				if(generator() % 4 == 0) {
+					auto state = a_read_states[generator() % count_of(a_read_states)];
+					render_graph::add_imported_resource(graph, "imported", state, (generator() % 2) ? state : D3D12_RESOURCE_STATE_PRESENT);
+				}
+				else {
+					uint64_t alignment = uint64_t(1) << (8 + generator() % 8);
+					render_graph::add_transient_resource(graph, "transient", alignment * (1 + generator() % 16), alignment, a_initialization_states[generator() % count_of(a_initialization_states)]);
+				}
+			}
+			uint32_t num_passes = 1 + generator() % 10;
+			for(uint32_t pass_index = 0; pass_index < num_passes; ++pass_index) {
+				render_graph::add_pass(graph, "pass");
+				uint32_t num_accesses = 1 + generator() % 3;
+				for(uint32_t access_index = 0; access_index < num_accesses; ++access_index) {
+					uint32_t resource_index = generator() % num_resources;
+					auto& v_accesses = graph.v_passes[pass_index].v_accesses;
+					// A pass either reads or writes a resource, the way the renderer declares them
+					if(any_of(v_accesses.begin(), v_accesses.end(), [&](const render_graph::Access &access) { return access.resource_index == resource_index; })) { continue; }
+					if(generator() % 2) {
+						render_graph::read(graph, pass_index, resource_index, a_read_states[generator() % count_of(a_read_states)]);
+					}
+					else {
+						render_graph::write(graph, pass_index, resource_index, a_write_states[generator() % count_of(a_write_states)]);
+					}
+				}
+			}
+
+			auto compiled = render_graph::compile(graph);
+			num_invalid_replays += is_replay_valid(graph, compiled, 3) ? 0 : 1;
+			num_invalid_placements += is_placement_valid(graph, compiled) ? 0 : 1;
+		}
+		CHECK(num_invalid_replays == 0);
+		CHECK(num_invalid_placements == 0);
+	}
+
+	void run() {
+		test_frame_graph();
+		test_barrier_merging();
+		test_invalid_accesses();
+		test_random_graphs();
+	}
+} // namespace render_graph_tests
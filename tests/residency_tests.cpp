@@ -0,0 +1,150 @@
+namespace residency_tests
+{
+	// What the device would hold: decisions are applied to it the way the renderer calls MakeResident and Evict
+	struct Device {
+		vector<bool> v_is_resident;
+		uint64_t resident_size;
+	};
+
+	struct FrameChecks {
+		uint32_t num_invalid_decisions;
+		uint32_t num_unresident_uses;
+		uint32_t num_protected_evictions;
+		uint32_t num_out_of_order_evictions;
+		uint32_t num_needless_evictions;
+		uint32_t num_missed_evictions;
+	};
+
+	// Runs one frame that uses v_used_indices against the budget and checks the decisions against the policy
+	void run_frame(residency::Manager &manager, Device &device, const vector<uint32_t> &v_used_indices, uint64_t budget, FrameChecks &checks) {
+		for(uint32_t pageable_index : v_used_indices) {
+			residency::mark_used(manager, pageable_index);
+		}
+		uint64_t frame = manager.current_frame;
+		uint64_t resident_size_before_evictions = device.resident_size;
+		for(uint32_t pageable_index = 0; pageable_index < manager.v_pageables.size(); ++pageable_index) {
+			auto& pageable = manager.v_pageables[pageable_index];
+			if(pageable.is_registered && !pageable.is_resident && pageable.last_used_frame == frame) {
+				resident_size_before_evictions += pageable.size;
+			}
+		}
+
+		auto decisions = residency::update(manager, budget);
+		for(uint32_t pageable_index : decisions.v_make_resident_indices) {
+			checks.num_invalid_decisions += device.v_is_resident[pageable_index] ? 1 : 0;
+			device.v_is_resident[pageable_index] = true;
+			device.resident_size += manager.v_pageables[pageable_index].size;
+		}
+		uint64_t latest_evicted_frame = 0;
+		for(uint32_t pageable_index : decisions.v_evict_indices) {
+			auto& pageable = manager.v_pageables[pageable_index];
+			checks.num_invalid_decisions += device.v_is_resident[pageable_index] ? 0 : 1;
+			checks.num_protected_evictions += (!pageable.is_evictable || pageable.last_used_frame + manager.num_frames_in_flight > frame) ? 1 : 0;
+			latest_evicted_frame = max(latest_evicted_frame, pageable.last_used_frame);
+			device.v_is_resident[pageable_index] = false;
+			device.resident_size -= pageable.size;
+		}
+		checks.num_invalid_decisions += (device.resident_size == manager.resident_size) ? 0 : 1;
+
+		// Only as much as the budget asks for is evicted, least recently used first, and nothing evictable is left while over budget
+		if(!decisions.v_evict_indices.empty()) {
+			auto& last_evicted = manager.v_pageables[decisions.v_evict_indices.back()];
+			checks.num_needless_evictions += (resident_size_before_evictions > budget && device.resident_size + last_evicted.size > budget) ? 0 : 1;
+		}
+		for(uint32_t pageable_index = 0; pageable_index < manager.v_pageables.size(); ++pageable_index) {
+			auto& pageable = manager.v_pageables[pageable_index];
+			if(!pageable.is_registered) { continue; }
+			checks.num_invalid_decisions += (device.v_is_resident[pageable_index] == pageable.is_resident) ? 0 : 1;
+			checks.num_unresident_uses += (pageable.last_used_frame == frame && !pageable.is_resident) ? 1 : 0;
+			bool is_candidate = pageable.is_resident && pageable.is_evictable && pageable.last_used_frame + manager.num_frames_in_flight <= frame;
+			if(is_candidate) {
+				checks.num_out_of_order_evictions += (pageable.last_used_frame < latest_evicted_frame) ? 1 : 0;
+				checks.num_missed_evictions += (device.resident_size > budget) ? 1 : 0;
+			}
+		}
+	}
+
+	// Pageables of random sizes, a working set that drifts over them and a budget that moves like the simulated budget slider does
+	void test_simulated_budget() {
+		constexpr uint32_t num_pageables{ 64 };
+		constexpr uint64_t mb{ 1024 * 1024 };
+		mt19937 generator(36);
+		residency::Manager manager;
+		residency::init(manager, max_inflight_frame_count);
+		Device device = {};
+		uint64_t total_size = 0;
+		for(uint32_t pageable_index = 0; pageable_index < num_pageables; ++pageable_index) {
+			uint64_t size = (1 + generator() % 64) * mb;
+			bool is_evictable = (generator() % 8) != 0;
+			CHECK(residency::add_pageable(manager, size, is_evictable) == pageable_index);
+			device.v_is_resident.push_back(true);
+			device.resident_size += size;
+			total_size += size;
+		}
+
+		FrameChecks checks = {};
+		uint32_t working_set_begin = 0;
+		for(uint32_t frame_index = 0; frame_index < 2000; ++frame_index) {
+			if(frame_index % 50 == 0) {
+				working_set_begin = generator() % num_pageables;
+			}
+			vector<uint32_t> v_used_indices;
+			for(uint32_t offset = 0; offset < 12; ++offset) {
+				if(generator() % 4 != 0) {
+					v_used_indices.push_back((working_set_begin + offset) % num_pageables);
+				}
+			}
+			uint64_t budget = (frame_index / 100 % 2) ? total_size : (generator() % 8 + 1) * total_size / 16;
+			run_frame(manager, device, v_used_indices, budget, checks);
+		}
+		CHECK(checks.num_invalid_decisions == 0);
+		CHECK(checks.num_unresident_uses == 0);
+		CHECK(checks.num_protected_evictions == 0);
+		CHECK(checks.num_out_of_order_evictions == 0);
+		CHECK(checks.num_needless_evictions == 0);
+		CHECK(checks.num_missed_evictions == 0);
+		CHECK(manager.num_evictions > 0 && manager.num_make_residents > 0);
+
+		auto statistics = residency::get_statistics(manager);
+		uint32_t num_resident_pageables = static_cast<uint32_t>(count(device.v_is_resident.begin(), device.v_is_resident.end(), true));
+		CHECK(statistics.num_pageables == num_pageables && statistics.num_resident_pageables == num_resident_pageables);
+		CHECK(statistics.resident_size == device.resident_size && statistics.registered_size == total_size);
+	}
+
+	// A budget of zero still keeps what the last frames used, and uses outside of the frame bring evicted pageables back
+	void test_protection() {
+		residency::Manager manager;
+		residency::init(manager, 2);
+		uint32_t a = residency::add_pageable(manager, 100, true);
+		uint32_t b = residency::add_pageable(manager, 200, true);
+		uint32_t pinned = residency::add_pageable(manager, 300, false);
+
+		auto decisions = residency::update(manager, 0);
+		CHECK(decisions.v_evict_indices.empty());
+		residency::mark_used(manager, a);
+		decisions = residency::update(manager, 0);
+		CHECK(decisions.v_evict_indices.empty());
+		decisions = residency::update(manager, 0);
+		CHECK(decisions.v_evict_indices == vector<uint32_t>{ b });
+		decisions = residency::update(manager, 0);
+		CHECK(decisions.v_evict_indices == vector<uint32_t>{ a });
+		CHECK(manager.v_pageables[pinned].is_resident && manager.resident_size == 300);
+
+		CHECK(residency::mark_used_now(manager, b));
+		CHECK(!residency::mark_used_now(manager, b));
+		CHECK(manager.resident_size == 500);
+		residency::mark_used(manager, a);
+		decisions = residency::update(manager, 1000);
+		CHECK(decisions.v_make_resident_indices == vector<uint32_t>{ a } && decisions.v_evict_indices.empty());
+
+		residency::remove_pageable(manager, b);
+		CHECK(manager.resident_size == 400 && manager.registered_size == 400);
+		CHECK(residency::add_pageable(manager, 50, true) == b);
+		CHECK(residency::get_statistics(manager).num_pageables == 3);
+	}
+
+	void run() {
+		test_simulated_budget();
+		test_protection();
+	}
+} // namespace residency_tests
@@ -0,0 +1,116 @@
+#define _SILENCE_ALL_CXX17_DEPRECATION_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../source/external/tiny_gltf/tiny_gltf.h"
+#include "../source/external/dear_imgui/imgui.h"
+#include "../source/external/octarine/octarine_image.h"
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+#include <wrl.h>
+
+#include <dxgi1_6.h>
+#include <d3d12.h>
+#include <DirectXMath.h>
+#include <intrin.h>
+
+#include <iostream>
+#include <exception>
+#include <vector>
+#include <array>
+#include <fstream>
+#include <future>
+#include <map>
+#include <set>
+#include <tuple>
+#include <chrono>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <atomic>
+#include <string_view>
+#include <random>
+
+using Microsoft::WRL::ComPtr;
+using namespace DirectX;
+using namespace std;
+
+// Host-side tests of the modules that do their work without a device, the D3D12 headers only provide their types
+#include "../source/common.cpp"
+#include "../source/job_system.cpp"
+#include "../source/draw_sort.cpp"
+#include "../source/draw_cull.cpp"
+#include "../source/occlusion_culler.cpp"
+#include "../source/mesh_simplifier.cpp"
+#include "../source/meshlet_builder.cpp"
+#include "../source/pipeline_cache.cpp"
+#include "../source/render_graph.cpp"
+#include "../source/heap_allocator.cpp"
+#include "../source/residency.cpp"
+#include "../source/gltf_loader.cpp"
+#include "../source/image_stream.cpp"
+
+namespace test
+{
+	uint32_t num_checks{ 0 };
+	uint32_t num_failed_checks{ 0 };
+
+	void check(bool condition, const char *p_expression, const char *p_file, int line) {
+		num_checks++;
+		if(!condition) {
+			num_failed_checks++;
+			cout << p_file << "(" << line << "): check failed: " << p_expression << endl;
+		}
+	}
+} // namespace test
+
+#define CHECK(x) test::check((x), #x, __FILE__, __LINE__)
+
+#include "draw_cull_tests.cpp"
+#include "pipeline_cache_tests.cpp"
+#include "render_graph_tests.cpp"
+#include "heap_allocator_tests.cpp"
+#include "residency_tests.cpp"
+#include "gltf_loader_tests.cpp"
+#include "image_stream_tests.cpp"
+#include "job_system_tests.cpp"
+#include "occlusion_culler_tests.cpp"
+#include "mesh_simplifier_tests.cpp"
+#include "meshlet_builder_tests.cpp"
+
+int main() {
+	pair<const char*, function<void()>> a_suites[] = {
+		{ "draw_cull", draw_cull_tests::run },
+		{ "pipeline_cache", pipeline_cache_tests::run },
+		{ "render_graph", render_graph_tests::run },
+		{ "heap_allocator", heap_allocator_tests::run },
+		{ "residency", residency_tests::run },
+		{ "gltf_loader", gltf_loader_tests::run },
+		{ "image_stream", image_stream_tests::run },
+		{ "job_system", job_system_tests::run },
+		{ "occlusion_culler", occlusion_culler_tests::run },
+		{ "mesh_simplifier", mesh_simplifier_tests::run },
+		{ "meshlet_builder", meshlet_builder_tests::run },
+	};
+
+	for(auto& [p_name, run] : a_suites) {
+		uint32_t num_failed_checks = test::num_failed_checks;
+		try {
+			run();
+		}
+		catch(const exception &e) {
+			test::num_failed_checks++;
+			cout << p_name << ": unexpected exception: " << e.what() << endl;
+		}
+		cout << p_name << ": " << ((test::num_failed_checks == num_failed_checks) ? "passed" : "FAILED") << endl;
+	}
+	cout << test::num_checks << " checks, " << test::num_failed_checks << " failed" << endl;
+	return (test::num_failed_checks == 0) ? 0 : 1;
+}